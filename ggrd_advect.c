@@ -0,0 +1,100 @@
+#include "hc.h"
+/*
+
+
+advect tracers in a (time-dependent) velocity field as read by
+ggrd_read_vel_grids, see ggrd_tracer.c
+
+tracer files are binary, the number of tracers as int, then lon, lat,
+depth [km] as doubles for each tracer
+
+with -v as the first argument, progress is printed to stderr
+
+
+*/
+
+int main(int argc, char **argv)
+{
+  struct ggrd_master *ggrd;
+  struct ggrd_tracer tr[1];
+  GGRD_CPREC *x,t0,t1,dt,dtrange,budget;
+  int n,rk_order,order,history,nfail;
+  ggrd_boolean verbose = FALSE;
+  /*
+     deal with parameters
+  */
+  dt = 1.0;
+  rk_order = 4;
+  history = 0;
+  order = 3;
+  dtrange = 1.0;
+  budget = 0.0;
+  if((argc > 1)&&(strcmp(argv[1],"-v")==0)){ /* verbose, drop the flag */
+    verbose = TRUE;
+    argv[1] = argv[0];
+    argv++;argc--;
+  }
+  if((argc < 6)||(argc > 12)){
+    fprintf(stderr,"%s: usage\n%s [-v] vel_prefix tracer.in tracer.out t_start t_stop [dt, %g] [rk, %i] [history, %i] [order, %i] [dtrange, %g] [budget, %g]\n\n",
+	    argv[0],argv[0],dt,rk_order,history,order,dtrange,budget);
+    fprintf(stderr,"advects tracers from tracer.in from time t_start to t_stop and writes them to tracer.out\n");
+    fprintf(stderr,"vel_prefix: directory with the velocity grids vr.i.grd, vt.i.grd, vp.i.grd [cm/yr]\n");
+    fprintf(stderr,"\tand the depth file, e.g. ./\n");
+    fprintf(stderr,"tracer files: binary, number of tracers as int, then lon lat depth[km] as doubles\n");
+    fprintf(stderr,"dt: maximum time step [Myr], steps will be equal\n");
+    fprintf(stderr,"rk: Runge Kutta order, 2 or 4\n");
+    fprintf(stderr,"history: if 1, read velocity stages from 1/, 2/, ... and the time history file\n");
+    fprintf(stderr,"order: polynomial interpolation order\n");
+    fprintf(stderr,"dtrange: transition width between velocity stages [Myr]\n");
+    fprintf(stderr,"budget: if > 0, memory for velocity stages [MB], stages are then read when needed\n");
+    fprintf(stderr,"-v: print progress to stderr\n");
+    exit(-1);
+  }
+  sscanf(argv[4],"%lf",&t0);
+  sscanf(argv[5],"%lf",&t1);
+  if(argc > 6)
+    sscanf(argv[6],"%lf",&dt);
+  if(argc > 7)
+    sscanf(argv[7],"%i",&rk_order);
+  if(argc > 8)
+    sscanf(argv[8],"%i",&history);
+  if(argc > 9)
+    sscanf(argv[9],"%i",&order);
+  if(argc > 10)
+    sscanf(argv[10],"%lf",&dtrange);
+  if(argc > 11)
+    sscanf(argv[11],"%lf",&budget);
+  /*
+     initialize velocity structure
+  */
+  ggrd = (struct ggrd_master *)calloc(1,sizeof(struct ggrd_master));
+  if(!ggrd)
+    HC_MEMERROR("ggrd_advect");
+  ggrd_init_master(ggrd);
+  ggrd->v.history = (history)?(TRUE):(FALSE);
+  if(budget > 0)		/* load stages lazily, and prefetch */
+    ggrd_vel_set_lazy(ggrd,budget,TRUE);
+  if(ggrd_read_vel_grids(ggrd,1.0,verbose,TRUE,argv[1],FALSE)){
+    fprintf(stderr,"%s: error reading velocities from %s\n",argv[0],argv[1]);
+    exit(-1);
+  }
+  if(ggrd_tracer_init(tr,ggrd,order,dtrange,verbose))
+    exit(-1);
+  /*
+     tracers
+  */
+  ggrd_tracer_read_bin(argv[2],&x,&n);
+  if(verbose)
+    fprintf(stderr,"%s: read %i tracers from %s\n",argv[0],n,argv[2]);
+  nfail = ggrd_tracer_advect(tr,ggrd,x,n,t0,t1,dt,rk_order,verbose);
+  ggrd_vel_prefetch_wait(ggrd);
+  if(verbose && ggrd->v.cache.lazy)
+    fprintf(stderr,"%s: read %i velocity stages\n",argv[0],ggrd->v.cache.nload);
+  if(nfail)
+    fprintf(stderr,"%s: WARNING: %i tracer steps failed\n",argv[0],nfail);
+  ggrd_tracer_write_bin(argv[3],x,n);
+  if(verbose)
+    fprintf(stderr,"%s: written %i tracers to %s\n",argv[0],n,argv[3]);
+  free(x);
+  return 0;
+}
@@ -10,6 +10,9 @@
 #define GGRD_MAX_ORDERP1 (GGRD_MAX_ORDER+1)
 #define GGRD_MAX_IORDERP1 (GGRD_MAX_IORDER+1)
 
+/* max digit width of the radix sort for batched grd interpolation */
+#define GGRD_RADIX_BITS 22
+
 #ifndef GGRD_CPREC			/* 
 				   precision for most C functions
 				*/
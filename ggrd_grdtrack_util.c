@@ -20,6 +20,15 @@
 #include <math.h>
 #include <string.h>
 #include <math.h>
+/* 
+   cursor of ggrd_grdtrack_interpolate, which only gets a BCR
+   structure, and the data it was used for last, per thread
+*/
+static struct ggrd_cursor ggrd_legacy_cur;
+static float *ggrd_legacy_f = NULL;
+#ifdef _OPENMP
+#pragma omp threadprivate(ggrd_legacy_cur,ggrd_legacy_f)
+#endif
 
 void ggrd_init_master(struct ggrd_master *ggrd)
 {
@@ -159,6 +168,7 @@ int ggrd_grdtrack_init_general(ggrd_boolean is_three,
     }
   }
   g->init = TRUE;
+  ggrd_cursor_init(&g->cur,g);
   return 0;
 }
 
@@ -192,6 +202,7 @@ int ggrd_grdtrack_rescale(struct ggrd_gt *g,
 	g->f[k] *= scale;
     }
   }
+  ggrd_cursor_init(&g->cur,g);	/* drop the old nodal values */
   return 0;
 }
 
@@ -203,11 +214,12 @@ for 3-D spherical
    interpolation wrapper, uses r, theta, phi input. return value and TRUE if success,
    undefined and FALSE else
 */
-ggrd_boolean ggrd_grdtrack_interpolate_rtp(double r,double t,double p,
+ggrd_boolean ggrd_grdtrack_interpolate_rtp_r(double r,double t,double p,
 					   struct ggrd_gt *g,
 					   double *value,
 					   ggrd_boolean verbose,
-					   ggrd_boolean shift_to_pos_lon)
+					   ggrd_boolean shift_to_pos_lon,
+					   struct ggrd_cursor *cur)
 {
   double x[3];
   ggrd_boolean result;
@@ -235,10 +247,10 @@ ggrd_boolean ggrd_grdtrack_interpolate_rtp(double r,double t,double p,
   if(g->zlevels_are_negative)	/* adjust for depth */
     x[2] = -x[2];
 
-  result = ggrd_grdtrack_interpolate(x,TRUE,g->grd,g->f,
+  result = ggrd_grdtrack_interpolate_cursor(x,TRUE,g->grd,g->f,
 				     g->edgeinfo,g->mm,g->z,
 				     g->nz,value,verbose,
-				     g->loc_bcr);
+				     cur);
   return result;
 }
 
@@ -247,10 +259,11 @@ ggrd_boolean ggrd_grdtrack_interpolate_rtp(double r,double t,double p,
 this is almost redundant, use lon lat in degrees and z in [km] depth
 
 */
-ggrd_boolean ggrd_grdtrack_interpolate_lonlatz(double lon,double lat,double z,
+ggrd_boolean ggrd_grdtrack_interpolate_lonlatz_r(double lon,double lat,double z,
 					       struct ggrd_gt *g,
 					       double *value,
-					       ggrd_boolean verbose)
+					       ggrd_boolean verbose,
+					       struct ggrd_cursor *cur)
 {
   double x[3];
   ggrd_boolean result;
@@ -271,10 +284,10 @@ ggrd_boolean ggrd_grdtrack_interpolate_lonlatz(double lon,double lat,double z,
   if(g->zlevels_are_negative)	/* adjust for depth */
     x[2] = -x[2];
   
-  result = ggrd_grdtrack_interpolate(x,TRUE,g->grd,g->f,
+  result = ggrd_grdtrack_interpolate_cursor(x,TRUE,g->grd,g->f,
 				     g->edgeinfo,g->mm,g->z,
 				     g->nz,value,verbose,
-				     g->loc_bcr);
+				     cur);
   return result;
 }
 
@@ -286,11 +299,12 @@ ggrd_boolean ggrd_grdtrack_interpolate_lonlatz(double lon,double lat,double z,
    undefined and FALSE else
    this mean lon lat z
 */
-ggrd_boolean ggrd_grdtrack_interpolate_xyz(double x,double y,
+ggrd_boolean ggrd_grdtrack_interpolate_xyz_r(double x,double y,
 					   double z,
 					   struct ggrd_gt *g,
 					   double *value,
-					   ggrd_boolean verbose)
+					   ggrd_boolean verbose,
+					   struct ggrd_cursor *cur)
 {
   double xloc[3];
   ggrd_boolean result;
@@ -310,10 +324,10 @@ ggrd_boolean ggrd_grdtrack_interpolate_xyz(double x,double y,
   xloc[2] = z;	/* depth, z*/
   if(g->zlevels_are_negative)	/* adjust for depth */
     xloc[2] = -xloc[2];
-  result = ggrd_grdtrack_interpolate(xloc,TRUE,g->grd,g->f,
+  result = ggrd_grdtrack_interpolate_cursor(xloc,TRUE,g->grd,g->f,
 				     g->edgeinfo,g->mm,g->z,
 				     g->nz,value,verbose,
-				     g->loc_bcr);
+				     cur);
   return result;
 }
 
@@ -326,11 +340,12 @@ return value and TRUE if success,
 undefined and FALSE else
 
 */
-ggrd_boolean ggrd_grdtrack_interpolate_tp(double t,double p,
+ggrd_boolean ggrd_grdtrack_interpolate_tp_r(double t,double p,
 					  struct ggrd_gt *g,
 					  double *value,
 					  ggrd_boolean verbose,
-					  ggrd_boolean shift_to_pos_lon)
+					  ggrd_boolean shift_to_pos_lon,
+					  struct ggrd_cursor *cur)
 {
   double x[3];
   ggrd_boolean result;
@@ -354,9 +369,9 @@ ggrd_boolean ggrd_grdtrack_interpolate_tp(double t,double p,
   }
   x[1] = 90.0 - t * ONEEIGHTYOVERPI; /* lat */
   x[2] = 1.0;
-  result = ggrd_grdtrack_interpolate(x,FALSE,g->grd,g->f,
+  result = ggrd_grdtrack_interpolate_cursor(x,FALSE,g->grd,g->f,
 				     g->edgeinfo,g->mm,g->z,g->nz,
-				     value,verbose,g->loc_bcr);
+				     value,verbose,cur);
   return result;
 }
 
@@ -367,10 +382,11 @@ ggrd_boolean ggrd_grdtrack_interpolate_tp(double t,double p,
    return value and TRUE if success,
    undefined and FALSE else
 */
-ggrd_boolean ggrd_grdtrack_interpolate_xy(double xin,double yin,
+ggrd_boolean ggrd_grdtrack_interpolate_xy_r(double xin,double yin,
 					   struct ggrd_gt *g,
 					   double *value,
-					   ggrd_boolean verbose)
+					   ggrd_boolean verbose,
+					   struct ggrd_cursor *cur)
 {
   double x[3];
   ggrd_boolean result;
@@ -385,14 +401,256 @@ ggrd_boolean ggrd_grdtrack_interpolate_xy(double xin,double yin,
   x[0] = xin;
   x[1] = yin;
   x[2] = 0.0;
-  result = ggrd_grdtrack_interpolate(x,FALSE,g->grd,g->f,g->edgeinfo,
+  result = ggrd_grdtrack_interpolate_cursor(x,FALSE,g->grd,g->f,g->edgeinfo,
 				     g->mm,g->z,g->nz,value,verbose,
-				     g->loc_bcr);
+				     cur);
   return result;
 }
 
 /* 
 
+the same wrappers without a cursor, which use the default cursor of
+g, such that consecutive calls reuse the nodal values. those are not
+reentrant, threads which share g should use the _r versions with
+their own cursor
+
+*/
+ggrd_boolean ggrd_grdtrack_interpolate_rtp(double r,double t,double p,
+					   struct ggrd_gt *g,
+					   double *value,
+					   ggrd_boolean verbose,
+					   ggrd_boolean shift_to_pos_lon)
+{
+  return ggrd_grdtrack_interpolate_rtp_r(r,t,p,g,value,verbose,
+					 shift_to_pos_lon,&g->cur);
+}
+ggrd_boolean ggrd_grdtrack_interpolate_lonlatz(double lon,double lat,double z,
+					       struct ggrd_gt *g,
+					       double *value,
+					       ggrd_boolean verbose)
+{
+  return ggrd_grdtrack_interpolate_lonlatz_r(lon,lat,z,g,value,verbose,&g->cur);
+}
+ggrd_boolean ggrd_grdtrack_interpolate_xyz(double x,double y,
+					   double z,
+					   struct ggrd_gt *g,
+					   double *value,
+					   ggrd_boolean verbose)
+{
+  return ggrd_grdtrack_interpolate_xyz_r(x,y,z,g,value,verbose,&g->cur);
+}
+ggrd_boolean ggrd_grdtrack_interpolate_tp(double t,double p,
+					  struct ggrd_gt *g,
+					  double *value,
+					  ggrd_boolean verbose,
+					  ggrd_boolean shift_to_pos_lon)
+{
+  return ggrd_grdtrack_interpolate_tp_r(t,p,g,value,verbose,
+					shift_to_pos_lon,&g->cur);
+}
+ggrd_boolean ggrd_grdtrack_interpolate_xy(double xin,double yin,
+					   struct ggrd_gt *g,
+					   double *value,
+					   ggrd_boolean verbose)
+{
+  return ggrd_grdtrack_interpolate_xy_r(xin,yin,g,value,verbose,&g->cur);
+}
+/* 
+
+initialize an interpolation cursor for grid g, which has to be
+initialized. a cursor holds all state which changes during
+interpolation, g is only read. threads which interpolate from the
+same g concurrently each need their own cursor, e.g.
+
+#pragma omp parallel private(cur)
+  {
+    ggrd_cursor_init(&cur,g);
+#pragma omp for
+    for(i=0;i < n;i++)
+      ggrd_grdtrack_interpolate_tp_r(t[i],p[i],g,(value+i),FALSE,FALSE,&cur);
+  }
+
+consecutive points in the same cell reuse the nodal values, and
+consecutive depths between the same layers the layer search
+
+*/
+void ggrd_cursor_init(struct ggrd_cursor *cur,struct ggrd_gt *g)
+{
+  cur->bcr[0] = cur->bcr[1] = g->loc_bcr[0];
+  cur->bcr[0].i = cur->bcr[0].j = cur->bcr[1].i = cur->bcr[1].j = -1;
+  cur->i1 = -1;
+  cur->zwarned = FALSE;
+}
+/* 
+
+batched interpolation of n points, lon and lat in degrees, and, for
+3-D grids, z in [km] as for ggrd_grdtrack_interpolate_lonlatz (z is
+ignored and may be NULL for 2-D grids)
+
+the points are sorted by layer and grid cell, such that the nodal
+values of the bicubic interpolation get reused by all points in the
+same cell, and the layers are found by bisection. the two layers
+use the nodal value caches of a local cursor, g is left untouched,
+such that this can be called from several threads. the depth blend
+is done for all points at the end
+
+on return, value[n] and valid[n] are in the original order, valid[i]
+is FALSE for points outside a non-periodic grid, value[i] is then
+undefined. returns the number of valid points
+
+*/
+int ggrd_grdtrack_interpolate_batch(double *lon,double *lat,double *z,
+				    int n,struct ggrd_gt *g,
+				    double *value,ggrd_boolean *valid,
+				    ggrd_boolean verbose)
+{
+  struct ggrd_batch_sort *sp,*p;
+  struct GRD_HEADER *grd;
+  struct GMT_EDGEINFO *edgeinfo;
+  double x,y,zl,*v,dx,dy;
+  int i,k,nvalid,il,il_old,ix,iy,lo,hi,nzm1;
+  long long kmax;
+  ggrd_boolean zwarned = FALSE;
+  struct ggrd_cursor cur;
+  if(!g->init){
+    fprintf(stderr,"ggrd_grdtrack_interpolate_batch: error, g structure not initialized\n");
+    return 0;
+  }
+  if(g->is_three && (!z)){
+    fprintf(stderr,"ggrd_grdtrack_interpolate_batch: error, g structure is 3-D and no z given\n");
+    return 0;
+  }
+  if(n < 1)
+    return 0;
+  grd = g->grd;edgeinfo = g->edgeinfo;
+  dx = grd[0].x_inc * edgeinfo[0].nxp;	/* periods */
+  dy = grd[0].y_inc * edgeinfo[0].nyp;
+  nzm1 = g->nz - 1;
+  kmax = (long long)((g->is_three)?(g->nz):(1)) * (grd[0].ny+1) * (grd[0].nx+1);
+  sp = (struct ggrd_batch_sort *)malloc(sizeof(struct ggrd_batch_sort)*2*n);
+  if(!sp)
+    GGRD_MEMERROR("ggrd_grdtrack_interpolate_batch");
+  ggrd_vecalloc(&v,2*n,"ggrd_grdtrack_interpolate_batch");
+  /* 
+     periodic shifts, layers, and sort keys
+  */
+  for(i=nvalid=0;i < n;i++){
+    x = lon[i];y = lat[i];
+    valid[i] = TRUE;
+    if((y < grd[0].y_min) && (edgeinfo[0].nyp > 0))
+      y += ceil((grd[0].y_min - y)/dy) * dy;
+    if((y > grd[0].y_max) && (edgeinfo[0].nyp > 0))
+      y -= ceil((y - grd[0].y_max)/dy) * dy;
+    if((x < grd[0].x_min) && (edgeinfo[0].nxp > 0))
+      x += ceil((grd[0].x_min - x)/dx) * dx;
+    if((x > grd[0].x_max) && (edgeinfo[0].nxp > 0))
+      x -= ceil((x - grd[0].x_max)/dx) * dx;
+    if((y < grd[0].y_min)||(y > grd[0].y_max)||
+       (x < grd[0].x_min)||(x > grd[0].x_max)){
+      valid[i] = FALSE;
+      continue;
+    }
+    p = sp + nvalid;
+    p->layer = 0;p->f2 = 0.0;
+    if(g->is_three){
+      /* 
+	 same layers as ggrd_gt_interpolate_z, first level >= z
+      */
+      zl = (g->zlevels_are_negative)?(-z[i]):(z[i]);
+      if(verbose && (!zwarned) && ((zl < g->z[0])||(zl > g->z[nzm1]))){
+	fprintf(stderr,"ggrd_grdtrack_interpolate_batch: WARNING: at least one z value extrapolated\n");
+	fprintf(stderr,"ggrd_grdtrack_interpolate_batch: zmin: %g z: %g zmax: %g\n",
+		g->z[0],zl,g->z[nzm1]);
+	zwarned = TRUE;
+      }
+      lo = 0;hi = nzm1;
+      while(lo < hi){
+	k = (lo + hi)/2;
+	if(g->z[k] < zl)
+	  lo = k + 1;
+	else
+	  hi = k;
+      }
+      if(lo == 0)
+	lo = 1;
+      p->layer = lo - 1;
+      p->f2 = (zl - (double)g->z[lo-1])/((double)g->z[lo]-(double)g->z[lo-1]);
+    }
+    ix = (int)((x - grd[0].x_min)/grd[0].x_inc);
+    iy = (int)((y - grd[0].y_min)/grd[0].y_inc);
+    p->x = x;p->y = y;
+    p->key = ((long long)p->layer * (grd[0].ny+1) + iy) * (grd[0].nx+1) + ix;
+    p->index = i;
+    nvalid++;
+  }
+  ggrd_radix_sort_batch(sp,(sp+n),nvalid,kmax);
+  /* 
+     bicubic interpolation in sorted order
+  */
+  il_old = -1;
+  for(k=0,p=sp;k < nvalid;k++,p++){
+    il = p->layer;
+    if(il != il_old){	/* new layer pair, force new nodal values */
+      ggrd_cursor_init(&cur,g);
+      il_old = il;
+    }
+    v[k] = ggrd_get_bcr_z((grd+il),p->x,p->y,(g->f+il*g->mm),
+			  (edgeinfo+il),cur.bcr);
+    if(g->is_three)
+      v[n+k] = ggrd_get_bcr_z((grd+il+1),p->x,p->y,(g->f+(il+1)*g->mm),
+			      (edgeinfo+il+1),(cur.bcr+1));
+  }
+  /* 
+     depth blend, and back to the original order
+  */
+  if(g->is_three)
+    for(k=0;k < nvalid;k++)
+      v[k] = (1.0 - sp[k].f2) * v[k] + sp[k].f2 * v[n+k];
+  for(k=0;k < nvalid;k++)
+    value[sp[k].index] = v[k];
+  free(sp);free(v);
+  return nvalid;
+}
+/* 
+
+stable LSD radix sort of n keys in [0,kmax) in sp, tmp is work space
+of the same size. the digits are about as wide as log2(n), up to
+GGRD_RADIX_BITS, such that the counts stay small compared to the
+points
+
+*/
+void ggrd_radix_sort_batch(struct ggrd_batch_sort *sp,
+			   struct ggrd_batch_sort *tmp,
+			   int n,long long kmax)
+{
+  int i,bits,npass,nbits,shift,*count;
+  long long mask;
+  struct ggrd_batch_sort *a,*b,*c;
+  for(bits=1;(kmax >> bits) > 0;bits++);
+  for(nbits=8;(nbits < GGRD_RADIX_BITS) && ((1 << nbits) < n);nbits++);
+  npass = (bits + nbits - 1)/nbits;
+  nbits = (bits + npass - 1)/npass;
+  mask = (1LL << nbits) - 1;
+  count = (int *)malloc(sizeof(int)*((1 << nbits)+1));
+  if(!count)
+    GGRD_MEMERROR("ggrd_radix_sort_batch");
+  a = sp;b = tmp;
+  for(shift=0;shift < bits;shift += nbits){
+    memset(count,0,sizeof(int)*((1 << nbits)+1));
+    for(i=0;i < n;i++)
+      count[((a[i].key >> shift) & mask)+1]++;
+    for(i=0;i < (1 << nbits);i++)
+      count[i+1] += count[i];
+    for(i=0;i < n;i++)
+      b[count[(a[i].key >> shift) & mask]++] = a[i];
+    c = a;a = b;b = c;
+  }
+  if(a != sp)
+    memcpy(sp,a,sizeof(struct ggrd_batch_sort)*n);
+  free(count);
+}
+/* 
+
 free structure
 
 */
@@ -842,6 +1100,11 @@ void ggrd_print_layer_avg(float *x,float *z,int nx, int ny,
 
 interpolate value 
 
+this keeps the interface with a BCR structure, which is only read. the
+interpolation works on a per thread cursor initialized from loc_bcr,
+which is kept as long as the data f stay the same, see
+ggrd_grdtrack_interpolate_cursor
+
  */
 #ifndef USE_GMT3
 ggrd_boolean ggrd_grdtrack_interpolate(double *in, /* lon/lat/z [2/3] in degrees/km */
@@ -869,10 +1132,41 @@ ggrd_boolean ggrd_grdtrack_interpolate(double *in, /* lon/lat/z [2/3] in degrees
 				       struct BCR *loc_bcr
 				       )
 #endif
+{
+  struct ggrd_cursor *cur;
+  cur = &ggrd_legacy_cur;
+  if(f != ggrd_legacy_f){	/* different grid */
+    cur->bcr[0] = cur->bcr[1] = loc_bcr[0];
+    cur->bcr[0].i = cur->bcr[0].j = cur->bcr[1].i = cur->bcr[1].j = -1;
+    cur->i1 = -1;
+    cur->zwarned = FALSE;
+    ggrd_legacy_f = f;
+  }
+  return ggrd_grdtrack_interpolate_cursor(in,three_d,grd,f,edgeinfo,mm,
+					  z,nz,value,verbose,cur);
+}
+/* 
+
+reentrant interpolation core, all state is kept in the cursor cur,
+the grids are only read. the upper and lower layer have their own
+nodal value caches in cur, which get reset when the layer pair
+changes, and the last layer pair is tried first for the depth
+
+ */
+ggrd_boolean ggrd_grdtrack_interpolate_cursor(double *in, /* lon/lat/z [2/3] in degrees/km */
+					      ggrd_boolean three_d, /* use 3-D inetrpolation or 2-D? */
+					      struct GRD_HEADER *grd, /* grd information */
+					      float *f,	/* data array */
+					      struct GMT_EDGEINFO *edgeinfo, /* edge information */
+					      int mm, /* nx * ny */
+					      float *z, /* depth layers */
+					      int nz,	/* number of depth layers */
+					      double *value, /* output value */
+					      ggrd_boolean verbose,
+					      struct ggrd_cursor *cur)
 {
   int i1,i2;
   double fac1,fac2,val1,val2;
-  static ggrd_boolean zwarned;	/* this should move, leave for now */
   /* If point is outside grd area, 
      shift it using periodicity or skip if not periodic. */
 
@@ -901,29 +1195,29 @@ ggrd_boolean ggrd_grdtrack_interpolate(double *in, /* lon/lat/z [2/3] in degrees
      interpolate 
   */
   if(three_d){
-    ggrd_gt_interpolate_z(in[2],z,nz,&i1,&i2,&fac1,&fac2,verbose,&zwarned);
-    /* 
-       we need these calls to reset the bcr.i and bcr.j counters 
-       otherwise the interpolation routine would assume we have the same 
-       grid
-       
-       TO DO:
-       
-       now, we still need the same grid dimensions, else a separate bcr
-       variable has to be introduced
-       
-       
-       
-    */
-#ifndef USE_GMT3
-    val1 = GMT_get_bcr_z((grd+i1), in[0], in[1], (f+i1*mm), (edgeinfo+i1),loc_bcr);
-    val2 = GMT_get_bcr_z((grd+i2), in[0], in[1], (f+i2*mm), (edgeinfo+i2),loc_bcr);
-#else
-    ggrd_global_bcr_assign(loc_bcr);
-    val1 = GMT_get_bcr_z((grd+i1), in[0], in[1], (f+i1*mm), (edgeinfo+i1));
-    ggrd_global_bcr_assign(loc_bcr);
-    val2 = GMT_get_bcr_z((grd+i2), in[0], in[1], (f+i2*mm), (edgeinfo+i2));
-#endif
+    i1 = cur->i1;i2 = i1 + 1;
+    if((i1 >= 0) && ((z[i2] >= in[2])||(i2 == nz-1)) && 
+       ((i1 == 0)||(z[i1] < in[2])) &&
+       ((!verbose) || cur->zwarned || ((in[2] >= z[0])&&(in[2] <= z[nz-1])))){
+      /* 
+	 same layers as ggrd_gt_interpolate_z would find
+      */
+      fac2 = ((in[2] - (double)z[i1])/((double)z[i2]-(double)z[i1]));
+      fac1 = 1.0 - fac2;
+    }else{
+      ggrd_gt_interpolate_z(in[2],z,nz,&i1,&i2,&fac1,&fac2,verbose,&cur->zwarned);
+      if(i1 != cur->i1){
+	/* 
+	   new layer pair, reset the bcr.i and bcr.j counters,
+	   otherwise the interpolation routine would assume we have
+	   the same grid
+	*/
+	cur->bcr[0].i = cur->bcr[0].j = cur->bcr[1].i = cur->bcr[1].j = -1;
+	cur->i1 = i1;
+      }
+    }
+    val1 = ggrd_get_bcr_z((grd+i1), in[0], in[1], (f+i1*mm), (edgeinfo+i1),cur->bcr);
+    val2 = ggrd_get_bcr_z((grd+i2), in[0], in[1], (f+i2*mm), (edgeinfo+i2),(cur->bcr+1));
     /*      fprintf(stderr,"z(%3i/%3i): %11g z: %11g z(%3i/%3i): %11g f1: %11g f2: %11g v1: %11g v2: %11g rms: %11g %11g\n",   */
     /* 	      i1+1,nz,z[i1],in[2],i2+1,nz,z[i2],fac1,fac2,  */
     /*        	      val1,val2,rms((f+i1*mm),mm),rms((f+i2*mm),mm));   */
@@ -931,17 +1225,41 @@ ggrd_boolean ggrd_grdtrack_interpolate(double *in, /* lon/lat/z [2/3] in degrees
     *value += fac2 * val2;
   }else{
     /* single layer */
-#ifndef USE_GMT3
-    *value = GMT_get_bcr_z(grd, in[0], in[1], f, edgeinfo,loc_bcr);
-#else
-    ggrd_global_bcr_assign(loc_bcr);
-    *value = GMT_get_bcr_z(grd, in[0], in[1], f, edgeinfo);
-#endif
+    *value = ggrd_get_bcr_z(grd, in[0], in[1], f, edgeinfo,cur->bcr);
   }
   //if(verbose)
   //fprintf(stderr,"ggrd_interpolate: lon: %g lat: %g val: %g\n",in[0],in[1],*value);
   return TRUE;
 }
+/* 
+
+bicubic interpolation with the nodal value cache bcr. GMT3 keeps the
+interpolation state in a global, such that the calls are serialized
+there
+
+*/
+#ifndef USE_GMT3
+double ggrd_get_bcr_z(struct GRD_HEADER *grd,double x,double y,float *f,
+		      struct GMT_EDGEINFO *edgeinfo,struct GMT_BCR *bcr)
+{
+  return GMT_get_bcr_z(grd,x,y,f,edgeinfo,bcr);
+}
+#else
+double ggrd_get_bcr_z(struct GRD_HEADER *grd,double x,double y,float *f,
+		      struct GMT_EDGEINFO *edgeinfo,struct BCR *loc_bcr)
+{
+  double val;
+#ifdef _OPENMP
+#pragma omp critical(ggrd_gmt3_bcr)
+#endif
+  {
+    ggrd_global_bcr_assign(loc_bcr);
+    val = GMT_get_bcr_z(grd,x,y,f,edgeinfo);
+    memcpy((void *)loc_bcr,(void *)(&bcr),sizeof(struct BCR));
+  }
+  return val;
+}
+#endif
 /*
   
   read in times for time history of velocities, if needed
@@ -1295,6 +1613,9 @@ int interpolate_seafloor_ages(GGRD_CPREC xt, GGRD_CPREC xp,
     left = ggrd->sf_old_left;right = ggrd->sf_old_right;
     f1 = ggrd->sf_old_f1;f2 = ggrd->sf_old_f2;
   }
+  if(ggrd->v.cache.lazy && (!ggrd->ages[left].init || !ggrd->ages[right].init))
+    if(ggrd_vel_load_ages(ggrd,left,right))
+      return -10;
   if(!ggrd_grdtrack_interpolate_tp((double)xt,(double)xp,
 				   (ggrd->ages+left),&a1,FALSE,shift_to_pos_lon)){
     fprintf(stderr,"interpolate_seafloor_ages: interpolation error left\n");
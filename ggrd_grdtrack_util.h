@@ -54,6 +54,34 @@ ggrd_boolean ggrd_grdtrack_interpolate_tp(double ,double ,
 					   struct ggrd_gt *,
 					   double *,
 					   ggrd_boolean ,ggrd_boolean);
+ggrd_boolean ggrd_grdtrack_interpolate_lonlatz_r(double ,double ,double ,
+						 struct ggrd_gt *,double *,
+						 ggrd_boolean,struct ggrd_cursor *);
+ggrd_boolean ggrd_grdtrack_interpolate_rtp_r(double ,double ,double ,
+					     struct ggrd_gt *,double *,
+					     ggrd_boolean,ggrd_boolean,
+					     struct ggrd_cursor *);
+ggrd_boolean ggrd_grdtrack_interpolate_xyz_r(double ,double ,double ,
+					     struct ggrd_gt *,double *,
+					     ggrd_boolean,struct ggrd_cursor *);
+ggrd_boolean ggrd_grdtrack_interpolate_xy_r(double ,double ,
+					    struct ggrd_gt *,
+					    double *,
+					    ggrd_boolean,struct ggrd_cursor *);
+ggrd_boolean ggrd_grdtrack_interpolate_tp_r(double ,double ,
+					    struct ggrd_gt *,
+					    double *,
+					    ggrd_boolean ,ggrd_boolean,
+					    struct ggrd_cursor *);
+void ggrd_cursor_init(struct ggrd_cursor *,struct ggrd_gt *);
+ggrd_boolean ggrd_grdtrack_interpolate_cursor(double *, ggrd_boolean , struct GRD_HEADER *, float *,
+					      struct GMT_EDGEINFO *, int, float *, int ,double *,ggrd_boolean,
+					      struct ggrd_cursor *);
+int ggrd_grdtrack_interpolate_batch(double *,double *,double *,int,
+				    struct ggrd_gt *,double *,
+				    ggrd_boolean *,ggrd_boolean);
+void ggrd_radix_sort_batch(struct ggrd_batch_sort *,struct ggrd_batch_sort *,
+			   int,long long);
 
 void ggrd_grdtrack_free_gstruc(struct ggrd_gt *);
 
@@ -71,12 +99,18 @@ void ggrd_init_master(struct ggrd_master *);
 
 int ggrd_init_thist_from_file(struct ggrd_t *,char *,ggrd_boolean ,ggrd_boolean);
 int ggrd_read_vel_grids(struct ggrd_master *, double, unsigned short, unsigned short, char *,ggrd_boolean);
+void ggrd_vel_set_lazy(struct ggrd_master *,double,ggrd_boolean);
+int ggrd_vel_stage_offset(struct ggrd_master *,int,double);
+void ggrd_vel_prefetch_wait(struct ggrd_master *);
+int ggrd_vel_load_ages(struct ggrd_master *,int,int);
 
 #ifndef USE_GMT3
 /* GMT >4.1.2 */
 ggrd_boolean ggrd_grdtrack_interpolate(double *, ggrd_boolean , struct GRD_HEADER *, float *,
 					struct GMT_EDGEINFO *, int, float *, int ,	double *,ggrd_boolean,
 					struct GMT_BCR *);
+double ggrd_get_bcr_z(struct GRD_HEADER *,double,double,float *,
+		      struct GMT_EDGEINFO *,struct GMT_BCR *);
 // GMT < 4.5.1
 //int ggrd_grdtrack_init(double *, double *, double *, double *, float **, int *, char *, struct GRD_HEADER **, struct GMT_EDGEINFO **, char *, ggrd_boolean *, int *, ggrd_boolean, char *, float **, int *, ggrd_boolean, ggrd_boolean, ggrd_boolean, struct GMT_BCR *);
 // GMT >= 4.5.1
@@ -99,6 +133,8 @@ ggrd_boolean ggrd_grdtrack_interpolate(double *, ggrd_boolean , struct GRD_HEADE
 				       float *, int ,	
 				       double *,ggrd_boolean,
 				       struct BCR *);
+double ggrd_get_bcr_z(struct GRD_HEADER *,double,double,float *,
+		      struct GMT_EDGEINFO *,struct BCR *);
 
 int ggrd_grdtrack_init(double *, double *,double *, double *, /* geographic bounds,
 								 set all to zero to 
@@ -62,7 +62,130 @@ void ggrd_init_vstruc(struct ggrd_master *ggrd)
   ggrd->v.vd.reduce_r_stencil = FALSE;
   ggrd->v.vd.z_warned = FALSE; 
   ggrd->v.vd.w_warned = FALSE;
+  /* lazy stage loading, off by default */
+  memset(&ggrd->v.cache,0,sizeof(struct ggrd_vel_cache));
+  ggrd->v.cache.pf_stage = ggrd->v.cache.pf_slot = -1;
+}
+/* 
+
+   switch on lazy loading of the stages of a velocity history, has to
+   be called after ggrd_init_master and before ggrd_read_vel_grids
+
+   budget: memory for the stages in MB. at least four stages are held,
+           five if prefetch is set
+
+   prefetch: load the next stage in the direction of time on a
+             background thread (needs HC_USE_PTHREADS)
+
+   only two stages are needed at any time, those bracketing the time
+   as given by ggrd_interpol_time. stages are read on demand by
+   ggrd_vel_stage_offset, which should be used to find the location of
+   a stage in vr, vt, and vp, and the least recently used stage is
+   replaced. seafloor age grids are loaded in the same way by
+   interpolate_seafloor_ages
+
+*/
+void ggrd_vel_set_lazy(struct ggrd_master *ggrd,GGRD_CPREC budget,
+		       ggrd_boolean prefetch)
+{
+  if(ggrd->v.init)
+    GGRD_PE("ggrd_vel_set_lazy: error, velocities already read");
+  ggrd->v.cache.lazy = TRUE;
+  ggrd->v.cache.budget = budget;
+#ifdef HC_USE_PTHREADS
+  ggrd->v.cache.prefetch = prefetch;
+#else
+  if(prefetch)
+    fprintf(stderr,"ggrd_vel_set_lazy: WARNING: no prefetching without pthreads\n");
+  ggrd->v.cache.prefetch = FALSE;
+#endif
+}
 
+/* 
+   number of stage slots for lazy loading, and allocate the slot
+   tables
+*/
+static int ggrd_vel_cache_init(struct ggrd_master *ggrd,
+			       hc_boolean verbose)
+{
+  struct ggrd_vel_cache *c;
+  int i,nmin;
+  double stage_mb;
+  c = &ggrd->v.cache;
+  /* two for the current, two for the next time, and the prefetch */
+  nmin = (c->prefetch)?(5):(4);
+  stage_mb = 3.0 * ggrd->v.n[HC_NRNTNP] * sizeof(GGRD_CPREC)/1048576.;
+  c->nslot = (int)(c->budget / stage_mb);
+  if(c->nslot < nmin){
+    if(verbose)
+      fprintf(stderr,"ggrd_vel_cache_init: WARNING: budget %g MB too small, using %i stages of %g MB\n",
+	      c->budget,nmin,stage_mb);
+    c->nslot = nmin;
+  }
+  if(c->nslot > ggrd->time_hist.nvtimes)
+    c->nslot = ggrd->time_hist.nvtimes;
+  c->slot_stage = (int *)malloc(sizeof(int)*c->nslot);
+  c->stage_slot = (int *)malloc(sizeof(int)*ggrd->time_hist.nvtimes);
+  c->slot_used = (long long *)calloc(c->nslot,sizeof(long long));
+  if(!c->slot_stage || !c->stage_slot || !c->slot_used)
+    GGRD_MEMERROR("ggrd_vel_cache_init");
+  for(i=0;i < c->nslot;i++)
+    c->slot_stage[i] = -1;
+  for(i=0;i < ggrd->time_hist.nvtimes;i++)
+    c->stage_slot[i] = -1;
+  c->nuse = 0;
+  c->time_dir = 0;
+  c->have_time = FALSE;
+  c->pf_stage = c->pf_slot = -1;
+  if(verbose)
+    fprintf(stderr,"ggrd_vel_cache_init: lazy loading, holding %i out of %i stages of %g MB%s\n",
+	    c->nslot,ggrd->time_hist.nvtimes,stage_mb,
+	    (c->prefetch)?(", with prefetch"):(""));
+  return c->nslot;
+}
+/* put a stage into a slot, dropping the old one */
+static void ggrd_vel_assign_slot(struct ggrd_vel_cache *c,int stage,int slot)
+{
+  if(c->slot_stage[slot] >= 0)
+    c->stage_slot[c->slot_stage[slot]] = -1;
+  c->slot_stage[slot] = stage;
+  c->stage_slot[stage] = slot;
+  c->slot_used[slot] = ++c->nuse;
+}
+/* empty, or least recently used slot, but not the one being prefetched */
+static int ggrd_vel_lru_slot(struct ggrd_vel_cache *c)
+{
+  int i,slot = -1;
+  for(i=0;i < c->nslot;i++){
+    if((c->pf_stage >= 0)&&(i == c->pf_slot))
+      continue;
+    if(c->slot_stage[i] < 0)
+      return i;
+    if((slot < 0)||(c->slot_used[i] < c->slot_used[slot]))
+      slot = i;
+  }
+  return slot;
+}
+/* 
+   read the seafloor age grid at the beginning of stage ivt, or the
+   end of the last one
+*/
+static int ggrd_read_age_grid(struct ggrd_master *ggrd,int ivt,
+			      char *prefix,ggrd_boolean use_nearneighbor,
+			      hc_boolean verbose)
+{
+  char tfilename[GGRD_CHAR_LENGTH],*char_dummy=NULL;
+  sprintf(tfilename,"%s%i/age.grd",prefix,ivt+1);
+  if(ggrd_grdtrack_init_general(FALSE,tfilename,char_dummy, /* load file */
+				"-Lx",(ggrd->ages+ivt),verbose,
+				FALSE,use_nearneighbor)){
+    fprintf(stderr,"ggrd_read_vel_grids: file error\n");
+    return -10;
+  }
+  if(verbose)
+    fprintf(stderr,"ggrd_read_vel_grids: read %s for seafloor age at time %g\n",
+	    tfilename,ggrd->age_time[ivt]);
+  return 0;
 }
 
 /* 
@@ -94,7 +217,7 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
 			)
 {
   FILE *in,*out;
-  int i,j,k,l,level,os,os1,ivt,*index;
+  int i,j,k,l,level,os,os1,ivt,*index,nstage;
 
   //int dummy[4]={0,0,0,0};	/* GMT  < 4.5.1 */
   GMT_LONG dummy[4]={0,0,0,0};	/* GMT >= 4.5.1 */
@@ -104,7 +227,7 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
     wraparound = FALSE,
     pixelreg = FALSE,
     weighted = TRUE;
-  char sname[GGRD_CHAR_LENGTH],suffix[50],loc_prefix[50],*char_dummy=NULL,
+  char sname[GGRD_CHAR_LENGTH],suffix[50],loc_prefix[50],
     vsfile_loc[GGRD_CHAR_LENGTH],tfilename[GGRD_CHAR_LENGTH];
   float *fgrd;
   double *dgrd;
@@ -142,6 +265,19 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
        if ggrd->v.history is set, will look for different time intervals 
     */
     ggrd_init_thist_from_file(&ggrd->time_hist,tfilename,ggrd->v.history,verbose);
+    if(ggrd->v.cache.lazy){
+      if((ggrd->time_hist.nvtimes < 2)||(ggrd->amode == GGRD_ONLY_VEL_STATS)){
+	/* nothing to gain, or all stages needed anyway */
+	ggrd->v.cache.lazy = FALSE;
+      }else{
+	if(strlen(prefix) >= GGRD_CHAR_LENGTH)
+	  GGRD_PE("ggrd_read_vel_grids: prefix too long");
+	strcpy(ggrd->v.cache.prefix,prefix);
+	ggrd->v.cache.zero_boundary_vr = zero_boundary_vr;
+	ggrd->v.cache.use_nearneighbor = use_nearneighbor;
+	ggrd->v.cache.verbose = verbose;
+      }
+    }
     if(ggrd->age_control){
       /* 
 
@@ -169,25 +305,19 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
 	return -5;
       }
       /* 
-	 read in the age grids 
+	 read in the age grids, when lazy, those are read by
+	 interpolate_seafloor_ages
       */
       for(ivt=0;ivt < ggrd->nage;ivt++){
 	ggrd->ages[ivt].bandlim = ggrd->age_bandlim;
-	sprintf(tfilename,"%s%i/age.grd",prefix,ivt+1);
-	if(ggrd_grdtrack_init_general(FALSE,tfilename,char_dummy, /* load file */
-				      "-Lx",(ggrd->ages+ivt),verbose,
-				      FALSE,use_nearneighbor)){
-	  fprintf(stderr,"ggrd_read_vel_grids: file error\n");
-	  return -10;
-	}
 	if(ivt < ggrd->nage-1)	/* assign beginning of stage as time 
 				   for seafloor age */
 	  ggrd->age_time[ivt] = ggrd->time_hist.vtimes[ivt*3];
 	else			/* end of last stage */
 	  ggrd->age_time[ivt] = ggrd->time_hist.vtimes[(ivt-1)*3+2];
-	if(verbose)
-	  fprintf(stderr,"ggrd_read_vel_grids: read %s for seafloor age at time %g\n",
-		  tfilename,ggrd->age_time[ivt]);
+	if(!ggrd->v.cache.lazy)
+	  if(ggrd_read_age_grid(ggrd,ivt,prefix,use_nearneighbor,verbose))
+	    return -10;
       }
       /* end age init */
     }
@@ -220,7 +350,9 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
 	      vsfile_loc);
       out = ggrd_open(vsfile_loc,"w","ggrd_read_vel_grids");
     }
-    for(ivt=0;ivt < ggrd->time_hist.nvtimes;ivt++){
+    /* when lazy, only the first stage is read here, into slot 0 */
+    nstage = (ggrd->v.cache.lazy)?(1):(ggrd->time_hist.nvtimes);
+    for(ivt=0;ivt < nstage;ivt++){
       if((ggrd->v.history)&&(verbose))
 	fprintf(stderr,"ggrd_read_vel_grids: reading velocities for time [%12g, %12g] from %3i/\n",
 		ggrd->time_hist.vtimes[ivt*3],
@@ -325,7 +457,16 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
 	    //
 	    ggrd->v.n[HC_TPPROD] = ggrd->v.n[HC_THETA]  * ggrd->v.n[HC_PHI];// ny * nx
 	    ggrd->v.n[HC_NRNTNP] = ggrd->v.n[HC_TPPROD] * ggrd->v.n[HC_R];  // ny * nx * nr
-	    os = ggrd->v.n[HC_NRNTNP] * ggrd->time_hist.nvtimes;//              ny * nx * nr *nt
+	    if(ggrd->v.cache.lazy){
+	      ggrd->v.cache.nx = header->nx;
+	      ggrd->v.cache.ny = header->ny;
+	      ggrd->v.cache.wraparound = wraparound;
+	      ggrd->v.cache.pixelreg = pixelreg;
+	      ggrd->v.cache.minphi = minphi;ggrd->v.cache.omaxphi = omaxphi;
+	      ggrd->v.cache.mintheta = mintheta;ggrd->v.cache.maxtheta = maxtheta;
+	      os = ggrd->v.n[HC_NRNTNP] * ggrd_vel_cache_init(ggrd,verbose);
+	    }else
+	      os = ggrd->v.n[HC_NRNTNP] * ggrd->time_hist.nvtimes;//              ny * nx * nr *nt
 	    //
 	    // allocate space
 	    ggrd_vecalloc(&ggrd->v.vr,os,"ggrd_readgrds: vr");
@@ -462,8 +603,15 @@ int ggrd_read_vel_grids(struct ggrd_master *ggrd, /* ggrd master structure
 		  ((ggrd->v.history)?(ggrd->time_hist.vtimes[ivt*3+1]):(0.0)));
       }
     }
-    /* free sorting array */
-    free(index);
+    if(ggrd->v.cache.lazy){
+      /* keep the sorting array for later stages */
+      ggrd->v.cache.index = index;
+      ggrd_vel_assign_slot(&ggrd->v.cache,0,0);
+      ggrd->v.cache.nload = 1;
+    }else{
+      /* free sorting array */
+      free(index);
+    }
     if(ggrd->v.read_gmt)
       free(fgrd);
     else
@@ -620,3 +768,264 @@ void ggrd_read_depth_levels(struct ggrd_master *ggrd,
     fprintf(stderr,"ggrd_read_depth_levels: read %i levels from %s, r_min: %g r_max: %g \n",
 	    ggrd->v.n[HC_R],GGRD_DFILE,ggrd->v.rlevels[0],ggrd->v.rlevels[ggrd->v.n[HC_R]-1]);
 }
+/* 
+
+   read velocity stage ivt into slot of vr, vt, and vp, in the
+   same way as ggrd_read_vel_grids, for lazy loading
+
+*/
+static void ggrd_vel_read_stage(struct ggrd_master *ggrd,int ivt,int slot,
+				ggrd_boolean *warned)
+{
+  struct ggrd_vel_cache *c;
+  FILE *in = NULL;
+  int i,j,level,os1,nxny;
+#ifdef USE_GMT3
+  int dummy[4]={0,0,0,0};
+#else
+  GMT_LONG dummy[4]={0,0,0,0};
+#endif
+  char sname[GGRD_CHAR_LENGTH],*suffix,*comp[3];
+  float *fgrd = NULL;
+  double *dgrd = NULL;
+  GGRD_CPREC *a;
+  hc_boolean to_zero;
+  struct GRD_HEADER header[1];
+
+  c = &ggrd->v.cache;
+  comp[HC_R] = "vr";comp[HC_THETA] = "vt";comp[HC_PHI] = "vp";
+  nxny = c->nx * c->ny;
+  if(ggrd->v.read_gmt){
+    fgrd = (float  *)malloc(sizeof(float)  * nxny);
+    suffix = "grd";
+  }else{
+    dgrd = (double *)malloc(sizeof(double) * nxny);
+    suffix = "bin";
+  }
+  if(!fgrd && !dgrd)
+    GGRD_MEMERROR("ggrd_vel_read_stage");
+  for(i=0;i < ggrd->v.n[HC_R];i++){
+    level = c->index[i]+1;
+    os1  = ggrd->v.n[HC_NRNTNP] * slot;
+    os1 += ggrd->v.n[HC_TPPROD] * i;
+    for(j=0;j < 3;j++){
+      if(snprintf(sname,GGRD_CHAR_LENGTH,"%s%i/%s.%i.%s",c->prefix,ivt+1,
+		  comp[j],level,suffix) >= GGRD_CHAR_LENGTH){
+	fprintf(stderr,"ggrd_vel_read_stage: filename for stage %i too long, prefix %s\n",
+		ivt+1,c->prefix);
+	exit(-1);
+      }
+      if(ggrd->v.read_gmt){
+#ifdef USE_GMT3
+	if(GMT_cdf_read_grd_info (sname,header) == -1){
+#else
+	if(GMT_read_grd_info (sname,header) == -1){
+#endif
+	  fprintf(stderr,"ggrd_vel_read_stage: error opening GMT grd file %s\n",sname);
+	  exit(-1);
+	}
+      }else{
+	in = ggrd_open(sname,"r","ggrd_vel_read_stage");
+	header->node_offset=FALSE;
+	if((fread(&header->x_min, sizeof(double), 1, in) != 1)||
+	   (fread(&header->x_max, sizeof(double), 1, in) != 1)||
+	   (fread(&header->y_min, sizeof(double), 1, in) != 1)||
+	   (fread(&header->y_max, sizeof(double), 1, in) != 1)||
+	   (fread(&header->x_inc, sizeof(double), 1, in) != 1)||
+	   (fread(&header->y_inc, sizeof(double), 1, in) != 1)||
+	   (fread(&header->nx, sizeof(int), 1, in) != 1)||
+	   (fread(&header->ny, sizeof(int), 1, in) != 1)){
+	  fprintf(stderr,"ggrd_vel_read_stage: error reading header of %s\n",sname);
+	  exit(-1);
+	}
+      }
+      /* same checks as in ggrd_read_vel_grids */
+      if((header->nx != c->nx)||(header->ny != c->ny)||
+	 HC_DIFFERENT(c->minphi,LON2PHI(header->x_min+(c->pixelreg?header->x_inc/2.0:0.0)))||
+	 HC_DIFFERENT(c->omaxphi,LON2PHI(header->x_max-(c->pixelreg?header->x_inc/2.0:0.0)))||
+	 HC_DIFFERENT(c->maxtheta,LAT2THETA(header->y_min+(c->pixelreg?header->y_inc/2.0:0.0)))||
+	 HC_DIFFERENT(c->mintheta,LAT2THETA(header->y_max-(c->pixelreg?header->y_inc/2.0:0.0)))||
+	 HC_DIFFERENT(ggrd->v.dphi,DEG2RAD(header->x_inc))||
+	 HC_DIFFERENT(ggrd->v.dtheta,DEG2RAD( header->y_inc))){
+	fprintf(stderr,"ggrd_vel_read_stage: grd files have different size, grd: %s\n",
+		sname);
+	exit(-1);
+      }
+      if(ggrd->v.read_gmt){
+#ifndef USE_GMT3
+	GMT_read_grd (sname,header,fgrd, 0.0, 0.0, 0.0, 0.0, 
+		      dummy,0);
+#else
+	GMT_cdf_read_grd (sname,header,fgrd, 0.0, 0.0, 0.0, 0.0, 
+			  dummy, 0);
+#endif
+      }else{
+	if(fread(dgrd,sizeof(double),nxny,in) != (size_t)nxny){
+	  fprintf(stderr,"ggrd_vel_read_stage: error reading %i values from %s\n",
+		  nxny,sname);
+	  exit(-1);
+	}
+	fclose(in);
+      }
+      if(j == HC_R){
+	a = ggrd->v.vr;
+	/* surface and CMB, as in ggrd_read_vel_grids */
+	to_zero = (c->zero_boundary_vr &&
+		   ((1.0 - ggrd->v.rlevels[i] < HC_EPS_PREC)||
+		    (ggrd->v.rlevels[i] < ggrd->v.rcmb)));
+      }else{
+	a = (j == HC_THETA)?(ggrd->v.vt):(ggrd->v.vp);
+	to_zero = FALSE;
+      }
+      ggrd_resort_and_check((a+os1),fgrd,dgrd,ggrd->v.n[HC_PHI],
+			    ggrd->v.n[HC_THETA],c->wraparound,1.0/ggrd->v.velscale,
+			    ggrd->v.read_gmt,to_zero,0.0,warned);
+    }
+  }
+  if(c->verbose >= 2)
+    fprintf(stderr,"ggrd_vel_read_stage: read stage %i into slot %i\n",ivt+1,slot);
+  free(fgrd);
+  free(dgrd);
+}
+#ifdef HC_USE_PTHREADS
+static void *ggrd_vel_prefetch_thread(void *arg)
+{
+  struct ggrd_master *ggrd;
+  ggrd_boolean warned = TRUE;	/* the main thread has warned */
+  ggrd = (struct ggrd_master *)arg;
+  ggrd_vel_read_stage(ggrd,ggrd->v.cache.pf_stage,ggrd->v.cache.pf_slot,
+		      &warned);
+  return NULL;
+}
+#endif
+/* 
+   
+   start reading the stage after istage in the direction of time,
+   or the one after that if it is already there, on a background
+   thread into the least recently used slot
+
+*/
+static void ggrd_vel_prefetch_start(struct ggrd_master *ggrd,int istage)
+{
+#ifdef HC_USE_PTHREADS
+  struct ggrd_vel_cache *c;
+  int next,slot;
+  c = &ggrd->v.cache;
+  if(c->pf_stage >= 0)		/* busy */
+    return;
+  next = istage + c->time_dir;
+  if((next >= 0)&&(next < ggrd->time_hist.nvtimes)&&(c->stage_slot[next] >= 0))
+    next += c->time_dir;
+  if((next < 0)||(next >= ggrd->time_hist.nvtimes)||(c->stage_slot[next] >= 0))
+    return;
+  slot = ggrd_vel_lru_slot(c);
+  if(c->slot_stage[slot] >= 0){	/* drop the old stage */
+    c->stage_slot[c->slot_stage[slot]] = -1;
+    c->slot_stage[slot] = -1;
+  }
+  c->pf_stage = next;
+  c->pf_slot = slot;
+  if(pthread_create(&c->thread,NULL,ggrd_vel_prefetch_thread,(void *)ggrd) != 0){
+    fprintf(stderr,"ggrd_vel_prefetch_start: WARNING: could not start thread, no more prefetching\n");
+    c->pf_stage = c->pf_slot = -1;
+    c->prefetch = FALSE;
+  }
+#endif
+}
+/* 
+   wait for a background read to finish, if any. host codes should
+   call this before they use GMT or the velocity files themselves
+*/
+void ggrd_vel_prefetch_wait(struct ggrd_master *ggrd)
+{
+#ifdef HC_USE_PTHREADS
+  struct ggrd_vel_cache *c;
+  c = &ggrd->v.cache;
+  if(c->pf_stage < 0)
+    return;
+  pthread_join(c->thread,NULL);
+  ggrd_vel_assign_slot(c,c->pf_stage,c->pf_slot);
+  c->nload++;
+  c->pf_stage = c->pf_slot = -1;
+#endif
+}
+/* 
+
+   return the offset of velocity stage istage in vr, vt, and vp, as
+   needed at time. with lazy loading, this reads the stage if it is
+   not held, and might start a prefetch of the next one
+
+   in parallel regions, all threads should ask for the same time,
+   else stages that are in use might get replaced
+
+*/
+int ggrd_vel_stage_offset(struct ggrd_master *ggrd,int istage,
+			  GGRD_CPREC time)
+{
+  struct ggrd_vel_cache *c;
+  int slot;
+  ggrd_boolean new_time;
+  if(!ggrd->v.cache.lazy)
+    return istage * ggrd->v.n[HC_NRNTNP];
+  c = &ggrd->v.cache;
+  if((istage < 0)||(istage >= ggrd->time_hist.nvtimes))
+    GGRD_PE("ggrd_vel_stage_offset: stage out of range");
+#ifdef _OPENMP
+#pragma omp critical (ggrd_vel_cache)
+#endif
+  {
+    new_time = (!c->have_time)||(fabs(time - c->time_last) > 1e-8);
+    if(new_time){
+      if(c->have_time)
+	c->time_dir = (time > c->time_last)?(1):(-1);
+      c->time_last = time;
+      c->have_time = TRUE;
+    }
+    if(c->stage_slot[istage] < 0){
+      /* 
+	 not held, a prefetch might be reading it, or GMT is busy
+      */
+      ggrd_vel_prefetch_wait(ggrd);
+      if(c->stage_slot[istage] < 0){
+	slot = ggrd_vel_lru_slot(c);
+	ggrd_vel_read_stage(ggrd,istage,slot,&ggrd->v.vd.w_warned);
+	ggrd_vel_assign_slot(c,istage,slot);
+	c->nload++;
+      }
+    }
+    slot = c->stage_slot[istage];
+    c->slot_used[slot] = ++c->nuse;
+    if(new_time && c->prefetch && c->time_dir)
+      ggrd_vel_prefetch_start(ggrd,istage);
+  }
+  return slot * ggrd->v.n[HC_NRNTNP];
+}
+/* 
+
+   for lazy loading, make sure the seafloor age grids left and right
+   are read, and free those not next to them
+
+*/
+int ggrd_vel_load_ages(struct ggrd_master *ggrd,int left,int right)
+{
+  int i;
+  float bandlim;
+  for(i=0;i < ggrd->nage;i++){
+    if((i == left)||(i == right)){
+      if(!ggrd->ages[i].init){
+	ggrd_vel_prefetch_wait(ggrd); /* GMT is not reentrant */
+	if(ggrd_read_age_grid(ggrd,i,ggrd->v.cache.prefix,
+			      ggrd->v.cache.use_nearneighbor,
+			      ggrd->v.cache.verbose))
+	  return -10;
+      }
+    }else if(ggrd->ages[i].init && ((i < left-1)||(i > right+1))){
+      ggrd_grdtrack_free_gstruc((ggrd->ages+i));
+      free(ggrd->ages[i].fmaxlim);
+      bandlim = ggrd->ages[i].bandlim;
+      memset((ggrd->ages+i),0,sizeof(struct ggrd_gt));
+      ggrd->ages[i].bandlim = bandlim;
+    }
+  }
+  return 0;
+}
@@ -14,6 +14,9 @@ structure for GGRD stuff (scalar and velocity interpolation)
 
 
 #include "prem.h"
+#ifdef HC_USE_PTHREADS
+#include <pthread.h>
+#endif
 
 /* 
    
@@ -48,6 +51,22 @@ struct ggrd_t{
 
 };
 
+/* 
+   interpolation cursor: the state which changes during the
+   interpolation from a ggrd_gt, the nodal value caches of the upper and
+   lower layer and the last layer pair. each thread which interpolates
+   from the same ggrd_gt needs its own, see ggrd_cursor_init
+*/
+struct ggrd_cursor{
+#ifndef USE_GMT3
+  struct GMT_BCR bcr[2];
+#else
+  struct BCR bcr[2];
+#endif
+  int i1;			/* last upper layer, -1 if none */
+  unsigned char zwarned;	/* extrapolation warning issued */
+};
+
 /* 
 
 several GMT grid file structure 
@@ -83,6 +102,19 @@ struct ggrd_gt{
 #else
   struct BCR loc_bcr[1];
 #endif
+  struct ggrd_cursor cur;	/* for the interpolation calls without
+				   cursor, see ggrd_cursor_init */
+};
+
+/* 
+   point of the batched grd interpolation, sorted by the layer and
+   cell index key, with the (periodically shifted) location and depth
+   weight, such that the sorted points can be processed in sequence
+*/
+struct ggrd_batch_sort{
+  long long key;
+  double x,y,f2;
+  int index,layer;
 };
 
 /* velocity interpolation structure */
@@ -98,8 +130,39 @@ struct ggrd_vip{
 structure for 3-D velocity interpolation
 
 */
+/* 
+   lazy loading of the stages of a velocity history: only a few
+   stages are kept in slots of vr, vt, and vp, and replaced least
+   recently used first, see ggrd_vel_stage_offset in ggrd_readgrds.c
+*/
+struct ggrd_vel_cache{
+  unsigned char lazy,		/* load stages on demand? */
+    prefetch,			/* load the next stage in the background? */
+    zero_boundary_vr,wraparound,verbose,use_nearneighbor,
+    have_time,			/* time_last set? */
+    pixelreg;			/* grids pixel registered? */
+  double budget;		/* memory budget for the stages [MB] */
+  int nslot;			/* number of stages held */
+  int *slot_stage,*stage_slot;	/* stage in each slot, slot of each
+				   stage, -1 if none */
+  long long *slot_used,nuse;	/* LRU counters */
+  int *index;			/* level sorting array */
+  int nx,ny;			/* original grid dimensions */
+  GGRD_CPREC minphi,omaxphi,	/* and range, for checking the stage */
+    mintheta,maxtheta;		/* files as they are read */
+  int time_dir;			/* direction of time, +/-1, 0 if unknown */
+  GGRD_CPREC time_last;
+  int nload;			/* stages read so far */
+  char prefix[GGRD_CHAR_LENGTH];
+  int pf_stage,pf_slot;		/* stage being prefetched, -1 if none */
+#ifdef HC_USE_PTHREADS
+  pthread_t thread;
+#endif
+};
+
 struct ggrd_vel{
-  GGRD_CPREC *vr,*vt,*vp;	/* velocity field */
+  GGRD_CPREC *vr,*vt,*vp;	/* velocity field, for lazy loading
+				   only cache.nslot stages */
   int n[5];		/* dimensions in r, theta, and 
 				   phi directions */
   int ntnp,nrntnp;		/*  */
@@ -113,6 +176,29 @@ struct ggrd_vel{
   unsigned char rl_warned,vd_init,vd_reduce_r_stencil;	/*  */
 
   struct ggrd_vip vd;		/* velocity interpolation structure */
+  struct ggrd_vel_cache cache;	/* lazy stage loading */
+};
+/* 
+   blending of the velocity stages of a time history at one time, with
+   the numbers and offsets of the two stages in vr, vt, and vp
+*/
+struct ggrd_tracer_stage{
+  GGRD_CPREC f[2];
+  int os[2],stage[2];
+};
+/* 
+   batched tracer advection in a ggrd_vel velocity field, see
+   ggrd_tracer.c
+*/
+struct ggrd_tracer{
+  int order,istencil[3],isshift[3];
+  /* inverse Lagrange denominators for the regular theta and phi
+     stencils, with unit spaced nodes */
+  GGRD_CPREC winv[3][GGRD_MAX_ORDERP1];
+  GGRD_CPREC dtrange;		/* stage transition width */
+  GGRD_CPREC vfac;		/* from velocities to radii per time */
+  GGRD_CPREC rmin,rmax;		/* radial range of the tracers */
+  unsigned char init;
 };
 
 
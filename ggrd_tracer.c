@@ -0,0 +1,416 @@
+#include "hc.h"
+/*
+
+batched tracer advection in the velocity field of ggrd_read_vel_grids,
+with second or fourth order Runge Kutta steps
+
+the velocities are interpolated with the same polynomial stencils as
+ggrd_find_vel_and_der, but
+
+- the weights of the regular theta and phi stencils are Lagrange
+  products with cached denominators, only the irregular radial stencil
+  uses ggrd_weights, and is found by bisection
+
+- the blending of the velocity stages of a time history is computed
+  once per time, in ggrd_tracer_stage_blend, rather than for each
+  stencil point
+
+- the phi stencil is not wrapped in coordinates, only in the indices,
+  such that tracers close to phi = 0 are interpolated like all others
+
+ggrd is only read during the interpolation, and the tracers are
+advected in parallel. stages of a lazily loaded history (see
+ggrd_vel_set_lazy) are read serially, when blending
+
+positions are x[3] = r, theta, phi, times are in the units of the
+velocity history, i.e. Myr
+
+*/
+
+/*
+   initialize the stencils for interpolation order order (e.g. 3), and
+   the stage transition width dtrange (e.g. 1 Myr). the velocities of
+   ggrd have to be read. returns 0 on success
+*/
+int ggrd_tracer_init(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+		     int order,GGRD_CPREC dtrange,ggrd_boolean verbose)
+{
+  int i,j,k,lorder;
+  GGRD_CPREC d;
+  tr->init = FALSE;
+  if(!ggrd->v.init){
+    fprintf(stderr,"ggrd_tracer_init: error: velocities not initialized\n");
+    return(-1);
+  }
+  if((order < 1)||(order > GGRD_MAX_ORDER)){
+    fprintf(stderr,"ggrd_tracer_init: error: order %i out of range, max is %i\n",
+	    order,GGRD_MAX_ORDER);
+    return(-1);
+  }
+  if((ggrd->v.n[HC_PHI] < order+1)||(ggrd->v.n[HC_THETA] < order+1)){
+    fprintf(stderr,"ggrd_tracer_init: error: need at least %i lon and lat levels\n",
+	    order+1);
+    return(-1);
+  }
+  for(i=1;i < ggrd->v.n[HC_R];i++)
+    if(ggrd->v.rlevels[i] <= ggrd->v.rlevels[i-1]){
+      fprintf(stderr,"ggrd_tracer_init: error: rlevels have to be ascending\n");
+      return(-1);
+    }
+  for(i=0;i < 3;i++){
+    if((i == HC_R)&&(ggrd->v.n[HC_R] < order+1)){
+      lorder = ggrd->v.n[HC_R]-1;
+      if(verbose)
+	fprintf(stderr,"ggrd_tracer_init: WARNING: reducing r stencil to nl-1: %i\n",
+		lorder);
+    }else
+      lorder = order;
+    tr->istencil[i] = lorder + 1;
+    tr->isshift[i] = (int)(tr->istencil[i]/2.0);
+    /* 1/prod_{k != j} (j - k) */
+    for(j=0;j < tr->istencil[i];j++){
+      for(d=1.0,k=0;k < tr->istencil[i];k++)
+	if(k != j)
+	  d *= (GGRD_CPREC)(j - k);
+      tr->winv[i][j] = 1.0/d;
+    }
+  }
+  tr->order = order;
+  tr->dtrange = dtrange;
+  /* cm/yr to radii per Myr */
+  tr->vfac = ggrd->v.velscale * 1e-5 * HC_TIMESCALE_YR / HC_RE_KM;
+  tr->rmin = ggrd->v.rlevels[0];
+  tr->rmax = HC_MIN(1.0,ggrd->v.rlevels[ggrd->v.n[HC_R]-1]);
+  tr->init = TRUE;
+  if(verbose)
+    fprintf(stderr,"ggrd_tracer_init: order %i, stencils %i/%i/%i, r: %g - %g, %i stages\n",
+	    order,tr->istencil[HC_R],tr->istencil[HC_THETA],tr->istencil[HC_PHI],
+	    tr->rmin,tr->rmax,ggrd->time_hist.nvtimes);
+  return 0;
+}
+/*
+   blending of the velocity stages at time, this has to be called
+   serially since ggrd_interpol_time keeps its state in ggrd
+*/
+void ggrd_tracer_stage_blend(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+			     GGRD_CPREC time,struct ggrd_tracer_stage *s)
+{
+  int i1,i2;
+  GGRD_CPREC f1,f2;
+  if(ggrd->time_hist.nvtimes == 1){
+    s->f[0] = 1.0;s->f[1] = 0.0;
+    s->os[0] = s->os[1] = 0;
+    s->stage[0] = s->stage[1] = 0;
+  }else{
+    ggrd_interpol_time(time,&ggrd->time_hist,&i1,&i2,&f1,&f2,tr->dtrange);
+    /* same cutoff as ggrd_get_velocities */
+    s->f[0] = (fabs(f1) > 1e-7)?(f1):(0.0);
+    s->f[1] = (fabs(f2) > 1e-7)?(f2):(0.0);
+    s->stage[0] = i1;s->stage[1] = i2;
+    /* this reads the stage if needed when loading lazily */
+    s->os[0] = (s->f[0] != 0.0)?(ggrd_vel_stage_offset(ggrd,i1,time)):(0);
+    s->os[1] = (s->f[1] != 0.0)?(ggrd_vel_stage_offset(ggrd,i2,time)):(0);
+  }
+}
+/*
+   Lagrange weights w[n] at u for the nodes 0, 1, ..., n-1
+*/
+static void ggrd_tracer_lagrange(GGRD_CPREC u,int n,GGRD_CPREC *winv,
+				 GGRD_CPREC *w)
+{
+  int j;
+  GGRD_CPREC pre,suf[GGRD_MAX_ORDERP1+1];
+  suf[n] = 1.0;
+  for(j=n-1;j >= 0;j--)
+    suf[j] = suf[j+1] * (u - (GGRD_CPREC)j);
+  for(pre=1.0,j=0;j < n;j++){
+    w[j] = pre * suf[j+1] * winv[j];
+    pre *= u - (GGRD_CPREC)j;
+  }
+}
+/*
+
+velocities v[3] = v_r, v_theta, v_phi (in the units of ggrd, i.e. cm/yr
+divided by velscale) at x[3] = r, theta, phi, blended with stage
+weights s. reentrant. returns 0 on success, -1 if x is out of range
+
+*/
+int ggrd_tracer_velocity(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+			 struct ggrd_tracer_stage *s,GGRD_CPREC *xin,
+			 GGRD_CPREC *v)
+{
+  GGRD_CPREC x[3],grid[GGRD_MAX_ORDERP1],c[GGRD_MAX_ORDERP1][GGRD_MAX_IORDERP1],
+    w[3][GGRD_MAX_ORDERP1],u,fac,wrt,sr,st,sp,*vr,*vt,*vp;
+  int ip[GGRD_MAX_ORDERP1],i0,it0,i,j,k,l,lo,hi,ilim,os,index;
+  x[HC_R] = xin[HC_R];x[HC_THETA] = xin[HC_THETA];x[HC_PHI] = xin[HC_PHI];
+  if(x[HC_PHI] < 0)
+    x[HC_PHI] += GGRD_TWOPI;
+  if(x[HC_PHI] > GGRD_TWOPI)
+    x[HC_PHI] -= GGRD_TWOPI;
+  if((x[HC_R] < 0) || (x[HC_R] > 1) || (x[HC_THETA] < 0) ||
+     (x[HC_THETA] > GGRD_PI) || (x[HC_PHI] < 0) ||
+     (x[HC_PHI] > GGRD_TWOPI))
+    return(-1);
+  /*
+     radial stencil around the first level >= r
+  */
+  ilim = ggrd->v.n[HC_R] - 1;
+  lo = 0;hi = ilim;
+  while(lo < hi){
+    k = (lo + hi)/2;
+    if(x[HC_R] <= ggrd->v.rlevels[k])
+      hi = k;
+    else
+      lo = k + 1;
+  }
+  i0 = lo - tr->isshift[HC_R];
+  if(i0 < 0)
+    i0 = 0;
+  if(i0 + tr->istencil[HC_R] - 1 > ilim)
+    i0 = ilim - tr->istencil[HC_R] + 1;
+  for(i=0;i < tr->istencil[HC_R];i++)
+    grid[i] = ggrd->v.rlevels[i0+i];
+  ggrd_weights(x[HC_R],grid,tr->istencil[HC_R],0,c);
+  for(i=0;i < tr->istencil[HC_R];i++)
+    w[HC_R][i] = c[i][0];
+  /*
+     theta, nodes at (i+0.5) dtheta
+  */
+  it0 = (int)(x[HC_THETA]/ggrd->v.dtheta) - tr->isshift[HC_THETA];
+  if(it0 < 0)
+    it0 = 0;
+  if(it0 + tr->istencil[HC_THETA] > ggrd->v.n[HC_THETA])
+    it0 = ggrd->v.n[HC_THETA] - tr->istencil[HC_THETA];
+  u = x[HC_THETA]/ggrd->v.dtheta - 0.5 - (GGRD_CPREC)it0;
+  ggrd_tracer_lagrange(u,tr->istencil[HC_THETA],tr->winv[HC_THETA],w[HC_THETA]);
+  /*
+     phi, nodes at i dphi, periodic
+  */
+  i = (int)(x[HC_PHI]/ggrd->v.dphi+.5) - tr->isshift[HC_PHI];
+  u = x[HC_PHI]/ggrd->v.dphi - (GGRD_CPREC)i;
+  for(k=0;k < tr->istencil[HC_PHI];k++){
+    ip[k] = i + k;
+    if(ip[k] >= ggrd->v.n[HC_PHI])
+      ip[k] -= ggrd->v.n[HC_PHI];
+    if(ip[k] < 0)
+      ip[k] += ggrd->v.n[HC_PHI];
+  }
+  ggrd_tracer_lagrange(u,tr->istencil[HC_PHI],tr->winv[HC_PHI],w[HC_PHI]);
+  /*
+     sum over the stencil for the (up to) two stages
+  */
+  v[HC_R] = v[HC_THETA] = v[HC_PHI] = 0.0;
+  for(l=0;l < 2;l++){
+    if(s->f[l] == 0.0)
+      continue;
+    vr = ggrd->v.vr + s->os[l];
+    vt = ggrd->v.vt + s->os[l];
+    vp = ggrd->v.vp + s->os[l];
+    sr = st = sp = 0.0;
+    for(i=0;i < tr->istencil[HC_R];i++)
+      for(j=0;j < tr->istencil[HC_THETA];j++){
+	wrt = w[HC_R][i] * w[HC_THETA][j];
+	os = (i0+i) * ggrd->v.n[HC_TPPROD] + (it0+j) * ggrd->v.n[HC_PHI];
+	for(k=0;k < tr->istencil[HC_PHI];k++){
+	  fac = wrt * w[HC_PHI][k];
+	  index = os + ip[k];
+	  sr += fac * vr[index];
+	  st += fac * vt[index];
+	  sp += fac * vp[index];
+	}
+      }
+    v[HC_R]     += s->f[l] * sr;
+    v[HC_THETA] += s->f[l] * st;
+    v[HC_PHI]   += s->f[l] * sp;
+  }
+  return 0;
+}
+/*
+   dx/dt at x for stage weights s
+*/
+static int ggrd_tracer_deriv(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+			     struct ggrd_tracer_stage *s,GGRD_CPREC *x,
+			     GGRD_CPREC *dx)
+{
+  GGRD_CPREC v[3],sin_theta;
+  if(ggrd_tracer_velocity(tr,ggrd,s,x,v))
+    return(-1);
+  sin_theta = sin(x[HC_THETA]);
+  if(sin_theta < 1e-8)
+    sin_theta = 1e-8;
+  dx[HC_R]     = tr->vfac * v[HC_R];
+  dx[HC_THETA] = tr->vfac * v[HC_THETA] / x[HC_R];
+  dx[HC_PHI]   = tr->vfac * v[HC_PHI] / (x[HC_R] * sin_theta);
+  return 0;
+}
+/*
+   xo = x + f dx, moved back into range: across the poles, phi to 0
+   ... 2pi, and r into the range of the velocity levels
+*/
+static void ggrd_tracer_move(struct ggrd_tracer *tr,GGRD_CPREC *x,
+			     GGRD_CPREC f,GGRD_CPREC *dx,GGRD_CPREC *xo)
+{
+  xo[HC_R]     = x[HC_R]     + f * dx[HC_R];
+  xo[HC_THETA] = x[HC_THETA] + f * dx[HC_THETA];
+  xo[HC_PHI]   = x[HC_PHI]   + f * dx[HC_PHI];
+  if(xo[HC_THETA] < 0){
+    xo[HC_THETA] = -xo[HC_THETA];
+    xo[HC_PHI] += GGRD_PI;
+  }else if(xo[HC_THETA] > GGRD_PI){
+    xo[HC_THETA] = GGRD_TWOPI - xo[HC_THETA];
+    xo[HC_PHI] += GGRD_PI;
+  }
+  xo[HC_PHI] = fmod(xo[HC_PHI],GGRD_TWOPI);
+  if(xo[HC_PHI] < 0)
+    xo[HC_PHI] += GGRD_TWOPI;
+  if(xo[HC_R] < tr->rmin)
+    xo[HC_R] = tr->rmin;
+  if(xo[HC_R] > tr->rmax)
+    xo[HC_R] = tr->rmax;
+}
+/*
+   one step for one tracer, s holds the stage weights at t, t+dt/2,
+   and t+dt. x is unchanged on error
+*/
+static int ggrd_tracer_rk(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+			  struct ggrd_tracer_stage *s,GGRD_CPREC *x,
+			  GGRD_CPREC dt,int rk_order)
+{
+  GGRD_CPREC k1[3],k2[3],k3[3],k4[3],xt[3];
+  int i;
+  if(ggrd_tracer_deriv(tr,ggrd,s,x,k1))
+    return(-1);
+  ggrd_tracer_move(tr,x,dt/2.0,k1,xt);
+  if(ggrd_tracer_deriv(tr,ggrd,(s+1),xt,k2))
+    return(-1);
+  if(rk_order == 2){		/* midpoint */
+    ggrd_tracer_move(tr,x,dt,k2,x);
+    return 0;
+  }
+  ggrd_tracer_move(tr,x,dt/2.0,k2,xt);
+  if(ggrd_tracer_deriv(tr,ggrd,(s+1),xt,k3))
+    return(-1);
+  ggrd_tracer_move(tr,x,dt,k3,xt);
+  if(ggrd_tracer_deriv(tr,ggrd,(s+2),xt,k4))
+    return(-1);
+  for(i=0;i < 3;i++)
+    k1[i] = (k1[i] + 2.0*(k2[i] + k3[i]) + k4[i])/6.0;
+  ggrd_tracer_move(tr,x,dt,k1,x);
+  return 0;
+}
+/*
+
+advance n tracers x[n*3] from time by dt with Runge Kutta of order
+rk_order, 2 or 4. the stage weights are computed once, and the
+tracers are distributed over threads. returns the number of tracers
+which could not be moved
+
+*/
+int ggrd_tracer_step(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+		     GGRD_CPREC *x,int n,GGRD_CPREC time,GGRD_CPREC dt,
+		     int rk_order)
+{
+  struct ggrd_tracer_stage s[3];
+  int i,l,nfail = 0;
+  if(!tr->init)
+    GGRD_PE("ggrd_tracer_step: error: tracer structure not initialized");
+  if((rk_order != 2)&&(rk_order != 4)){
+    fprintf(stderr,"ggrd_tracer_step: error: Runge Kutta order %i undefined, use 2 or 4\n",
+	    rk_order);
+    exit(-1);
+  }
+  ggrd_tracer_stage_blend(tr,ggrd,time,s);
+  ggrd_tracer_stage_blend(tr,ggrd,time+dt/2.0,(s+1));
+  if(rk_order == 4)
+    ggrd_tracer_stage_blend(tr,ggrd,time+dt,(s+2));
+  if(ggrd->v.cache.lazy)	/* all stages of the step still held? */
+    for(i=0;i < ((rk_order == 4)?(3):(2));i++)
+      for(l=0;l < 2;l++)
+	if((s[i].f[l] != 0.0)&&
+	   (ggrd->v.cache.stage_slot[s[i].stage[l]] * ggrd->v.n[HC_NRNTNP] != s[i].os[l]))
+	  GGRD_PE("ggrd_tracer_step: error: stage dropped within step, raise the budget or reduce dt");
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:nfail) schedule(static)
+#endif
+  for(i=0;i < n;i++)
+    if(ggrd_tracer_rk(tr,ggrd,s,(x+i*3),dt,rk_order))
+      nfail++;
+  return nfail;
+}
+/*
+
+advect n tracers x[n*3] from t0 to t1 with equal steps of at most
+|dt|. returns the number of failed tracer steps
+
+*/
+int ggrd_tracer_advect(struct ggrd_tracer *tr,struct ggrd_master *ggrd,
+		       GGRD_CPREC *x,int n,GGRD_CPREC t0,GGRD_CPREC t1,
+		       GGRD_CPREC dt,int rk_order,ggrd_boolean verbose)
+{
+  int nstep,i,nfail = 0;
+  GGRD_CPREC time,dtl;
+  dt = fabs(dt);
+  if(dt < HC_EPS_PREC)
+    GGRD_PE("ggrd_tracer_advect: error: time step is zero");
+  nstep = (int)ceil(fabs(t1 - t0)/dt - 1e-7);
+  if(nstep < 1)
+    return 0;
+  dtl = (t1 - t0)/(GGRD_CPREC)nstep;
+  for(i=0,time=t0;i < nstep;i++){
+    nfail += ggrd_tracer_step(tr,ggrd,x,n,time,dtl,rk_order);
+    time = t0 + (t1 - t0) * (GGRD_CPREC)(i+1)/(GGRD_CPREC)nstep;
+    if(verbose >= 2)
+      fprintf(stderr,"ggrd_tracer_advect: step %5i of %5i, t: %g\n",
+	      i+1,nstep,time);
+  }
+  if(verbose)
+    fprintf(stderr,"ggrd_tracer_advect: %i tracers from %g to %g in %i RK%i steps, %i failed\n",
+	    n,t0,t1,nstep,rk_order,nfail);
+  return nfail;
+}
+/*
+
+binary tracer files: number of tracers as int, then lon, lat, and
+depth [km] as doubles for each tracer. x[n*3] gets allocated and
+holds r, theta, phi
+
+*/
+int ggrd_tracer_read_bin(char *filename,GGRD_CPREC **x,int *n)
+{
+  FILE *in;
+  double loc[3];
+  int i;
+  in = ggrd_open(filename,"r","ggrd_tracer_read_bin");
+  if((fread(n,sizeof(int),1,in) != 1)||(*n < 0)){
+    fprintf(stderr,"ggrd_tracer_read_bin: error reading header of %s\n",filename);
+    exit(-1);
+  }
+  ggrd_vecalloc(x,HC_MAX(1,*n*3),"ggrd_tracer_read_bin");
+  for(i=0;i < *n;i++){
+    if(fread(loc,sizeof(double),3,in) != 3){
+      fprintf(stderr,"ggrd_tracer_read_bin: error reading tracer %i of %i from %s\n",
+	      i+1,*n,filename);
+      exit(-1);
+    }
+    (*x)[i*3+HC_R]     = HC_ND_RADIUS(loc[2]);
+    (*x)[i*3+HC_THETA] = LAT2THETA(loc[1]);
+    (*x)[i*3+HC_PHI]   = LON2PHI(loc[0]);
+  }
+  fclose(in);
+  return *n;
+}
+void ggrd_tracer_write_bin(char *filename,GGRD_CPREC *x,int n)
+{
+  FILE *out;
+  double loc[3];
+  int i;
+  out = ggrd_open(filename,"w","ggrd_tracer_write_bin");
+  fwrite(&n,sizeof(int),1,out);
+  for(i=0;i < n;i++){
+    loc[0] = PHI2LON(x[i*3+HC_PHI]);
+    loc[1] = THETA2LAT(x[i*3+HC_THETA]);
+    loc[2] = HC_Z_DEPTH(x[i*3+HC_R]);
+    fwrite(loc,sizeof(double),3,out);
+  }
+  fclose(out);
+}
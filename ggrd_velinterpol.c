@@ -365,6 +365,9 @@ int ggrd_find_vel_and_der(GGRD_CPREC *xloc,
 //     vr(nrntnp*nvtimes) long. the vtimes array is nvtimes*3 and has 
 //     t_left t_mid t_right for each interval in a row
 //
+//     with lazy loading, the stages are located (and read) by
+//     ggrd_vel_stage_offset
+//
 //
 //     dtrange: time range used to transition between plate tectonic stages
 //
@@ -388,7 +391,7 @@ void ggrd_get_velocities(GGRD_CPREC *vrloc,GGRD_CPREC *vthetaloc,
     // interpolate in time
     ggrd_interpol_time(time,&ggrd->time_hist,&i1,&i2,&vf1,&vf2,dtrange);
     if(fabs(vf1) > 1e-7){
-      index1 = i1 * ggrd->v.n[HC_NRNTNP] + index;
+      index1 = ggrd_vel_stage_offset(ggrd,i1,time) + index;
       *vrloc=      ggrd->v.vr[index1] * vf1 ;
       *vthetaloc = ggrd->v.vt[index1] * vf1; 
       *vphiloc=    ggrd->v.vp[index1] * vf1 ;
@@ -396,7 +399,7 @@ void ggrd_get_velocities(GGRD_CPREC *vrloc,GGRD_CPREC *vthetaloc,
       *vrloc = *vthetaloc = *vphiloc = 0.0;
     }
     if(fabs(vf2) > 1e-7){
-      index1 = i2 * ggrd->v.n[HC_NRNTNP] + index;
+      index1 = ggrd_vel_stage_offset(ggrd,i2,time) + index;
       *vrloc     += ggrd->v.vr[index1] * vf2;
       *vthetaloc += ggrd->v.vt[index1] * vf2;
       *vphiloc   += ggrd->v.vp[index1] * vf2;
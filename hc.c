@@ -52,12 +52,14 @@ int main(int argc, char **argv)
 				   zeroes */
   struct sh_lms *sol_spectral=NULL, *geoid = NULL;		/* solution expansions */
   struct sh_lms *pvel=NULL;					/* local plate velocity expansion */
-  int nsol,lmax,i;
+  struct sh_lms *dtopo=NULL;					/* dynamic topography */
+  int nsol,lmax,i,k,mode,sol_mode;
   FILE *out;
   struct hc_parameters p[1]; /* parameters */
-  char filename[HC_CHAR_LENGTH],file_prefix[10];
+  char filename[HC_CHAR_LENGTH],file_prefix[10],sol_prefix[10];
   HC_PREC *sol_spatial = NULL;	/* spatial solution,
 				   e.g. velocities */
+  HC_PREC *vtu_fac = NULL;
   HC_PREC corr[2];			/* correlations */
   static hc_boolean geoid_binary = FALSE;	/* type of geoid output */
   static HC_CPREC unitya[1] = {1.0};
@@ -170,39 +172,16 @@ int main(int argc, char **argv)
      
   */
   /* 
-     
-     output of spherical harmonics solution
-     
+     the density field and the geoid only depend on the solve
   */
-  switch(p->solution_mode){
-  case HC_VEL:
-    sprintf(file_prefix,"vel");break;
-  case HC_RTRACTIONS:
-    sprintf(file_prefix,"rtrac");break;
-  case HC_HTRACTIONS:
-    sprintf(file_prefix,"htrac");break;
-  default:
-    HC_ERROR(argv[0],"solution mode undefined");break;
-  }
-  if(p->sol_binary_out)
-    sprintf(filename,"%s.%s",file_prefix,HC_SOLOUT_FILE_BINARY);
-  else
-    sprintf(filename,"%s.%s",file_prefix,HC_SOLOUT_FILE_ASCII);
-  if(p->verbose)
-    fprintf(stderr,"%s: writing spherical harmonics solution to %s\n",
-	    argv[0],filename);
-  out = ggrd_open(filename,"w","main");
-  hc_print_spectral_solution(model,sol_spectral,out,
-			     p->solution_mode,
-			     p->sol_binary_out,p->verbose);
-  fclose(out);
-  /*  */
   if(p->print_density_field){
     /* 
        print the density field 
     */
     sprintf(file_prefix,"dscaled");
-    if(p->sol_binary_out)
+    if(p->sol_binary_out == HC_SH_CONTAINER)
+      sprintf(filename,"%s.%s",file_prefix,HC_SOLOUT_FILE_CONTAINER);
+    else if(p->sol_binary_out)
       sprintf(filename,"%s.%s",file_prefix,HC_SOLOUT_FILE_BINARY);
     else
       sprintf(filename,"%s.%s",file_prefix,HC_SOLOUT_FILE_ASCII);
@@ -249,27 +228,147 @@ int main(int argc, char **argv)
       fclose(out);
     }
   }
-  if(p->print_spatial){
+  /* 
+     
+     all requested solutions, summed from the same poloidal and
+     toroidal solution
+     
+  */
+  if((!p->nsol_modes)&&(!p->compute_dtopo)){ /* only the one solved for */
+    p->sol_modes[0] = p->solution_mode;
+    p->nsol_modes = 1;
+  }
+  /* 
+     sol_spectral holds the solution_mode solution after hc_solve,
+     which need not be the first of the list if -rtrac or -htrac
+     came after -sol
+  */
+  sol_mode = p->solution_mode;
+  for(k=0;k < p->nsol_modes;k++){
+    mode = p->sol_modes[k];
+    if(mode != sol_mode){
+      if(p->verbose)
+	fprintf(stderr,"%s: summing solution mode %i from the same solve\n",
+		argv[0],mode);
+      hc_sum(model,model->nrad,model->pol_sol,model->tor_sol,mode,
+	     p->free_slip,sol_spectral,p->verbose);
+      model->spatial_solution_computed = FALSE;
+      sol_mode = mode;
+    }
     /* 
-       we wish to use the spatial solution
-       
-       expand velocities to spatial base, compute spatial
-       representation
-       
+     
+       output of spherical harmonics solution
+     
     */
-    hc_compute_sol_spatial(model,sol_spectral,&sol_spatial,
-			   p->verbose);
+    switch(mode){
+    case HC_VEL:
+      sprintf(sol_prefix,"vel");break;
+    case HC_RTRACTIONS:
+      sprintf(sol_prefix,"rtrac");break;
+    case HC_HTRACTIONS:
+      sprintf(sol_prefix,"htrac");break;
+    default:
+      HC_ERROR(argv[0],"solution mode undefined");break;
+    }
+    if(p->sol_binary_out == HC_SH_CONTAINER)
+      sprintf(filename,"%s.%s",sol_prefix,HC_SOLOUT_FILE_CONTAINER);
+    else if(p->sol_binary_out)
+      sprintf(filename,"%s.%s",sol_prefix,HC_SOLOUT_FILE_BINARY);
+    else
+      sprintf(filename,"%s.%s",sol_prefix,HC_SOLOUT_FILE_ASCII);
+    if(p->verbose)
+      fprintf(stderr,"%s: writing spherical harmonics solution to %s\n",
+	      argv[0],filename);
+    out = ggrd_open(filename,"w","main");
+    hc_print_spectral_solution(model,sol_spectral,out,
+			       mode,
+			       p->sol_binary_out,p->verbose);
+    fclose(out);
+    /*  */
+    if(p->print_spatial){
+      /* 
+	 a single solution keeps the old spatial file names, which
+	 use the density prefix if that field was printed
+      */
+      sprintf(filename,"%s.%s",(((p->nsol_modes == 1)&&(p->print_density_field))?
+				  (file_prefix):(sol_prefix)),
+	      HC_SPATIAL_SOLOUT_FILE);
+      if(p->spatial_ring){
+	/* 
+	   transform and print layer by layer, bounded memory
+	*/
+	hc_stream_spatial_solution(model,sol_spectral,
+				   filename,HC_LAYER_OUT_FILE,
+				   mode,p->sol_binary_out,
+				   p->spatial_ring,p->verbose);
+      }else{
+	/* 
+	   we wish to use the spatial solution
+	 
+	   expand velocities to spatial base, compute spatial
+	   representation
+	 
+	*/
+	hc_compute_sol_spatial(model,sol_spectral,&sol_spatial,mode,
+			       p->verbose);
+	/* 
+	 
+	   output of spatial solution
+	 
+	*/
+	/* print lon lat z v_r v_theta v_phi */
+	hc_print_spatial_solution(model,sol_spectral,sol_spatial,
+				  filename,HC_LAYER_OUT_FILE,
+				  mode,p->sol_binary_out,
+				  p->verbose);
+      }
+    }
+    if(p->print_vtu){
+      /* 
+	 XML VTK output, directly from the solution, horizontal
+	 tractions are written as a cartesian stress tensor
+      */
+      if(!model->spatial_solution_computed)
+	hc_compute_sol_spatial(model,sol_spectral,&sol_spatial,mode,
+			       p->verbose);
+      hc_vecalloc(&vtu_fac,3*model->nradp2,"main");
+      for(i=0;i < model->nradp2;i++)
+	hc_compute_solution_scaling_factors(model,mode,model->r[i],
+					    model->dvisc[i],(vtu_fac+i*3));
+      sprintf(filename,"%s.%s",sol_prefix,HC_VTU_OUT_FILE);
+      if(p->verbose)
+	fprintf(stderr,"%s: writing VTU file %s\n",argv[0],filename);
+      out = ggrd_open(filename,"w","main");
+      hc_print_vtu(out,sol_spectral,model->r,model->nradp2,
+		   sol_spatial,3*sol_spectral[0].npoints,vtu_fac,
+		   (mode == HC_VEL)?("velocity"):("traction"),
+		   (hc_boolean)(mode == HC_HTRACTIONS),NULL,0,0,(hc_boolean)(p->print_vtu == 2),p->verbose);
+      fclose(out);
+      free(vtu_fac);
+    }
+    if(p->grd_dx > 0){
+      /* 
+	 gridded output, directly from the spectral solution
+      */
+      hc_print_grd_solution(model,sol_spectral,sol_prefix,mode,
+			    p->grd_region,p->grd_dx,p->grd_native,p->verbose);
+    }
+  }
+  if(p->compute_dtopo){
     /* 
-
-       output of spatial solution
-       
+       dynamic topography from the surface radial tractions
     */
-    sprintf(filename,"%s.%s",file_prefix,HC_SPATIAL_SOLOUT_FILE);
-    /* print lon lat z v_r v_theta v_phi */
-    hc_print_spatial_solution(model,sol_spectral,sol_spatial,
-			      filename,HC_LAYER_OUT_FILE,
-			      p->solution_mode,p->sol_binary_out,
-			      p->verbose);
+    if(sol_mode != HC_RTRACTIONS)
+      hc_sum(model,model->nrad,model->pol_sol,model->tor_sol,HC_RTRACTIONS,
+	     p->free_slip,sol_spectral,p->verbose);
+    hc_compute_dynamic_topography(model,sol_spectral,&dtopo,TRUE,p->verbose);
+    if(p->verbose)
+      fprintf(stderr,"%s: writing dynamic topography to %s\n",argv[0],HC_DTOPO_FILE);
+    out = ggrd_open(HC_DTOPO_FILE,"w","main");
+    hc_print_sh_scalar_field(dtopo,out,FALSE,geoid_binary,p->verbose);
+    fclose(out);
+    sh_free_expansion(dtopo,1);
+    free(dtopo);
   }
   /* 
      
@@ -143,6 +143,7 @@ spherical harmonics
 //#include <malloc.h>
 
 #include <limits.h>
+#include <float.h>
 
 
 /* 
@@ -155,6 +156,93 @@ use short format for spherical harmonic models
 					      routines internally  */
 
 
+/* 
+
+buffered formatted output, see hc_format_e in hc_output.c
+
+*/
+struct hc_outbuf{
+  char *buf;
+  size_t n,size;
+  FILE *out;			/* NULL: keep everything in memory */
+};
+#define HC_OUTBUF_SIZE 4194304
+#define HC_FORMAT_LEN 512	/* room needed for one formatted number */
+/* 
+
+per-layer output of the spatial solution, see
+hc_print_spatial_solution and hc_stream_spatial_solution
+
+*/
+struct hc_spatial_out{
+  struct hcs *hc;
+  char *name;			/* files are name.i.dat or name.i.bin */
+  int sol_mode,np;		/* solution type and lateral points */
+  hc_boolean binary,verbose;
+  HC_PREC *xy;			/* lon lat of all points */
+  char *lstring;		/* ASCII: lon lat formatted once */
+  int *lloc;			/* start of point j in lstring */
+};
+/* 
+
+layer index of a solution file, for reading selected layers only,
+see hc_open_sh_solution in hc_input.c
+
+*/
+#define HC_SOL_INDEX_SUFFIX "idx"	/* cache is written to file.idx */
+#define HC_SOL_INDEX_MAGIC "HCSOLIDX"
+#define HC_SOL_INDEX_VERSION 2
+struct hc_sol_index_header{
+  char magic[8];
+  int version,binary,nset,shps,type,prec;
+  int kind,pad;			/* SH_SET_VECTOR or SH_SET_HTENSOR */
+  long long src_size,src_mtime;	/* of the indexed file, mtime in ns */
+};
+struct hc_sol_index_layer{
+  long long offset;		/* start of the coefficients */
+  double zlabel;
+  int lmax,pad;
+};
+struct hc_sol_index{
+  struct hc_sol_index_header h;
+  struct hc_sol_index_layer *layer;
+  struct sh_container *container; /* if the file is a container */
+  FILE *in;
+};
+/* 
+
+one array in the appended data section of a VTU file, see hc_vtu.c
+
+*/
+struct hc_vtu_array{
+  struct hc_outbuf *ob;		/* in-memory appended data */
+  size_t header;		/* location of the UInt64 header in ob */
+  size_t nbytes;		/* uncompressed size */
+  size_t nblock,iblock;		/* compressed blocks, total and done */
+  unsigned char *stage;		/* uncompressed block being filled */
+  size_t nstage;
+  hc_boolean compress;
+};
+#define HC_VTU_BLOCK 32768	/* zlib compression block size */
+#define HC_VTU_ZLIB_LEVEL 6
+#define HC_NSOL_MODES 3		/* vel, rtrac, htrac, for -sol */
+#define HC_SPATIAL_RING 3	/* default number of layer buffers
+				   for streamed spatial output */
+#ifdef HC_USE_PTHREADS
+#include <pthread.h>
+/* 
+   ring of layer buffers between the transform and the writer thread
+*/
+struct hc_spatial_ring{
+  struct hc_spatial_out *o;
+  HC_PREC *buf;			/* nring * 3 * np */
+  int nring,nlayer;
+  int nfull;			/* layers transformed but not written */
+  pthread_mutex_t lock;
+  pthread_cond_t filled,emptied;
+};
+#endif
+
 /* 
 
 for H & C solutions
@@ -206,10 +294,23 @@ struct hc_parameters{
   hc_boolean verbose;		/* debugging output? (0,1,2,3,4...) */
   hc_boolean sol_binary_out;	/* binary or ASCII output of SH expansion */
   hc_boolean print_spatial;	/* print the spatial solution */
+  int print_vtu;		/* 1: write the spatial solution as VTU,
+				   2: zlib compressed VTU */
+  int spatial_ring;		/* if > 0, transform and write the spatial
+				   solution layer by layer, using that many
+				   layer buffers */
+  HC_PREC grd_dx;		/* if > 0, write the spatial solution as
+				   GMT grids with this spacing [deg] */
+  HC_PREC grd_region[4];	/* w/e/s/n of those grids */
+  hc_boolean grd_native;	/* GMT native binary instead of netCDF */
   hc_boolean compute_geoid; 	/* compute and print the geoid */
   hc_boolean print_density_field;	 /* print the scaled density field */
   hc_boolean compute_geoid_correlations; 	/* compute correlations only */
   int solution_mode;	/* velocity or stress */
+  int sol_modes[HC_NSOL_MODES];	/* solutions to sum and write from the
+				   same solve, if set by -sol */
+  int nsol_modes;		/* if zero, only solution_mode */
+  hc_boolean compute_dtopo;	/* compute and print dynamic topography */
 
   int pvel_mode;		/* plate velocity mode */
   HC_PREC pvel_time;		/* time to use */
@@ -333,6 +434,8 @@ struct hcs{
   */
   /* poloidal solution */
   struct sh_lms *pol_sol;
+  int npol_sol,ntor_sol;	/* number of allocated pol_sol and
+				   tor_sol expansions, nrad may change */
   HC_PREC *rho,*rho_zero;	/* 
 				   density factors 
 				*/
@@ -393,6 +496,15 @@ solution modes
 
 /* 
 
+spherical harmonics solution output, the binary flag of the output
+routines is FALSE for ASCII, TRUE for plain binary, or
+HC_SH_CONTAINER for the indexed container of sh_container.c
+
+*/
+#define HC_SH_CONTAINER 2
+
+/* 
+
 init and assignment modes
 
 */
@@ -470,7 +582,16 @@ macro defintions
 #define HC_MEMERROR(x) {fprintf(stderr,"%s: memory allocation error, exiting\n",x);exit(-1);}
 #define HC_ERROR(x,y) {fprintf(stderr,"%s: error: %s, exiting\n",x,y);exit(-1);}
 
+/* alignment of blocks from hc_aligned_alloc, in bytes */
+#define HC_MEM_ALIGN 64
+
+/* stdio buffer for large coefficient input files */
+#define HC_READ_BUFSIZE 1048576
+/* max length of a number for hc_read_flt */
+#define HC_FLT_TOKEN_LEN 127
+
 #define HC_MIN(x,y) (( (x) < (y)) ? (x) : (y))
+#define HC_MAX(x,y) (( (x) > (y)) ? (x) : (y))
 
 #define HC_DIFFERENT(x,y) ((fabs((x)-(y)) > 1e-7)?(1):(0))
 
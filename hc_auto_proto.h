@@ -1,14 +1,23 @@
 /* convert_bernhard_dens.c */
+/* ggrd_advect.c */
 /* ggrd_grdtrack_util.c */
 void ggrd_init_master(struct ggrd_master *);
 void ggrd_grdinfo(char *);
 int ggrd_grdtrack_init_general(unsigned char, char *, char *, char *, struct ggrd_gt *, unsigned char, unsigned char, unsigned char);
 int ggrd_grdtrack_rescale(struct ggrd_gt *, unsigned char, unsigned char, unsigned char, double);
+unsigned char ggrd_grdtrack_interpolate_rtp_r(double, double, double, struct ggrd_gt *, double *, unsigned char, unsigned char, struct ggrd_cursor *);
+unsigned char ggrd_grdtrack_interpolate_lonlatz_r(double, double, double, struct ggrd_gt *, double *, unsigned char, struct ggrd_cursor *);
+unsigned char ggrd_grdtrack_interpolate_xyz_r(double, double, double, struct ggrd_gt *, double *, unsigned char, struct ggrd_cursor *);
+unsigned char ggrd_grdtrack_interpolate_tp_r(double, double, struct ggrd_gt *, double *, unsigned char, unsigned char, struct ggrd_cursor *);
+unsigned char ggrd_grdtrack_interpolate_xy_r(double, double, struct ggrd_gt *, double *, unsigned char, struct ggrd_cursor *);
 unsigned char ggrd_grdtrack_interpolate_rtp(double, double, double, struct ggrd_gt *, double *, unsigned char, unsigned char);
 unsigned char ggrd_grdtrack_interpolate_lonlatz(double, double, double, struct ggrd_gt *, double *, unsigned char);
 unsigned char ggrd_grdtrack_interpolate_xyz(double, double, double, struct ggrd_gt *, double *, unsigned char);
 unsigned char ggrd_grdtrack_interpolate_tp(double, double, struct ggrd_gt *, double *, unsigned char, unsigned char);
 unsigned char ggrd_grdtrack_interpolate_xy(double, double, struct ggrd_gt *, double *, unsigned char);
+void ggrd_cursor_init(struct ggrd_cursor *, struct ggrd_gt *);
+int ggrd_grdtrack_interpolate_batch(double *, double *, double *, int, struct ggrd_gt *, double *, unsigned char *, unsigned char);
+void ggrd_radix_sort_batch(struct ggrd_batch_sort *, struct ggrd_batch_sort *, int, long long);
 void ggrd_grdtrack_free_gstruc(struct ggrd_gt *);
 void ggrd_find_spherical_vel_from_rigid_cart_rot(double *, double *, double *, double *, double *);
 void ggrd_print_layer_avg(float *, float *, int, int, int, FILE *, GMT_LONG *);
@@ -25,10 +34,22 @@ float ggrd_gt_rms(float *, int);
 float ggrd_gt_mean(float *, int);
 /* ggrd_readgrds.c */
 void ggrd_init_vstruc(struct ggrd_master *);
+void ggrd_vel_set_lazy(struct ggrd_master *, double, unsigned char);
 int ggrd_read_vel_grids(struct ggrd_master *, double, unsigned short, unsigned short, char *, unsigned char);
 void ggrd_resort_and_check(double *, float *, double *, int, int, unsigned short, double, unsigned short, unsigned short, double, unsigned char *);
 void ggrd_read_depth_levels(struct ggrd_master *, int **, char *, unsigned short);
+void ggrd_vel_prefetch_wait(struct ggrd_master *);
+int ggrd_vel_stage_offset(struct ggrd_master *, int, double);
+int ggrd_vel_load_ages(struct ggrd_master *, int, int);
 /* ggrd_test.c */
+/* ggrd_tracer.c */
+int ggrd_tracer_init(struct ggrd_tracer *, struct ggrd_master *, int, double, unsigned char);
+void ggrd_tracer_stage_blend(struct ggrd_tracer *, struct ggrd_master *, double, struct ggrd_tracer_stage *);
+int ggrd_tracer_velocity(struct ggrd_tracer *, struct ggrd_master *, struct ggrd_tracer_stage *, double *, double *);
+int ggrd_tracer_step(struct ggrd_tracer *, struct ggrd_master *, double *, int, double, double, int);
+int ggrd_tracer_advect(struct ggrd_tracer *, struct ggrd_master *, double *, int, double, double, double, int, unsigned char);
+int ggrd_tracer_read_bin(char *, double **, int *);
+void ggrd_tracer_write_bin(char *, double *, int);
 /* ggrd_velinterpol.c */
 int ggrd_find_vel_and_der(double *, double, double, struct ggrd_master *, int, unsigned short, unsigned short, double *, double *, double *);
 void ggrd_get_velocities(double *, double *, double *, int, struct ggrd_master *, double, double);
@@ -37,6 +58,8 @@ void ggrd_weights(double, double *, int, int, double [(5 +1)][(1 +1)]);
 /* hc.c */
 /* hc_extract_sh_layer.c */
 /* hc_extract_spatial.c */
+/* hc_grd.c */
+void hc_print_grd_solution(struct hcs *, struct sh_lms *, char *, int, double *, double, unsigned short, unsigned short);
 /* hc_init.c */
 void hc_init_parameters(struct hc_parameters *);
 void hc_struc_init(struct hcs **);
@@ -44,6 +67,7 @@ void hc_init_polsol_struct(struct hc_ps *);
 void hc_init_main(struct hcs *, int, struct hc_parameters *);
 void hc_init_constants(struct hcs *, double, char *, unsigned short);
 void hc_handle_command_line(int, char **, int, struct hc_parameters *);
+void hc_parse_solution_list(char *, struct hc_parameters *);
 void hc_assign_viscosity(struct hcs *, int, double [4], struct hc_parameters *);
 void hc_assign_density(struct hcs *, unsigned short, int, char *, int, unsigned short, unsigned short, unsigned short, unsigned short, unsigned short, unsigned short, int, double *, double *, unsigned short);
 double hc_find_dens_scale(double, double, unsigned short, double *, double *, int);
@@ -58,6 +82,12 @@ void hc_read_scalar_shexp(char *, struct sh_lms **, char *, struct hc_parameters
 void hc_select_pvel(double, struct pvels *, struct sh_lms *, unsigned short);
 /* hc_input.c */
 int hc_read_sh_solution(struct hcs *, struct sh_lms **, FILE *, unsigned short, unsigned short);
+int hc_open_sh_solution(struct hcs *, struct hc_sol_index *, char *, unsigned short, unsigned short);
+void hc_read_sh_solution_layers(struct hc_sol_index *, struct sh_lms **, int, int, unsigned short);
+void hc_close_sh_solution(struct hc_sol_index *);
+void hc_sol_index_build(struct hc_sol_index *, char *, unsigned short, unsigned short);
+unsigned short hc_sol_index_load(struct hc_sol_index *, char *, unsigned short, unsigned short);
+void hc_sol_index_store(struct hc_sol_index *, char *, unsigned short);
 /* hc_invert_dtopo.c */
 /* hc_matrix.c */
 void hc_ludcmp_3x3(double [3][3], int, int *);
@@ -68,6 +98,7 @@ void hc_dvecalloc(double **, int, char *);
 void hc_svecalloc(float **, int, char *);
 void hc_ivecalloc(int **, int, char *);
 void hc_vecalloc(double **, int, char *);
+void *hc_aligned_alloc(size_t, char *);
 void hc_scmplx_vecalloc(struct hc_scmplx **, int, char *);
 void hc_svecrealloc(float **, int, char *);
 void hc_dvecrealloc(double **, int, char *);
@@ -81,6 +112,9 @@ double hc_mean_vec(double *, int);
 void hc_zero_dvector(double *, int);
 void hc_zero_lvector(unsigned short *, int);
 void hc_get_flt_frmt_string(char *, int, unsigned short);
+unsigned short hc_read_flt(FILE *, double *);
+unsigned short hc_skip_tokens(FILE *, long);
+unsigned short hc_parse_flt(char *, double *);
 char *hc_name_boolean(unsigned short);
 unsigned short hc_toggle_boolean(unsigned short *);
 void hc_advance_argument(int *, int, char **);
@@ -94,6 +128,11 @@ void hc_linear_interpolate(double *, int, double, int *, int *, double *, double
 void hc_print_spectral_solution(struct hcs *, struct sh_lms *, FILE *, int, unsigned short, unsigned short);
 void hc_print_sh_scalar_field(struct sh_lms *, FILE *, unsigned short, unsigned short, unsigned short);
 void hc_print_spatial_solution(struct hcs *, struct sh_lms *, double *, char *, char *, int, unsigned short, unsigned short);
+void hc_stream_spatial_solution(struct hcs *, struct sh_lms *, char *, char *, int, unsigned short, int, unsigned short);
+void *hc_spatial_writer(void *);
+void hc_spatial_out_init(struct hc_spatial_out *, struct hcs *, struct sh_lms *, char *, char *, int, unsigned short, unsigned short);
+void hc_print_spatial_layer(struct hc_spatial_out *, int, double *);
+void hc_spatial_out_free(struct hc_spatial_out *);
 void hc_print_depth_layers(struct hcs *, FILE *, unsigned short);
 void hc_print_3x3(double [3][3], FILE *);
 void hc_print_sm(double [6][4], FILE *);
@@ -105,6 +144,7 @@ void hc_compute_solution_scaling_factors(struct hcs *, int, double, double, doub
 void hc_print_poloidal_solution(struct sh_lms *, struct hcs *, int, char *, unsigned short, unsigned short);
 void hc_print_toroidal_solution(double *, int, struct hcs *, int, char *, unsigned short);
 void hc_print_vtk(FILE *, double *, double *, int, int, unsigned short, int, double *, int, int);
+void hc_print_vtk_vec(struct hc_outbuf *, double *);
 int hc_print_be_float(double *, int, FILE *, unsigned short);
 int hc_print_float(double *, int, FILE *);
 int hc_read_float(double *, int, FILE *);
@@ -113,6 +153,19 @@ unsigned short hc_is_little_endian(void);
 void hc_flip_byte_order(void *, size_t);
 void hc_flipit(void *, void *, size_t);
 void hc_print_dens_anom(struct hcs *, FILE *, unsigned short, unsigned short);
+int hc_format_e(char *, double, int, int);
+int hc_format_f(char *, double, int, int);
+int hc_format_i(char *, int);
+void hc_outbuf_init(struct hc_outbuf *, FILE *, size_t);
+void hc_outbuf_reserve(struct hc_outbuf *, size_t);
+void hc_outbuf_flush(struct hc_outbuf *);
+void hc_outbuf_free(struct hc_outbuf *);
+void hc_outbuf_e(struct hc_outbuf *, double, int, int);
+void hc_outbuf_f(struct hc_outbuf *, double, int, int);
+void hc_outbuf_i(struct hc_outbuf *, int);
+void hc_outbuf_s(struct hc_outbuf *, char *);
+void hc_outbuf_mem(struct hc_outbuf *, char *, size_t);
+void hc_outbuf_c(struct hc_outbuf *, char);
 /* hc_polsol.c */
 void hc_polsol(struct hcs *, int, double *, int, double *, unsigned short, struct sh_lms *, unsigned short, int, double *, double *, unsigned short, struct sh_lms *, struct sh_lms *, unsigned short, struct sh_lms *, unsigned short, unsigned short, unsigned short);
 /* hc_propagator.c */
@@ -121,11 +174,17 @@ void hc_evppot(int, double, double *);
 /* hc_solve.c */
 void hc_solve(struct hcs *, unsigned short, int, struct sh_lms *, unsigned short, unsigned short, unsigned short, unsigned short, unsigned short, struct sh_lms *, struct sh_lms *, struct sh_lms *, unsigned short);
 void hc_sum(struct hcs *, int, struct sh_lms *, struct sh_lms *, int, unsigned short, struct sh_lms *, unsigned short);
-void hc_compute_sol_spatial(struct hcs *, struct sh_lms *, double **, unsigned short);
+void hc_compute_sol_spatial(struct hcs *, struct sh_lms *, double **, int, unsigned short);
 void hc_compute_dynamic_topography(struct hcs *, struct sh_lms *, struct sh_lms **, unsigned short, unsigned short);
 /* hc_torsol.c */
 void hc_torsol(struct hcs *, int, int, int, double *, double **, double **, struct sh_lms *, struct sh_lms *, double *, unsigned short);
 /* hc_visc_scan.c */
+/* hc_vtu.c */
+void hc_print_vtu(FILE *, struct sh_lms *, double *, int, double *, int, double *, char *, unsigned short, double *, int, int, unsigned short, unsigned short);
+void hc_vtu_begin(struct hc_vtu_array *, struct hc_outbuf *, size_t, unsigned short);
+void hc_vtu_add(struct hc_vtu_array *, void *, size_t);
+void hc_vtu_end(struct hc_vtu_array *);
+void hc_vtu_compress_block(struct hc_vtu_array *);
 /* prem2dsm.c */
 /* prem_util.c */
 int prem_find_layer_x(double, double, double *, int, int, double *);
@@ -139,26 +198,68 @@ void prem_get_values(double *, double *, double *, double *, double *, double *,
 int prem_read_model(char *, struct prem_model *, unsigned short);
 int prem_read_para_set(double *, int, int, FILE *);
 /* print_gauss_lat.c */
+/* rick_cache_c.c */
+void rick_set_plm_cache_dir(char *);
+char *rick_get_plm_cache_dir(void);
+void rick_plm_cache_name(char *, char *, int, int);
+unsigned long long rick_plm_cache_checksum(unsigned long long, unsigned char *, size_t);
+size_t rick_plm_cache_size(int, int, int);
+void rick_plm_cache_set_header(struct rick_plm_cache_header *, int, int, int, int);
+SH_RICK_PREC *rick_plm_cache_load(int, int, int, int, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, void **, size_t *);
+void rick_plm_cache_store(int, int, int, int, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, SH_RICK_PREC *);
+void rick_plm_cache_unmap(void *, size_t);
 /* rick_fft_c.c */
-void rick_cs2ab(double *, int);
-void rick_ab2cs(double *, int);
-void rick_realft_nr(double *, int, int);
-void rick_four1_nr(double *, int, int);
+void rick_cs2ab(SH_RICK_PREC *, int);
+void rick_ab2cs(SH_RICK_PREC *, int);
+void rick_realft_nr(SH_RICK_PREC *, int, int);
+void rick_four1_nr(SH_RICK_PREC *, int, int);
+/* rick_plm_test.c */
+int main(int, char **);
+/* rick_prec_test.c */
+int main(int, char **);
 /* rick_sh_c.c */
-void rick_compute_allplm(int, int, double *, double *, struct rick_module *);
-void rick_compute_allplm_reg(int, int, double *, double *, struct rick_module *, double *, int);
-void rick_pix2ang(int, int, double *, double *, struct rick_module *);
-void rick_shc2d(double *, double *, int, int, double *, double *, struct rick_module *);
-void rick_shc2d_reg(double *, double *, int, int, double *, double *, struct rick_module *, double *, int, double *, int, unsigned short);
-void rick_shc2d_pre(double *, double *, int, double *, double *, int, double *, double *, struct rick_module *);
-void rick_shc2d_pre_reg(double *, double *, int, double *, double *, int, double *, double *, struct rick_module *, double *, int, double *, int, unsigned short);
-void rick_shc2d_irreg(double *, double *, int, int, double *, double *, struct rick_module *, double *, double *, int);
-void rick_shd2c(double *, double *, int, int, double *, double *, struct rick_module *);
-void rick_shd2c_pre(double *, double *, int, double *, double *, int, double *, double *, struct rick_module *);
+void rick_compute_allplm(int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_compute_allplm_reg(int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *, SH_RICK_PREC *, int);
+void rick_pix2ang(int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_shc2d(SH_RICK_PREC *, SH_RICK_PREC *, int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_shc2d_reg(SH_RICK_PREC *, SH_RICK_PREC *, int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *, SH_RICK_PREC *, int, SH_RICK_PREC *, int, unsigned short);
+void rick_shc2d_pre(SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_shc2d_pre_rv(SH_RICK_PREC *, SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, SH_RICK_PREC *, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_shc2d_pre_reg(SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *, SH_RICK_PREC *, int, SH_RICK_PREC *, int, unsigned short);
+void rick_reg_fourier(SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_reg_fourier_eval(SH_RICK_PREC *, int, SH_RICK_PREC *, int, int, SH_RICK_PREC *, struct rick_module *);
+int rick_reg_fft_size(SH_RICK_PREC *, int, int);
+void rick_shc2d_irreg(SH_RICK_PREC *, SH_RICK_PREC *, int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *, SH_RICK_PREC *, SH_RICK_PREC *, int);
+void rick_init_point_set(struct rick_point_set *, SH_RICK_PREC *, SH_RICK_PREC *, int);
+int rick_compare_point_sort(const void *, const void *);
+void rick_free_point_set(struct rick_point_set *);
+void rick_shc2d_point_set(SH_RICK_PREC *, SH_RICK_PREC *, int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *, struct rick_point_set *);
+SH_RICK_PREC rick_fourier_sum(SH_RICK_PREC *, int, SH_RICK_PREC);
+void rick_shd2c(SH_RICK_PREC *, SH_RICK_PREC *, int, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
+void rick_shd2c_pre(SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, int, SH_RICK_PREC *, SH_RICK_PREC *, struct rick_module *);
 void rick_init(int, int, int *, int *, int *, struct rick_module *, unsigned short);
 void rick_free_module(struct rick_module *, int);
-void rick_plmbar1(double *, double *, int, int, double, struct rick_module *);
-void rick_gauleg(double, double, double *, double *, int);
+void rick_alloc_workspace(struct rick_module *);
+void rick_plmbar1_factors(int, int, struct rick_module *);
+void rick_plmbar1(SH_RICK_PREC *, SH_RICK_PREC *, int, int, SH_RICK_HIGH_PREC, struct rick_module *);
+void rick_plmbar1_std(SH_RICK_PREC *, int, SH_RICK_HIGH_PREC, struct rick_module *);
+void rick_plmbar1_xnum(SH_RICK_PREC *, int, SH_RICK_HIGH_PREC, struct rick_module *);
+void rick_gauleg(SH_RICK_HIGH_PREC, SH_RICK_HIGH_PREC, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, int);
+void rick_gauleg_newton(SH_RICK_HIGH_PREC, SH_RICK_HIGH_PREC, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, int);
+void rick_gauleg_asymp(SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, int);
+void rick_gauleg_asymp_pair(int, int, double *, double *);
+double rick_bessel_j0_zero(int);
+void rick_gauss_points(int, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *);
+struct rick_tables *rick_get_tables(int, int, unsigned short);
+void rick_release_tables(struct rick_tables *);
+void rick_tables_factors(struct rick_tables *);
+SH_RICK_PREC *rick_get_plm_table(int, int, struct rick_module *);
+unsigned short rick_release_plm_table(SH_RICK_PREC *);
+/* rick_simd_c.c */
+struct rick_kernels *rick_get_kernels(void);
+char *rick_kernel_name(int);
+void rick_lm2mm(SH_RICK_PREC *, SH_RICK_PREC *, SH_RICK_PREC *, int, unsigned short, struct rick_module *);
+void rick_mm2lm(SH_RICK_HIGH_PREC *, SH_RICK_HIGH_PREC *, SH_RICK_PREC *, int, unsigned short, struct rick_module *);
 /* rotvec2vel.c */
 FILE *rv_myopen(const char *, const char *);
 /* sh_ana.c */
@@ -172,10 +273,26 @@ void shana_shd2c_pre(double *, double *, int, double *, double *, int, double *,
 void shana_init(int, int, int *, int *, int *, struct shana_module *);
 void shana_free_module(struct shana_module *, int);
 void shana_plmbar1(double *, double *, int, int, double, struct shana_module *);
+/* sh_container.c */
+void sh_container_le(void *, size_t, int);
+void sh_container_le_header(struct sh_container_header *);
+void sh_container_le_index(struct sh_container_layer *, int);
+long long sh_container_stride(int, int);
+unsigned short sh_container_detect(FILE *);
+struct sh_container *sh_container_create(FILE *, int, int, int);
+void sh_container_write_layer(struct sh_container *, struct sh_lms *, int, int, double, double *);
+struct sh_container *sh_container_open(FILE *, unsigned short);
+void sh_container_check_layer(struct sh_container *, int);
+void sh_container_view_layer(struct sh_container *, int, struct sh_lms *, int, unsigned short);
+void sh_container_copy_layer(struct sh_container *, int, struct sh_lms *, double *);
+void sh_container_close(struct sh_container *);
+void sh_container_release(struct sh_container *);
 /* sh_corr.c */
 /* sh_exp.c */
 void sh_allocate_and_init(struct sh_lms **, int, int, int, int, unsigned short, unsigned short);
+void sh_init_expansion_block(struct sh_lms *, int, int, int, int, unsigned short, unsigned short);
 void sh_init_expansion(struct sh_lms *, int, int, int, unsigned short, unsigned short);
+void sh_init_expansion_alm(struct sh_lms *, int, int, int, unsigned short, unsigned short, double *, int);
 void sh_free_expansion(struct sh_lms *, int);
 void sh_clear_alm(struct sh_lms *);
 double sh_total_power(struct sh_lms *);
@@ -186,32 +303,45 @@ void sh_single_par_and_exp_to_file(struct sh_lms *, char *, unsigned short, unsi
 void sh_single_par_and_exp_to_stream(struct sh_lms *, FILE *, unsigned short, unsigned short);
 void sh_print_parameters_to_stream(struct sh_lms *, int, int, int, double, FILE *, unsigned short, unsigned short, unsigned short);
 unsigned short sh_read_parameters_from_stream(int *, int *, int *, int *, int *, double *, int *, FILE *, unsigned short, unsigned short, unsigned short);
+unsigned short sh_read_set_parameters_from_stream(int *, int *, int *, int *, int *, double *, int *, int *, FILE *, unsigned short, unsigned short, unsigned short);
 void sh_print_coefficients_to_stream(struct sh_lms *, int, FILE *, double *, unsigned short, unsigned short);
 void sh_read_coefficients_from_stream(struct sh_lms *, int, int, FILE *, unsigned short, double *, unsigned short);
 void sh_print_nonzero_coeff(struct sh_lms *, FILE *);
 void sh_read_spatial_data_from_stream(struct sh_lms *, FILE *, unsigned short, int, double *, double *);
 void sh_read_spatial_data_from_grd(struct sh_lms *, struct ggrd_gt *, unsigned short, int, double *, double *);
+void sh_interpolate_spatial_data_from_grd(struct sh_lms *, struct ggrd_gt *, int, double *);
 void sh_read_spatial_data(struct sh_lms *, FILE *, struct ggrd_gt *, unsigned short, unsigned short, int, double *, double *);
 void sh_compute_spatial_basis(struct sh_lms *, FILE *, unsigned short, double, double **, int, unsigned short);
 void sh_compute_spectral(double *, int, unsigned short, double **, struct sh_lms *, unsigned short);
 void sh_compute_spatial(struct sh_lms *, int, unsigned short, double **, double *, unsigned short);
+void sh_compute_spatial_rv(struct sh_lms *, unsigned short, double **, double *, unsigned short);
 void sh_compute_spatial_reg(struct sh_lms *, int, unsigned short, double **, double *, int, double *, int, double *, unsigned short, unsigned short);
 void sh_compute_spatial_irreg(struct sh_lms *, int, double *, double *, int, double *, unsigned short);
+void sh_compute_spatial_tensor(struct sh_lms *, struct sh_lms *, unsigned short, double **, double *, unsigned short);
+void sh_compute_spatial_tensor_reg(struct sh_lms *, struct sh_lms *, double **, double **, double *, int, double *, int, double *, unsigned short);
 void sh_exp_type_error(char *, struct sh_lms *);
 void sh_print_plm(double *, int, int, int, FILE *);
 void sh_print_spatial_data_to_stream(struct sh_lms *, int, double *, unsigned short, double, FILE *);
 void sh_get_coordinates(struct sh_lms *, int, double *, double *);
 void sh_print_reg_spatial_data_to_stream(struct sh_lms *, int, double *, unsigned short, double, double *, int, double *, int, FILE *);
 void sh_print_irreg_spatial_data_to_stream(struct sh_lms *, int, double *, unsigned short, double, double *, double *, int, FILE *);
+void sh_free_plm(double **);
 void sh_compute_plm(struct sh_lms *, int, double **, unsigned short);
 void sh_compute_plm_reg(struct sh_lms *, int, double **, unsigned short, double *, int);
 void sh_get_coeff(struct sh_lms *, int, int, int, unsigned short, double *);
 void sh_write_coeff(struct sh_lms *, int, int, int, unsigned short, double *);
 void sh_add_coeff(struct sh_lms *, int, int, int, unsigned short, double *);
+double *sh_phys_norm_table(int);
+double *sh_lslice(struct sh_lms *, int);
+void sh_get_coeff_l(struct sh_lms *, int, unsigned short, double *);
+void sh_write_coeff_l(struct sh_lms *, int, unsigned short, double *);
+void sh_get_phys_norm_coeff(struct sh_lms *, double *);
+void sh_write_phys_norm_coeff(struct sh_lms *, double *);
 void sh_copy_lms(struct sh_lms *, struct sh_lms *);
 void sh_aexp_equals_bexp_coeff(struct sh_lms *, struct sh_lms *);
 void sh_c_is_a_plus_b_coeff(struct sh_lms *, struct sh_lms *, struct sh_lms *);
 void sh_scale_expansion_l_factor(struct sh_lms *, double *);
+void sh_add_expansion_l_factor(struct sh_lms *, struct sh_lms *, double *);
 void sh_scale_expansion(struct sh_lms *, double);
 /* sh_extract_layer.c */
 /* sh_model.c */
@@ -4,6 +4,11 @@
 
 extract part of a spherical harmonics solution of a HC run
 
+only the selected layers are read, see hc_open_sh_solution
+
+horizontal traction solutions keep their stress tensor tag in mode
+3, and mode 1 prints the isotropic part as a scalar
+
 
 $Id: hc_extract_sh_layer.c,v 1.9 2006/01/22 01:11:34 becker Exp becker $
 
@@ -13,11 +18,11 @@ $Id: hc_extract_sh_layer.c,v 1.9 2006/01/22 01:11:34 becker Exp becker $
 int main(int argc, char **argv)
 {
   int ilayer,nsol,i,mode,shps=1,nset=1,loop,i1,i2,shps_read;
-  FILE *in;
+  struct hc_sol_index idx;
   struct sh_lms *sol=NULL;
   struct hcs *model;
   HC_PREC fac[3] = {1.0,1.0,1.0};
-  hc_boolean binary = TRUE, verbose = TRUE, short_format = FALSE;
+  hc_boolean binary = TRUE, verbose = TRUE, short_format = FALSE,htensor;
   hc_struc_init(&model);
   /* 
      deal with parameters
@@ -56,18 +61,22 @@ int main(int argc, char **argv)
     fprintf(stderr,"\t          4, will print the depth levels of all layers\n");
     fprintf(stderr,"\t          5, will print x_pol\n");
     fprintf(stderr,"\t          6, will print x_tor\n");
+    fprintf(stderr,"horizontal traction solutions only allow modes 1, 3, and 4\n");
     exit(-1);
     break;
   }
   if(mode == 4)
     ilayer = -2;
   /* 
-     read in solution
+     open solution, this only reads the layer depths
   */
-  in = ggrd_open(argv[1],"r","hc_extract_sh_layer");
-  shps_read = hc_read_sh_solution(model,&sol,in,binary,verbose);
-  fclose(in);
-  nsol = model->nradp2 * shps_read;
+  shps_read = hc_open_sh_solution(model,&idx,argv[1],binary,verbose);
+  htensor = (hc_boolean)(idx.h.kind == SH_SET_HTENSOR);
+  if(htensor && ((mode == 2)||(mode == 5)||(mode == 6))){
+    fprintf(stderr,"%s: error, %s holds horizontal stresses, use mode 1 or 3 instead of %i\n",
+	    argv[0],argv[1],mode);
+    exit(-1);
+  }
   /* 
      deal with selection
   */
@@ -106,6 +115,13 @@ int main(int argc, char **argv)
     exit(-1);
     
   }
+  /* read the selected layers */
+  if(mode != 4){
+    hc_read_sh_solution_layers(&idx,&sol,i1,i2,verbose);
+    nsol = (i2-i1+1) * shps_read;
+  }else
+    nsol = 0;
+  hc_close_sh_solution(&idx);
   for(ilayer=i1;ilayer <= i2;ilayer++){
     /* 
        output 
@@ -114,7 +130,8 @@ int main(int argc, char **argv)
       /* SH header */
       if(short_format && loop)
 	fprintf(stdout,"%g\n",(double)HC_Z_DEPTH(model->r[ilayer]));
-      sh_print_parameters_to_stream((sol+ilayer*shps_read),shps,
+      sh_print_parameters_to_stream((sol+(ilayer-i1)*shps_read),
+				    ((htensor && (shps == 3))?(-shps):(shps)),
 				    ilayer,nset,(HC_PREC)(HC_Z_DEPTH(model->r[ilayer])),
 				    stdout,short_format,FALSE,verbose);
     }
@@ -124,21 +141,21 @@ int main(int argc, char **argv)
       if(verbose)
 	fprintf(stderr,"%s: printing x_r SHE at layer %i (depth: %g)\n",
 		argv[0],ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
-      sh_print_coefficients_to_stream((sol+ilayer*shps_read),shps,stdout,fac,FALSE,verbose);
+      sh_print_coefficients_to_stream((sol+(ilayer-i1)*shps_read),shps,stdout,fac,FALSE,verbose);
       break;
     case 2:
       /*  */
       if(verbose)
 	fprintf(stderr,"%s: printing x_pol x_tor SHE at layer %i (depth: %g)\n",
 		argv[0],ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
-      sh_print_coefficients_to_stream((sol+ilayer*shps_read+1),shps,stdout,fac,FALSE,verbose);
+      sh_print_coefficients_to_stream((sol+(ilayer-i1)*shps_read+1),shps,stdout,fac,FALSE,verbose);
       break;
     case 3:
       /* mode == 3 */
       if(verbose)
 	fprintf(stderr,"%s: printing x_r x_pol x_tor SHE at layer %i (depth: %g)\n",
 		argv[0],ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
-      sh_print_coefficients_to_stream((sol+ilayer*shps_read),shps,stdout,fac,FALSE,verbose);
+      sh_print_coefficients_to_stream((sol+(ilayer-i1)*shps_read),shps,stdout,fac,FALSE,verbose);
       break;
     case 4:
       fprintf(stdout,"%5i %11g\n",ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
@@ -148,14 +165,14 @@ int main(int argc, char **argv)
       if(verbose)
 	fprintf(stderr,"%s: printing x_pol SHE at layer %i (depth: %g)\n",
 		argv[0],ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
-      sh_print_coefficients_to_stream((sol+ilayer*shps_read+1),shps,stdout,fac,FALSE,verbose);
+      sh_print_coefficients_to_stream((sol+(ilayer-i1)*shps_read+1),shps,stdout,fac,FALSE,verbose);
       break;
     case 6:
       /*  */
       if(verbose)
 	fprintf(stderr,"%s: printing x_tor SHE at layer %i (depth: %g)\n",
 		argv[0],ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
-      sh_print_coefficients_to_stream((sol+ilayer*shps_read+2),shps,stdout,fac,FALSE,verbose);
+      sh_print_coefficients_to_stream((sol+(ilayer-i1)*shps_read+2),shps,stdout,fac,FALSE,verbose);
       break;
  
     default:
@@ -165,7 +182,8 @@ int main(int argc, char **argv)
     }
   }
   /* clear and exit */
-  sh_free_expansion(sol,nsol);
+  if(nsol)
+    sh_free_expansion(sol,nsol);
 
   return 0;
 }
@@ -4,22 +4,29 @@
 
 extract part of a solution of a HC run and convert to spatial
 
+only the selected layers are read, using a layer index (see
+hc_open_sh_solution), and the layers are transformed in parallel
+
+horizontal traction solutions (-htrac) are tagged as stress tensor
+sets and synthesized as stt, stp, spp with sh_compute_spatial_tensor,
+only modes 3, 4, 7, and 8 apply to those
+
 
 */
 
 int main(int argc, char **argv)
 {
   int ilayer,nvsol,ndsol=0,mode,shps,loop,i1,i2,nlat,nlon,
-    ivec,lc,ndata,ndata_all,ndata_d,npoints,i,j,
+    ivec,lc,nl,ndata,ndata_all,ndata_d,npoints,i,j,
     poff,shps_read=0,shps_read_d=0;
-  FILE *in;
-  struct sh_lms *vsol=NULL,*dsol=NULL;
+  struct hc_sol_index vidx,didx;
+  struct sh_lms *vsol=NULL,*dsol=NULL,*work;
   struct hcs *model;
   HC_PREC zlabel;
-  hc_boolean binary_in = TRUE, verbose = FALSE,read_dsol=FALSE;
-  HC_PREC *data,*plm=NULL,*xpos,*xvec,lon,lat,theta,phi,xtmp[3],pvec[3],
+  hc_boolean binary_in = TRUE, verbose = FALSE,read_dsol=FALSE,htensor;
+  HC_PREC *data,*plm,*xpos,*xvec,lon,lat,theta,phi,pvec[3],
     *xscalar;
-  HC_PREC polar_base[9];
+  HC_PREC *polar_base;
   hc_struc_init(&model);
   /* 
      deal with parameters
@@ -43,6 +50,7 @@ int main(int argc, char **argv)
     fprintf(stderr,"%s: usage\n%s sol.file layer [mode,%i] [scalar.sol]\n\n",
 	    argv[0],argv[0],mode);
     fprintf(stderr,"extracts spatial solution (velocity or stress, v) from output file sol.file\n");
+    fprintf(stderr,"         horizontal traction solutions are printed as stt stp spp, modes 3, 4, 7, and 8 only\n");
     fprintf(stderr,"         if scalar.sol argument is given, will also read in a scalar for VTK output\n");
     fprintf(stderr,"layer: 1...nset\n");
     fprintf(stderr,"\tif ilayer= 1..nset, will print one layer\n");
@@ -55,18 +63,18 @@ int main(int argc, char **argv)
     fprintf(stderr,"\t          4, will print the depth levels of all layers\n");
     fprintf(stderr,"\t          5, compute all depth levels (set ilayer=-2) and write VTK file, ASCII\n");
     fprintf(stderr,"\t          6, compute all depth levels (set ilayer=-2) and write VTK file, BINARY\n");
+    fprintf(stderr,"\t          7, compute all depth levels (set ilayer=-2) and write XML VTK (.vtu) file\n");
+    fprintf(stderr,"\t          8, compute all depth levels (set ilayer=-2) and write zlib compressed .vtu file\n");
     exit(-1);
     break;
   }
-  if((mode == 4)||(mode==5)||(mode==6))
+  if((mode >= 4)&&(mode <= 8))
     ilayer = -2;
   /* 
-     read in velocity/traction solution
+     open velocity/traction solution, this only reads the layer depths
   */
-  in = ggrd_open(argv[1],"r","hc_extract_spatial");
-  shps_read = hc_read_sh_solution(model,&vsol,in,binary_in,verbose);
-  fclose(in);
-  nvsol = model->nradp2 * shps_read;
+  shps_read = hc_open_sh_solution(model,&vidx,argv[1],binary_in,verbose);
+  htensor = (hc_boolean)(vidx.h.kind == SH_SET_HTENSOR);
   /* 
      deal with selection
   */
@@ -88,12 +96,32 @@ int main(int argc, char **argv)
   }else{
     i1=ilayer-1;i2 = i1;
   }
+  nl = i2 - i1 + 1;
+  if(mode == 4){
+    /* depth levels only */
+    for(ilayer=i1;ilayer <= i2;ilayer++)
+      fprintf(stdout,"%5i %11g\n",ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
+    hc_close_sh_solution(&vidx);
+    return 0;
+  }
+  if((mode < 1)||(mode > 8)){
+    fprintf(stderr,"%s: error, mode %i undefined\n",argv[0],mode);
+    exit(-1);
+  }
+  if(htensor && (mode != 3) && (mode != 7) && (mode != 8)){
+    fprintf(stderr,"%s: error, %s holds horizontal stresses, use mode 3, 7, or 8 instead of %i\n",
+	    argv[0],argv[1],mode);
+    exit(-1);
+  }
+  hc_read_sh_solution_layers(&vidx,&vsol,i1,i2,verbose);
+  hc_close_sh_solution(&vidx);
+  nvsol = nl * shps_read;
   /* detect number of expansions */
   if(mode == 1){
     shps = 1;			/* r */
   }else if(mode == 2){
     shps = 2;			/* theta,phi */
-  }else if((mode == 3)||(mode == 5)||(mode==6)){
+  }else if((mode == 3)||((mode >= 5)&&(mode <= 8))){
     shps = 3;			/* r,theta,phi */
   }else{
     shps = 1;
@@ -107,88 +135,80 @@ int main(int argc, char **argv)
      density solution or other scalar
   */
   if(read_dsol){
-    if((mode != 5)&&(mode != 6))
-      HC_ERROR("hc_extract_spatial","error, only mode 5 and  can handle scalar input");
-    in = ggrd_open(argv[4],"r","hc_extract_spatial");
-    shps_read_d = hc_read_sh_solution(model,&dsol,in,binary_in,
-				    verbose);
-    fclose(in);
-    ndsol = model->nradp2 * shps_read_d;
+    if((mode < 5)||(mode > 8))
+      HC_ERROR("hc_extract_spatial","error, only modes 5 to 8 can handle scalar input");
+    shps_read_d = hc_open_sh_solution(model,&didx,argv[4],binary_in,
+				      verbose);
+    hc_read_sh_solution_layers(&didx,&dsol,i1,i2,verbose);
+    hc_close_sh_solution(&didx);
+    ndsol = nl * shps_read_d;
   }
   /* 
      
      room for spatial expansion 
 
   */
-  npoints = (vsol+i1*shps_read)->npoints;
-  if((vsol+i1*shps_read)->type != SH_RICK)
+  npoints = vsol->npoints;
+  if(vsol->type != SH_RICK)
     HC_ERROR("sh_extract_spatial","SH_RICK type required");
   /* geographic set up */
-  nlat = (vsol+i1*shps_read)->rick.nlat;
-  nlon = (vsol+i1*shps_read)->rick.nlon;
+  nlat = vsol->rick.nlat;
+  nlon = vsol->rick.nlon;
   
   ndata =     npoints * shps ;
   ndata_d =   npoints * shps_read_d;
   ndata_all = npoints * (shps + shps_read_d);
-
-  if((mode == 5)||(mode==6)){			/* save all layers */
-    hc_vecalloc(&data,model->nradp2 * ndata_all,"hc_extract_spatial");
-  }else
-    hc_vecalloc(&data, ndata_all,"hc_extract_spatial");
-  for(lc=0,ilayer=i1;ilayer <= i2;ilayer++,lc++){
+  /* 
+     transform all selected layers, in parallel, each thread with its
+     own Legendre function pointer
+  */
+  hc_vecalloc(&data,nl * ndata_all,"hc_extract_spatial");
+#ifdef _OPENMP
+#pragma omp parallel private(lc,ivec,plm,work)
+#endif
+  {
+    plm = NULL;work = NULL;
+    if(htensor)			/* for the derivative expansions */
+      sh_allocate_and_init(&work,4,vsol->lmax,vsol->type,1,FALSE,FALSE);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1)
+#endif
+    for(lc=0;lc < nl;lc++){
+      if(htensor){		/* stt, stp, spp */
+	sh_compute_spatial_tensor((vsol+lc*shps_read),work,TRUE,&plm,
+				  (data+lc*ndata_all),verbose);
+      }else if(mode == 2){		/* theta,phi */
+	ivec=TRUE;sh_compute_spatial((vsol+lc*shps_read+1),ivec,TRUE,&plm,(data+lc*ndata_all),verbose);
+      }else{
+	ivec=FALSE;sh_compute_spatial((vsol+lc*shps_read),ivec,TRUE,&plm,(data+lc*ndata_all),verbose); /* radial */
+	if(shps == 3){
+	  ivec=TRUE; sh_compute_spatial((vsol+lc*shps_read+1),ivec,TRUE,&plm,(data+lc*ndata_all+npoints),verbose); /* theta,phi */
+	}
+      }
+      if(read_dsol){
+	ivec=FALSE;sh_compute_spatial((dsol+lc*shps_read_d),ivec,TRUE,&plm,(data+lc*ndata_all+npoints*shps),verbose); /* scalar */
+      }
+    }
+    sh_free_plm(&plm);
+    if(htensor){
+      sh_free_expansion(work,4);
+      free(work);
+    }
+  }
+  if((mode >= 1)&&(mode <= 3)){
     /* 
-       output 
+       output in layer order
     */
-
-    zlabel = HC_Z_DEPTH(model->r[ilayer]);
-    switch(mode){
-    case 1:
-      /*  */
-      if(verbose)
-	fprintf(stderr,"%s: printing v_r at layer %i (depth: %g)\n",argv[0],ilayer,
-		(double)zlabel);
-
-      ivec=FALSE;sh_compute_spatial((vsol+ilayer*shps_read),ivec,TRUE,&plm,data,verbose);
-      sh_print_spatial_data_to_stream((vsol+ilayer*shps_read),shps,data,TRUE,zlabel,stdout);
-      break;
-    case 2:
-      /*  */
+    for(lc=0,ilayer=i1;ilayer <= i2;ilayer++,lc++){
+      zlabel = HC_Z_DEPTH(model->r[ilayer]);
       if(verbose)
-	fprintf(stderr,"%s: printing v_theta v_phi SHE at layer %i (depth: %g)\n",argv[0],ilayer,(double)zlabel);
-      ivec=TRUE;sh_compute_spatial((vsol+ilayer*shps_read+1),ivec,TRUE,&plm,data,verbose);
-      sh_print_spatial_data_to_stream((vsol+ilayer*shps_read+1),shps,data,TRUE,zlabel,stdout);
-      break;
-    case 3:
-      if(verbose)
-	fprintf(stderr,"%s: printing v_r v_theta v_phi SHE at layer %i (depth: %g)\n",argv[0],ilayer,(double)zlabel);
-      ivec=FALSE;sh_compute_spatial((vsol+ilayer*shps_read),  ivec,TRUE,&plm,data,verbose); /* radial */
-      ivec=TRUE; sh_compute_spatial((vsol+ilayer*shps_read+1),ivec,TRUE,&plm,(data+npoints),verbose); /* theta,phi */
-      sh_print_spatial_data_to_stream((vsol+ilayer*shps_read),shps,data,TRUE,zlabel,stdout);
-      break;
-    case 4:
-      fprintf(stdout,"%5i %11g\n",ilayer,(double)HC_Z_DEPTH(model->r[ilayer]));
-      break;
-    case 5:			/* compute all and store */
-    case 6:
-      ivec=FALSE;sh_compute_spatial((vsol+ilayer*shps_read),  ivec,TRUE,&plm,(data+lc*ndata_all),verbose); /* radial */
-      ivec=TRUE; sh_compute_spatial((vsol+ilayer*shps_read+1),ivec,TRUE,&plm,(data+lc*ndata_all+npoints),verbose); /* theta,phi */
-      if(read_dsol){
-	if(!shps_read_d)
-	  HC_ERROR("sh_extract_spatial","logic error");
-	ivec=FALSE;sh_compute_spatial((dsol+ilayer*shps_read_d),ivec,TRUE,&plm,(data+lc*ndata_all+npoints*shps),verbose); /* radial */
-      }
-      break;
-    default:
-      fprintf(stderr,"%s: error, mode %i undefined\n",argv[0],mode);
-      exit(-1);
-      break;
+	fprintf(stderr,"%s: printing %s at layer %i (depth: %g)\n",argv[0],
+		(htensor)?("s_tt s_tp s_pp"):((mode==1)?("v_r"):((mode==2)?("v_theta v_phi SHE"):("v_r v_theta v_phi SHE"))),
+		ilayer,(double)zlabel);
+      sh_print_spatial_data_to_stream((vsol+lc*shps_read+((mode==2)?(1):(0))),
+				      shps,(data+lc*ndata_all),TRUE,zlabel,stdout);
     }
   }
-  /* clear and exit */
-  sh_free_expansion(vsol,nvsol);
-  if(read_dsol)
-    sh_free_expansion(dsol,ndsol);
-  free(plm);
   /*  */
   if((mode == 5)||(mode==6)){
     /* 
@@ -200,46 +220,56 @@ int main(int argc, char **argv)
     hc_vecalloc(&xvec,model->nradp2 * ndata,"hc_extract_spatial");
     if(read_dsol)
       hc_vecalloc(&xscalar,model->nradp2 * ndata_d,"hc_extract_spatial");
+    /* 
+       unit vectors and polar bases of all points, computed once
+    */
+    hc_vecalloc(&polar_base,9*npoints,"hc_extract_spatial");
     for(i=0;i < npoints;i++){	/* loop through all points */
       /* lon lat coordinates */
-      sh_get_coordinates((vsol+i1*3),i,&lon,&lat);
+      sh_get_coordinates(vsol,i,&lon,&lat);
       theta = LAT2THETA(lat);phi = LON2PHI(lon);
-      xtmp[0] = xtmp[1] = sin(theta);
-      xtmp[0] *= cos(phi);	/* x */
-      xtmp[1] *= sin(phi);	/* y */
-      xtmp[2] = cos(theta);	/* z */
-      /* for conversion */
-      calc_polar_base_at_theta_phi(theta,phi,polar_base);
-      for(ilayer=0;ilayer < model->nradp2;ilayer++){
-	/* this is the slow data storage loop but it avoids
-	   recomputing the polar basis vector */
+      calc_polar_base_at_theta_phi(theta,phi,(polar_base+i*9));
+    }
+    for(ilayer=0;ilayer < model->nradp2;ilayer++){
+      for(i=0;i < npoints;i++){	/* loop through all points */
 	poff = ilayer * ndata + i*shps;	/* point offset */
-	for(j=0;j < 3;j++){
-	  xpos[poff+j]   = xtmp[j] * model->r[ilayer]; /* cartesian coordinates */
-	}
-	/* data are stored a bit weirdly, this makes for lots of
-	   jumping around in memory ... */
+	for(j=0;j < 3;j++)	/* cartesian coordinates, the r basis
+				   vector is the unit location */
+	  xpos[poff+j]   = polar_base[i*9+j] * model->r[ilayer]; 
 	pvec[0] = data[ilayer*ndata_all +           i];
 	pvec[1] = data[ilayer*ndata_all + npoints  +i];
 	pvec[2] = data[ilayer*ndata_all + npoints*2+i];
-	lonlatpv2cv_with_base(pvec,polar_base,(xvec+poff));
-	/* assign scalar fata if any */
-	for(j=0;j < shps_read_d;j++)
-	  xscalar[j * model->nradp2 * ndata_d + ilayer * npoints  + i] = 
-	    data[ilayer * ndata_all + npoints*(shps+j) + i];
+	lonlatpv2cv_with_base(pvec,(polar_base+i*9),(xvec+poff));
       }
+      /* assign scalar fata if any */
+      for(j=0;j < shps_read_d;j++)
+	memcpy((xscalar+j * model->nradp2 * ndata_d + ilayer * npoints),
+	       (data+ilayer * ndata_all + npoints*(shps+j)),
+	       sizeof(HC_PREC)*npoints);
     }
-    free(data);
+    free(data);free(polar_base);
     /* print in VTK format */
     hc_print_vtk(stdout,xpos,xvec,npoints,model->nradp2,(mode==6),
 		 shps_read_d,xscalar,nlon,nlat);
     free(xvec);free(xpos);
     if(shps_read_d)
       free(xscalar);
-    
+  }else if((mode == 7)||(mode == 8)){
+    /* 
+       XML VTK directly from the spatial fields
+    */
+    hc_print_vtu(stdout,vsol,model->r,model->nradp2,
+		 data,ndata_all,NULL,(htensor)?("stress"):("velocity"),htensor,
+		 (data+npoints*shps),shps_read_d,ndata_all,
+		 (hc_boolean)(mode == 8),verbose);
+    free(data);
   }else{
     free(data);
   }
+  /* clear and exit */
+  sh_free_expansion(vsol,nvsol);
+  if(read_dsol)
+    sh_free_expansion(dsol,ndsol);
 
   return 0;
 }
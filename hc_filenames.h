@@ -12,7 +12,9 @@
 				   */
 #define HC_SOLOUT_FILE_ASCII  "sol.dat" /* solution output files */
 #define HC_SOLOUT_FILE_BINARY "sol.bin" 
+#define HC_SOLOUT_FILE_CONTAINER "sol.shc" /* indexed container */
 
+#define HC_VTU_OUT_FILE "vtu"	/* XML VTK spatial solution, see hc_vtu.c */
 #define HC_SPATIAL_SOLOUT_FILE  "ssol" /* spatial solution output
 					  files, those will ahave stuff
 					  appended like 5.bin */
@@ -27,3 +29,4 @@
 
 #define HC_LAYER_OUT_FILE "vdepth.dat" /* depth [km] output */
 #define HC_GEOID_FILE "geoid.ab" /* geoid output file */
+#define HC_DTOPO_FILE "dtopo.ab" /* dynamic topography output file */
@@ -0,0 +1,190 @@
+#include "hc.h"
+/*
+
+   gridded output of the spatial solution: all layers are synthesized
+   directly on a regular lon/lat grid with sh_compute_spatial_reg, and
+   written as GMT grids, one per layer and component, with the same
+   scaling as the -px output
+
+   the format is decided by GMT: COARDS netCDF by default, or, if
+   native is set, GMT native binary floats (=bf suffix)
+
+   the coefficients of each layer are copied into work expansions
+   which keep the Legendre functions and sin/cos factors of the grid
+   between layers, such that those are only computed once. the
+   synthesis itself is parallel over latitudes
+
+   horizontal tractions are synthesized as the stt, stp, and spp
+   tensor components with sh_compute_spatial_tensor_reg
+
+*/
+
+/*
+
+   sol:    spectral solution, three expansions per layer
+   name:   prefix, files are name.i.comp.grd, i = 1...nradp2
+   region: w/e/s/n in degrees, gridline registered with spacing dx. if
+           the poles are included, the latitude range is shrunk by
+           dx/2 to avoid the vector singularities. the grid starts at
+           w and at the non-polar latitude bound, and ends at the last
+           node within the region
+
+*/
+void hc_print_grd_solution(struct hcs *hc,struct sh_lms *sol,
+			   char *name,int sol_mode,HC_PREC *region,
+			   HC_PREC dx,hc_boolean native,
+			   hc_boolean verbose)
+{
+  int i,j,k,lmax,nphi,ntheta,npoints,os;
+  hc_boolean npole,spole;
+  HC_PREC w,e,s,n,*theta,*phi,*data,fac[3];
+  SH_RICK_PREC *plm_s=NULL,*plm_v=NULL;
+  struct sh_lms *wexp,*twork=NULL;
+  struct GRD_HEADER header;
+  float *fgrd;
+  char filename[HC_CHAR_LENGTH],*comp[3];
+#ifdef USE_GMT3
+  int pad[4]={0,0,0,0};
+#else
+  GMT_LONG pad[4]={0,0,0,0};
+  char *cdummy;
+  static hc_boolean gmt_init = FALSE;
+#endif
+  if(sol->type != SH_RICK)
+    HC_ERROR("hc_print_grd_solution","SH_RICK type required");
+  if(dx <= 0)
+    HC_ERROR("hc_print_grd_solution","grid spacing has to be positive");
+  switch(sol_mode){
+  case HC_VEL:
+    comp[0]="vr";comp[1]="vt";comp[2]="vp";break;
+  case HC_RTRACTIONS:
+    comp[0]="srr";comp[1]="srt";comp[2]="srp";break;
+  case HC_HTRACTIONS:
+    comp[0]="stt";comp[1]="stp";comp[2]="spp";break;
+  default:
+    HC_ERROR("hc_print_grd_solution","solution mode undefined");
+    break;
+  }
+  w = region[0];e = region[1];s = region[2];n = region[3];
+  if((w >= e)||(s >= n)||(s < -90)||(n > 90)){
+    fprintf(stderr,"hc_print_grd_solution: range error: -R%g/%g/%g/%g\n",
+	    (double)w,(double)e,(double)s,(double)n);
+    exit(-1);
+  }
+  npole = (n >= 90);spole = (s <= -90);
+  if(spole)
+    s += dx/2;
+  if(npole)
+    n -= dx/2;
+  /*
+     grid, truncated such that it stays within the region
+  */
+  nphi   = (int)((e-w)/dx + 1e-5) + 1;
+  ntheta = (int)((n-s)/dx + 1e-5) + 1;
+  e = w + (nphi-1)*dx;
+  if(npole && (!spole))	/* keep the southern bound */
+    n = s + (ntheta-1)*dx;
+  else
+    s = n - (ntheta-1)*dx;
+  npoints = nphi * ntheta;
+  hc_vecalloc(&phi,nphi,"hc_print_grd_solution");
+  hc_vecalloc(&theta,ntheta,"hc_print_grd_solution");
+  for(i=0;i < nphi;i++)
+    phi[i] = LON2PHI(w + i*dx);
+  for(j=0;j < ntheta;j++)	/* north to south, as GMT rows */
+    theta[j] = LAT2THETA(n - j*dx);
+  hc_vecalloc(&data,3*npoints,"hc_print_grd_solution");
+  fgrd = (float *)malloc(sizeof(float)*npoints);
+  if(!fgrd)
+    HC_MEMERROR("hc_print_grd_solution");
+  /*
+     work expansions: scalar, and poloidal/toroidal
+  */
+  lmax = sol->lmax;
+  for(i=0;i < hc->nradp2*3;i++)
+    lmax = HC_MAX(lmax,sol[i].lmax);
+  sh_allocate_and_init(&wexp,3,lmax,SH_RICK,1,verbose,TRUE);
+  if(sol_mode == HC_HTRACTIONS)	/* derivatives, divergence, and curl */
+    sh_allocate_and_init(&twork,4,lmax,SH_RICK,1,verbose,TRUE);
+  /*
+     GMT header
+  */
+#ifndef USE_GMT3
+  if(!gmt_init){
+    GMT_program = "hc";
+    GMT_make_fnan (GMT_f_NaN);
+    GMT_make_dnan (GMT_d_NaN);
+    GMT_io_init ();
+    GMT_grdio_init();
+    gmt_init = TRUE;
+  }
+  GMT_grd_init (&header,0,&cdummy,FALSE);
+#else
+  memset(&header,0,sizeof(struct GRD_HEADER));
+#endif
+  header.nx = nphi;header.ny = ntheta;
+  header.node_offset = 0;
+  header.x_min = w;header.x_max = e;
+  header.y_min = s;header.y_max = n;
+  header.x_inc = header.y_inc = dx;
+  header.z_scale_factor = 1.0;header.z_add_offset = 0.0;
+  strcpy(header.x_units,"longitude [degrees_east]");
+  strcpy(header.y_units,"latitude [degrees_north]");
+  strcpy(header.z_units,(sol_mode == HC_VEL)?("cm/yr"):("MPa"));
+  if(verbose)
+    fprintf(stderr,"hc_print_grd_solution: writing %i layers on -R%g/%g/%g/%g -I%g (%i by %i) to %s.i.%s.grd%s etc.\n",
+	    hc->nradp2,(double)w,(double)e,(double)s,(double)n,(double)dx,
+	    nphi,ntheta,name,comp[0],(native)?("=bf"):(""));
+  for(i=0;i < hc->nradp2;i++){
+    os = i*3;
+    hc_compute_solution_scaling_factors(hc,sol_mode,hc->r[i],
+					hc->dvisc[i],fac);
+    for(k=0;k < 3;k++){
+      sh_aexp_equals_bexp_coeff((wexp+k),(sol+os+k));
+      wexp[k].spectral_init = TRUE;
+    }
+    if(twork){
+      sh_compute_spatial_tensor_reg(wexp,twork,&plm_s,&plm_v,theta,ntheta,
+				    phi,nphi,data,verbose);
+    }else{
+      /* r, then theta and phi */
+      sh_compute_spatial_reg(wexp,0,TRUE,&plm_s,theta,ntheta,phi,nphi,
+			     data,verbose,TRUE);
+      sh_compute_spatial_reg((wexp+1),1,TRUE,&plm_v,theta,ntheta,phi,nphi,
+			     (data+npoints),verbose,TRUE);
+    }
+    for(k=0;k < 3;k++){
+      header.z_min =  HC_FLT_MAX;
+      header.z_max = -HC_FLT_MAX;
+      for(j=0;j < npoints;j++){
+	fgrd[j] = (float)(data[k*npoints+j] * fac[k]);
+	header.z_min = HC_MIN(header.z_min,fgrd[j]);
+	header.z_max = HC_MAX(header.z_max,fgrd[j]);
+      }
+      sprintf(header.title,"HC %s at %g km depth",comp[k],
+	      (double)HC_Z_DEPTH(hc->r[i]));
+      sprintf(filename,"%s.%i.%s.grd%s",name,i+1,comp[k],(native)?("=bf"):(""));
+#ifdef USE_GMT3
+      if(native)
+	HC_ERROR("hc_print_grd_solution","native binary grids need GMT4");
+      if(GMT_cdf_write_grd(filename,&header,fgrd,0.0,0.0,0.0,0.0,pad,FALSE)){
+#else
+      if(GMT_write_grd(filename,&header,fgrd,0.0,0.0,0.0,0.0,pad,FALSE)){
+#endif
+	fprintf(stderr,"hc_print_grd_solution: error writing %s\n",filename);
+	exit(-1);
+      }
+    }
+    if(verbose >= 2)
+      fprintf(stderr,"hc_print_grd_solution: layer %3i at %8.3f km done\n",
+	      i+1,(double)HC_Z_DEPTH(hc->r[i]));
+  }
+  sh_free_expansion(wexp,3);
+  free(wexp);
+  if(twork){
+    sh_free_expansion(twork,4);
+    free(twork);
+  }
+  sh_free_plm(&plm_s);sh_free_plm(&plm_v);
+  free(phi);free(theta);free(data);free(fgrd);
+}
@@ -48,6 +48,8 @@ void hc_init_parameters(struct hc_parameters *p)
   p->verbose = 0;		/* debugging output? (0,1,2,3,4...) */
   p->sol_binary_out = TRUE;	/* binary or ASCII output of SH expansion */
   p->solution_mode = HC_VEL;	/* default: velocity output */
+  p->nsol_modes = 0;		/* only solution_mode */
+  p->compute_dtopo = FALSE;
 
   p->print_density_field = TRUE; /* print the scaled density field (useful for debugging) */
 
@@ -55,6 +57,12 @@ void hc_init_parameters(struct hc_parameters *p)
   
   p->print_pt_sol = FALSE;
   p->print_spatial = FALSE;	/* by default, only print the spectral solution */
+  p->spatial_ring = 0;		/* compute all layers before printing */
+  p->print_vtu = 0;
+  p->grd_dx = 0;		/* no gridded output */
+  p->grd_region[0] = 0;p->grd_region[1] = 360;
+  p->grd_region[2] = -90;p->grd_region[3] = 90;
+  p->grd_native = FALSE;
   /* for four layer approaches */
   p->rlayer[0] = HC_ND_RADIUS(660);
   p->rlayer[1] = HC_ND_RADIUS(410);
@@ -106,6 +114,8 @@ void hc_struc_init(struct hcs **hc)
     (*hc)->dfact = (*hc)->rden = (*hc)->dvisc = NULL;
   (*hc)->rpb = (*hc)->fpb= NULL;
   (*hc)->dens_anom = NULL; /* expansions */
+  (*hc)->pol_sol = (*hc)->tor_sol = NULL;
+  (*hc)->npol_sol = (*hc)->ntor_sol = 0;
   (*hc)->plm = NULL;
   (*hc)->prem_init = FALSE;
 }
@@ -359,7 +369,8 @@ void hc_init_constants(struct hcs *hc, HC_PREC dens_anom_scale,
 void hc_handle_command_line(int argc, char **argv,int start_from_i,
 			    struct hc_parameters *p)
 {
-  int i;
+  int i,j;
+  double dtmp[4];
   hc_boolean used_parameter;
   for(i=start_from_i;i < argc;i++){
     used_parameter = FALSE;			/*  */
@@ -471,8 +482,27 @@ void hc_handle_command_line(int argc, char **argv,int start_from_i,
 		hc_name_boolean(p->print_pt_sol));
 	fprintf(stderr,"-px\t\tprint the spatial solution to file (%s)\n",
 		hc_name_boolean(p->print_spatial));
+	fprintf(stderr,"-pxs\tn\tprint the spatial solution, transforming and writing layer by layer\n");
+	fprintf(stderr,"\t\tthrough n layer buffers, memory independent of layers (%i, try %i)\n",
+		p->spatial_ring,HC_SPATIAL_RING);
+	fprintf(stderr,"-vtu\t\twrite the spatial solution as XML VTK file, *.%s (%s)\n",
+		HC_VTU_OUT_FILE,hc_name_boolean(p->print_vtu == 1));
+	fprintf(stderr,"-vtuz\t\tsame, but zlib compressed (%s)\n",
+		hc_name_boolean(p->print_vtu == 2));
+	fprintf(stderr,"-grd\tdx\twrite the spatial solution as GMT grids, *.i.vr.grd etc., with spacing dx [deg] (%g)\n",
+		(double)p->grd_dx);
+	fprintf(stderr,"-grdr\tw/e/s/n\tregion of those grids (%g/%g/%g/%g)\n",
+		(double)p->grd_region[0],(double)p->grd_region[1],
+		(double)p->grd_region[2],(double)p->grd_region[3]);
+	fprintf(stderr,"-grdbf\t\twrite GMT native binary grids instead of netCDF (%s)\n",
+		hc_name_boolean(p->grd_native));
+	fprintf(stderr,"-shc\t\twrite the spherical harmonics solution as indexed container, *.%s (%s)\n",
+		HC_SOLOUT_FILE_CONTAINER,hc_name_boolean(p->sol_binary_out == HC_SH_CONTAINER));
 	fprintf(stderr,"-rtrac\t\tcompute srr,srt,srp tractions [MPa] instead of velocities [cm/yr] (default: vel)\n");
-	fprintf(stderr,"-htrac\t\tcompute stt,stp,spp tractions [MPa] instead of velocities [cm/yr] (default: vel)\n");
+	fprintf(stderr,"-htrac\t\tcompute deviatoric stt,stp,spp stresses [MPa] instead of velocities [cm/yr] (default: vel)\n");
+	fprintf(stderr,"-sol\tlist\tsum and write all of the comma separated list of vel,rtrac,htrac,dtopo,geoid\n");
+	fprintf(stderr,"\t\tfrom one solve, instead of the above. dtopo is written to %s\n",
+		HC_DTOPO_FILE);
       }
       fprintf(stderr,"-v\t-vv\t-vvv: verbosity levels (%i)\n",
 	      (int)(p->verbose));
@@ -553,6 +583,44 @@ void hc_handle_command_line(int argc, char **argv,int start_from_i,
       if(strcmp(argv[i],"-px")==0){	/* print spatial solution? */
 	hc_toggle_boolean(&p->print_spatial);
 	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-pxs")==0){	/* streamed spatial solution */
+	p->print_spatial = TRUE;
+	hc_advance_argument(&i,argc,argv);
+	sscanf(argv[i],"%i",&p->spatial_ring);
+	if(p->spatial_ring < 1){
+	  fprintf(stderr,"%s: -pxs needs at least one layer buffer\n",argv[0]);
+	  exit(-1);
+	}
+	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-vtu")==0){	/* VTU output */
+	p->print_vtu = (p->print_vtu == 1)?(0):(1);
+	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-vtuz")==0){	/* compressed VTU output */
+	p->print_vtu = (p->print_vtu == 2)?(0):(2);
+	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-grd")==0){	/* gridded output */
+	hc_advance_argument(&i,argc,argv);
+	sscanf(argv[i],HC_FLT_FORMAT,&p->grd_dx);
+	if(p->grd_dx <= 0){
+	  fprintf(stderr,"%s: -grd needs a positive spacing\n",argv[0]);
+	  exit(-1);
+	}
+	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-grdr")==0){	/* region of grids */
+	hc_advance_argument(&i,argc,argv);
+	if(sscanf(argv[i],"%lf/%lf/%lf/%lf",(dtmp),(dtmp+1),(dtmp+2),(dtmp+3)) != 4){
+	  fprintf(stderr,"%s: -grdr needs w/e/s/n\n",argv[0]);
+	  exit(-1);
+	}
+	for(j=0;j < 4;j++)
+	  p->grd_region[j] = (HC_PREC)dtmp[j];
+	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-grdbf")==0){	/* native binary grids */
+	hc_toggle_boolean(&p->grd_native);
+	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-shc")==0){	/* container output */
+	p->sol_binary_out = (p->sol_binary_out == HC_SH_CONTAINER)?(TRUE):(HC_SH_CONTAINER);
+	used_parameter = TRUE;
       }else if(strcmp(argv[i],"-pptsol")==0){	/* print
 						   poloidal/toroidal
 						   solution
@@ -580,6 +648,10 @@ void hc_handle_command_line(int argc, char **argv,int start_from_i,
 						   tractions */
 	p->solution_mode = HC_HTRACTIONS;
 	used_parameter = TRUE;
+      }else if(strcmp(argv[i],"-sol")==0){	/* several solutions */
+	hc_advance_argument(&i,argc,argv);
+	hc_parse_solution_list(argv[i],p);
+	used_parameter = TRUE;
       }
     } /* end default operation mode branch  */
     if(!used_parameter){
@@ -591,6 +663,62 @@ void hc_handle_command_line(int argc, char **argv,int start_from_i,
 }
 /* 
 
+parse the -sol list, e.g. vel,rtrac,dtopo,geoid
+
+the velocity and traction solutions are summed and written in the
+given order, all from the same poloidal and toroidal solution. the
+geoid is only computed if listed
+
+*/
+void hc_parse_solution_list(char *list,struct hc_parameters *p)
+{
+  char *buf,*tok;
+  int mode,j;
+  hc_boolean geoid = FALSE;
+  buf = (char *)malloc(strlen(list)+1);
+  if(!buf)
+    HC_MEMERROR("hc_parse_solution_list");
+  strcpy(buf,list);
+  p->nsol_modes = 0;
+  p->compute_dtopo = FALSE;
+  for(tok = strtok(buf,",");tok;tok = strtok(NULL,",")){
+    mode = -1;
+    if(strcmp(tok,"vel")==0)
+      mode = HC_VEL;
+    else if(strcmp(tok,"rtrac")==0)
+      mode = HC_RTRACTIONS;
+    else if(strcmp(tok,"htrac")==0)
+      mode = HC_HTRACTIONS;
+    else if(strcmp(tok,"dtopo")==0)
+      p->compute_dtopo = TRUE;
+    else if(strcmp(tok,"geoid")==0)
+      geoid = TRUE;
+    else{
+      fprintf(stderr,"hc_parse_solution_list: error: solution %s unknown, use vel,rtrac,htrac,dtopo,geoid\n",
+	      tok);
+      exit(-1);
+    }
+    if(mode >= 0){
+      for(j=0;j < p->nsol_modes;j++)
+	if(p->sol_modes[j] == mode)
+	  break;
+      if(j == p->nsol_modes)
+	p->sol_modes[p->nsol_modes++] = mode;
+    }
+  }
+  if(!geoid)
+    p->compute_geoid = 0;
+  else if(p->compute_geoid != 2) /* keep all layers, if -ag was given */
+    p->compute_geoid = 1;
+  /* the first one is solved for */
+  if(p->nsol_modes)
+    p->solution_mode = p->sol_modes[0];
+  else if(p->compute_dtopo)
+    p->solution_mode = HC_RTRACTIONS;
+  free(buf);
+}
+/* 
+
 assign viscosity structure
 
 mode == 0
@@ -738,7 +866,8 @@ radii
 
 furthermore, the dfact factors are assigned as well
 
-set  density_in_binary to TRUE, if expansion given in binary
+set  density_in_binary to TRUE, if expansion given in binary. indexed
+containers (sh_container.c) are detected automatically
 
 nominal_lmax: -1: the max order of the density expansion will either
                   determine the lmax of the solution (free-slip, or vel_bc_zero) or 
@@ -764,6 +893,7 @@ void hc_assign_density(struct hcs *hc,
   double rho0;
   hc_boolean reported = FALSE,read_on;
   HC_PREC dtmp[3];
+  struct sh_container *cont = NULL;
   hc->compressible = compressible;
   hc->inho = 0;
   if(hc->dens_init)			/* clear old expansions, if 
@@ -795,13 +925,11 @@ void hc_assign_density(struct hcs *hc,
     */
 
     in = ggrd_open(filename,"r","hc_assign_density");
+    setvbuf(in,NULL,_IOFBF,HC_READ_BUFSIZE);
     if(verbose)
       fprintf(stderr,"hc_assign_density: reading density anomalies in [%g%%] from %s\n",
 	      100*HC_DENSITY_SCALING,filename);
     hc->inho = 0;		/* counter for density layers */
-    /* get one density expansion */
-    hc_get_blank_expansions(&hc->dens_anom,1,0,
-			    "hc_assign_density");
     /* 
        read all layers as spherical harmonics assuming real Dahlen &
        Tromp (physical) normalization, short format
@@ -812,6 +940,11 @@ void hc_assign_density(struct hcs *hc,
 	fprintf(stderr,"hc_assign_density: using short format for density SH\n");
       fscanf(in,"%i",&nset);
       ilayer = -1;
+    }else if(sh_container_detect(in)){
+      /* indexed container, header information from the layer index */
+      cont = sh_container_open(in,verbose);
+      nset = cont->h.nset;
+      ilayer = -1;
     }else{
       if(verbose)
 	fprintf(stderr,"hc_assign_density: using default SH format for density\n");
@@ -826,6 +959,16 @@ void hc_assign_density(struct hcs *hc,
 	read_on = (i == 2)?(TRUE):(FALSE);
 	ivec = 0;shps = 1;type = HC_DEFAULT_INTERNAL_FORMAT;
 	ilayer++;
+      }else if(cont){
+	ilayer++;
+	read_on = (ilayer < nset)?(TRUE):(FALSE);
+	if(read_on){
+	  lmax = cont->layer[ilayer].lmax;
+	  shps = cont->layer[ilayer].shps;
+	  type = cont->layer[ilayer].type;
+	  zlabel = (HC_PREC)cont->layer[ilayer].zlabel;
+	  ivec = (shps == 1)?(0):(1);
+	}
       }else{
 	read_on = sh_read_parameters_from_stream(&type,&lmax,&shps,&ilayer, &nset,
 						 &zlabel,&ivec,in,FALSE,density_in_binary,
@@ -853,11 +996,21 @@ void hc_assign_density(struct hcs *hc,
 	*/
 	if((shps != 1)||(ivec))
 	  HC_ERROR("hc_assign_density","vector field read in but only scalar expansion expected");
+	if(hc->inho == 0){
+	  /* 
+	     the number of layers is known from the first header,
+	     allocate all expansions on irregular grids in one block,
+	     and the depth levels
+	  */
+	  if(nset < 1)
+	    HC_ERROR("hc_assign_density","no layers in file");
+	  sh_allocate_and_init(&hc->dens_anom,nset,
+			       (nominal_lmax > lmax) ? (nominal_lmax):(lmax),
+			       hc->sh_type,0,verbose,FALSE);
+	  hc_vecrealloc(&hc->rden,nset,"hc_assign_density: rden");
+	}else if(hc->inho >= nset)
+	  HC_ERROR("hc_assign_density","file mode: mismatch in number of layers");
 	/* test and assign depth levels */
-	hc->rden=(HC_PREC *)
-	  realloc(hc->rden,(1+hc->inho)*sizeof(HC_PREC));
-	if(!hc->rden)
-	  HC_MEMERROR("hc_assign_density: rden");
 	/* 
 	   assign depth, this assumes that we are reading in depths [km]
 	*/
@@ -895,9 +1048,8 @@ void hc_assign_density(struct hcs *hc,
 	  /* 
 	     check by comparison with previous expansion 
 	  */
-	  if(nominal_lmax == -1)
-	    if(lmax != hc->dens_anom[0].lmax)
-	      HC_ERROR("hc_assign_density","lmax changed in file");
+	  if(((nominal_lmax > lmax) ? (nominal_lmax):(lmax)) != hc->dens_anom[0].lmax)
+	    HC_ERROR("hc_assign_density","lmax changed in file");
 	  if(hc->rden[hc->inho] <= hc->rden[hc->inho-1]){
 	    fprintf(stderr,"hc_assign_density: %i %g %g\n",hc->inho,
 		    (double)hc->rden[hc->inho], 
@@ -905,17 +1057,6 @@ void hc_assign_density(struct hcs *hc,
 	    HC_ERROR("hc_assign_density","depth should decrease, radius increase (give z[km])");
 	  }
 	}
-	/* 
-	   make room for new expansion 
-	*/
-	hc_get_blank_expansions(&hc->dens_anom,hc->inho+1,hc->inho,
-				"hc_assign_density");
-	/* 
-	   initialize expansion on irregular grid
-	*/
-	sh_init_expansion((hc->dens_anom+hc->inho),
-			  (nominal_lmax > lmax) ? (nominal_lmax):(lmax),
-			  hc->sh_type,0,verbose,FALSE);
 	/* 
 	   
 	read parameters and scale (put possible depth dependence of
@@ -924,8 +1065,11 @@ void hc_assign_density(struct hcs *hc,
 	will assume input is in physical convention
 	
 	*/
-	sh_read_coefficients_from_stream((hc->dens_anom+hc->inho),1,lmax,in,density_in_binary,
-					 dens_scale,verbose);
+	if(cont)
+	  sh_container_copy_layer(cont,ilayer,(hc->dens_anom+hc->inho),dens_scale);
+	else
+	  sh_read_coefficients_from_stream((hc->dens_anom+hc->inho),1,lmax,in,density_in_binary,
+					   dens_scale,verbose);
 	hc->inho++;
       }	/* end actualy read on */
     } /* end while */
@@ -935,6 +1079,8 @@ void hc_assign_density(struct hcs *hc,
     hc->rho_top_kg = rho0 * 1000;
     if(hc->inho != nset)
       HC_ERROR("hc_assign_density","file mode: mismatch in number of layers");
+    if(cont)
+      sh_container_close(cont);
     fclose(in);
     break;
   default:
@@ -946,13 +1092,10 @@ void hc_assign_density(struct hcs *hc,
        make a copy of the original density anomaly before applying
        depth dependent scaling, only done once per run 
     */
-    hc_get_blank_expansions(&hc->dens_anom_orig,hc->inho+1,hc->inho,
-			    "hc_assign_density");
-    for(i=0;i<hc->inho;i++){
-      sh_init_expansion((hc->dens_anom_orig+i),hc->dens_anom[0].lmax,
-			hc->sh_type,0,FALSE,FALSE);
+    sh_allocate_and_init(&hc->dens_anom_orig,hc->inho,hc->dens_anom[0].lmax,
+			 hc->sh_type,0,FALSE,FALSE);
+    for(i=0;i<hc->inho;i++)
       sh_aexp_equals_bexp_coeff((hc->dens_anom_orig+i),(hc->dens_anom+i));
-    }
     hc->orig_danom_saved=TRUE;
   }
   /* 
@@ -1185,11 +1328,12 @@ void hc_init_single_plate_exp(char *filename,struct hcs *hc, hc_boolean pvel_in_
 {
   FILE *in;
   int type,shps,ilayer,nset,ivec,lmax;
-  HC_PREC zlabel,vfac[2],t10[2],t11[2];
+  HC_PREC zlabel,vfac[2],t1[4];
   /* scale to go from cm/yr to internal scale */
   vfac[0] = vfac[1] = 1.0/hc->vel_scale;
   
   in = ggrd_open(filename,"r","hc_init_single_plate_exp");
+  setvbuf(in,NULL,_IOFBF,HC_READ_BUFSIZE);
   if(read_short_pvel_sh){
     ivec = 1;shps = 2;type = HC_DEFAULT_INTERNAL_FORMAT;ilayer=0;zlabel=0;nset=1;
     fscanf(in,"%i",&lmax);
@@ -1234,11 +1378,10 @@ void hc_init_single_plate_exp(char *filename,struct hcs *hc, hc_boolean pvel_in_
     /*  
 	check for net rotation
     */
-    sh_get_coeff((pvel+1),1,0,0,TRUE,t10);
-    sh_get_coeff((pvel+1),1,0,2,TRUE,t11);
-    if(fabs(t10[0])+fabs(t11[0])+fabs(t11[1]) > 1.0e-7)
+    sh_get_coeff_l((pvel+1),1,TRUE,t1); /* A(1,0) B(1,0) A(1,1) B(1,1) */
+    if(fabs(t1[0])+fabs(t1[2])+fabs(t1[3]) > 1.0e-7)
       fprintf(stderr,"\nhc_init_single_plate_exp: WARNING: toroidal A(1,0): %g A(1,1): %g B(1,1): %g\n\n",
-	      (double)t10[0],(double)t11[0],(double)t11[1]);
+	      (double)t1[0],(double)t1[2],(double)t1[3]);
   }
 }
 
@@ -1,4 +1,7 @@
 #include "hc.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /* 
 
@@ -7,6 +10,12 @@ routines dealing with input, pass sol initialized as NULL
 returns shps, the number of expansions. should be 3 for velocities and
 tractions, and 1 for density anomalies
 
+indexed containers (see sh_container.c) are detected automatically,
+and the expansions then use the memory-mapped coefficients in place
+
+hc_open_sh_solution and hc_read_sh_solution_layers read selected
+layers only, using a layer index
+
 $Id: hc_input.c,v 1.8 2004/12/20 05:18:12 becker Exp $
 
 */
@@ -16,6 +25,34 @@ int hc_read_sh_solution(struct hcs *hc,
 {
   int nset,ilayer,shps,lmax,type,ivec,nsol,i,os,n;
   HC_PREC zlabel,unity[3]={1.,1.,1.};
+  struct sh_container *cont;
+  if(sh_container_detect(in)){
+    /* 
+       indexed container
+    */
+    cont = sh_container_open(in,verbose);
+    nset = cont->h.nset;
+    shps = cont->h.shps;
+    *sol = (struct sh_lms *)realloc(*sol,nset * shps * sizeof(struct sh_lms));
+    if(!(*sol))
+      HC_MEMERROR("hc_read_sh_solution: sol");
+    hc->sh_type = cont->h.type;
+    hc->nrad = nset - 2;
+    hc->nradp2 = hc->nrad + 2;
+    hc_vecrealloc(&hc->r,nset,"hc_read_sh_solution");
+    for(ilayer=os=0;ilayer < nset;ilayer++,os += shps){
+      sh_container_view_layer(cont,ilayer,(*sol+os),1,verbose);
+      hc->r[ilayer] = HC_ND_RADIUS((HC_PREC)cont->layer[ilayer].zlabel);
+      if(verbose >= 2)
+	fprintf(stderr,"hc_read_sh_solution: z: %8.3f |exp(1)|: %12.5e\n",
+		(double)HC_Z_DEPTH(hc->r[ilayer]),
+		(double)sqrt(sh_total_power((*sol+os))));
+    }
+    sh_container_close(cont);	/* the views keep the mapping */
+    if(verbose)
+      fprintf(stderr,"hc_read_sh_solution: mapped %i solution layers\n",nset);
+    return shps;
+  }
    /* 
 
    read all layes as spherical harmonics assuming real Dahlen & Tromp
@@ -76,3 +113,252 @@ int hc_read_sh_solution(struct hcs *hc,
   }
   return shps;
 }
+/* modification time in ns, where available */
+static long long hc_sol_index_mtime(struct stat *st)
+{
+#if defined(__APPLE__)
+  return (long long)st->st_mtimespec.tv_sec * 1000000000LL + (long long)st->st_mtimespec.tv_nsec;
+#elif defined(_POSIX_C_SOURCE) && (_POSIX_C_SOURCE >= 200809L)
+  return (long long)st->st_mtim.tv_sec * 1000000000LL + (long long)st->st_mtim.tv_nsec;
+#else
+  return (long long)st->st_mtime * 1000000000LL;
+#endif
+}
+/* 
+
+open a solution file for reading selected layers only. the layer
+depths are assigned to hc (r, nrad, nradp2, sh_type), and the layer
+offsets are taken from the index, which is built by skipping through
+the file, and cached as filename.HC_SOL_INDEX_SUFFIX. the cache is
+only used if size and modification time of the file match
+
+containers (see sh_container.c) have their own index
+
+idx->h.kind tells if the layers are vectors or horizontal stress
+tensors (SH_SET_HTENSOR, see hc_sum), which have to be synthesized
+with sh_compute_spatial_tensor
+
+returns shps. read layers with hc_read_sh_solution_layers, and
+close with hc_close_sh_solution
+
+*/
+int hc_open_sh_solution(struct hcs *hc,struct hc_sol_index *idx,
+			char *filename,hc_boolean binary,
+			hc_boolean verbose)
+{
+  int ilayer;
+  memset(idx,0,sizeof(struct hc_sol_index));
+  idx->in = ggrd_open(filename,"r","hc_open_sh_solution");
+  if(sh_container_detect(idx->in)){
+    idx->container = sh_container_open(idx->in,verbose);
+    idx->h.nset = idx->container->h.nset;
+    idx->h.shps = idx->container->h.shps;
+    idx->h.type = idx->container->h.type;
+    idx->h.kind = idx->container->h.kind;
+    fclose(idx->in);idx->in = NULL;
+  }else{
+    if(!binary)
+      setvbuf(idx->in,NULL,_IOFBF,HC_READ_BUFSIZE);
+    if(!hc_sol_index_load(idx,filename,binary,verbose))
+      hc_sol_index_build(idx,filename,binary,verbose);
+  }
+  hc->sh_type = idx->h.type;
+  hc->nrad = idx->h.nset - 2;
+  hc->nradp2 = hc->nrad + 2;
+  hc_vecrealloc(&hc->r,idx->h.nset,"hc_open_sh_solution");
+  for(ilayer=0;ilayer < idx->h.nset;ilayer++)
+    hc->r[ilayer] = HC_ND_RADIUS((HC_PREC)((idx->container)?
+					   (idx->container->layer[ilayer].zlabel):
+					   (idx->layer[ilayer].zlabel)));
+  return idx->h.shps;
+}
+/* 
+
+read layers i1...i2 of a solution opened with hc_open_sh_solution,
+*sol (pass as NULL) will hold (i2-i1+1)*shps expansions, starting
+with layer i1
+
+*/
+void hc_read_sh_solution_layers(struct hc_sol_index *idx,
+				struct sh_lms **sol,int i1,int i2,
+				hc_boolean verbose)
+{
+  int ilayer,i,os,shps;
+  HC_PREC unity[3]={1.,1.,1.};
+  shps = idx->h.shps;
+  if((i1 < 0)||(i2 >= idx->h.nset)||(i1 > i2))
+    HC_ERROR("hc_read_sh_solution_layers","layer range out of bounds");
+  *sol = (struct sh_lms *)realloc(*sol,(i2-i1+1) * shps * sizeof(struct sh_lms));
+  if(!(*sol))
+    HC_MEMERROR("hc_read_sh_solution_layers: sol");
+  memset(*sol,0,(i2-i1+1) * shps * sizeof(struct sh_lms));
+  for(ilayer=i1,os=0;ilayer <= i2;ilayer++,os += shps){
+    if(idx->container){
+      sh_container_view_layer(idx->container,ilayer,(*sol+os),1,verbose);
+    }else{
+      for(i=0;i < shps;i++)
+	sh_init_expansion((*sol+os+i),idx->layer[ilayer].lmax,idx->h.type,
+			  1,verbose,FALSE);
+      if(fseeko(idx->in,(off_t)idx->layer[ilayer].offset,SEEK_SET) != 0)
+	HC_ERROR("hc_read_sh_solution_layers","seek error");
+      sh_read_coefficients_from_stream((*sol+os),shps,-1,idx->in,
+				       (hc_boolean)idx->h.binary,unity,verbose);
+    }
+    if(verbose >= 2)
+      fprintf(stderr,"hc_read_sh_solution_layers: layer %i z: %8.3f |exp(1)|: %12.5e\n",
+	      ilayer,(double)HC_Z_DEPTH(HC_ND_RADIUS((HC_PREC)((idx->container)?
+							       (idx->container->layer[ilayer].zlabel):
+							       (idx->layer[ilayer].zlabel)))),
+	      (double)sqrt(sh_total_power((*sol+os))));
+  }
+  if(verbose)
+    fprintf(stderr,"hc_read_sh_solution_layers: read layers %i to %i out of %i\n",
+	    i1+1,i2+1,idx->h.nset);
+}
+/* close the file and free the index, expansions remain valid */
+void hc_close_sh_solution(struct hc_sol_index *idx)
+{
+  if(idx->container)
+    sh_container_close(idx->container);
+  if(idx->in)
+    fclose(idx->in);
+  free(idx->layer);
+  memset(idx,0,sizeof(struct hc_sol_index));
+}
+/* 
+
+build the index by reading the layer parameters and skipping the
+coefficients, then try to store it
+
+*/
+void hc_sol_index_build(struct hc_sol_index *idx,char *filename,
+			hc_boolean binary,hc_boolean verbose)
+{
+  int type,lmax,shps,ilayer,nset,ivec,kind,n;
+  long ncoeff;
+  HC_PREC zlabel;
+  struct stat st;
+  n = 0;
+  rewind(idx->in);
+  while(sh_read_set_parameters_from_stream(&type,&lmax,&shps,&ilayer,
+					   &nset,&zlabel,&ivec,&kind,idx->in,
+					   FALSE,binary,FALSE)){
+    if(ilayer != n){
+      fprintf(stderr,"hc_sol_index_build: error: %s: ilayer %i n %i\n",
+	      filename,ilayer,n);
+      exit(-1);
+    }
+    if(n == 0){
+      idx->h.nset = nset;
+      idx->h.shps = shps;
+      idx->h.type = type;
+      idx->h.kind = kind;
+      idx->layer = (struct hc_sol_index_layer *)
+	calloc(nset,sizeof(struct hc_sol_index_layer));
+      if(!idx->layer)
+	HC_MEMERROR("hc_sol_index_build");
+    }else if((nset != idx->h.nset)||(shps != idx->h.shps)||
+	     (kind != idx->h.kind)||(n >= nset))
+      HC_ERROR("hc_sol_index_build","inconsistent layer parameters");
+    idx->layer[n].offset = (long long)ftello(idx->in);
+    idx->layer[n].zlabel = (double)zlabel;
+    idx->layer[n].lmax = lmax;
+    /* skip A and B of all (l,m) of all sets */
+    ncoeff = (long)(lmax+1)*(lmax+2)/2 * shps * 2;
+    if(binary){
+      if(fseeko(idx->in,(off_t)ncoeff*sizeof(HC_BIN_PREC),SEEK_CUR) != 0)
+	HC_ERROR("hc_sol_index_build","seek error");
+    }else if(!hc_skip_tokens(idx->in,ncoeff)){
+      fprintf(stderr,"hc_sol_index_build: error: %s: layer %i incomplete\n",
+	      filename,n);
+      exit(-1);
+    }
+    n++;
+  }
+  if((n == 0)||(n != idx->h.nset))
+    HC_ERROR("hc_sol_index_build","read error");
+  /* 
+     store
+  */
+  memcpy(idx->h.magic,HC_SOL_INDEX_MAGIC,8);
+  idx->h.version = HC_SOL_INDEX_VERSION;
+  idx->h.binary = (int)binary;
+  idx->h.prec = (int)sizeof(HC_BIN_PREC);
+  if(fstat(fileno(idx->in),&st) == 0){
+    idx->h.src_size = (long long)st.st_size;
+    idx->h.src_mtime = hc_sol_index_mtime(&st);
+    hc_sol_index_store(idx,filename,verbose);
+  }
+  if(verbose)
+    fprintf(stderr,"hc_sol_index_build: indexed %i layers of %s\n",
+	    n,filename);
+}
+/* 
+
+try to read a cached index, returns TRUE on success
+
+*/
+hc_boolean hc_sol_index_load(struct hc_sol_index *idx,char *filename,
+			     hc_boolean binary,hc_boolean verbose)
+{
+  char name[HC_CHAR_LENGTH+10];
+  struct hc_sol_index_header h;
+  struct stat st;
+  FILE *in;
+  if(fstat(fileno(idx->in),&st) != 0)
+    return FALSE;
+  snprintf(name,HC_CHAR_LENGTH+10,"%s.%s",filename,HC_SOL_INDEX_SUFFIX);
+  if(!(in = fopen(name,"r")))
+    return FALSE;
+  if((fread(&h,sizeof(struct hc_sol_index_header),1,in) != 1)||
+     (memcmp(h.magic,HC_SOL_INDEX_MAGIC,8) != 0)||
+     (h.version != HC_SOL_INDEX_VERSION)||(h.binary != (int)binary)||
+     (h.prec != (int)sizeof(HC_BIN_PREC))||
+     (h.src_size != (long long)st.st_size)||
+     (h.src_mtime != hc_sol_index_mtime(&st))||(h.nset < 1)){
+    fclose(in);
+    return FALSE;
+  }
+  idx->layer = (struct hc_sol_index_layer *)
+    malloc(h.nset * sizeof(struct hc_sol_index_layer));
+  if(!idx->layer)
+    HC_MEMERROR("hc_sol_index_load");
+  if(fread(idx->layer,sizeof(struct hc_sol_index_layer),h.nset,in) != (size_t)h.nset){
+    fclose(in);
+    free(idx->layer);idx->layer = NULL;
+    return FALSE;
+  }
+  fclose(in);
+  idx->h = h;
+  if(verbose)
+    fprintf(stderr,"hc_sol_index_load: using index %s, %i layers\n",
+	    name,h.nset);
+  return TRUE;
+}
+/* 
+
+write the index next to the file, under a temporary name which then
+gets renamed. failure only produces a warning
+
+*/
+void hc_sol_index_store(struct hc_sol_index *idx,char *filename,
+			hc_boolean verbose)
+{
+  char name[HC_CHAR_LENGTH+10],tname[HC_CHAR_LENGTH+40];
+  FILE *out;
+  size_t n;
+  snprintf(name,HC_CHAR_LENGTH+10,"%s.%s",filename,HC_SOL_INDEX_SUFFIX);
+  snprintf(tname,HC_CHAR_LENGTH+40,"%s.tmp.%i",name,(int)getpid());
+  if(!(out = fopen(tname,"w"))){
+    if(verbose)
+      fprintf(stderr,"hc_sol_index_store: WARNING: cannot write index %s\n",tname);
+    return;
+  }
+  n  = fwrite(&idx->h,sizeof(struct hc_sol_index_header),1,out);
+  n += fwrite(idx->layer,sizeof(struct hc_sol_index_layer),idx->h.nset,out);
+  if((fclose(out) != 0)||(n != (size_t)idx->h.nset + 1)||
+     (rename(tname,name) != 0)){
+    fprintf(stderr,"hc_sol_index_store: WARNING: could not write %s\n",name);
+    remove(tname);
+  }
+}
@@ -49,6 +49,16 @@ void hc_vecalloc(HC_PREC **x,int n,char *message)
   if(! (*x))
     HC_MEMERROR(message);
 }
+/* 
+   block of size bytes aligned to HC_MEM_ALIGN, release with free()
+*/
+void *hc_aligned_alloc(size_t size,char *message)
+{
+  void *p;
+  if(posix_memalign(&p,HC_MEM_ALIGN,(size)?(size):(HC_MEM_ALIGN)) != 0)
+    HC_MEMERROR(message);
+  return p;
+}
 /* single prec complex vector allocation */
 void hc_scmplx_vecalloc(struct hc_scmplx **x,int n,char *message)
 {
@@ -179,6 +189,154 @@ void hc_get_flt_frmt_string(char *string, int n,
   for(i=1;i<n;i++)
     sprintf(string,"%s %%%s",string,type_s);
 }
+/* 
+
+read the next floating point number from stream in, as
+fscanf(in,HC_FLT_FORMAT,x) would, returns TRUE on success
+
+this avoids the format interpretation of fscanf and works on the
+stdio buffer directly, which matters for coefficient files with
+millions of entries. the number is delimited by white space, and
+converted by hc_parse_flt. the first character after the number is
+pushed back, such that fscanf can be used for the next item
+
+*/
+hc_boolean hc_read_flt(FILE *in, HC_PREC *x)
+{
+  char token[HC_FLT_TOKEN_LEN+1];
+  int c,n;
+  /* skip white space */
+  do{
+    c = getc_unlocked(in);
+  }while((c == ' ')||(c == '\n')||(c == '\t')||(c == '\r')||(c == '\v')||(c == '\f'));
+  for(n=0;(c != EOF) && (((c >= '0')&&(c <= '9'))||((c >= 'a')&&(c <= 'z'))||
+			  ((c >= 'A')&&(c <= 'Z'))||(c == '.')||(c == '+')||(c == '-'));n++){
+    if(n == HC_FLT_TOKEN_LEN)
+      return FALSE;
+    token[n] = (char)c;
+    c = getc_unlocked(in);
+  }
+  if(c != EOF)
+    ungetc(c,in);
+  token[n] = '\0';
+  if(!n)
+    return FALSE;
+  return hc_parse_flt(token,x);
+}
+/* 
+
+skip n white space delimited items in stream in, without
+converting them, returns FALSE if the stream ended before
+
+*/
+hc_boolean hc_skip_tokens(FILE *in, long n)
+{
+  int c;
+  hc_boolean in_token = FALSE;
+  while(n){
+    c = getc_unlocked(in);
+    if(c == EOF)		/* last item may end with the file */
+      return (in_token && (n == 1))?(TRUE):(FALSE);
+    if((c == ' ')||(c == '\n')||(c == '\t')||(c == '\r')||(c == '\v')||(c == '\f')){
+      if(in_token){
+	in_token = FALSE;
+	n--;
+      }
+    }else
+      in_token = TRUE;
+  }
+  return TRUE;
+}
+/* 
+
+convert the string s, which has to be a complete number, returns
+TRUE on success
+
+for double precision, numbers with up to 15 significant digits and
+decimal exponents within +/-22 are computed directly as one exactly
+rounded product or quotient of two exactly representable numbers
+(Clinger's fast path), which covers the usual %15.7e output. all else
+goes to strtod, such that results are always the same as with fscanf,
+independent of the precision
+
+*/
+hc_boolean hc_parse_flt(char *s, HC_PREC *x)
+{
+  char *end;
+#if HC_PRECISION == 16
+  static const double p10[23] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+				 1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+  unsigned long long m;
+  int nd,ndig,e,ee;
+  hc_boolean neg,eneg;
+  char *p;
+  p = s;
+  neg = FALSE;
+  if(*p == '-'){
+    neg = TRUE;p++;
+  }else if(*p == '+')
+    p++;
+  m = 0;nd = ndig = e = 0;
+  for(;(*p >= '0')&&(*p <= '9');p++,ndig++){
+    if(m || (*p != '0'))
+      nd++;
+    m = m * 10 + (unsigned long long)(*p - '0');
+    if(nd > 15)
+      goto slow;
+  }
+  if(*p == '.'){
+    for(p++;(*p >= '0')&&(*p <= '9');p++,ndig++,e--){
+      if(m || (*p != '0'))
+	nd++;
+      m = m * 10 + (unsigned long long)(*p - '0');
+      if(nd > 15)
+	goto slow;
+    }
+  }
+  if(!ndig)			/* inf, nan, or not a number */
+    goto slow;
+  if((*p == 'e')||(*p == 'E')){
+    p++;
+    eneg = FALSE;
+    if(*p == '-'){
+      eneg = TRUE;p++;
+    }else if(*p == '+')
+      p++;
+    if((*p < '0')||(*p > '9'))
+      goto slow;
+    for(ee=0;(*p >= '0')&&(*p <= '9');p++){
+      ee = ee * 10 + (*p - '0');
+      if(ee > 1000)
+	goto slow;
+    }
+    e += (eneg)?(-ee):(ee);
+  }
+  if(*p != '\0')
+    goto slow;
+  if(m == 0)
+    *x = 0.0;
+  else if((e >= 0)&&(e <= 22))
+    *x = (double)m * p10[e];
+  else if((e < 0)&&(e >= -22))
+    *x = (double)m / p10[-e];
+  else
+    goto slow;
+  if(neg)
+    *x = -*x;
+  return TRUE;
+ slow:
+#endif
+#if HC_PRECISION == 8
+  *x = strtof(s,&end);
+#elif HC_PRECISION == 32
+  *x = strtold(s,&end);
+#else
+  *x = strtod(s,&end);
+#endif
+  if((end == s)||(*end != '\0'))
+    return FALSE;
+  return TRUE;
+}
 //
 // deal with boolean values/switches
 char *hc_name_boolean(hc_boolean value)
@@ -13,6 +13,12 @@ $Id: hc_output.c,v 1.11 2006/01/22 01:11:34 becker Exp becker $
 
 print the spherical harmonics version of a solution set
 
+binary: FALSE for ASCII, TRUE for plain binary, or HC_SH_CONTAINER for
+the indexed container format (out has to be a seekable file then)
+
+horizontal tractions are marked as SH_SET_HTENSOR, by a negative shps
+in the parameter lines, or by the container kind, such that readers
+do not take them for vectors
 
 */
 void hc_print_spectral_solution(struct hcs *hc,struct sh_lms *sol,
@@ -20,11 +26,18 @@ void hc_print_spectral_solution(struct hcs *hc,struct sh_lms *sol,
 				hc_boolean binary, 
 				hc_boolean verbose)
 {
-  int i,os;
+  int i,os,shps;
   const int ntype = 3;			/* three sets of solutions, r/pol/tor */
   HC_PREC fac[3];
+  struct sh_container *cont = NULL;
   if(!hc->spectral_solution_computed)
     HC_ERROR("hc_print_spectral_solution","spectral solution not computed");
+  if(binary == HC_SH_CONTAINER){
+    cont = sh_container_create(out,hc->nradp2,ntype,(int)sizeof(SH_RICK_PREC));
+    if(sol_mode == HC_HTRACTIONS)
+      cont->h.kind = SH_SET_HTENSOR;
+  }
+  shps = (sol_mode == HC_HTRACTIONS)?(-ntype):(ntype);
   /* 
      number of solution sets of ntype solutions 
   */
@@ -36,19 +49,24 @@ void hc_print_spectral_solution(struct hcs *hc,struct sh_lms *sol,
     */
     hc_compute_solution_scaling_factors(hc,sol_mode,
 					hc->r[i],hc->dvisc[i],fac);
-    /* 
-       write parameters, convert radius to depth in [km]  
-    */
-    sh_print_parameters_to_stream((sol+os),ntype,i,hc->nradp2,
-				  HC_Z_DEPTH(hc->r[i]),
-				  out,FALSE,binary,verbose);
-    /* 
-       
-       write the set of coefficients in D&T convention
-       
-    */
-    sh_print_coefficients_to_stream((sol+os),ntype,out,fac,
-				  binary,verbose);
+    if(cont){
+      /* indexed container, depth in [km] */
+      sh_container_write_layer(cont,(sol+os),ntype,i,HC_Z_DEPTH(hc->r[i]),fac);
+    }else{
+      /* 
+	 write parameters, convert radius to depth in [km]  
+      */
+      sh_print_parameters_to_stream((sol+os),shps,i,hc->nradp2,
+				    HC_Z_DEPTH(hc->r[i]),
+				    out,FALSE,binary,verbose);
+      /* 
+	 
+	 write the set of coefficients in D&T convention
+	 
+      */
+      sh_print_coefficients_to_stream((sol+os),ntype,out,fac,
+				      binary,verbose);
+    }
     if(verbose >= 2){
       switch(sol_mode){
       case HC_VEL:
@@ -68,7 +86,7 @@ void hc_print_spectral_solution(struct hcs *hc,struct sh_lms *sol,
 		(double)(fac[0]/(0.553073278428428/hc->r[i])));
 	break;
       case HC_HTRACTIONS:
-	fprintf(stderr,"hc_print_spectral_solution: z: %8.3f htrac: |r|: %11.3e |pol|: %11.3e |tor|: %11.3e (scale: %g MPa)\n",
+	fprintf(stderr,"hc_print_spectral_solution: z: %8.3f htrac: |iso|: %11.3e |pol|: %11.3e |tor|: %11.3e (scale: %g MPa)\n",
 		(double)HC_Z_DEPTH(hc->r[i]),
 		(double)sqrt(sh_total_power((sol+os))),
 		(double)sqrt(sh_total_power((sol+os+1))),
@@ -82,6 +100,8 @@ void hc_print_spectral_solution(struct hcs *hc,struct sh_lms *sol,
       }
     }
   }
+  if(cont)
+    sh_container_close(cont);
   if(verbose)
     fprintf(stderr,"hc_print_spectral_solution: wrote solution at %i levels\n",
 	    hc->nradp2);
@@ -124,98 +144,270 @@ void hc_print_spatial_solution(struct hcs *hc,
 			       int sol_mode, hc_boolean binary, 
 			       hc_boolean verbose)
 {
-  int i,j,k,os[3],los,np,np2,np3;
-  FILE *file_dummy=NULL,*out,*dout;
-  HC_PREC flt_dummy=0,*xy=NULL,value[3];
-  HC_PREC fac[3];
-  char filename[300];
+  int i;
+  struct hc_spatial_out o;
   if(!hc->spatial_solution_computed)
     HC_ERROR("hc_print_spatial_solution","spectral solution not computed");
-  /* number of solution sets of ntype solutions */
+  hc_spatial_out_init(&o,hc,sol,name,dfilename,sol_mode,binary,verbose);
+  /* 
+     layers go to separate files, and are formatted and written in
+     parallel, if OpenMP is used
+  */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(i=0;i < hc->nradp2;i++)
+    hc_print_spatial_layer(&o,i,(sol_x+i*3*o.np));
+  hc_spatial_out_free(&o);
+}
+/* 
+
+streamed version of hc_compute_sol_spatial and
+hc_print_spatial_solution: the layers are transformed one by one into
+a ring of nring layer buffers, from which a writer thread scales and
+writes them. memory use is thus independent of the number of layers,
+and the transforms overlap with the output
+
+without HC_USE_PTHREADS, layers are transformed and written in turn
+
+*/
+void hc_stream_spatial_solution(struct hcs *hc, 
+				struct sh_lms *sol_w,
+				char *name, char *dfilename, 
+				int sol_mode, hc_boolean binary, 
+				int nring,hc_boolean verbose)
+{
+  int i,np3;
+  HC_PREC *buf=NULL;
+  struct hc_spatial_out o;
+  struct sh_lms *work=NULL;
+#ifdef HC_USE_PTHREADS
+  struct hc_spatial_ring ring;
+  pthread_t writer;
+#endif
+  if(nring < 1)
+    nring = 1;
+  if(nring > hc->nradp2)
+    nring = hc->nradp2;
+  hc_spatial_out_init(&o,hc,sol_w,name,dfilename,sol_mode,binary,verbose);
+  np3 = 3 * o.np;
+  hc_vecalloc(&buf,np3*nring,"hc_stream_spatial_solution");
+  /* 
+     compute the plm factors 
+  */
+  sh_compute_plm(sol_w,1,&hc->plm,verbose);
+  if(sol_mode == HC_HTRACTIONS)
+    sh_allocate_and_init(&work,4,sol_w[0].lmax,sol_w[0].type,1,verbose,FALSE);
+  if(verbose)
+    fprintf(stderr,"hc_stream_spatial_solution: %i layers through %i buffers of %.1f MB\n",
+	    hc->nradp2,nring,(double)(np3*sizeof(HC_PREC))/1048576.);
+#ifdef HC_USE_PTHREADS
+  ring.o = &o;ring.buf = buf;
+  ring.nring = nring;ring.nlayer = hc->nradp2;
+  ring.nfull = 0;
+  pthread_mutex_init(&ring.lock,NULL);
+  pthread_cond_init(&ring.filled,NULL);
+  pthread_cond_init(&ring.emptied,NULL);
+  if(pthread_create(&writer,NULL,hc_spatial_writer,(void *)&ring) != 0)
+    HC_ERROR("hc_stream_spatial_solution","could not start writer thread");
+  for(i=0;i < hc->nradp2;i++){
+    /* wait for a free buffer */
+    pthread_mutex_lock(&ring.lock);
+    while(ring.nfull == nring)
+      pthread_cond_wait(&ring.emptied,&ring.lock);
+    pthread_mutex_unlock(&ring.lock);
+    if(work)			/* horizontal tractions */
+      sh_compute_spatial_tensor((sol_w+i*3+HC_RAD),work,TRUE,&hc->plm,
+				(buf+(i%nring)*np3),verbose);
+    else
+      sh_compute_spatial_rv((sol_w+i*3+HC_RAD),TRUE,&hc->plm,
+			    (buf+(i%nring)*np3),verbose);
+    /* hand it to the writer */
+    pthread_mutex_lock(&ring.lock);
+    ring.nfull++;
+    pthread_cond_signal(&ring.filled);
+    pthread_mutex_unlock(&ring.lock);
+  }
+  pthread_join(writer,NULL);
+  pthread_mutex_destroy(&ring.lock);
+  pthread_cond_destroy(&ring.filled);
+  pthread_cond_destroy(&ring.emptied);
+#else
+  for(i=0;i < hc->nradp2;i++){
+    if(work)			/* horizontal tractions */
+      sh_compute_spatial_tensor((sol_w+i*3+HC_RAD),work,TRUE,&hc->plm,
+				(buf+(i%nring)*np3),verbose);
+    else
+      sh_compute_spatial_rv((sol_w+i*3+HC_RAD),TRUE,&hc->plm,
+			    (buf+(i%nring)*np3),verbose);
+    hc_print_spatial_layer(&o,i,(buf+(i%nring)*np3));
+  }
+#endif
+  free(buf);
+  if(work){
+    sh_free_expansion(work,4);
+    free(work);
+  }
+  hc_spatial_out_free(&o);
+}
+#ifdef HC_USE_PTHREADS
+/* 
+   writer thread for hc_stream_spatial_solution, writes the layers in
+   order as they become available in the ring
+*/
+void *hc_spatial_writer(void *arg)
+{
+  struct hc_spatial_ring *ring;
+  int i,np3;
+  ring = (struct hc_spatial_ring *)arg;
+  np3 = 3 * ring->o->np;
+  for(i=0;i < ring->nlayer;i++){
+    pthread_mutex_lock(&ring->lock);
+    while(ring->nfull == 0)
+      pthread_cond_wait(&ring->filled,&ring->lock);
+    pthread_mutex_unlock(&ring->lock);
+    hc_print_spatial_layer(ring->o,i,(ring->buf+(i%ring->nring)*np3));
+    pthread_mutex_lock(&ring->lock);
+    ring->nfull--;
+    pthread_cond_signal(&ring->emptied);
+    pthread_mutex_unlock(&ring->lock);
+  }
+  return NULL;
+}
+#endif
+/* 
+
+prepare the per-layer output of the spatial solution: lateral
+coordinates, and the depth levels, which get written to dfilename
 
+*/
+void hc_spatial_out_init(struct hc_spatial_out *o,struct hcs *hc, 
+			 struct sh_lms *sol,char *name, 
+			 char *dfilename,int sol_mode, 
+			 hc_boolean binary,hc_boolean verbose)
+{
+  int i,j,los;
+  FILE *file_dummy=NULL,*dout;
+  HC_PREC flt_dummy=0;
+  o->hc = hc;
+  o->name = name;
+  o->sol_mode = sol_mode;
+  o->binary = binary;
+  o->verbose = verbose;
+  o->xy = NULL;
+  o->lstring = NULL;
+  o->lloc = NULL;
   /* number of lateral points */
-  np = sol[0].npoints;
-  np2 = np*2;
-  np3 = np*3;
-  if(!np)
-    HC_ERROR("hc_print_spatial_solution","npoints is zero");
+  o->np = sol[0].npoints;
+  if(!o->np)
+    HC_ERROR("hc_spatial_out_init","npoints is zero");
   /* 
      compute the lateral coordinates
   */
-  sh_compute_spatial_basis(sol, file_dummy, FALSE,flt_dummy, &xy,
+  sh_compute_spatial_basis(sol, file_dummy, FALSE,flt_dummy, &o->xy,
 			   1,verbose);
-
+  if(!binary){
+    /* 
+       the lon lat part is the same for all layers, format only once
+    */
+    o->lstring = (char *)malloc((size_t)o->np*HC_FORMAT_LEN/8);
+    hc_ivecalloc(&o->lloc,o->np+1,"hc_spatial_out_init");
+    if(!o->lstring)
+      HC_MEMERROR("hc_spatial_out_init");
+    for(j=los=0,o->lloc[0]=0;j < o->np;j++,los+=2)
+      o->lloc[j+1] = o->lloc[j] + sprintf((o->lstring+o->lloc[j]),"%11g %11g\t",
+					  (double)o->xy[los],(double)o->xy[los+1]);
+  }
   /* depth file */
-  dout = ggrd_open(dfilename,"w","hc_print_spatial_solution");
+  dout = ggrd_open(dfilename,"w","hc_spatial_out_init");
   if(verbose >= 2)
-    fprintf(stderr,"hc_print_spatial_solution: writing depth levels to %s\n",
+    fprintf(stderr,"hc_spatial_out_init: writing depth levels to %s\n",
 	    dfilename);
-  for(i=0;i < hc->nradp2;i++){
-    /* 
+  for(i=0;i < hc->nradp2;i++)
+    /* write depth in [km] to dout file */
+    fprintf(dout,"%g\n",(double)HC_Z_DEPTH(hc->r[i]));
+  fclose(dout);
+}
+/* 
 
-    compute the scaling factors, those do depend on radius
-    in the case of the stresses, so leave inside loop!
+write layer i, given its spatial solution x[3*np], to its own file
 
-    */
-    hc_compute_solution_scaling_factors(hc,sol_mode,hc->r[i],
-					hc->dvisc[i],fac);
+*/
+void hc_print_spatial_layer(struct hc_spatial_out *o,int i,HC_PREC *x)
+{
+  int j,k,os[3],los,np;
+  FILE *out;
+  HC_PREC value[3],fac[3];
+  char filename[300];
+  struct hc_outbuf ob;
+  np = o->np;
+  /* 
 
-    /* write depth in [km] to dout file */
-    fprintf(dout,"%g\n",(double)HC_Z_DEPTH(hc->r[i]));
-    for(k=0;k < 3;k++)		/* pointers */
-      os[k] = i * np3 + k*np;
-    /* 
+  compute the scaling factors, those do depend on radius
+  in the case of the stresses, so leave inside loop!
 
-    format:
+  */
+  hc_compute_solution_scaling_factors(o->hc,o->sol_mode,o->hc->r[i],
+				      o->hc->dvisc[i],fac);
+  for(k=0;k < 3;k++)		/* pointers */
+    os[k] = k*np;
+  /* 
 
+  format:
 
-    lon lat vr vt vp   OR
 
-    lon lat srr srt srp 
+  lon lat vr vt vp   OR
 
-    
-    */
+  lon lat srr srt srp 
 
-    if(binary){
-      /* binary output */
-      sprintf(filename,"%s.%i.bin",name,i+1);
-      out = ggrd_open(filename,"w","hc_print_spatial_solution");
-      for(j=los=0;j < np;j++,los+=2){ /* loop through all points in layer */
-	hc_print_float((xy+los),2,out);
-	for(k=0;k<3;k++)
-	  value[k] = sol_x[os[k]] * fac[k];
-	hc_print_float(value,3,out);
-	os[0]++;os[1]++;os[2]++;
-      }     
-      fclose(out);
-    }else{
-      /* ASCII output */
-      sprintf(filename,"%s.%i.dat",name,i+1);
-      out = ggrd_open(filename,"w","hc_print_spatial_solution");
-      for(j=los=0;j < np;j++,los+=2){ /* loop through all points in layer */
-	for(k=0;k<3;k++)
-	  value[k] = sol_x[os[k]] * fac[k];
-	fprintf(out,"%11g %11g\t%12.5e %12.5e %12.5e\n",
-		(double)xy[los],
-		(double)xy[los+1],
-		(double)value[0],
-		(double)value[1],(double)value[2]);
-	os[0]++;os[1]++;os[2]++;
-      }
-      fclose(out);
+    
+  */
+  if(o->binary){
+    /* binary output */
+    sprintf(filename,"%s.%i.bin",o->name,i+1);
+    out = ggrd_open(filename,"w","hc_print_spatial_layer");
+    for(j=los=0;j < np;j++,los+=2){ /* loop through all points in layer */
+      hc_print_float((o->xy+los),2,out);
+      for(k=0;k<3;k++)
+	value[k] = x[os[k]] * fac[k];
+      hc_print_float(value,3,out);
+      os[0]++;os[1]++;os[2]++;
+    }     
+    fclose(out);
+  }else{
+    /* ASCII output, "%11g %11g\t%12.5e %12.5e %12.5e\n" */
+    sprintf(filename,"%s.%i.dat",o->name,i+1);
+    out = ggrd_open(filename,"w","hc_print_spatial_layer");
+    hc_outbuf_init(&ob,out,HC_OUTBUF_SIZE);
+    for(j=0;j < np;j++){ /* loop through all points in layer */
+      for(k=0;k<3;k++)
+	value[k] = x[os[k]] * fac[k];
+      hc_outbuf_mem(&ob,(o->lstring+o->lloc[j]),(size_t)(o->lloc[j+1]-o->lloc[j]));
+      hc_outbuf_e(&ob,(double)value[0],12,5);hc_outbuf_c(&ob,' ');
+      hc_outbuf_e(&ob,(double)value[1],12,5);hc_outbuf_c(&ob,' ');
+      hc_outbuf_e(&ob,(double)value[2],12,5);hc_outbuf_c(&ob,'\n');
+      os[0]++;os[1]++;os[2]++;
     }
-    if(verbose >= 2)
-      fprintf(stderr,"hc_print_spatial_solution: layer %3i: RMS: r: %12.5e t: %12.5e p: %12.5e file: %s\n",
-	      i+1,	(double)hc_vec_rms((sol_x+i*np3),np),
-	      (double)hc_vec_rms((sol_x+i*np3+np),np),
-	      (double)hc_vec_rms((sol_x+i*np3+np2),np),
-	      filename);
+    hc_outbuf_free(&ob);
+    fclose(out);
   }
-  fclose(dout);
-  if(verbose)
+  if(o->verbose >= 2)
+    fprintf(stderr,"hc_print_spatial_solution: layer %3i: RMS: r: %12.5e t: %12.5e p: %12.5e file: %s\n",
+	    i+1,	(double)hc_vec_rms(x,np),
+	    (double)hc_vec_rms((x+np),np),
+	    (double)hc_vec_rms((x+2*np),np),
+	    filename);
+}
+/* free the hc_spatial_out_init storage */
+void hc_spatial_out_free(struct hc_spatial_out *o)
+{
+  if(o->verbose)
     fprintf(stderr,"hc_print_spatial_solution: wrote solution at %i levels\n",
-	    hc->nradp2);
-  free(xy);
+	    o->hc->nradp2);
+  if(!o->binary){
+    free(o->lstring);free(o->lloc);
+  }
+  free(o->xy);
 }
 
 /* 
@@ -338,9 +530,9 @@ void hc_print_poloidal_solution(struct sh_lms *pol_sol,
 							     to Dahlen & Tromp format */
 				hc_boolean verbose)
 {
-  int l,m,i,j,a_or_b,ll,nl,os,alim;
+  int l,m,i,j,a_or_b,ll,nl,os,alim,n2;
   FILE *out;
-  HC_PREC value[2];
+  HC_PREC *value;
   /* 
      output of poloidal solution vectors 
   */
@@ -352,8 +544,13 @@ void hc_print_poloidal_solution(struct sh_lms *pol_sol,
   /* number of output layers */
   nl = hc->nrad + 2;
   
+  /* all A and B of one degree for all layers and components */
+  n2 = 2*(ll+1);
+  hc_vecalloc(&value,nl*6*n2,"hc_print_poloidal_solution");
   out = ggrd_open(filename,"w","hc_print_poloidal_solution");
   for(l=1;l <= ll;l++){
+    for(i=0;i < nl*6;i++)
+      sh_get_coeff_l((pol_sol+i),l,convert_to_dt,(value+i*n2));
     for(m=0;m <= l;m++){
       alim = (m==0)?(1):(2);
       for(a_or_b=0;a_or_b < alim;a_or_b++){
@@ -361,9 +558,7 @@ void hc_print_poloidal_solution(struct sh_lms *pol_sol,
 	  fprintf(out,"%3i %3i %1i %3i %8.5f ",
 		  l,m,a_or_b,i+1,(double)hc->r[i]);
 	  for(j=0;j < 6;j++){
-	    sh_get_coeff((pol_sol+os+j),l,m,
-			 a_or_b,convert_to_dt,value);
-	    fprintf(out,"%11.4e ",(double)value[0]);
+	    fprintf(out,"%11.4e ",(double)value[(os+j)*n2+2*m+a_or_b]);
 	  } /* end u_1 .. u_4 nu_1 nu_2 loop */
 	  fprintf(out,"\n");
 	} /* end layer loop */
@@ -371,6 +566,7 @@ void hc_print_poloidal_solution(struct sh_lms *pol_sol,
     }	/* end m loop */
   } /* end l loop */
   fclose(out);
+  free(value);
 }
 
 /* 
@@ -423,8 +619,11 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
   
   hc_boolean little_endian;
   HC_PREC xtmp[3],r,spole[3],npole[3];
+  struct hc_outbuf ob;		/* for ASCII output, flushed before
+				   every section header */
   /* determine machine type */
   little_endian = hc_is_little_endian();
+  hc_outbuf_init(&ob,out,(binary)?(0):(HC_OUTBUF_SIZE));
   /*  */
   npoints = npoints_orig + 2;
   ndata =   npoints_orig*3;
@@ -449,8 +648,7 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
       if(binary)
 	hc_print_be_float((xloc+poff),3,out,little_endian);
       else
-	fprintf(out,"%.6e %.6e %.6e\n",
-		(double)xloc[poff],(double)xloc[poff+1],(double)xloc[poff+2]);
+	hc_print_vtk_vec(&ob,(xloc+poff));
     }
     /* 
        south and north poles, add two, to go to npoints per layer 
@@ -464,13 +662,13 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
     if(binary)
       hc_print_be_float((xtmp),3,out,little_endian);
     else 
-      fprintf(out,"%.6e %.6e %.6e\n",(double)xtmp[0],(double)xtmp[1],(double)xtmp[2]);
+      hc_print_vtk_vec(&ob,xtmp);
     /* north pole */
     xtmp[2] = r;		
     if(binary)
       hc_print_be_float((xtmp),3,out,little_endian);
     else 
-      fprintf(out,"%.6e %.6e %.6e\n",(double)xtmp[0],(double)xtmp[1],(double)xtmp[2]);
+      hc_print_vtk_vec(&ob,xtmp);
   }
   /*  */
   nele_x = nlon;nlon_m1=nlon-1; /* elements in longitude */
@@ -484,6 +682,7 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
   /* 
      element connectivity 
   */
+  hc_outbuf_flush(&ob);
   fprintf(out,"CELLS %i %i\n",nlay_m1 * nele_lay,
 	  nlay_m1 * (nele_lay_reg * (1+nele_brick) 
 		  + nele_x * 2 * (1+nele_tri)));
@@ -510,9 +709,10 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
 	if(binary){
 	  hc_print_be_int(ncon,npe1,out,little_endian);
 	}else{
-	  for(k=0;k < npe1;k++)
-	    fprintf(out,"%i ",ncon[k]);
-	  fprintf(out,"\n");
+	  for(k=0;k < npe1;k++){
+	    hc_outbuf_i(&ob,ncon[k]);hc_outbuf_c(&ob,' ');
+	  }
+	  hc_outbuf_c(&ob,'\n');
 	}
       }
     }
@@ -546,9 +746,10 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
 	if(binary){
 	  hc_print_be_int(ncon,npe1,out,little_endian);
 	}else{
-	  for(i=0;i < npe1;i++)
-	    fprintf(out,"%i ",ncon[i]);
-	  fprintf(out,"\n");
+	  for(i=0;i < npe1;i++){
+	    hc_outbuf_i(&ob,ncon[i]);hc_outbuf_c(&ob,' ');
+	  }
+	  hc_outbuf_c(&ob,'\n');
 	}
       }
     }
@@ -556,6 +757,7 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
   /* 
      print cell types 
   */
+  hc_outbuf_flush(&ob);
   fprintf(out,"CELL_TYPES %i\n",nlay_m1 * nele_lay);
   for(ilay = 0; ilay < nlay_m1; ilay++){
     if(binary){
@@ -569,21 +771,23 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
     }else{
       /* ascicc */
       for(i=0;i < nele_lay_reg;i++){
-	fprintf(out,"%i ",12);	/* vtk quad */
+	hc_outbuf_mem(&ob,"12 ",3);	/* vtk quad */
 	if(i % 80 == 0)
-	  fprintf(out,"\n");
+	  hc_outbuf_c(&ob,'\n');
       }
       for(i=0;i < nele_lay_pole;i++){
-	fprintf(out,"%i ",13);	/* vtk triagnle */
+	hc_outbuf_mem(&ob,"13 ",3);	/* vtk triagnle */
 	if(i % 80 == 0)
-	  fprintf(out,"\n");
+	  hc_outbuf_c(&ob,'\n');
       }
-      fprintf(out,"\n");
+      hc_outbuf_c(&ob,'\n');
     }
   }
+  hc_outbuf_flush(&ob);
   fprintf(out,"POINT_DATA %i\n",npoints*nlay);
   if(shps_d){
     for(j=0;j < shps_d;j++){
+      hc_outbuf_flush(&ob);
       fprintf(out,"SCALARS scalar%i float 1\n",j+1);
       fprintf(out,"LOOKUP_TABLE default\n");
       for(ilay=0;ilay < nlay;ilay++){
@@ -593,8 +797,8 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
 	  if(binary)
 	    hc_print_be_float((xscalar+poff),1,out,little_endian);
 	  else{
-	    fprintf(out,"%.6e ",(double)xscalar[poff]);
-	    if(i%20 == 0)fprintf(out,"\n");
+	    hc_outbuf_e(&ob,(double)xscalar[poff],0,6);hc_outbuf_c(&ob,' ');
+	    if(i%20 == 0)hc_outbuf_c(&ob,'\n');
 	  }
 	  if(i < nlon)
 	    spole[0] += xscalar[poff];
@@ -604,8 +808,9 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
 	spole[0] /= (HC_PREC)nlon;
 	npole[0] /= (HC_PREC)nlon;
 	if(!binary){		/* ascii */
-	  fprintf(out,"\n");
-	  fprintf(out,"%.6e %.6e\n",(double)spole[0],(double)npole[0]);
+	  hc_outbuf_c(&ob,'\n');
+	  hc_outbuf_e(&ob,(double)spole[0],0,6);hc_outbuf_c(&ob,' ');
+	  hc_outbuf_e(&ob,(double)npole[0],0,6);hc_outbuf_c(&ob,'\n');
 	}else{			/* binary */
 	  hc_print_be_float(spole,1,out,little_endian);
 	  hc_print_be_float(npole,1,out,little_endian);
@@ -613,6 +818,7 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
       }
     }
   }
+  hc_outbuf_flush(&ob);
   fprintf(out,"VECTORS velocity float\n");
   for(ilay=0;ilay < nlay;ilay++){
     spole[0] = spole[1] = spole[2] = 
@@ -630,8 +836,7 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
       if(binary)		/* binary */
 	hc_print_be_float((xvec+poff),3,out,little_endian);
       else			/* ascii */
-	fprintf(out,"%.6e %.6e %.6e\n",(double)xvec[poff],(double)xvec[poff+1],
-		(double)xvec[poff+2]);
+	hc_print_vtk_vec(&ob,(xvec+poff));
     }
     for(k=0;k<3;k++){
       spole[k] /= (HC_PREC)nlon;
@@ -643,11 +848,18 @@ void hc_print_vtk(FILE *out,HC_PREC *xloc,HC_PREC *xvec,
       hc_print_be_float(npole,3,out,little_endian);  
     }else{
       /* ascii */
-      fprintf(out,"%.6e %.6e %.6e\n",(double)spole[0],(double)spole[1],(double)spole[2]);
-      fprintf(out,"%.6e %.6e %.6e\n",(double)npole[0],(double)npole[1],(double)npole[2]);
+      hc_print_vtk_vec(&ob,spole);
+      hc_print_vtk_vec(&ob,npole);
     }
   }
-  
+  hc_outbuf_free(&ob);
+}
+/* ASCII VTK vector, "%.6e %.6e %.6e\n" */
+void hc_print_vtk_vec(struct hc_outbuf *ob,HC_PREC *x)
+{
+  hc_outbuf_e(ob,(double)x[0],0,6);hc_outbuf_c(ob,' ');
+  hc_outbuf_e(ob,(double)x[1],0,6);hc_outbuf_c(ob,' ');
+  hc_outbuf_e(ob,(double)x[2],0,6);hc_outbuf_c(ob,'\n');
 }
 /* 
    print big endian binary to file, no matter what hardware
@@ -771,7 +983,10 @@ void hc_print_dens_anom(struct hcs *hc,
   HC_PREC f1,f2;
   HC_PREC fac[3] = {1.,1.,1.};
   struct sh_lms *exp;
+  struct sh_container *cont = NULL;
   sh_allocate_and_init(&exp,3,hc->dens_anom[0].lmax,hc->sh_type,0,FALSE,FALSE);
+  if(binary == HC_SH_CONTAINER)
+    cont = sh_container_create(out,hc->nradp2,1,(int)sizeof(SH_RICK_PREC));
   for(i=0;i < hc->nradp2;i++){
     /* interpolate density depth to velocity node layer depth */
     hc_linear_interpolate(hc->rden,hc->inho,hc->r[i],&i1,&i2,&f1,&f2);
@@ -781,8 +996,12 @@ void hc_print_dens_anom(struct hcs *hc,
     sh_c_is_a_plus_b_coeff((exp+2),(exp+0),(exp+1)); /* c = a+b */
 
     /* print to file */
-    sh_print_parameters_to_stream((exp+2),1,i,hc->nradp2,HC_Z_DEPTH(hc->r[i]),out,FALSE,binary,verbose);
-    sh_print_coefficients_to_stream((exp+2),1,out,fac,binary,verbose);
+    if(cont)
+      sh_container_write_layer(cont,(exp+2),1,i,HC_Z_DEPTH(hc->r[i]),fac);
+    else{
+      sh_print_parameters_to_stream((exp+2),1,i,hc->nradp2,HC_Z_DEPTH(hc->r[i]),out,FALSE,binary,verbose);
+      sh_print_coefficients_to_stream((exp+2),1,out,fac,binary,verbose);
+    }
     if(verbose>2)fprintf(stderr,"hc_print_dens_anom: z: %8.3f (f1: %6.3f f2: %6.3f) %3i/%3i pow: %10.3e %10.3e %10.3e\n",
 			 (double)HC_Z_DEPTH(hc->r[i]),
 			 (double)f1,(double)f2,i+1,hc->nradp2,
@@ -790,6 +1009,236 @@ void hc_print_dens_anom(struct hcs *hc,
 			 (double)sqrt(sh_total_power((hc->dens_anom+i2))),
 			 (double)sqrt(sh_total_power((exp+2))));
   }
-  
+  if(cont)
+    sh_container_close(cont);
   sh_free_expansion(exp,3);
 }
+/* 
+
+fast formatted output
+
+hc_format_e, hc_format_f, and hc_format_i write x to s exactly as
+sprintf with "%[width].[prec]e", "%[width].[prec]f", and "%i" would,
+and return the number of characters. s needs room for HC_FORMAT_LEN
+characters
+
+for prec <= 9 and normal magnitudes, the digits are obtained from one
+rounded long double product or quotient with an exact power of ten,
+which is accurate to far better than the rounding decision needs,
+unless the value is (close to) half way between two outputs. those
+cases, and all others, go to snprintf
+
+*/
+#if defined(LDBL_MANT_DIG) && (LDBL_MANT_DIG >= 64)
+#define HC_FAST_FORMAT
+static const long double hc_format_p10[28] = {
+  1e0L,1e1L,1e2L,1e3L,1e4L,1e5L,1e6L,1e7L,1e8L,1e9L,1e10L,1e11L,1e12L,1e13L,
+  1e14L,1e15L,1e16L,1e17L,1e18L,1e19L,1e20L,1e21L,1e22L,1e23L,1e24L,1e25L,
+  1e26L,1e27L};
+#endif
+int hc_format_e(char *s, double x, int width, int prec)
+{
+#ifdef HC_FAST_FORMAT
+  long double scaled,frac;
+  unsigned long long r;
+  int e10,be,k,n,i,ae;
+  char tmp[40],*p;
+  hc_boolean neg;
+  double ax;
+  if((prec > 9)||(width > HC_FORMAT_LEN-1)||(!isfinite(x)))
+    goto slow;
+  neg = (signbit(x))?(TRUE):(FALSE);
+  ax = fabs(x);
+  if(ax == 0.0){
+    r = 0;e10 = 0;
+  }else{
+    if(ax < DBL_MIN)
+      goto slow;
+    frexp(ax,&be);
+    e10 = (int)floor((double)(be-1)*0.30102999566398120);
+    for(i=0;i < 2;i++){		/* the estimate may be off by one */
+      k = prec - e10;
+      if(k > 27 || k < -27)
+	goto slow;
+      scaled = (k >= 0)?((long double)ax * hc_format_p10[k]):((long double)ax / hc_format_p10[-k]);
+      if(scaled < hc_format_p10[prec])
+	e10--;
+      else if(scaled >= hc_format_p10[prec+1])
+	e10++;
+      else
+	break;
+    }
+    if(i == 2)
+      goto slow;
+    r = (unsigned long long)scaled;
+    frac = scaled - (long double)r;
+    if(fabsl(frac - 0.5L) < 1e-7L)	/* too close to call */
+      goto slow;
+    if(frac > 0.5L)
+      r++;
+    if((long double)r >= hc_format_p10[prec+1]){ /* rounded up to next power */
+      r /= 10;e10++;
+    }
+  }
+  /* mantissa digits from the back */
+  p = tmp + sizeof(tmp);
+  ae = (e10 < 0)?(-e10):(e10);
+  do{
+    *(--p) = (char)('0' + ae % 10);ae /= 10;
+  }while(ae);
+  if(p > tmp + sizeof(tmp) - 2)
+    *(--p) = '0';
+  *(--p) = (e10 < 0)?('-'):('+');
+  *(--p) = 'e';
+  for(i=0;i < prec;i++){
+    *(--p) = (char)('0' + r % 10);r /= 10;
+  }
+  if(prec)
+    *(--p) = '.';
+  *(--p) = (char)('0' + r);
+  if(neg)
+    *(--p) = '-';
+  n = (int)(tmp + sizeof(tmp) - p);
+  for(i=0;i < width - n;i++)
+    *(s++) = ' ';
+  memcpy(s,p,n);
+  s[n] = '\0';
+  return (width > n)?(width):(n);
+ slow:
+#endif
+  return snprintf(s,HC_FORMAT_LEN,"%*.*e",width,prec,x);
+}
+int hc_format_f(char *s, double x, int width, int prec)
+{
+#ifdef HC_FAST_FORMAT
+  long double scaled,frac;
+  unsigned long long r,ip,fp;
+  int n,i;
+  char tmp[40],*p;
+  if((prec > 9)||(width > HC_FORMAT_LEN-1)||(!isfinite(x)))
+    goto slow;
+  scaled = (long double)fabs(x) * hc_format_p10[prec];
+  if(scaled >= 1e11L)
+    goto slow;
+  r = (unsigned long long)scaled;
+  frac = scaled - (long double)r;
+  if(fabsl(frac - 0.5L) < 1e-7L)
+    goto slow;
+  if(frac > 0.5L)
+    r++;
+  ip = r / (unsigned long long)hc_format_p10[prec];
+  fp = r % (unsigned long long)hc_format_p10[prec];
+  p = tmp + sizeof(tmp);
+  for(i=0;i < prec;i++){
+    *(--p) = (char)('0' + fp % 10);fp /= 10;
+  }
+  if(prec)
+    *(--p) = '.';
+  do{
+    *(--p) = (char)('0' + ip % 10);ip /= 10;
+  }while(ip);
+  if(signbit(x))
+    *(--p) = '-';
+  n = (int)(tmp + sizeof(tmp) - p);
+  for(i=0;i < width - n;i++)
+    *(s++) = ' ';
+  memcpy(s,p,n);
+  s[n] = '\0';
+  return (width > n)?(width):(n);
+ slow:
+#endif
+  return snprintf(s,HC_FORMAT_LEN,"%*.*f",width,prec,x);
+}
+int hc_format_i(char *s, int x)
+{
+  char tmp[16],*p;
+  unsigned int u;
+  int n;
+  p = tmp + sizeof(tmp);
+  u = (x < 0)?(0u - (unsigned int)x):((unsigned int)x);
+  do{
+    *(--p) = (char)('0' + u % 10);u /= 10;
+  }while(u);
+  if(x < 0)
+    *(--p) = '-';
+  n = (int)(tmp + sizeof(tmp) - p);
+  memcpy(s,p,n);
+  s[n] = '\0';
+  return n;
+}
+/* 
+
+output buffer for out, which is written whenever it fills up. with
+out NULL, the buffer grows and keeps everything, e.g. to format in
+parallel and write in order later
+
+*/
+void hc_outbuf_init(struct hc_outbuf *b, FILE *out, size_t size)
+{
+  b->out = out;
+  b->size = (size < 2*HC_FORMAT_LEN)?(2*HC_FORMAT_LEN):(size);
+  b->n = 0;
+  b->buf = (char *)malloc(b->size);
+  if(!b->buf)
+    HC_MEMERROR("hc_outbuf_init");
+}
+/* make room for another n characters */
+void hc_outbuf_reserve(struct hc_outbuf *b, size_t n)
+{
+  if(b->n + n <= b->size)
+    return;
+  if(b->out)
+    hc_outbuf_flush(b);
+  if(b->n + n > b->size){
+    b->size = 2*b->size + n;
+    b->buf = (char *)realloc(b->buf,b->size);
+    if(!b->buf)
+      HC_MEMERROR("hc_outbuf_reserve");
+  }
+}
+void hc_outbuf_flush(struct hc_outbuf *b)
+{
+  if(b->out && b->n){
+    if(fwrite(b->buf,1,b->n,b->out) != b->n)
+      HC_ERROR("hc_outbuf_flush","write error");
+    b->n = 0;
+  }
+}
+/* write what is left to out, if set, and free */
+void hc_outbuf_free(struct hc_outbuf *b)
+{
+  hc_outbuf_flush(b);
+  free(b->buf);
+  b->buf = NULL;
+  b->n = b->size = 0;
+}
+void hc_outbuf_e(struct hc_outbuf *b, double x, int width, int prec)
+{
+  hc_outbuf_reserve(b,HC_FORMAT_LEN);
+  b->n += hc_format_e((b->buf+b->n),x,width,prec);
+}
+void hc_outbuf_f(struct hc_outbuf *b, double x, int width, int prec)
+{
+  hc_outbuf_reserve(b,HC_FORMAT_LEN);
+  b->n += hc_format_f((b->buf+b->n),x,width,prec);
+}
+void hc_outbuf_i(struct hc_outbuf *b, int x)
+{
+  hc_outbuf_reserve(b,16);
+  b->n += hc_format_i((b->buf+b->n),x);
+}
+void hc_outbuf_s(struct hc_outbuf *b, char *string)
+{
+  hc_outbuf_mem(b,string,strlen(string));
+}
+void hc_outbuf_mem(struct hc_outbuf *b, char *string, size_t n)
+{
+  hc_outbuf_reserve(b,n);
+  memcpy((b->buf+b->n),string,n);
+  b->n += n;
+}
+void hc_outbuf_c(struct hc_outbuf *b, char c)
+{
+  hc_outbuf_reserve(b,1);
+  b->buf[b->n++] = c;
+}
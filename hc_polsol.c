@@ -203,6 +203,12 @@ void hc_polsol(struct hcs *hc, 	/*
   HC_PREC rbound_kludge;
   HC_HIGH_PREC amat[3][3],bvec[3],u[4],poten[2],
     unew[4],potnew[2],clm[2];
+  /* 
+     per-degree coefficient slices of the density, plate motion, and
+     solution expansions, see sh_lslice
+  */
+  SH_RICK_PREC **dslice,**sslice,*pslice=NULL,*gslice;
+  int lmi,m2;
   /* 
      structures which hold u[6][4] type arrays 
   */
@@ -251,6 +257,10 @@ void hc_polsol(struct hcs *hc, 	/*
   if(!u3)
     HC_MEMERROR("hc_polsol: u3");
   hc_vecalloc(&b,inho2,"hc_polsol");
+  dslice = (SH_RICK_PREC **)malloc(sizeof(SH_RICK_PREC *)*(inho+hc->nradp2*6));
+  if(!dslice)
+    HC_MEMERROR("hc_polsol: dslice");
+  sslice = dslice + inho;
   if(save_prop_mats){
     /* 
        propagators saved
@@ -541,6 +551,16 @@ void hc_polsol(struct hcs *hc, 	/*
     */
     rbound_kludge = (1. - (1.-hc->r_cmb)*(HC_PREC)hc->psp.solver_kludge_l/el);
     kludge_warned = FALSE;
+    /* 
+       all coefficients of this degree
+    */
+    if((!calc_kernel_only) && (l <= dens_anom[0].lmax))
+      for(i=0;i < inho;i++)
+	dslice[i] = sh_lslice((dens_anom+i),l);
+    if(!free_slip)
+      pslice = sh_lslice(pvel_pol,l);
+    for(i=0;i < hc->nradp2*6;i++)
+      sslice[i] = sh_lslice((pol_sol+i),l);
 
     if((!save_prop_mats) || (!hc->psp.prop_mats_init)|| (viscosity_or_layer_changed)){
       //    
@@ -584,11 +604,12 @@ void hc_polsol(struct hcs *hc, 	/*
 	    obtain the coefficients from the density field expansions
 
 	  */    
+	  lmi = SH_LSLICE_STRIDE*m + a_or_b;
 	  for(i=0;i < inho;i++)/* 
 				  A or B coeff, use the internal
 				  convention here, as stored before
 			       */
-	    sh_get_coeff((dens_anom+i),l,m,a_or_b,FALSE,(b+i));
+	    b[i] = dslice[i][lmi];
 	  //hc_print_vector(b,inho,stderr);
 	}else{
 	  /* 
@@ -796,7 +817,7 @@ void hc_polsol(struct hcs *hc, 	/*
 	   get one coefficient from the poloidal plate motion part
 	*/
 	if(!free_slip)
-	  sh_get_coeff(pvel_pol,l,m,a_or_b,FALSE,clm); /* use internal convention */
+	  clm[0] = pslice[SH_LSLICE_STRIDE*m + a_or_b]; /* use internal convention */
 	else
 	  clm[0] = 0.0;
 	/* 
@@ -826,6 +847,7 @@ void hc_polsol(struct hcs *hc, 	/*
 	/* 
 	   assign solution 
 	*/
+	lmi = SH_LSLICE_STRIDE*m + a_or_b;
 	for(os=ilayer=0;ilayer < nl;ilayer++,os+=6){
 	  for(i6=0;i6 < 6;i6++){
 	    /* sum up contributions from vector solution */
@@ -837,8 +859,7 @@ void hc_polsol(struct hcs *hc, 	/*
 	       adding vector components to spherical harmonic solution 
 	    */
 	    /* A or B coefficients */
-	    sh_write_coeff((pol_sol+os+i6),l,m,a_or_b,FALSE, /* use internal convention */
-			   &u3[ilayer].u[i6][0]);
+	    sslice[os+i6][lmi] = u3[ilayer].u[i6][0]; /* use internal convention */
 	  }
  	} /* end layer loop */
 
@@ -889,8 +910,6 @@ void hc_polsol(struct hcs *hc, 	/*
     n6 = 4;
     //n6 = -iformat-1;
 
-    /* first coefficients are zero  */
-    clm[0] = clm[1] = 0.0;
     switch(compute_geoid){
     case 1:
       g1 = hc->nrad+1;g2=hc->nradp2;	/* only surface */
@@ -906,24 +925,22 @@ void hc_polsol(struct hcs *hc, 	/*
       /* 
 	 first coefficients 
       */
-      sh_write_coeff((geoid+gic),0,0,0,FALSE,clm); /* 0,0 */
-      sh_write_coeff((geoid+gic),1,0,0,FALSE,clm); /* 1,0 */
-      sh_write_coeff((geoid+gic),1,1,2,FALSE,clm); /* 1,1 */
-
+      for(l=0;l < 2;l++){		/* 0,0 1,0 1,1 */
+	gslice = sh_lslice((geoid+gic),l);
+	for(m2=0;m2 < 2*(l+1);m2++)
+	  gslice[m2] = 0.0;
+      }
       os = gi * 6 + n6;	/* select component */
       for(l=2;l <= pol_sol[0].lmax;l++){
-	for(m=0;m <= l;m++){
-	  if (m != 0){
-	    sh_get_coeff((pol_sol+os),l,m,2,FALSE,clm); /* internal convention */
-	    clm[0] *= hc->psp.geoid_factor;
-	    clm[1] *= hc->psp.geoid_factor;
-	    sh_write_coeff((geoid+gic),l,m,2,FALSE,clm);
-	  }else{			/* m == 0 */
-	    sh_get_coeff((pol_sol+os),l,m,0,FALSE,clm);
-	    clm[0] *= hc->psp.geoid_factor;
-	    sh_write_coeff((geoid+gic),l,m,0,FALSE,clm);
-	  }
+	/* internal convention, all A and B of this degree */
+	pslice = sh_lslice((pol_sol+os),l);
+	gslice = sh_lslice((geoid+gic),l);
+	for(m2=0;m2 < 2*(l+1);m2++){
+	  clm[0] = pslice[m2];
+	  clm[0] *= hc->psp.geoid_factor;
+	  gslice[m2] = clm[0];
 	}
+	gslice[1] = 0.0;	/* B(l,0) */
       }
     }
     if(verbose > 1)
@@ -932,7 +949,7 @@ void hc_polsol(struct hcs *hc, 	/*
   /* 
      free the local arrays 
   */
-  free(b);free(u3);
+  free(b);free(u3);free(dslice);
   if(!save_prop_mats){		
     /* 
        destroy individual propagator matrices, if we don't want to
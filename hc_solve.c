@@ -47,7 +47,7 @@ void hc_solve(struct hcs *hc, hc_boolean free_slip,
 	      struct sh_lms *geoid, /* geoid solution, needs to be init */
 	      hc_boolean verbose)
 {
-  int nsh_pol,nsh_tor=0;
+  int nsh_pol,nsh_tor;
   static hc_boolean convert_to_dt = TRUE; /* convert the poloidal and
 					     toroidal solution vectors
 					     to physical SH convention
@@ -75,11 +75,22 @@ void hc_solve(struct hcs *hc, hc_boolean free_slip,
      initialize a bunch of expansions for the poloidal solution 
   */
   nsh_pol = 6 * (hc->nrad+2);	/* u[4] plus poten[2] */
-  if((!hc->psp.pol_init)||(!hc->save_solution)){
-    /* room for pol solution */
+  if((!hc->pol_sol)||(hc->npol_sol != nsh_pol)||
+     (hc->pol_sol[0].lmax != dens_anom[0].lmax)){
+    /* 
+       room for pol solution, one block which is kept for later
+       calls, also if the solution itself is not saved. the number of
+       layers may have changed with the density model
+    */
+    if(hc->pol_sol){
+      sh_free_expansion(hc->pol_sol,hc->npol_sol);
+      free(hc->pol_sol);
+    }
     sh_allocate_and_init(&hc->pol_sol,nsh_pol,
 			 dens_anom[0].lmax,hc->sh_type,
 			 0,verbose,FALSE); /* irregular grid */
+    hc->npol_sol = nsh_pol;
+    hc->psp.pol_init = FALSE;
   }
   if((!hc->save_solution) || (!hc->psp.pol_init) || viscosity_or_layer_changed ||
      dens_anom_changed || ((!free_slip) && (plate_vel_changed))){  
@@ -111,10 +122,18 @@ void hc_solve(struct hcs *hc, hc_boolean free_slip,
        solve toroidal part only for no-slip surface boundary condition
 
     */
-    if((!hc->psp.tor_init)||(!hc->save_solution)){
-      nsh_tor = 2 * (hc->nrad+2);
+    nsh_tor = 2 * (hc->nrad+2);
+    if((!hc->tor_sol)||(hc->ntor_sol != nsh_tor)||
+       (hc->tor_sol[0].lmax != pvel[1].lmax)){
+      /* allocated once, as for the poloidal part */
+      if(hc->tor_sol){
+	sh_free_expansion(hc->tor_sol,hc->ntor_sol);
+	free(hc->tor_sol);
+      }
       sh_allocate_and_init(&hc->tor_sol,nsh_tor,pvel[1].lmax,
 			   hc->sh_type,0,verbose,FALSE); /* irregular grid */
+      hc->ntor_sol = nsh_tor;
+      hc->psp.tor_init = FALSE;
     }
     if((!hc->psp.tor_init) || viscosity_or_layer_changed || plate_vel_changed || 
        (!hc->save_solution)){
@@ -135,8 +154,6 @@ void hc_solve(struct hcs *hc, hc_boolean free_slip,
 				   verbose);
       free(tvec);
     }
-  }else{
-    nsh_tor = 0;
   }
   switch(solve_mode){
   case HC_VEL:
@@ -166,21 +183,9 @@ void hc_solve(struct hcs *hc, hc_boolean free_slip,
   hc_sum(hc,hc->nrad,hc->pol_sol,hc->tor_sol,solve_mode,free_slip,sol,
 	 verbose);
   /* 
-     free temporary arrays
+     the poloidal and toroidal expansions are kept for the next call,
+     if the solution is not saved, they will be overwritten
   */
-  if(!hc->save_solution){
-    /* 
-       POLOIDAL SOLUTION related expansions, those are not saved as they
-       change with density anomalies and plate motions
-    */
-    sh_free_expansion(hc->pol_sol,nsh_pol);
-    /* 
-       toroidal, maybe save those, since they only depend on plate velocities
-       and viscosities 
-    */
-    if(!free_slip)
-      sh_free_expansion(hc->tor_sol,nsh_tor);
-  }
   hc->psp.pol_init = TRUE;
   hc->psp.tor_init = TRUE;
   hc->spectral_solution_computed = TRUE;
@@ -209,6 +214,7 @@ void hc_sum(struct hcs *hc,
 {
   int itchoose,irchoose,ipchoose; /* indices for which solutions to use */
   int i,j,i3,i6;
+  HC_PREC *hfac=NULL;
   if(sol[0].lmax > hc->lfac_init)
     hc_init_l_factors(hc,sol[0].lmax);
 
@@ -236,8 +242,16 @@ void hc_sum(struct hcs *hc,
     itchoose = 1;// y10 for toroidal 
     break;
   case HC_HTRACTIONS:
-    fprintf(stderr,"hc_sum: horizontal tractions not implemented yet\n");
-    exit(-1);
+    //
+    //    stt stp spp output requested, from the horizontal strain-rates
+    //    of the velocity solution, see below
+    //
+    irchoose = 0; // y1 for radial
+    ipchoose = 1; // y2 for poloidal
+    itchoose = 0; // y9 for toroidal
+    hc_vecalloc(&hfac,sol[0].lmax+1,"hc_sum");
+    for(j=0;j <= sol[0].lmax;j++)
+      hfac[j] = -0.5 * hc->lfac[j];
     break;
   default:
     HC_ERROR("hc_sum","solve mode undefined");
@@ -273,7 +287,19 @@ void hc_sum(struct hcs *hc,
       /* no toroidal part for free-slip */
       sh_clear_alm((sol+i3+2));
     }
+    if(solve_mode == HC_HTRACTIONS){
+      /* 
+	 the radial expansion holds the isotropic part of the
+	 horizontal strain-rate, (e_tt + e_pp)/2 = u_r - l(l+1)/2 y2,
+	 both divided by r. the deviatoric part follows from the
+	 horizontal velocities in the pol/tor expansions, see
+	 sh_compute_spatial_tensor
+      */
+      sh_add_expansion_l_factor((sol+i3+HC_RAD),(sol+i3+HC_POL),hfac);
+    }
   } /* end layer loop */
+  if(solve_mode == HC_HTRACTIONS)
+    free(hfac);
 }
 
 
@@ -285,12 +311,17 @@ corresponding solution
 sol[nradp2 * 3 ]
 
 data has to be initialized, eg. as NULL
+
+for HC_HTRACTIONS, the three components are ttt, ttp, and tpp as
+computed by sh_compute_spatial_tensor
 */
 void hc_compute_sol_spatial(struct hcs *hc, struct sh_lms *sol_w,
-			    HC_PREC **sol_x, hc_boolean verbose)
+			    HC_PREC **sol_x, int sol_mode,
+			    hc_boolean verbose)
 {
   int i,i3,np,np2,np3,os;
   static int ntype = 3;
+  struct sh_lms *work = NULL;
   np = sol_w[0].npoints;
   np2 = np * 2;
   np3 = np2 + np;	/* 
@@ -303,15 +334,26 @@ void hc_compute_sol_spatial(struct hcs *hc, struct sh_lms *sol_w,
      compute the plm factors 
   */
   sh_compute_plm(sol_w,1,&hc->plm,verbose);
+  if(sol_mode == HC_HTRACTIONS)
+    sh_allocate_and_init(&work,4,sol_w[0].lmax,sol_w[0].type,1,verbose,FALSE);
   for(i=i3=0;i < hc->nradp2;i++,i3 += ntype){
     os = i*np3;
-    /* radial component */
-    sh_compute_spatial((sol_w+i3+HC_RAD),0,TRUE,&hc->plm,
-		       (*sol_x+os),verbose);
-    os += np;
-    /* poloidal/toroidal component */
-    sh_compute_spatial((sol_w+i3+HC_POL),1,TRUE,&hc->plm,
-		       (*sol_x+os),verbose);
+    if(sol_mode == HC_HTRACTIONS){
+      /* horizontal stress tensor components */
+      sh_compute_spatial_tensor((sol_w+i3+HC_RAD),work,TRUE,&hc->plm,
+				(*sol_x+os),verbose);
+    }else{
+      /* 
+	 radial and poloidal/toroidal components in one go, r, theta,
+	 phi
+      */
+      sh_compute_spatial_rv((sol_w+i3+HC_RAD),TRUE,&hc->plm,
+			    (*sol_x+os),verbose);
+    }
+  }
+  if(work){
+    sh_free_expansion(work,4);
+    free(work);
   }
   hc->spatial_solution_computed = TRUE;
 }
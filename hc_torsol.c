@@ -137,6 +137,9 @@ void hc_torsol(struct hcs *hc,
   /* set local pointes */
   tvec1 = tvec;
   tvec2 = (tvec + hc->nradp2 * lmaxp1);
+  /* l = 0 does not get computed below, but gets used for scaling */
+  for(i=os=0;i < hc->nradp2;i++,os+=lmaxp1)
+    tvec1[os] = tvec2[os] = 0.0;
   //
   //     (PREVENTS THE REQUESTING OF NON-EXISTANT VALUES)
   //     
@@ -0,0 +1,388 @@
+#include "hc.h"
+#ifdef HC_USE_ZLIB
+#include <zlib.h>
+#endif
+/*
+
+   XML VTK unstructured grid (.vtu) output of a spatial solution on
+   the Gauss grid of a SH_RICK expansion, as read by Paraview
+
+   the mesh is the same as for the legacy VTK files of hc_print_vtk:
+   nlay layers of npoints + 2 nodes (the two poles are appended to
+   every layer), hexahedra between neighboring layers, and wedges
+   around the poles. all arrays go as contiguous blocks into the
+   appended raw data section, in the native byte order, with UInt64
+   headers, and optionally zlib compressed in HC_VTU_BLOCK sized
+   pieces (vtkZLibDataCompressor, needs HC_USE_ZLIB)
+
+   the connectivity, offsets, and cell types are only computed for
+   one layer, and shifted for all others. node locations and
+   cartesian vectors are computed directly from the layer-wise r,
+   theta, phi spatial fields, without intermediate copies
+
+*/
+
+/*
+
+   write a VTU file to out
+
+   exp:     expansion that defines the grid (SH_RICK), e.g. the first
+            of a solution
+   r:       radii of the nlay layers, bottom up
+   vec:     for layer i, vec + i*vec_stride holds the r, theta, and
+            phi components on the npoints grid, one after the other
+   fac:     if not NULL, scale components k of layer i by fac[i*3+k]
+   vec_name: name of the vector field
+   htensor: if TRUE, vec holds the stt, stp, and spp components of a
+            horizontal stress tensor instead (see
+            sh_compute_spatial_tensor), which is written as a
+            cartesian tensor with nine components
+   scalar:  if nscalar > 0, scalar field j of layer i is at
+            scalar + i*scalar_stride + j*npoints
+
+*/
+void hc_print_vtu(FILE *out,struct sh_lms *exp,HC_PREC *r,int nlay,
+		  HC_PREC *vec,int vec_stride,HC_PREC *fac,
+		  char *vec_name,hc_boolean htensor,
+		  HC_PREC *scalar,int nscalar,
+		  int scalar_stride,hc_boolean compress,
+		  hc_boolean verbose)
+{
+  int i,j,k,l,ilay,np,npl,nlon,nlat,nele_lay,nele_lay_reg,nconn_lay,
+    *conn,*coff,tl,tr,nlon_m1,nleft,cshift,ncomp;
+  long long nnodes,ncells,*offset;
+  HC_PREC *xy=NULL,*base,*unit,pvec[3],cvec[9],spole[9],npole[9],lfac[3],
+    theta,phi,*et,*ep;
+  float *fbuf;
+  int *ibuf;
+  unsigned char *tbuf;
+  struct hc_outbuf app;
+  struct hc_vtu_array arr;
+  FILE *file_dummy=NULL;
+  HC_PREC flt_dummy = 0;
+
+  if(exp->type != SH_RICK)
+    HC_ERROR("hc_print_vtu","SH_RICK type required");
+#ifndef HC_USE_ZLIB
+  if(compress){
+    fprintf(stderr,"hc_print_vtu: WARNING: no zlib support compiled in, writing uncompressed\n");
+    compress = FALSE;
+  }
+#endif
+  np = exp->npoints;
+  ncomp = (htensor)?(9):(3);	/* components per node */
+  nlat = exp->rick.nlat;
+  nlon = exp->rick.nlon;
+  npl = np + 2;			/* nodes per layer */
+  nlon_m1 = nlon - 1;
+  tl = (nlat-1)*nlon;tr = tl + nlon; /* top row */
+  nele_lay_reg = nlon * (nlat - 1);
+  nele_lay = nele_lay_reg + 2*nlon;
+  nconn_lay = nele_lay_reg * 8 + 2*nlon * 6;
+  nnodes = (long long)npl * nlay;
+  ncells = (long long)nele_lay * (nlay - 1);
+  if((long long)nconn_lay * (nlay-1) > INT_MAX)
+    HC_ERROR("hc_print_vtu","too many nodes for Int32 connectivity");
+  /*
+     unit vectors and polar bases of all points, shared by all layers
+  */
+  sh_compute_spatial_basis(exp,file_dummy,FALSE,flt_dummy,&xy,1,verbose);
+  hc_vecalloc(&base,9*np,"hc_print_vtu");
+  for(i=0;i < np;i++){
+    theta = LAT2THETA(xy[i*2+1]);phi = LON2PHI(xy[i*2]);
+    calc_polar_base_at_theta_phi(theta,phi,(base+i*9));
+  }
+  unit = base;			/* the r basis vector is the location */
+  free(xy);
+  /* one layer worth of output values */
+  fbuf = (float *)malloc(sizeof(float)*ncomp*(size_t)npl);
+  ibuf = (int *)malloc(sizeof(int)*(size_t)nconn_lay);
+  hc_ivecalloc(&conn,nconn_lay,"hc_print_vtu");
+  hc_ivecalloc(&coff,nele_lay,"hc_print_vtu");
+  offset = (long long *)malloc(sizeof(long long)*(3+nscalar+3));
+  tbuf = (unsigned char *)malloc((size_t)nele_lay);
+  if(!fbuf || !ibuf || !offset || !tbuf)
+    HC_MEMERROR("hc_print_vtu");
+  /*
+     connectivity pattern of the bottom layer, node numbers as in
+     hc_print_vtk
+  */
+  for(i=k=0;i < nlat-1;i++)
+    for(j=0;j < nlon;j++){
+      nleft = i * nlon + j;
+      if(j == nlon_m1){	/* at edge, wrap around */
+	conn[k+3] = nleft+nlon;conn[k+2] = nleft-nlon_m1+nlon;
+	conn[k]   = nleft;     conn[k+1] = nleft-nlon_m1;
+      }else{
+	conn[k+3] = nleft+nlon;conn[k+2] = nleft+nlon+1;
+	conn[k]   = nleft;     conn[k+1] = nleft+1;
+      }
+      for(l=0;l < 4;l++)	/* layer above */
+	conn[k+4+l] = conn[k+l] + npl;
+      coff[i*nlon+j] = k + 8;
+      k += 8;
+    }
+  for(j=0;j < 2;j++)
+    for(i=0;i < nlon;i++){
+      if(j == 0){		/* south pole */
+	nleft = i;
+	conn[k] = np;
+	if(i == nlon_m1){
+	  conn[k+1] = nleft-nlon_m1;conn[k+2] = nleft;
+	}else{
+	  conn[k+1] = nleft+1;conn[k+2] = nleft;
+	}
+      }else{			/* north pole */
+	nleft = (nlat-2) * nlon + i;
+	conn[k] = nleft;
+	conn[k+1] = (i == nlon_m1)?(nleft-nlon_m1):(nleft+1);
+	conn[k+2] = np + 1;
+      }
+      for(l=0;l < 3;l++)
+	conn[k+3+l] = conn[k+l] + npl;
+      coff[nele_lay_reg + j*nlon + i] = k + 6;
+      k += 6;
+    }
+  /*
+     encode all arrays into the appended data section, in memory
+  */
+  hc_outbuf_init(&app,NULL,HC_OUTBUF_SIZE);
+  /* node locations */
+  offset[0] = (long long)app.n;
+  hc_vtu_begin(&arr,&app,(size_t)nnodes*3*sizeof(float),compress);
+  for(ilay=0;ilay < nlay;ilay++){
+    for(i=0;i < np;i++)
+      for(k=0;k < 3;k++)
+	fbuf[i*3+k] = (float)(unit[i*9+k] * r[ilay]);
+    fbuf[np*3] = fbuf[np*3+1] = fbuf[np*3+4] = fbuf[np*3+3] = 0.0;
+    fbuf[np*3+2] = (float)-r[ilay];fbuf[np*3+5] = (float)r[ilay];
+    hc_vtu_add(&arr,fbuf,sizeof(float)*3*(size_t)npl);
+  }
+  hc_vtu_end(&arr);
+  /* connectivity */
+  offset[1] = (long long)app.n;
+  hc_vtu_begin(&arr,&app,(size_t)nconn_lay*(nlay-1)*sizeof(int),compress);
+  for(ilay=0;ilay < nlay-1;ilay++){
+    cshift = ilay * npl;
+    for(i=0;i < nconn_lay;i++)
+      ibuf[i] = conn[i] + cshift;
+    hc_vtu_add(&arr,ibuf,sizeof(int)*(size_t)nconn_lay);
+  }
+  hc_vtu_end(&arr);
+  /* offsets */
+  offset[2] = (long long)app.n;
+  hc_vtu_begin(&arr,&app,(size_t)ncells*sizeof(int),compress);
+  for(ilay=0;ilay < nlay-1;ilay++){
+    cshift = ilay * nconn_lay;
+    for(i=0;i < nele_lay;i++)
+      ibuf[i] = coff[i] + cshift;
+    hc_vtu_add(&arr,ibuf,sizeof(int)*(size_t)nele_lay);
+  }
+  hc_vtu_end(&arr);
+  /* cell types, VTK_HEXAHEDRON and VTK_WEDGE */
+  offset[3] = (long long)app.n;
+  memset(tbuf,12,(size_t)nele_lay_reg);
+  memset((tbuf+nele_lay_reg),13,(size_t)(nele_lay-nele_lay_reg));
+  hc_vtu_begin(&arr,&app,(size_t)ncells,compress);
+  for(ilay=0;ilay < nlay-1;ilay++)
+    hc_vtu_add(&arr,tbuf,(size_t)nele_lay);
+  hc_vtu_end(&arr);
+  /*
+     scalars, poles are the averages of the first and last rows
+  */
+  for(j=0;j < nscalar;j++){
+    offset[4+j] = (long long)app.n;
+    hc_vtu_begin(&arr,&app,(size_t)nnodes*sizeof(float),compress);
+    for(ilay=0;ilay < nlay;ilay++){
+      HC_PREC *s;
+      s = scalar + (size_t)ilay*scalar_stride + (size_t)j*np;
+      spole[0] = npole[0] = 0.0;
+      for(i=0;i < np;i++){
+	fbuf[i] = (float)s[i];
+	if(i < nlon)
+	  spole[0] += s[i];
+	if((i >= tl) && (i < tr))
+	  npole[0] += s[i];
+      }
+      fbuf[np]   = (float)(spole[0]/(HC_PREC)nlon);
+      fbuf[np+1] = (float)(npole[0]/(HC_PREC)nlon);
+      hc_vtu_add(&arr,fbuf,sizeof(float)*(size_t)npl);
+    }
+    hc_vtu_end(&arr);
+  }
+  /*
+     cartesian vectors, or tensors
+     
+     t_ij = stt e_t,i e_t,j + stp (e_t,i e_p,j + e_p,i e_t,j) + spp e_p,i e_p,j
+  */
+  offset[4+nscalar] = (long long)app.n;
+  hc_vtu_begin(&arr,&app,(size_t)nnodes*ncomp*sizeof(float),compress);
+  for(ilay=0;ilay < nlay;ilay++){
+    HC_PREC *v;
+    v = vec + (size_t)ilay*vec_stride;
+    for(k=0;k < 3;k++)
+      lfac[k] = (fac)?(fac[ilay*3+k]):(1.0);
+    for(k=0;k < ncomp;k++)
+      spole[k] = npole[k] = 0.0;
+    for(i=0;i < np;i++){
+      for(k=0;k < 3;k++)
+	pvec[k] = v[k*np+i] * lfac[k];
+      if(htensor){
+	et = base + i*9 + 3;ep = base + i*9 + 6;
+	for(k=0;k < 3;k++)
+	  for(l=0;l < 3;l++)
+	    cvec[k*3+l] = pvec[0] * et[k] * et[l] + 
+	      pvec[1] * (et[k] * ep[l] + ep[k] * et[l]) + 
+	      pvec[2] * ep[k] * ep[l];
+      }else
+	lonlatpv2cv_with_base(pvec,(base+i*9),cvec);
+      for(k=0;k < ncomp;k++){
+	fbuf[i*ncomp+k] = (float)cvec[k];
+	if(i < nlon)
+	  spole[k] += cvec[k];
+	if((i >= tl) && (i < tr))
+	  npole[k] += cvec[k];
+      }
+    }
+    for(k=0;k < ncomp;k++){
+      fbuf[np*ncomp+k]       = (float)(spole[k]/(HC_PREC)nlon);
+      fbuf[np*ncomp+ncomp+k] = (float)(npole[k]/(HC_PREC)nlon);
+    }
+    hc_vtu_add(&arr,fbuf,sizeof(float)*ncomp*(size_t)npl);
+  }
+  hc_vtu_end(&arr);
+  /*
+     XML part
+  */
+  fprintf(out,"<?xml version=\"1.0\"?>\n");
+  fprintf(out,"<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+	  (hc_is_little_endian())?("LittleEndian"):("BigEndian"),
+	  (compress)?(" compressor=\"vtkZLibDataCompressor\""):(""));
+  fprintf(out,"  <UnstructuredGrid>\n");
+  fprintf(out,"    <Piece NumberOfPoints=\"%lli\" NumberOfCells=\"%lli\">\n",nnodes,ncells);
+  fprintf(out,"      <PointData");
+  if(nscalar)
+    fprintf(out," Scalars=\"scalar1\"");
+  fprintf(out," %s=\"%s\">\n",(htensor)?("Tensors"):("Vectors"),vec_name);
+  for(j=0;j < nscalar;j++)
+    fprintf(out,"        <DataArray type=\"Float32\" Name=\"scalar%i\" format=\"appended\" offset=\"%lli\"/>\n",
+	    j+1,offset[4+j]);
+  fprintf(out,"        <DataArray type=\"Float32\" Name=\"%s\" NumberOfComponents=\"%i\" format=\"appended\" offset=\"%lli\"/>\n",
+	  vec_name,ncomp,offset[4+nscalar]);
+  fprintf(out,"      </PointData>\n");
+  fprintf(out,"      <Points>\n");
+  fprintf(out,"        <DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"appended\" offset=\"%lli\"/>\n",
+	  offset[0]);
+  fprintf(out,"      </Points>\n");
+  fprintf(out,"      <Cells>\n");
+  fprintf(out,"        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\"%lli\"/>\n",
+	  offset[1]);
+  fprintf(out,"        <DataArray type=\"Int32\" Name=\"offsets\" format=\"appended\" offset=\"%lli\"/>\n",
+	  offset[2]);
+  fprintf(out,"        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"%lli\"/>\n",
+	  offset[3]);
+  fprintf(out,"      </Cells>\n");
+  fprintf(out,"    </Piece>\n");
+  fprintf(out,"  </UnstructuredGrid>\n");
+  fprintf(out,"  <AppendedData encoding=\"raw\">\n   _");
+  if(fwrite(app.buf,1,app.n,out) != app.n)
+    HC_ERROR("hc_print_vtu","write error");
+  fprintf(out,"\n  </AppendedData>\n</VTKFile>\n");
+  if(verbose)
+    fprintf(stderr,"hc_print_vtu: %lli nodes, %lli cells, %i layers, %.1f MB %s\n",
+	    nnodes,ncells,nlay,(double)app.n/1048576.,
+	    (compress)?("compressed"):("raw"));
+  hc_outbuf_free(&app);
+  free(base);free(fbuf);free(ibuf);free(conn);free(coff);
+  free(offset);free(tbuf);
+}
+/*
+
+   start an appended data array of nbytes bytes in ob. the UInt64
+   header is [nbytes] for raw data, and [nblocks, block size, size of
+   the last partial block, compressed block sizes...] for compressed
+   data
+
+*/
+void hc_vtu_begin(struct hc_vtu_array *a,struct hc_outbuf *ob,
+		  size_t nbytes,hc_boolean compress)
+{
+  unsigned long long h[3];
+  a->ob = ob;
+  a->nbytes = nbytes;
+  a->compress = compress;
+  a->header = ob->n;
+  a->nstage = 0;
+  a->iblock = 0;
+  if(!compress){
+    h[0] = (unsigned long long)nbytes;
+    hc_outbuf_mem(ob,(char *)h,sizeof(unsigned long long));
+    a->stage = NULL;
+  }else{
+    a->nblock = (nbytes + HC_VTU_BLOCK - 1) / HC_VTU_BLOCK;
+    h[0] = (unsigned long long)a->nblock;
+    h[1] = (unsigned long long)HC_VTU_BLOCK;
+    h[2] = (unsigned long long)(nbytes % HC_VTU_BLOCK);
+    hc_outbuf_mem(ob,(char *)h,3*sizeof(unsigned long long));
+    /* room for the compressed block sizes, filled in later */
+    hc_outbuf_reserve(ob,a->nblock*sizeof(unsigned long long));
+    memset((ob->buf+ob->n),0,a->nblock*sizeof(unsigned long long));
+    ob->n += a->nblock*sizeof(unsigned long long);
+    a->stage = (unsigned char *)malloc(HC_VTU_BLOCK);
+    if(!a->stage)
+      HC_MEMERROR("hc_vtu_begin");
+  }
+}
+/* append n bytes of data to an array */
+void hc_vtu_add(struct hc_vtu_array *a,void *data,size_t n)
+{
+  size_t m;
+  unsigned char *p;
+  if(!a->compress){
+    hc_outbuf_mem(a->ob,(char *)data,n);
+    return;
+  }
+  p = (unsigned char *)data;
+  while(n){
+    m = HC_VTU_BLOCK - a->nstage;
+    if(m > n)
+      m = n;
+    memcpy((a->stage+a->nstage),p,m);
+    a->nstage += m;p += m;n -= m;
+    if(a->nstage == HC_VTU_BLOCK)
+      hc_vtu_compress_block(a);
+  }
+}
+/* finish an array */
+void hc_vtu_end(struct hc_vtu_array *a)
+{
+  if(a->compress){
+    if(a->nstage)
+      hc_vtu_compress_block(a);
+    if(a->iblock != a->nblock)
+      HC_ERROR("hc_vtu_end","array size mismatch");
+    free(a->stage);
+  }else if(a->ob->n - a->header != a->nbytes + sizeof(unsigned long long))
+    HC_ERROR("hc_vtu_end","array size mismatch");
+}
+/* compress the staged block and record its size in the header */
+void hc_vtu_compress_block(struct hc_vtu_array *a)
+{
+#ifdef HC_USE_ZLIB
+  uLongf clen;
+  unsigned long long size;
+  clen = compressBound((uLong)a->nstage);
+  hc_outbuf_reserve(a->ob,(size_t)clen);
+  if(compress2((Bytef *)(a->ob->buf + a->ob->n),&clen,
+	       (Bytef *)a->stage,(uLong)a->nstage,HC_VTU_ZLIB_LEVEL) != Z_OK)
+    HC_ERROR("hc_vtu_compress_block","zlib error");
+  a->ob->n += (size_t)clen;
+  size = (unsigned long long)clen;
+  memcpy((a->ob->buf + a->header + (3+a->iblock)*sizeof(unsigned long long)),
+	 &size,sizeof(unsigned long long));
+  a->iblock++;
+  a->nstage = 0;
+#else
+  HC_ERROR("hc_vtu_compress_block","no zlib support");
+#endif
+}
@@ -0,0 +1,237 @@
+#include "hc.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+/*
+
+   optional on-disk cache of the full Legendre function tables at the
+   Gauss latitudes, as computed by rick_compute_allplm
+
+   if the environment variable RICK_PLM_CACHE_ENV (HC_PLM_CACHE) names
+   a directory, or a directory was set with rick_set_plm_cache_dir,
+   rick_get_plm_table will first try to memory-map a table for the
+   given lmax and ivec from there, and else store the table it
+   computed for later runs
+
+   file layout: a struct rick_plm_cache_header (padded to
+   RICK_PLM_CACHE_HDR bytes), the nlat Gauss points and weights the
+   table was computed for (as SH_RICK_HIGH_PREC), and the
+   nplm*(1+ivec) Plm/dPlm values (as SH_RICK_PREC). the
+   checksum covers those three parts. tables are only used
+   if version, precision, byte order, dimensions, Gauss points, and
+   checksum all match, else they get recomputed and overwritten
+
+*/
+
+static char *rick_plm_cache_dir = NULL;
+static my_boolean rick_plm_cache_dir_init = FALSE;
+
+/*
+   set the cache directory, NULL switches the cache off. overrides the
+   environment variable
+*/
+void rick_set_plm_cache_dir(char *dir)
+{
+  if(rick_plm_cache_dir)
+    free(rick_plm_cache_dir);
+  rick_plm_cache_dir = NULL;
+  if(dir && strlen(dir)){
+    rick_plm_cache_dir = (char *)malloc(strlen(dir)+1);
+    if(!rick_plm_cache_dir)
+      HC_MEMERROR("rick_set_plm_cache_dir");
+    strcpy(rick_plm_cache_dir,dir);
+  }
+  rick_plm_cache_dir_init = TRUE;
+}
+/*
+   return the cache directory, or NULL if not in use
+*/
+char *rick_get_plm_cache_dir(void)
+{
+  if(!rick_plm_cache_dir_init)
+    rick_set_plm_cache_dir(getenv(RICK_PLM_CACHE_ENV));
+  return rick_plm_cache_dir;
+}
+/*
+   file name for lmax and ivec
+*/
+void rick_plm_cache_name(char *name,char *dir,int lmax,int ivec)
+{
+  sprintf(name,"%s/rick_plm.%i.%i.%i.v%i.bin",dir,lmax,ivec,
+	  (int)sizeof(SH_RICK_PREC),RICK_PLM_CACHE_VERSION);
+}
+/*
+
+   64 bit checksum of n bytes, start with h =
+   RICK_PLM_CACHE_CHECKSUM_INIT or continue with a previous one. this
+   is FNV-1a applied to 64 bit words in four interleaved lanes (and
+   bytewise for the remainder), which is fast enough to check GB sized
+   tables on every load
+
+*/
+unsigned long long rick_plm_cache_checksum(unsigned long long h,
+					   unsigned char *p,size_t n)
+{
+  const unsigned long long prime = 1099511628211ULL;
+  unsigned long long w[4],l[4];
+  size_t i,j,nw;
+  nw = n / 32;
+  l[0] = h;l[1] = h ^ 1;l[2] = h ^ 2;l[3] = h ^ 3;
+  for(i=0;i < nw;i++,p += 32){
+    memcpy(w,p,32);
+    for(j=0;j < 4;j++)
+      l[j] = (l[j] ^ w[j]) * prime;
+  }
+  h = l[0];
+  for(j=1;j < 4;j++)
+    h = (h ^ l[j]) * prime;
+  for(i=nw*32;i < n;i++,p++)
+    h = (h ^ (unsigned long long)(*p)) * prime;
+  return h;
+}
+/* size of a cache file in bytes */
+size_t rick_plm_cache_size(int nlat,int nplm,int ivec)
+{
+  return RICK_PLM_CACHE_HDR + (size_t)2*nlat*sizeof(SH_RICK_HIGH_PREC) + 
+    (size_t)nplm*(1+ivec)*sizeof(SH_RICK_PREC);
+}
+/*
+   fill a header for a table
+*/
+void rick_plm_cache_set_header(struct rick_plm_cache_header *h,
+			       int lmax,int ivec,int nlat,int nplm)
+{
+  memset(h,0,sizeof(struct rick_plm_cache_header));
+  strncpy(h->magic,RICK_PLM_CACHE_MAGIC,8);
+  h->version = RICK_PLM_CACHE_VERSION;
+  h->byte_order = 0x01020304;
+  h->prec = (int)sizeof(SH_RICK_PREC);
+  h->lmax = lmax;
+  h->ivec = ivec;
+  h->nlat = nlat;
+  h->nplm = nplm;
+  h->ndata = (long long)2*nlat + (long long)nplm*(1+ivec);
+}
+/*
+
+   try to memory-map the table for lmax and ivec. gauss_z and gauss_w
+   are those of the calling module, and need to match the cached
+   ones. on success, returns the Plm part, and the mapping in *map of
+   size *map_size (release with rick_plm_cache_unmap). else, returns
+   NULL
+
+*/
+SH_RICK_PREC *rick_plm_cache_load(int lmax,int ivec,int nlat,int nplm,
+				  SH_RICK_HIGH_PREC *gauss_z,
+				  SH_RICK_HIGH_PREC *gauss_w,
+				  void **map,size_t *map_size)
+{
+  char *dir,name[HC_CHAR_LENGTH];
+  struct rick_plm_cache_header h,*fh;
+  struct stat st;
+  SH_RICK_HIGH_PREC *gdata;
+  SH_RICK_PREC *data;
+  unsigned long long sum;
+  size_t size;
+  int fd,i;
+  void *p;
+  if(!(dir = rick_get_plm_cache_dir()))
+    return NULL;
+  rick_plm_cache_name(name,dir,lmax,ivec);
+  rick_plm_cache_set_header(&h,lmax,ivec,nlat,nplm);
+  size = rick_plm_cache_size(nlat,nplm,ivec);
+  if((fd = open(name,O_RDONLY)) < 0)
+    return NULL;
+  if((fstat(fd,&st) != 0)||((size_t)st.st_size != size)){
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(p == MAP_FAILED)
+    return NULL;
+  fh = (struct rick_plm_cache_header *)p;
+  gdata = (SH_RICK_HIGH_PREC *)((char *)p + RICK_PLM_CACHE_HDR);
+  data = (SH_RICK_PREC *)(gdata + 2*nlat);
+  /* check the header, everything but the checksum */
+  h.checksum = fh->checksum;
+  if(memcmp(&h,fh,sizeof(struct rick_plm_cache_header)) != 0){
+    munmap(p,size);
+    return NULL;
+  }
+  /* Gauss points have to be the same */
+  for(i=0;i < nlat;i++)
+    if((gdata[i] != gauss_z[i])||(gdata[nlat+i] != gauss_w[i])){
+      munmap(p,size);
+      return NULL;
+    }
+  sum = rick_plm_cache_checksum(RICK_PLM_CACHE_CHECKSUM_INIT,(unsigned char *)gdata,
+				nlat*sizeof(SH_RICK_HIGH_PREC));
+  sum = rick_plm_cache_checksum(sum,(unsigned char *)(gdata+nlat),
+				nlat*sizeof(SH_RICK_HIGH_PREC));
+  sum = rick_plm_cache_checksum(sum,(unsigned char *)data,
+				((size_t)h.ndata-2*nlat)*sizeof(SH_RICK_PREC));
+  if(sum != fh->checksum){
+    fprintf(stderr,"rick_plm_cache_load: WARNING: checksum mismatch for %s, recomputing\n",
+	    name);
+    munmap(p,size);
+    return NULL;
+  }
+  *map = p;
+  *map_size = size;
+  return data;
+}
+/*
+
+   store a table as computed. the file is written under a temporary
+   name and then renamed, such that other processes will never map a
+   partial file. failure only produces a warning
+
+*/
+void rick_plm_cache_store(int lmax,int ivec,int nlat,int nplm,
+			  SH_RICK_HIGH_PREC *gauss_z,SH_RICK_HIGH_PREC *gauss_w,
+			  SH_RICK_PREC *plm)
+{
+  char *dir,name[HC_CHAR_LENGTH],tname[HC_CHAR_LENGTH+30];
+  char hbuf[RICK_PLM_CACHE_HDR];
+  struct rick_plm_cache_header h;
+  unsigned long long sum;
+  size_t n,np;
+  FILE *out;
+  if(!(dir = rick_get_plm_cache_dir()))
+    return;
+  rick_plm_cache_name(name,dir,lmax,ivec);
+  sprintf(tname,"%s.tmp.%i",name,(int)getpid());
+  rick_plm_cache_set_header(&h,lmax,ivec,nlat,nplm);
+  np = (size_t)nplm*(1+ivec);
+  /* checksum over Gauss points, weights and Plm */
+  sum = rick_plm_cache_checksum(RICK_PLM_CACHE_CHECKSUM_INIT,(unsigned char *)gauss_z,
+				nlat*sizeof(SH_RICK_HIGH_PREC));
+  sum = rick_plm_cache_checksum(sum,(unsigned char *)gauss_w,nlat*sizeof(SH_RICK_HIGH_PREC));
+  h.checksum = rick_plm_cache_checksum(sum,(unsigned char *)plm,np*sizeof(SH_RICK_PREC));
+  memset(hbuf,0,RICK_PLM_CACHE_HDR);
+  memcpy(hbuf,&h,sizeof(struct rick_plm_cache_header));
+  if(!(out = fopen(tname,"w"))){
+    fprintf(stderr,"rick_plm_cache_store: WARNING: cannot write to %s\n",tname);
+    return;
+  }
+  n  = fwrite(hbuf,1,RICK_PLM_CACHE_HDR,out);
+  n += fwrite(gauss_z,sizeof(SH_RICK_HIGH_PREC),nlat,out) * sizeof(SH_RICK_HIGH_PREC);
+  n += fwrite(gauss_w,sizeof(SH_RICK_HIGH_PREC),nlat,out) * sizeof(SH_RICK_HIGH_PREC);
+  n += fwrite(plm,sizeof(SH_RICK_PREC),np,out) * sizeof(SH_RICK_PREC);
+  if((fclose(out) != 0)||
+     (n != rick_plm_cache_size(nlat,nplm,ivec))||
+     (rename(tname,name) != 0)){
+    fprintf(stderr,"rick_plm_cache_store: WARNING: could not write %s\n",name);
+    remove(tname);
+  }
+}
+/*
+   release a mapping from rick_plm_cache_load
+*/
+void rick_plm_cache_unmap(void *map,size_t map_size)
+{
+  munmap(map,map_size);
+}
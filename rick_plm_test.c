@@ -0,0 +1,105 @@
+#include "hc.h"
+/*
+
+   accuracy of the Legendre functions of Rick type expansions, for the
+   Gauss points of lmax
+
+   - the standard recurrence (rick_plmbar1_std) and the one with
+     extended exponents (rick_plmbar1_xnum) should agree where the
+     former does not underflow
+
+   - the normalization of all P(l,m) is checked by Gauss quadrature,
+     which is exact for those. terms which are lost because of
+     underflow in the standard recurrence show up here
+
+   fails, with non-zero exit status, if the recurrence rick_plmbar1
+   uses for lmax (the X-numbers above RICK_PLM_XNUM_LMAX) is off, or
+   if both disagree where the standard one is still in use. run e.g.
+
+   rick_plm_test 511 1023 2047
+
+*/
+#define RICK_PLM_TEST_NORM_TOL 1e-8
+#define RICK_PLM_TEST_DIFF_TOL 1e-10
+
+static int rick_plm_test_accuracy(int lmax)
+{
+  struct rick_module rick;
+  int npoints,nplm,tnplm,i,j,k,l,m,nlost[2],used;
+  SH_RICK_PREC *p,*px,*norm[2];
+  double maxdiff,maxerr[2],err;
+  
+  memset(&rick,0,sizeof(struct rick_module));
+  rick_init(lmax,0,&npoints,&nplm,&tnplm,&rick,FALSE);
+  rick_vecalloc(&p,rick.lmsize,"rick_plm_test");
+  rick_vecalloc(&px,rick.lmsize,"rick_plm_test");
+  for(j=0;j < 2;j++){
+    rick_vecalloc((norm+j),rick.lmsize,"rick_plm_test");
+    for(k=0;k < rick.lmsize;k++)
+      norm[j][k] = 0.0;
+  }
+  maxdiff = 0.0;
+  for(i=0;i < rick.nlat;i++){
+    /* m = 0 terms */
+    rick_plmbar1(p,NULL,0,lmax,rick.gauss_z[i],&rick);
+    for(k=0;k < rick.lmsize;k++)
+      px[k] = p[k];
+    /* m > 0 both ways */
+    rick_plmbar1_std(p,lmax,rick.gauss_z[i],&rick);
+    rick_plmbar1_xnum(px,lmax,rick.gauss_z[i],&rick);
+    for(k=0;k < rick.lmsize;k++){
+      if(p[k] != 0.0)		/* not underflown */
+	maxdiff = HC_MAX(maxdiff,fabs(p[k]-px[k]));
+      norm[0][k] += rick.gauss_w[i] * p[k]  * p[k];
+      norm[1][k] += rick.gauss_w[i] * px[k] * px[k];
+    }
+  }
+  for(j=0;j < 2;j++){
+    maxerr[j] = 0.0;
+    nlost[j] = 0;
+    for(l=k=0;l <= lmax;l++)
+      for(m=0;m <= l;m++,k++){
+	/* should be 2(2-delta(0,m)) */
+	err = fabs(norm[j][k]/((m==0)?(2.0):(4.0)) - 1.0);
+	maxerr[j] = HC_MAX(maxerr[j],err);
+	if(err > 1e-6)
+	  nlost[j]++;
+      }
+  }
+  used = (lmax > RICK_PLM_XNUM_LMAX)?(1):(0);
+  fprintf(stdout,"%5i %11.3e  %11.3e %8i%s  %11.3e %8i%s  %8i\n",lmax,maxdiff,
+	  maxerr[0],nlost[0],(used==0)?("*"):(" "),
+	  maxerr[1],nlost[1],(used==1)?("*"):(" "),rick.lmsize);
+  free(p);free(px);free(norm[0]);free(norm[1]);
+  rick_free_module(&rick,0);
+  if(((used == 0)&&(maxdiff > RICK_PLM_TEST_DIFF_TOL))||
+     (maxerr[used] > RICK_PLM_TEST_NORM_TOL)){
+    fprintf(stderr,"rick_plm_test: FAILED for lmax %i\n",lmax);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  int i,lmax,nfail;
+  if((argc > 1)&&(strcmp(argv[1],"-h")==0)){
+    fprintf(stderr,"%s [lmax_1 lmax_2 ..., 511 1023]\n",argv[0]);
+    fprintf(stderr,"checks the Legendre functions on the Gauss points of each lmax = 2**n-1\n");
+    exit(-1);
+  }
+  fprintf(stdout,"# lmax  |P_std-P_x|  standard, norm. error  X-numbers, norm. error    terms\n");
+  fprintf(stdout,"#                        max     lost          max     lost\n");
+  nfail = 0;
+  if(argc > 1){
+    for(i=1;i < argc;i++){
+      sscanf(argv[i],"%i",&lmax);
+      nfail += rick_plm_test_accuracy(lmax);
+    }
+  }else{
+    nfail += rick_plm_test_accuracy(511);
+    nfail += rick_plm_test_accuracy(1023);
+  }
+  fprintf(stdout,"# * recurrence in use, %i failed\n",nfail);
+  return (nfail)?(1):(0);
+}
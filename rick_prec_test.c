@@ -0,0 +1,197 @@
+#include "hc.h"
+#include <time.h>
+/*
+
+   regression benchmark for the single precision Rick transforms
+
+   this source gets compiled twice, against the regular double
+   precision library (rick_prec_test) and with SH_RICK_PRECISION=8
+   against the single precision library (rick_prec_test.float, see
+   librick.float.a in the Makefile)
+
+   the double precision version computes scalar and vector
+   (poloidal/toroidal) syntheses on the Gauss grid for lmax = 31, 63,
+   ..., 511 from a fixed set of random coefficients, and writes the
+   spatial fields to a reference file
+
+   the single precision version reads the reference, and reports max
+   and RMS errors, relative to the RMS of the reference, for
+
+   - the synthesis from the same coefficients (rounded to float)
+
+   - the analysis of the reference fields (rounded to float), compared
+     to the original coefficients
+
+   as well as the timings of both, for all three fields. run e.g.
+
+   rick_prec_test ref.bin; rick_prec_test.float ref.bin
+
+   the double precision version prints the error of its own analysis
+   for comparison
+
+*/
+#define RICK_PREC_TEST_LMIN 31
+#define RICK_PREC_TEST_LMAX 511
+#define RICK_PREC_TEST_NREP 3	/* timings are the best of those */
+
+static double rick_prec_test_time(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return (double)t.tv_sec + 1e-9*(double)t.tv_nsec;
+}
+/*
+   random coefficients, generated in double precision the same way
+   for both versions. B(l,0) is zero, as are the l = 0 terms of vector
+   fields
+*/
+static void rick_prec_test_coeff(double *c,int lmax,int seed,
+				 hc_boolean vector)
+{
+  int l,m,k;
+  unsigned long long r;
+  r = 88172645463325252ULL + (unsigned long long)seed;
+  for(l=k=0;l <= lmax;l++)
+    for(m=0;m <= l;m++,k++){
+      /* xorshift */
+      r ^= r << 13;r ^= r >> 7;r ^= r << 17;
+      c[k*2]   = (double)(r >> 11)/9007199254740992.0 - 0.5;
+      r ^= r << 13;r ^= r >> 7;r ^= r << 17;
+      c[k*2+1] = (m == 0)?(0.0):((double)(r >> 11)/9007199254740992.0 - 0.5);
+    }
+  if(vector)
+    c[0] = c[1] = 0.0;
+}
+/*
+   max and RMS of a - b, relative to the RMS of b
+*/
+static void rick_prec_test_error(SH_RICK_PREC *a,double *b,int n,
+				 double *maxerr,double *rmserr)
+{
+  int i;
+  double d,rms;
+  *maxerr = *rmserr = rms = 0.0;
+  for(i=0;i < n;i++){
+    d = (double)a[i] - b[i];
+    *maxerr = HC_MAX(*maxerr,fabs(d));
+    *rmserr += d*d;
+    rms += b[i]*b[i];
+  }
+  rms = sqrt(rms/(double)n);
+  *rmserr = sqrt(*rmserr/(double)n)/rms;
+  *maxerr /= rms;
+}
+
+int main(int argc, char **argv)
+{
+  struct rick_module rick;
+  int lmax,lmsize2,npoints,nplm,tnplm,i,j,hdr[2];
+  SH_RICK_PREC *plm,*c,*data,*coeff;
+  double *dc,*ref,t0,t1,t2,err[2];
+  FILE *fp;
+  char filename[HC_CHAR_LENGTH];
+
+  if(argc > 1)
+    sprintf(filename,"%s",argv[1]);
+  else
+    sprintf(filename,"rick_prec_test.ref");
+  if((argc > 2)||((argc > 1)&&(strcmp(argv[1],"-h")==0))){
+    fprintf(stderr,"%s [reference file, %s]\n",argv[0],filename);
+    fprintf(stderr,"double precision version writes, single precision version compares\n");
+    exit(-1);
+  }
+#if SH_RICK_PRECISION == 8
+  fp = fopen(filename,"r");
+#else
+  fp = fopen(filename,"w");
+#endif
+  if(!fp){
+    fprintf(stderr,"%s: error: could not open %s\n",argv[0],filename);
+    exit(-1);
+  }
+  fprintf(stdout,"# %s: %i byte floats, %s kernels, reference %s\n",argv[0],
+	  (int)sizeof(SH_RICK_PREC),rick_kernel_name(rick_get_kernels()->type),
+	  filename);
+#if SH_RICK_PRECISION == 8
+  fprintf(stdout,"# lmax   synthesis scalar      synthesis vector      analysis scalar       analysis vector      t_syn    t_ana\n");
+  fprintf(stdout,"#          max      rms          max      rms          max      rms          max      rms        [s]      [s]\n");
+#else
+  fprintf(stdout,"# lmax   analysis scalar       analysis vector      t_syn    t_ana\n");
+  fprintf(stdout,"#          max      rms          max      rms        [s]      [s]\n");
+#endif
+  for(lmax = RICK_PREC_TEST_LMIN;lmax <= RICK_PREC_TEST_LMAX;lmax = lmax*2+1){
+    memset(&rick,0,sizeof(struct rick_module));
+    rick_init(lmax,1,&npoints,&nplm,&tnplm,&rick,FALSE);
+    plm = rick_get_plm_table(lmax,1,&rick);
+    lmsize2 = rick.lmsize * 2;
+    /*
+       coefficients: scalar, poloidal, toroidal
+    */
+    hc_dvecalloc(&dc,3*lmsize2,"rick_prec_test");
+    rick_vecalloc(&c,3*lmsize2,"rick_prec_test");
+    for(i=0;i < 3;i++)
+      rick_prec_test_coeff((dc+i*lmsize2),lmax,i,(hc_boolean)(i > 0));
+    for(i=0;i < 3*lmsize2;i++)
+      c[i] = (SH_RICK_PREC)dc[i];
+    rick_vecalloc(&data,3*npoints,"rick_prec_test");
+    rick_vecalloc(&coeff,3*lmsize2,"rick_prec_test");
+    hc_dvecalloc(&ref,3*npoints,"rick_prec_test");
+    /*
+       synthesis
+    */
+    for(j=0;j < RICK_PREC_TEST_NREP;j++){
+      t0 = rick_prec_test_time();
+      rick_shc2d_pre(c,NULL,lmax,plm,(plm+nplm),0,data,NULL,&rick);
+      rick_shc2d_pre((c+lmsize2),(c+2*lmsize2),lmax,plm,(plm+nplm),1,
+		     (data+npoints),(data+2*npoints),&rick);
+      t0 = rick_prec_test_time() - t0;
+      t1 = (j == 0)?(t0):(HC_MIN(t1,t0));
+    }
+#if SH_RICK_PRECISION == 8
+    /* read reference */
+    if((fread(hdr,sizeof(int),2,fp) != 2)||(hdr[0] != lmax)||(hdr[1] != npoints)||
+       (fread(ref,sizeof(double),3*npoints,fp) != (size_t)(3*npoints))){
+      fprintf(stderr,"%s: error: reference %s does not match at lmax %i\n",
+	      argv[0],filename,lmax);
+      exit(-1);
+    }
+    fprintf(stdout,"%5i ",lmax);
+    rick_prec_test_error(data,ref,npoints,err,(err+1));
+    fprintf(stdout," %9.2e %9.2e ",err[0],err[1]);
+    rick_prec_test_error((data+npoints),(ref+npoints),2*npoints,err,(err+1));
+    fprintf(stdout," %9.2e %9.2e ",err[0],err[1]);
+    /* analyze the reference fields */
+    for(i=0;i < 3*npoints;i++)
+      data[i] = (SH_RICK_PREC)ref[i];
+#else
+    /* write reference */
+    hdr[0] = lmax;hdr[1] = npoints;
+    for(i=0;i < 3*npoints;i++)
+      ref[i] = (double)data[i];
+    fwrite(hdr,sizeof(int),2,fp);
+    fwrite(ref,sizeof(double),3*npoints,fp);
+    fprintf(stdout,"%5i ",lmax);
+#endif
+    /*
+       analysis
+    */
+    for(j=0;j < RICK_PREC_TEST_NREP;j++){
+      t0 = rick_prec_test_time();
+      rick_shd2c_pre(data,NULL,lmax,plm,(plm+nplm),0,coeff,NULL,&rick);
+      rick_shd2c_pre((data+npoints),(data+2*npoints),lmax,plm,(plm+nplm),1,
+		     (coeff+lmsize2),(coeff+2*lmsize2),&rick);
+      t0 = rick_prec_test_time() - t0;
+      t2 = (j == 0)?(t0):(HC_MIN(t2,t0));
+    }
+    rick_prec_test_error(coeff,dc,lmsize2,err,(err+1));
+    fprintf(stdout," %9.2e %9.2e ",err[0],err[1]);
+    rick_prec_test_error((coeff+lmsize2),(dc+lmsize2),2*lmsize2,err,(err+1));
+    fprintf(stdout," %9.2e %9.2e ",err[0],err[1]);
+    fprintf(stdout," %8.4f %8.4f\n",t1,t2);
+    free(dc);free(c);free(data);free(coeff);free(ref);
+    rick_release_plm_table(plm);
+    rick_free_module(&rick,1);
+  }
+  fclose(fp);
+  return 0;
+}
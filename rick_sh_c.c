@@ -4,22 +4,44 @@
 // compute Legendre function (l,m) evaluated on nlat points 
 // in latitude and their derviatives with respect to theta, if 
 // ivec is set to 1
+//
+// unlike rick_plmbar1, the output is sorted m-major for each
+// latitude, P(l,m) at latitude i is at i*lmsize + RICK_MM_INDEX(l,m,lmax)
+// so that the transforms can sum over l for fixed m 
 // */
 
 void rick_compute_allplm(int lmax,int ivec,SH_RICK_PREC *plm,
 			 SH_RICK_PREC *dplm, struct rick_module *rick) 
 {
-  int i,os;
+  int i;
   
   if (lmax != rick->nlat-1) {
     fprintf(stderr,"rick_compute_allplm: error: lmax mismatch: nlat/lmax %i %i \n",rick->nlat,lmax);
     /*     print *,nlat,lmax */
     exit(-1);
   }
-  os=0;				/* changed this to 0 TWB */
+  /* factors have to be there before going parallel */
+  rick_plmbar1_factors(ivec,lmax,rick);
+  rick_alloc_workspace(rick);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (i=0;i < rick->nlat;i++) { /*changed from 1->nlat to 0->nlat-1 - need change in plmbar1 also */
-    rick_plmbar1((plm+os),(dplm+os),ivec,lmax,rick->gauss_z[i],rick); /*note change in gauss_z[i] */
-    os += rick->lmsize;
+    int j,k,l,m,os;
+    SH_RICK_PREC *lplm,*ldplm;
+    /* l-major values for this latitude */
+    lplm = RICK_THREAD_WS(rick) + 2*(rick->nlon+2);
+    ldplm = lplm + rick->lmsize;
+    os = i * rick->lmsize;
+    rick_plmbar1(lplm,ldplm,ivec,lmax,rick->gauss_z[i],rick); /*note change in gauss_z[i] */
+    /* resort to m-major */
+    for(k=m=0;m <= lmax;m++)
+      for(l=m;l <= lmax;l++,k++){
+	j = (l+1)*l/2 + m;
+	plm[os+k] = lplm[j];
+	if(ivec)
+	  dplm[os+k] = ldplm[j];
+      }
   }
 }
 
@@ -31,12 +53,14 @@ void rick_compute_allplm_reg(int lmax,int ivec,SH_RICK_PREC *plm,
 			     SH_RICK_PREC *dplm, struct rick_module *rick, 
 			     SH_RICK_PREC *theta, int ntheta) 
 {
-  int i,os;
+  int i;
   
-  os=0;				/* changed this to 0 TWB */
+  rick_plmbar1_factors(ivec,lmax,rick);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (i=0;i < ntheta;i++) { /*changed from 1->nlat to 0->nlat-1 - need change in plmbar1 also */
-    rick_plmbar1((plm+os),(dplm+os),ivec,lmax,cos(theta[i]),rick); /*note change in gauss_z[i] */
-    os += rick->lmsize;
+    rick_plmbar1((plm+i*rick->lmsize),(dplm+i*rick->lmsize),ivec,lmax,cos(theta[i]),rick); /*note change in gauss_z[i] */
   }
 }
 
@@ -170,12 +194,14 @@ void rick_shc2d_pre(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
 		    struct rick_module *rick)
 {
   /* //
-  // Legendre functions are precomputed
+  // Legendre functions are precomputed, and sorted m-major (see
+  // rick_compute_allplm). the coefficients get resorted the same
+  // way so that the sum over l for each m is a dot product
+  //
+  // latitudes are independent and get distributed over threads
   // */
-  SH_RICK_PREC  *valuex, *valuey;
-  SH_RICK_PREC  dpdt,dpdp;
-  static int negunity = -1;	/* an actual constant */
-  int  i,j,m,m2,j2,ios1,l,lmaxp1,lmaxp1t2,oplm,nlon2,lm1;
+  SH_RICK_PREC  *mma,*mmb,*mmc=NULL,*mmd=NULL;
+  int  i,lmaxp1,lmaxp1t2;
   if(!rick->initialized){
     fprintf(stderr,"rick_shc2d_pre: error: initialize modules first\n");
     exit(-1);
@@ -194,39 +220,50 @@ void rick_shc2d_pre(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
       exit(-1);
     }
   }
-  nlon2 = rick->nlon + 2;
-  /* allocate value arrays */
-  rick_vecalloc(&valuex,nlon2,"rick_shc2d_pre 1");
-  if(ivec)
-    rick_vecalloc(&valuey,nlon2,"rick_shc2d_pre 2");
-  
+  /* make sure every thread has value arrays */
+  rick_alloc_workspace(rick);
+  /* 
+     m-major coefficients 
+  */
+  mma = rick->mm_work;
+  mmb = mma + rick->lmsize;
+  rick_lm2mm(cslm,mma,mmb,lmax,(my_boolean)ivec,rick);
+  if(ivec){
+    /* those are scaled by ell_factor already */
+    mmc = mmb + rick->lmsize;
+    mmd = mmc + rick->lmsize;
+    rick_lm2mm(dslm,mmc,mmd,lmax,TRUE,rick);
+  }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (i=0;i < rick->nlat; i++) {	
     /*  
 	loop through latitudes 
     */
+    SH_RICK_PREC  *valuex, *valuey;
+    SH_RICK_PREC  sum[8],fm,isin_theta;
+    static int negunity = -1;	/* an actual constant */
+    int j,m,m2,k,n,ios1,oplm,nlon2;
+    nlon2 = rick->nlon + 2;
+    valuex = RICK_THREAD_WS(rick);
+    valuey = valuex + nlon2;
     oplm = i * rick->lmsize;        /*  offset for Plm array. (changed indices TWB) */
     ios1 = i * rick->nlon;        /* offset for data array */
     if(!ivec){          
       /* 
 	 scalar
       */
-      for(j=0;j < nlon2;j++)
-	valuex[j] = 0.0;               /* init with 0.0es */
-      l = 0; m = -1;
-      for (j=j2=0; j < rick->lmsize; j++,j2+=2) { /* loop through l,m */
-	m++;
-	if (m > l) {
-	  m=0;
-	  l++;
-	}
-	m2 = 2*m;
-	//fprintf(stderr,"%11i %11i %11g %11g\n",l,m,cslm[j2],cslm[j2+1]);
-	/*  add up contributions from all l,m  */
-	valuex[m2]   +=  /* cos term */
-	  plm[oplm+j] * (SH_RICK_PREC)cslm[j2]; /* A coeff */
-	valuex[m2+1] +=  /* sin term */
-	  plm[oplm+j] * (SH_RICK_PREC)cslm[j2+1];   /* B coeff */
+      for(k=m=m2=0;m <= lmax;m++,m2+=2){ /* loop through m */
+	n = lmaxp1 - m;
+	/*  add up contributions from all l for this m  */
+	rick->kern->dot2((plm+oplm+k),(mma+k),(mmb+k),n,sum);
+	valuex[m2]   = sum[0];	/* cos term */
+	valuex[m2+1] = sum[1];	/* sin term */
+	k += n;
       }
+      for(j=m2;j < nlon2;j++)
+	valuex[j] = 0.0;
 
       /* compute inverse FFT  */
 #ifdef NO_RICK_FORTRAN      
@@ -244,43 +281,32 @@ void rick_shc2d_pre(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
     } else {
       /* 
 	 vector harmonics
-      */
-      for(j=0;j < nlon2;j++){
-	valuex[j] = valuey[j] = 0.0;
-      }
-      l = 1; 
-      m = -1;       
-      /* start at l = 1 */
-      for (j=1,j2=2; j < rick->lmsize; j++,j2+=2) { 
-	/* loop through l,m */
-	m++;
-	if (m > l) {
-	  m=0;
-	  l++;
-	}
-	m2  = 2*m;
-	/* derivative factors */
-	lm1 = l - 1;
-	dpdt = dplm[oplm+j] * (SH_RICK_PREC)rick->ell_factor[lm1]; /* d_theta(P_lm) factor */
-	dpdp  = ((SH_RICK_PREC)m) * plm[oplm+j]/ (SH_RICK_PREC)rick->sin_theta[i];
-	dpdp *= (SH_RICK_PREC)rick->ell_factor[lm1]; /* d_phi (P_lm) factor */
-	/* add up contributions from all l,m 
-
-	u_theta
 
+	 the coefficients include the ell_factor, and the d_phi
+	 factor m/sin(theta) is the same for all l, so we only need
+	 sums of the coefficients times plm and dplm
+	 
+      */
+      isin_theta = 1.0/rick->sin_theta[i];
+      for(k=m=m2=0;m <= lmax;m++,m2+=2){ /* loop through m */
+	n = lmaxp1 - m;
+	rick->kern->dot8((plm+oplm+k),(dplm+oplm+k),
+			 (mma+k),(mmb+k),(mmc+k),(mmd+k),n,sum);
+	fm = ((SH_RICK_PREC)m) * isin_theta; /* d_phi (P_lm) factor */
+	/* 
+	   u_theta
 	*/
-	valuex[m2] +=   /* cos term */
-	  cslm[j2]   * dpdt + dslm[j2+1] * dpdp;
-	valuex[m2+1] +=   /* sin term */
-	  cslm[j2+1] * dpdt - dslm[j2]   * dpdp;
+	valuex[m2]   =  sum[0] + fm * sum[7]; /* cos term */
+	valuex[m2+1] =  sum[1] - fm * sum[6]; /* sin term */
 	/* 
 	   u_phi
 	*/
-	valuey[m2] +=  // cos term
-	  cslm[j2+1] * dpdp  - dslm[j2]   * dpdt;
-	valuey[m2+1] +=   // sin term
-	  - cslm[j2] * dpdp  - dslm[j2+1] * dpdt;
-      }	/* end l,m loop */
+	valuey[m2]   =  fm * sum[5] - sum[2]; /* cos term */
+	valuey[m2+1] = -fm * sum[4] - sum[3]; /* sin term */
+	k += n;
+      }	/* end m loop */
+      for(j=m2;j < nlon2;j++)
+	valuex[j] = valuey[j] = 0.0;
         /* do inverse FFTs */
 #ifdef NO_RICK_FORTRAN
       rick_cs2ab(valuex,rick->nlon);
@@ -300,12 +326,120 @@ void rick_shc2d_pre(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
       }
     }
   } /* end latitude loop */
+}
 
-  /* free temporary arrays */
-  free(valuex);
-  if(ivec)
-    free(valuey);
-  
+/* 
+
+   fused transform of a radial scalar field, with coefficients rslm,
+   and a vector field, with poloidal and toroidal coefficients cslm
+   and dslm, from spectral to spatial on the Gauss grid
+
+   this gives the same as rick_shc2d_pre with ivec = 0 for rslm into
+   rdatar, and ivec = 1 for cslm/dslm into rdatax (u_theta) and rdatay
+   (u_phi), but the Legendre functions are only passed over once for
+   all three components
+
+   needs Legendre functions for ivec = 1, and a module that was
+   initialized for vector harmonics
+
+*/
+void rick_shc2d_pre_rv(SH_RICK_PREC *rslm,SH_RICK_PREC *cslm,
+		       SH_RICK_PREC *dslm,int lmax,SH_RICK_PREC *plm,
+		       SH_RICK_PREC *dplm,SH_RICK_PREC *rdatar,
+		       SH_RICK_PREC *rdatax,SH_RICK_PREC *rdatay,
+		       struct rick_module *rick)
+{
+  SH_RICK_PREC  *mma,*mmb,*mmc,*mmd,*mme,*mmf;
+  int  i,lmaxp1,lmaxp1t2;
+  if(!rick->initialized){
+    fprintf(stderr,"rick_shc2d_pre_rv: error: initialize modules first\n");
+    exit(-1);
+  }
+  lmaxp1 = lmax + 1;
+  lmaxp1t2 = 2 * lmaxp1;
+  if((rick->nlat != lmaxp1)||(rick->nlon != lmaxp1t2)){
+    fprintf(stderr,"rick_shc2d_pre_rv: dimension mismatch: lmax: %i nlon: %i nlat:%i\n",
+	    lmax,rick->nlon,rick->nlat);
+    exit(-1);
+  }
+  if((!rick->vector_sh_fac_init)||(!rick->old_ivec)){
+    fprintf(stderr,"rick_shc2d_pre_rv: error: vector harmonics factors not initialized\n");
+    exit(-1);
+  }
+  rick_alloc_workspace(rick);
+  /* 
+     m-major coefficients: poloidal and toroidal scaled by
+     ell_factor, radial as is
+  */
+  mma = rick->mm_work;
+  mmb = mma + rick->lmsize;
+  mmc = mmb + rick->lmsize;
+  mmd = mmc + rick->lmsize;
+  mme = mmd + rick->lmsize;
+  mmf = mme + rick->lmsize;
+  rick_lm2mm(cslm,mma,mmb,lmax,TRUE,rick);
+  rick_lm2mm(dslm,mmc,mmd,lmax,TRUE,rick);
+  rick_lm2mm(rslm,mme,mmf,lmax,FALSE,rick);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (i=0;i < rick->nlat; i++) {	
+    SH_RICK_PREC  *valuex, *valuey, *valuer;
+    SH_RICK_PREC  sum[10],fm,isin_theta,inlat;
+    static int negunity = -1;	/* an actual constant */
+    int j,m,m2,k,n,ios1,oplm,nlon2;
+    nlon2 = rick->nlon + 2;
+    /* 
+       the per-thread plm/dplm block is not needed here, and has
+       room for the third value array
+    */
+    valuex = RICK_THREAD_WS(rick);
+    valuey = valuex + nlon2;
+    valuer = valuey + nlon2;
+    oplm = i * rick->lmsize;
+    ios1 = i * rick->nlon;
+    isin_theta = 1.0/rick->sin_theta[i];
+    for(k=m=m2=0;m <= lmax;m++,m2+=2){ /* loop through m */
+      n = lmaxp1 - m;
+      rick->kern->dot10((plm+oplm+k),(dplm+oplm+k),
+			(mma+k),(mmb+k),(mmc+k),(mmd+k),(mme+k),(mmf+k),
+			n,sum);
+      fm = ((SH_RICK_PREC)m) * isin_theta; /* d_phi (P_lm) factor */
+      /* u_theta */
+      valuex[m2]   =  sum[0] + fm * sum[7];
+      valuex[m2+1] =  sum[1] - fm * sum[6];
+      /* u_phi */
+      valuey[m2]   =  fm * sum[5] - sum[2];
+      valuey[m2+1] = -fm * sum[4] - sum[3];
+      /* u_r */
+      valuer[m2]   = sum[8];
+      valuer[m2+1] = sum[9];
+      k += n;
+    }	/* end m loop */
+    for(j=m2;j < nlon2;j++)
+      valuex[j] = valuey[j] = valuer[j] = 0.0;
+#ifdef NO_RICK_FORTRAN
+    rick_cs2ab(valuer,rick->nlon);
+    rick_cs2ab(valuex,rick->nlon);
+    rick_cs2ab(valuey,rick->nlon);
+    rick_realft_nr((valuer-1),rick->nlat,negunity);
+    rick_realft_nr((valuex-1),rick->nlat,negunity);
+    rick_realft_nr((valuey-1),rick->nlat,negunity);
+#else
+    rick_f90_cs2ab(valuer,&rick->nlon);
+    rick_f90_cs2ab(valuex,&rick->nlon);
+    rick_f90_cs2ab(valuey,&rick->nlon);
+    rick_f90_realft(valuer,&rick->nlat,&negunity);
+    rick_f90_realft(valuex,&rick->nlat,&negunity);
+    rick_f90_realft(valuey,&rick->nlat,&negunity);
+#endif
+    inlat = 1.0/(SH_RICK_PREC)(rick->nlat);
+    for (j=0; j < rick->nlon; j++) {   
+      rdatar[ios1 + j] = valuer[j]*inlat;
+      rdatax[ios1 + j] = valuex[j]*inlat;
+      rdatay[ios1 + j] = valuey[j]*inlat;
+    }
+  } /* end latitude loop */
 }
 
 /* 
@@ -323,11 +457,19 @@ void rick_shc2d_pre_reg(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
 			my_boolean save_sincos_fac)
 {
   /* //
-  // Legendre functions are precomputed
+  // Legendre functions are precomputed. 
+  //
+  // the synthesis is separable: for each latitude, the sums over l
+  // reduce the coefficients to the cos/sin Fourier coefficients of
+  // that row, m = 0..lmax, which are then evaluated at the nphi
+  // longitudes. this is done with an inverse FFT if the phi values
+  // are uniformly spaced with a power of two number of points around
+  // the globe (zero padded above lmax), else as a sum over the
+  // sin/cos factors
   // */
-  SH_RICK_HIGH_PREC  dpdt,dpdp,mphi,sin_theta;
-  SH_RICK_PREC *loc_plma=NULL,*loc_plmb=NULL;
-  int  i,j,k,k2,m,ios1,ios2,ios3,l,lmaxp1,lm1,idata;
+  SH_RICK_HIGH_PREC  mphi;
+  SH_RICK_PREC *work=NULL;
+  int  i,m,ios1,lmaxp1,nfft,nwork,nthreads;
   if(!rick->initialized){
     fprintf(stderr,"rick_shc2d_pre_reg: error: initialize modules first\n");
     exit(-1);
@@ -351,8 +493,11 @@ void rick_shc2d_pre_reg(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
     
     rick_vecrealloc(&rick->sfac,nphi*lmaxp1,"rick_shc2d_pre_reg");
     rick_vecrealloc(&rick->cfac,nphi*lmaxp1,"rick_shc2d_pre_reg");
-    for(ios1=i=0;i < nphi;i++){
-      for(m=0;m <= lmax;m++,ios1++){
+#ifdef _OPENMP
+#pragma omp parallel for private(m,ios1,mphi) schedule(static)
+#endif
+    for(i=0;i < nphi;i++){
+      for(m=0,ios1=i*lmaxp1;m <= lmax;m++,ios1++){
 	mphi = (SH_RICK_HIGH_PREC)m*(SH_RICK_HIGH_PREC)phi[i];
 	rick->sfac[ios1] = (SH_RICK_PREC)sin(mphi);
 	rick->cfac[ios1] = (SH_RICK_PREC)cos(mphi);
@@ -361,210 +506,328 @@ void rick_shc2d_pre_reg(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
     if(save_sincos_fac)
       rick->sin_cos_saved = TRUE;
   }
-  if(ivec == 0){
-    /* 
+  /* 
+     FFT length, zero if phi is not suitable 
+  */
+  nfft = rick_reg_fft_size(phi,nphi,lmax);
+  /* 
+     per thread: Fourier coefficients for x and y, and the FFT
+     buffer
+  */
+  nwork = 4*lmaxp1 + ((nfft)?(nfft+2):(0));
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+#else
+  nthreads = 1;
+#endif
+  rick_vecalloc(&work,nthreads*nwork,"rick_shc2d_pre_reg");
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (i=0;i < ntheta; i++) { /* theta loop */
+    SH_RICK_PREC *fx,*fy,*fbuf;
+#ifdef _OPENMP
+    fx = work + omp_get_thread_num() * nwork;
+#else
+    fx = work;
+#endif
+    fy = fx + 2*lmaxp1;
+    fbuf = fy + 2*lmaxp1;
+    /* Legendre sums */
+    rick_reg_fourier(cslm,dslm,lmax,(plm+i*rick->lmsize),
+		     (ivec)?(dplm+i*rick->lmsize):(NULL),ivec,theta[i],
+		     fx,fy,rick);
+    /* evaluate at the longitudes */
+    rick_reg_fourier_eval(fx,lmax,(rdatax+i*nphi),nphi,nfft,fbuf,rick);
+    if(ivec)
+      rick_reg_fourier_eval(fy,lmax,(rdatay+i*nphi),nphi,nfft,fbuf,rick);
+  } /* end theta loop */
+  free(work);
 
-       scalar
+  if(!save_sincos_fac){
+    rick_vecrealloc(&rick->sfac,1,"");
+    rick_vecrealloc(&rick->cfac,1,"");
+  }
+}
+/* 
 
+   Fourier coefficients of one latitude row for rick_shc2d_pre_reg,
+   stored as C(0),S(0),C(1),S(1),...,C(lmax),S(lmax) for a series of
+   C cos(m phi) + S sin(m phi)
+
+   scalar: fx from cslm and plm
+
+   vector: u_theta in fx, and u_phi in fy, from the poloidal and
+   toroidal coefficients cslm and dslm, and plm and dplm
+
+*/
+void rick_reg_fourier(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,int lmax,
+		      SH_RICK_PREC *plm,SH_RICK_PREC *dplm,int ivec,
+		      SH_RICK_PREC theta,SH_RICK_PREC *fx,SH_RICK_PREC *fy,
+		      struct rick_module *rick)
+{
+  SH_RICK_HIGH_PREC dpdt,dpdp,sin_theta;
+  int k,k2,l,m,m2,lm1;
+  for(m2=0;m2 < 2*(lmax+1);m2++)
+    fx[m2] = 0.0;
+  if(!ivec){
+    /* 
+       scalar
     */
-    rick_vecrealloc(&loc_plma,ntheta*rick->lmsize,"rick_shc2d_pre_reg 3");
-    rick_vecrealloc(&loc_plmb,ntheta*rick->lmsize,"rick_shc2d_pre_reg 4");
-    for(i=ios1=0;i < ntheta;i++){ /* theta dependent array */
-      for(k=k2=0;k < rick->lmsize;k++,k2+=2,ios1++){
-	loc_plma[ios1] =  cslm[k2  ] * plm[ios1];
-	loc_plmb[ios1] =  cslm[k2+1] * plm[ios1];
+    for(l=k=k2=0;l <= lmax;l++)
+      for(m=m2=0;m <= l;m++,m2+=2,k++,k2+=2){
+	fx[m2]   += cslm[k2]   * plm[k]; /* cos term */
+	fx[m2+1] += cslm[k2+1] * plm[k]; /* sin term */
       }
-    }
-    for (idata=i=ios2=0;i < ntheta; i++,ios2 += rick->lmsize) { /* theta loop */
-      for(ios3=j=0;j < nphi;j++,idata++,ios3 += lmaxp1){ /* phi loop */
-	
-	/* m = 0 , l = 0*/
-	l=0;m=0;
-	rdatax[idata] = loc_plma[ios2];
-	for (k=1; k < rick->lmsize; k++) { 
-	  m++;
-	  if (m > l) {
-	    m=0;l++;
-	  }
-	  rdatax[idata] += loc_plma[ios2+k] * rick->cfac[ios3+m];
-	  if(m != 0)
-	    rdatax[idata] += loc_plmb[ios2+k] * rick->sfac[ios3+m];
-	}
+  }else{
+    /* 
+       vector harmonics, start at l = 1
+    */
+    for(m2=0;m2 < 2*(lmax+1);m2++)
+      fy[m2] = 0.0;
+    sin_theta = sin(theta);
+    for(l=1,k=1,k2=2;l <= lmax;l++){
+      lm1 = l - 1;
+      for(m=m2=0;m <= l;m++,m2+=2,k++,k2+=2){
+	dpdt = dplm[k] * rick->ell_factor[lm1]; /* d_theta(P_lm) factor */
+	dpdp  = ((SH_RICK_PREC)m) * plm[k]/ sin_theta;
+	dpdp *= (SH_RICK_PREC)rick->ell_factor[lm1]; /* d_phi (P_lm) factor */
+	/* 
+	   u_theta
+	*/
+	fx[m2]   += cslm[k2]   * dpdt + dslm[k2+1] * dpdp; /* cos term */
+	fx[m2+1] += cslm[k2+1] * dpdt - dslm[k2]   * dpdp; /* sin term */
+	/* 
+	   u_phi
+	*/
+	fy[m2]   += cslm[k2+1] * dpdp - dslm[k2]   * dpdt; /* cos term */
+	fy[m2+1] += -cslm[k2]  * dpdp - dslm[k2+1] * dpdt; /* sin term */
       }
     }
+  }
+}
+/* 
+
+   evaluate a Fourier series f as from rick_reg_fourier at the nphi
+   longitudes of rick_shc2d_pre_reg, output in data
+
+   if nfft is non-zero, the phi values are phi[0] + j 2 pi/nfft, and
+   an inverse FFT is used after rotating the series by phi[0]. fbuf
+   has to hold nfft+2 values then
 
-    free(loc_plma);free(loc_plmb);
-    /* end scalar part */
-  } else {
+   else, sums over the sin/cos factors rick->cfac and rick->sfac
+
+*/
+void rick_reg_fourier_eval(SH_RICK_PREC *f,int lmax,SH_RICK_PREC *data,
+			   int nphi,int nfft,SH_RICK_PREC *fbuf,
+			   struct rick_module *rick)
+{
+  SH_RICK_HIGH_PREC sum;
+  int j,m,m2,ios3,lmaxp1;
+  static int negunity = -1;	/* an actual constant */
+  lmaxp1 = lmax + 1;
+  if(nfft){
     /* 
-       vector harmonics
+       shift to phi[0], those factors are the first row
     */
-    for (idata=i=ios2=0;i < ntheta; i++,ios2 += rick->lmsize) { /* theta
-								   loop */
-      sin_theta = sin(theta[i]);
-      for(ios3=j=0;j < nphi;j++,idata++,ios3 += lmaxp1){ /* phi loop */
-	
-
-	rdatax[idata] = rdatay[idata] = 0.0;
-
-	l = 0;m = 0;       
-	/* start at l = 1 */
-	for (k=1,k2=2; k < rick->lmsize; k++,k2+=2) { 
-	  /* loop through l,m */
-	  m++;
-	  if (m > l) {
-	    m=0;l++;
-	  }
-	  lm1 = l - 1;
-	  //	  fprintf(stderr,"%5i %5i\t %11g %11g\tPA: %11g  PB: %11g\tTA: %11g TB:%11g\n",
-	  //	  l,m,rick->ell_factor[lm1],plm[ios2+k], 
-	  //	  SH_RICK_FACTOR(l, m) * cslm[k2] ,SH_RICK_FACTOR(l, m) *cslm[k2+1],
-	  //	  SH_RICK_FACTOR(l, m) * dslm[k2], SH_RICK_FACTOR(l, m) *dslm[k2+1]);
-	  dpdt = dplm[ios2+k] * rick->ell_factor[lm1]; /* d_theta(P_lm) factor */
-	  dpdp  = ((SH_RICK_PREC)m) * plm[ios2+k]/ sin_theta;
-	  dpdp *= (SH_RICK_PREC)rick->ell_factor[lm1]; /* d_phi (P_lm) factor */
-	  
-	  /* 
-	     
-	     add up contributions from all l,m 
-	  
-	     u_theta
-	  
-	  */
-	  rdatax[idata] +=   /* cos term */
-	    (cslm[k2]   * dpdt + dslm[k2+1] * dpdp) * rick->cfac[ios3+m];
-	  rdatax[idata] +=   /* sin term */
-	    (cslm[k2+1] * dpdt - dslm[k2]   * dpdp) * rick->sfac[ios3+m];
-	  /* 
-	     u_phi
-	  */
-	  rdatay[idata] +=  // cos term
-	    (cslm[k2+1] * dpdp  - dslm[k2]   * dpdt) * rick->cfac[ios3+m];
-	  rdatay[idata] +=   // sin term
-	    (- cslm[k2] * dpdp  - dslm[k2+1] * dpdt) * rick->sfac[ios3+m];
-	}
-	//fprintf(stderr,"%11g %11g %11g %11g\n",theta[j],phi[i],rdatax[i],rdatay[i]);
-	
-      }	/* end phi loop */
-    } /* end theta loop */
+    for(m=m2=0;m <= lmax;m++,m2+=2){
+      fbuf[m2]   = f[m2]   * rick->cfac[m] + f[m2+1] * rick->sfac[m];
+      fbuf[m2+1] = f[m2+1] * rick->cfac[m] - f[m2]   * rick->sfac[m];
+    }
+    fbuf[1] = 0.0;		/* sin(0) term would end up at nfft/2 */
+    for(j=m2;j < nfft+2;j++)	/* zero padding */
+      fbuf[j] = 0.0;
+    rick_cs2ab(fbuf,nfft);
+    rick_realft_nr((fbuf-1),nfft/2,negunity);
+    for(j=0;j < nphi;j++)
+      data[j] = fbuf[j % nfft]/(SH_RICK_PREC)(nfft/2);
+  }else{
+    for(ios3=j=0;j < nphi;j++,ios3 += lmaxp1){ /* phi loop */
+      sum = f[0];
+      for(m=1,m2=2;m <= lmax;m++,m2+=2)
+	sum += f[m2] * rick->cfac[ios3+m] + f[m2+1] * rick->sfac[ios3+m];
+      data[j] = sum;
+    }
   }
+}
+/* 
 
-  if(!save_sincos_fac){
-    rick_vecrealloc(&rick->sfac,1,"");
-    rick_vecrealloc(&rick->cfac,1,"");
-  }
+   check if the nphi longitudes phi are uniformly spaced with
+   nfft points around the globe, where nfft is a power of two that
+   is at least 2(lmax+1). returns nfft if so, else zero
+
+*/
+int rick_reg_fft_size(SH_RICK_PREC *phi,int nphi,int lmax)
+{
+  SH_RICK_HIGH_PREC dphi,x;
+  int j,n;
+  if(nphi < 2)
+    return 0;
+  dphi = (phi[nphi-1] - phi[0])/(SH_RICK_HIGH_PREC)(nphi-1);
+  if(dphi <= 0)
+    return 0;
+  for(j=1;j < nphi-1;j++)
+    if(fabs(phi[j] - phi[0] - (SH_RICK_HIGH_PREC)j*dphi) > 1e-6*dphi)
+      return 0;
+  x = RICK_TWOPI/dphi;
+  n = (int)(x + 0.5);
+  if(fabs(x - (SH_RICK_HIGH_PREC)n) > 1e-6*x)
+    return 0;
+  if((n < 2*(lmax+1))||(n & (n-1)))
+    return 0;
+  return n;
 }
-/* completely irregular output */
+/* 
+
+   completely irregular output, theta and phi have npoints values.
+
+   the points are grouped by colatitude first, see rick_shc2d_point_set
+
+*/
 void rick_shc2d_irreg(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
 		      int lmax,int ivec,SH_RICK_PREC *rdatax,SH_RICK_PREC *rdatay, 
 		      struct rick_module *rick, SH_RICK_PREC *theta,
 		      SH_RICK_PREC *phi,int npoints)
 {
-  /* //
-  // Legendre functions are precomputed
-  // */
-  SH_RICK_HIGH_PREC  dpdt,dpdp,mphi,sin_theta,sfac,cfac;
-  SH_RICK_PREC *plm=NULL,*dplm=NULL;
-  int  i,k,k2,m,l,lm1;
+  struct rick_point_set ps;
+  rick_init_point_set(&ps,theta,phi,npoints);
+  rick_shc2d_point_set(cslm,dslm,lmax,ivec,rdatax,rdatay,rick,&ps);
+  rick_free_point_set(&ps);
+}
+/* 
+
+   sort npoints locations theta, phi by colatitude, and find the unique
+   colatitudes. the point set can be reused for all expansions on the
+   same locations
+
+*/
+void rick_init_point_set(struct rick_point_set *ps,SH_RICK_PREC *theta,
+			 SH_RICK_PREC *phi,int npoints)
+{
+  struct rick_point_sort *sp;
+  int i;
+  ps->npoints = npoints;
+  ps->ntheta = 0;
+  ps->order = (int *)malloc(sizeof(int)*((npoints)?(npoints):(1)));
+  ps->start = (int *)malloc(sizeof(int)*(npoints+1));
+  sp = (struct rick_point_sort *)malloc(sizeof(struct rick_point_sort)*((npoints)?(npoints):(1)));
+  if(!ps->order || !ps->start || !sp)
+    HC_MEMERROR("rick_init_point_set");
+  rick_vecalloc(&ps->theta,(npoints)?(npoints):(1),"rick_init_point_set");
+  rick_vecalloc(&ps->phi,(npoints)?(npoints):(1),"rick_init_point_set");
+  for(i=0;i < npoints;i++){
+    sp[i].theta = theta[i];
+    sp[i].index = i;
+  }
+  qsort(sp,npoints,sizeof(struct rick_point_sort),rick_compare_point_sort);
+  for(i=0;i < npoints;i++){
+    if((i == 0)||(sp[i].theta != sp[i-1].theta)){
+      /* new colatitude */
+      ps->theta[ps->ntheta] = sp[i].theta;
+      ps->start[ps->ntheta] = i;
+      ps->ntheta++;
+    }
+    ps->order[i] = sp[i].index;
+    ps->phi[i] = phi[sp[i].index];
+  }
+  ps->start[ps->ntheta] = npoints;
+  free(sp);
+}
+/* 
+   by theta, then by original index, such that the order is unique
+*/
+int rick_compare_point_sort(const void *a,const void *b)
+{
+  const struct rick_point_sort *pa = (const struct rick_point_sort *)a;
+  const struct rick_point_sort *pb = (const struct rick_point_sort *)b;
+  if(pa->theta < pb->theta)
+    return -1;
+  if(pa->theta > pb->theta)
+    return 1;
+  return pa->index - pb->index;
+}
+void rick_free_point_set(struct rick_point_set *ps)
+{
+  free(ps->order);free(ps->start);
+  free(ps->theta);free(ps->phi);
+  ps->npoints = ps->ntheta = 0;
+}
+/* 
+
+   synthesis at the locations of a point set. for each unique
+   colatitude, the Legendre functions are evaluated and the
+   coefficients reduced to a Fourier series in phi (see
+   rick_reg_fourier), which is then summed at each point's longitude
+   with a cos/sin recurrence. output is in the original order of the
+   points
+
+*/
+void rick_shc2d_point_set(SH_RICK_PREC *cslm,SH_RICK_PREC *dslm,
+			  int lmax,int ivec,SH_RICK_PREC *rdatax,
+			  SH_RICK_PREC *rdatay,struct rick_module *rick,
+			  struct rick_point_set *ps)
+{
+  int  i;
   if(!rick->initialized){
-    fprintf(stderr,"rick_shc2d_pre_reg: error: initialize modules first\n");
+    fprintf(stderr,"rick_shc2d_point_set: error: initialize modules first\n");
     exit(-1);
   }
   if((lmax+1)*(lmax+2)/2 > rick->lmsize){
-    fprintf(stderr,"rick_shc2d_pre_reg: error: lmax %i out of bounds\n",lmax);
+    fprintf(stderr,"rick_shc2d_point_set: error: lmax %i out of bounds\n",lmax);
       exit(-1);
   }
-  if(ivec == 0){
-    /* 
-
-    scalar
-
-    */
-    rick_vecrealloc(&plm,rick->lmsize,"rick_shc2d_irreg: mem 1");
-    for(i=0;i < npoints;i++){
-      /* get legendre function values */
-      rick_plmbar1(plm,dplm,ivec,lmax,cos(theta[i]),rick); 
-      /* m = 0 , l = 0*/
-      l=0;m=0;
-      rdatax[i] = cslm[0] * plm[0];
-      for (k=1,k2=2; k < rick->lmsize; k++,k2+=2) { 
-	m++;
-	if (m > l) {
-	  m=0;l++;
-	}
-	//fprintf(stderr,"%5i %5i %11g %11g\n",l,m,cslm[k2],cslm[k2+1]);
-	if(m != 0){
-	  mphi = (SH_RICK_HIGH_PREC)m*(SH_RICK_HIGH_PREC)phi[i];
-	  rdatax[i] += cslm[k2]   * plm[k] * cos(mphi);
-	  rdatax[i] += cslm[k2+1] * plm[k] * sin(mphi);
-	}else{
-	  rdatax[i] += cslm[k2]   * plm[k] ;
-	}
-      }
-    } /* end data loop */
-    
-    free(plm);
-    /* end scalar part */
-  } else {
+  /* set up before the parallel loop */
+  rick_plmbar1_factors(ivec,lmax,rick);
+  rick_alloc_workspace(rick);
+  /* 
+     the number of points per colatitude may vary a lot
+  */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(i=0;i < ps->ntheta;i++){
+    SH_RICK_PREC *fx,*fy,*plm,*dplm;
+    int j,k;
     /* 
-       vector harmonics
+       Fourier coefficients go where the values are for the Gauss
+       transforms, 2(lmax+1) < nlon+2
     */
-    rick_vecrealloc(&plm,rick->lmsize,"rick_shc2d_irreg: mem 1");
-    rick_vecrealloc(&dplm,rick->lmsize,"rick_shc2d_irreg: mem 2");
-    for(i=0;i < npoints;i++){
-      /* get legendre function values */
-      rick_plmbar1(plm,dplm,ivec,lmax,cos(theta[i]),rick); 
-      sin_theta = sin(theta[i]);
-
-      rdatax[i] = rdatay[i] = 0.0;
-      l = 0;m = 0;
-      /* start at l = 1 */
-      for (k=1,k2=2; k < rick->lmsize; k++,k2+=2) { 
-	/* loop through l,m */
-	m++;
-	if (m > l) {
-	  m=0;l++;
-	}
-	lm1 = l - 1;
-	//	  fprintf(stderr,"%5i %5i\t %11g %11g\tPA: %11g  PB: %11g\tTA: %11g TB:%11g\n",
-	//	  l,m,rick->ell_factor[lm1],plm[ios2+k], 
-	//	  SH_RICK_FACTOR(l, m) * cslm[k2] ,SH_RICK_FACTOR(l, m) *cslm[k2+1],
-	//	  SH_RICK_FACTOR(l, m) * dslm[k2], SH_RICK_FACTOR(l, m) *dslm[k2+1]);
-	dpdt = dplm[k] * rick->ell_factor[lm1]; /* d_theta(P_lm) factor */
-	dpdp  = ((SH_RICK_PREC)m) * plm[k]/ sin_theta;
-	dpdp *= (SH_RICK_PREC)rick->ell_factor[lm1]; /* d_phi (P_lm) factor */
+    fx = RICK_THREAD_WS(rick);
+    fy = fx + rick->nlon + 2;
+    plm = fy + rick->nlon + 2;
+    dplm = plm + rick->lmsize;
+    /* get legendre function values */
+    rick_plmbar1(plm,dplm,ivec,lmax,cos(ps->theta[i]),rick); 
+    rick_reg_fourier(cslm,dslm,lmax,plm,dplm,ivec,ps->theta[i],fx,fy,rick);
+    for(j=ps->start[i];j < ps->start[i+1];j++){
+      k = ps->order[j];
+      rdatax[k] = rick_fourier_sum(fx,lmax,ps->phi[j]);
+      if(ivec)
+	rdatay[k] = rick_fourier_sum(fy,lmax,ps->phi[j]);
+    }
+  }
+}
+/* 
 
-	if(m){
-	  mphi = (SH_RICK_HIGH_PREC)m*(SH_RICK_HIGH_PREC)phi[i];
-	  sfac = (SH_RICK_PREC)sin(mphi);
-	  cfac = (SH_RICK_PREC)cos(mphi);
-	}else{
-	  mphi = sfac = 0.0;
-	  cfac = 1.0;
-	}
-	/* 
-	   
-	   add up contributions from all l,m 
-	   
-	   u_theta
-	   
-	*/
-	rdatax[i] +=   /* cos term */
-	  (cslm[k2]   * dpdt + dslm[k2+1] * dpdp) * cfac;
-	rdatax[i] +=   /* sin term */
-	  (cslm[k2+1] * dpdt - dslm[k2]   * dpdp) * sfac;
-	/* 
-	   u_phi
-	*/
-	rdatay[i] +=  // cos term
-	  (cslm[k2+1] * dpdp  - dslm[k2]   * dpdt) * cfac;
-	rdatay[i] +=   // sin term
-	  (- cslm[k2] * dpdp  - dslm[k2+1] * dpdt) * sfac;
-      }
-    }	/* end phi loop */
+   sum a Fourier series C(0),S(0),C(1),S(1),...,C(lmax),S(lmax) at phi,
+   using the rotation recurrence for cos(m phi) and sin(m phi)
 
-    free(plm);free(dplm);
-  }	/* end vector part */
+*/
+SH_RICK_PREC rick_fourier_sum(SH_RICK_PREC *f,int lmax,SH_RICK_PREC phi)
+{
+  SH_RICK_HIGH_PREC sum,c1,s1,c,s,tmp;
+  int m,m2;
+  c1 = cos((SH_RICK_HIGH_PREC)phi);
+  s1 = sin((SH_RICK_HIGH_PREC)phi);
+  sum = f[0];
+  c = c1;s = s1;
+  for(m=1,m2=2;m <= lmax;m++,m2+=2){
+    sum += f[m2] * c + f[m2+1] * s;
+    tmp = c * c1 - s * s1;	/* cos((m+1) phi) */
+    s   = s * c1 + c * s1;	/* sin((m+1) phi) */
+    c = tmp;
+  }
+  return (SH_RICK_PREC)sum;
 }
 
 void rick_shd2c(SH_RICK_PREC *rdatax,SH_RICK_PREC *rdatay,
@@ -651,11 +914,10 @@ void rick_shd2c_pre(SH_RICK_PREC *rdatax,SH_RICK_PREC *rdatay,
 		    struct rick_module *rick)
 {
   // local
-  SH_RICK_PREC *valuex, *valuey;
-  SH_RICK_PREC dfact,dpdt,dpdp;
+  SH_RICK_HIGH_PREC *mma,*mmb,*mmc,*mmd;
   static int unity = 1;		/* constant */
   //
-  int  lmaxp1,lmaxp1t2,i,j,l,m,ios1,m2,j2,oplm,nlon2,lm1;
+  int  lmaxp1,lmaxp1t2,i,m,nlon2,nspec;
   // check
   if(!rick->initialized){
     fprintf(stderr,"rick_shd2c_pre: error: initialize first\n");
@@ -672,128 +934,138 @@ void rick_shd2c_pre(SH_RICK_PREC *rdatax,SH_RICK_PREC *rdatay,
     fprintf(stderr,"rick_shd2c_pre: lmsize %i\n",rick->lmsize);
     exit(-1);
   }
-  /* allocate */
-  rick_vecalloc(&valuex,nlon2,"rick_shd2c_pre 1");
-  if(ivec)
-    rick_vecalloc(&valuey,nlon2,"rick_shd2c_pre 2");
-  
-  //
-  // initialize the coefficients
-  //
-  for(i=0;i < rick->lmsize2;i++)
-    cslm[i] = 0.0;
   if(ivec){
     if(! rick->vector_sh_fac_init){
       fprintf(stderr,"rick_shd2c_pre: error: vector harmonics factors not initialized\n");
       exit(-1);
     }
-    for(i=0;i < rick->lmsize2;i++)
-      dslm[i] = 0.0;
   }
+  /* 
+     space for the Fourier coefficients of all latitudes, x
+     components first, then y
+  */
+  nspec = rick->nlat * nlon2 * (1+ivec);
+  if(nspec > rick->spec_work_n){
+    rick_vecrealloc(&rick->spec_work,nspec,"rick_shd2c_pre 1");
+    rick->spec_work_n = nspec;
+  }
+  //
+  // initialize the m-major accumulators for the coefficients,
+  // those are kept at higher precision
+  //
+  if((2+2*ivec)*rick->lmsize > rick->acc_work_n){
+    if(rick->acc_work_n)
+      free(rick->acc_work);
+    rick->acc_work_n = (2+2*ivec)*rick->lmsize;
+    rick_hvecalloc(&rick->acc_work,rick->acc_work_n,"rick_shd2c_pre 2");
+  }
+  mma = rick->acc_work;
+  mmb = mma + rick->lmsize;
+  mmc = mmb + rick->lmsize;
+  mmd = mmc + rick->lmsize;
+  for(i=0;i < (2+2*ivec)*rick->lmsize;i++)
+    rick->acc_work[i] = 0.0;
+  /* 
+     first pass: FFTs of all latitudes, those are independent 
+  */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for(i=0;i < rick->nlat;i++){
-    //
-    // loop through latitudes
-    //
+    SH_RICK_PREC *valuex, *valuey;
+    int j,ios1;
     ios1 = i * rick->nlon;          // offset for data array
-    oplm = i * rick->lmsize;        // offset for Plm array
-    //
-    if(!ivec){
-      //
-      // scalar expansion
-      //
-      for(j=0;j < rick->nlon;j++){      
-	valuex[j] = rdatax[ios1 + j];
-      }
-      //
-      // compute the FFT 
-      //
-
+    valuex = rick->spec_work + i * nlon2;
+    for(j=0;j < rick->nlon;j++){      
+      valuex[j] = rdatax[ios1 + j]; // theta for vectors
+    }
 #ifdef NO_RICK_FORTRAN
-      rick_realft_nr((valuex-1),rick->nlat,unity);
-      rick_ab2cs(valuex,rick->nlon);
+    rick_realft_nr((valuex-1),rick->nlat,unity);
+    rick_ab2cs(valuex,rick->nlon);
 #else
-      rick_f90_realft(valuex,&rick->nlat,&unity);
-      rick_f90_ab2cs(valuex,&rick->nlon);
+    rick_f90_realft(valuex,&rick->nlat,&unity);
+    rick_f90_ab2cs(valuex,&rick->nlon);
 #endif
-      // sum up for integration
-      l = 0;m = -1;
-      for(j=j2=0;j < rick->lmsize;j++,j2+=2){
-	m++;
-	if( m >  l ) {
-	  l++;m=0;
-	}
-	// we incorporate the Gauss integration weight and Plm factors here
-	if (m == 0) {
-	  dfact = ((SH_RICK_PREC)rick->gauss_w[i] * plm[oplm+j])/2.0;
-	}else{
-	  dfact = ((SH_RICK_PREC)rick->gauss_w[i] * plm[oplm+j])/4.0;
-	}
-	m2 = m * 2;
-	cslm[j2]   += valuex[m2]   * dfact; // A coefficient
-	cslm[j2+1] += valuex[m2+1] * dfact; // B coefficient
-      }	/* end lmsize loop */
-      /* end scalar */
-    }else{
-      //
-      // vector field expansion
-      //
+    if(ivec){
+      valuey = rick->spec_work + (rick->nlat + i) * nlon2;
       for(j=0;j < rick->nlon;j++){    
-	valuex[j] = rdatax[ios1 + j]; // theta
 	valuey[j] = rdatay[ios1 + j]; // phi
       }
-      // perform the FFTs on both components
 #ifdef NO_RICK_FORTRAN
-      rick_realft_nr((valuex-1),rick->nlat,unity);
       rick_realft_nr((valuey-1),rick->nlat,unity);
-      rick_ab2cs(valuex,rick->nlon);
       rick_ab2cs(valuey,rick->nlon);
 #else
-      rick_f90_realft(valuex,&rick->nlat,&unity);
       rick_f90_realft(valuey,&rick->nlat,&unity);
-      rick_f90_ab2cs(valuex,&rick->nlon);
       rick_f90_ab2cs(valuey,&rick->nlon);
 #endif
+    }
+  }
+  /* 
+     second pass: Gauss integration. this is parallel in m, and for
+     each coefficient the latitudes are summed in order, so that the
+     result does not depend on the number of threads
+  */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(m=0;m <= lmax;m++){
+    SH_RICK_PREC *valuex, *valuey;
+    SH_RICK_HIGH_PREC dfact,fm,isin_theta,f[8];
+    int j,k,n,m2,oplm;
+    n = lmaxp1 - m;
+    m2 = m * 2;
+    k = RICK_MM_INDEX(m,m,lmax);
+    for(j=0;j < rick->nlat;j++){
       //
-      l=1;m=-1;                // there's no l=0 term
+      // loop through latitudes
       //
-      for(j = 1,j2 = 2;j < rick->lmsize;j++,j2+=2){
-	m++;
-	if( m >l ) {
-	  l++;m=0;
-	}
-	lm1 = l - 1;
-	if (m == 0){ // ell_factor is 1/sqrt(l(l+1))
-	  dfact = rick->gauss_w[i] * rick->ell_factor[lm1]/2.0;
-	}else{
-	  dfact = rick->gauss_w[i] * rick->ell_factor[lm1]/4.0;
-	}
+      oplm = j * rick->lmsize;        // offset for Plm array
+      valuex = rick->spec_work + j * nlon2;
+      // we incorporate the Gauss integration weight here
+      if (m == 0) {
+	dfact = (SH_RICK_HIGH_PREC)rick->gauss_w[j]/2.0;
+      }else{
+	dfact = (SH_RICK_HIGH_PREC)rick->gauss_w[j]/4.0;
+      }
+      if(!ivec){
 	//
-	// some more factors
+	// scalar expansion
 	//
-	// d_theta(P_lm) factor
-	dpdt = dplm[oplm+j];
-	// d_phi (P_lm) factor
-	dpdp = ((SH_RICK_PREC)m) * plm[oplm+j]/(SH_RICK_PREC)rick->sin_theta[i];
+	f[0] = valuex[m2]   * dfact; // A coefficient
+	f[1] = valuex[m2+1] * dfact; // B coefficient
+	rick->kern->axpy2((plm+oplm+k),n,f,(mma+k),(mmb+k));
+      }else{
 	//
-	m2 = m * 2;
-	//           print *,m,l,dpdt*dfact,dpdp*dfact
-	/* poloidal */
-	cslm[j2]   += // poloidal A
-	  (dpdt * valuex[m2]   - dpdp * valuey[m2+1])*dfact;
-	cslm[j2+1] += //   poloidal B
-	  (dpdt * valuex[m2+1] + dpdp * valuey[m2]  )*dfact;
-	/* toroidal */
-	dslm[j2]   += // toroidal A 
-	  (-dpdp * valuex[m2+1] - dpdt * valuey[m2]  )*dfact;
-	dslm[j2+1] += // toroidal B 
-	  ( dpdp * valuex[m2]   - dpdt * valuey[m2+1])*dfact;
+	// vector field expansion
+	//
+	// the ell_factor, 1/sqrt(l(l+1)), gets applied when the
+	// accumulators are sorted back, that also takes care of l=0
+	//
+	valuey = rick->spec_work + (rick->nlat + j) * nlon2;
+	isin_theta = 1.0/(SH_RICK_HIGH_PREC)rick->sin_theta[j];
+	// d_phi (P_lm) factor
+	fm = ((SH_RICK_HIGH_PREC)m) * isin_theta;
+	/* factors for d_theta(P_lm) */
+	f[0] =  valuex[m2]   * dfact; // poloidal A
+	f[1] =  valuex[m2+1] * dfact; // poloidal B
+	f[2] = -valuey[m2]   * dfact; // toroidal A
+	f[3] = -valuey[m2+1] * dfact; // toroidal B
+	/* factors for P_lm */
+	f[4] = -fm * valuey[m2+1] * dfact;
+	f[5] =  fm * valuey[m2]   * dfact;
+	f[6] = -fm * valuex[m2+1] * dfact;
+	f[7] =  fm * valuex[m2]   * dfact;
+	rick->kern->axpy8((plm+oplm+k),(dplm+oplm+k),n,f,
+			  (mma+k),(mmb+k),(mmc+k),(mmd+k));
       }
-    }                      // end vector field
-  }                        // end latitude loop
-
-  free(valuex);
+    }                        // end latitude loop
+  }			     // end m loop
+  /* 
+     sort back to the (l,m) order
+  */
+  rick_mm2lm(mma,mmb,cslm,lmax,(my_boolean)ivec,rick);
   if(ivec)
-    free(valuey);
+    rick_mm2lm(mmc,mmd,dslm,lmax,TRUE,rick);
 }
 
 
@@ -813,7 +1085,6 @@ void rick_init(int lmax,int ivec,int *npoints,int *nplm,
   // output: npoints,nplm,tnplm
   // local 
   SH_RICK_PREC xtemp;
-  int i,l;
 
 
   if(!rick->was_called){
@@ -860,63 +1131,40 @@ void rick_init(int lmax,int ivec,int *npoints,int *nplm,
     rick->old_tnplm = *tnplm;
     rick->old_nplm = *nplm;
     //
-    // initialize the Gauss points, at which the latitudes are 
-    // evaluated
+    // the Gauss points at which the latitudes are evaluated, the
+    // factors for the Legendre functions, and the vector harmonics
+    // factors are read-only and shared with all other modules of the
+    // same lmax and grid type
     //
-    if(!regular){
-      rick_vecalloc(&rick->gauss_z,rick->nlat,"rick_init 1");
-      rick_vecalloc(&rick->gauss_w,rick->nlat,"rick_init 2");
-      rick_vecalloc(&rick->gauss_theta,rick->nlat,"rick_init 3");
-      /* 
-	 gauss weighting 
-      */
-      rick_gauleg(-1.0,1.0,rick->gauss_z,rick->gauss_w,rick->nlat);
-      //
-      // theta values of the Gauss quadrature points
-      //
-      for(i=0;i < rick->nlat;i++){
-	rick->gauss_theta[i] = acos(rick->gauss_z[i]);
-      }
-    }
+    rick->tables = rick_get_tables(lmax,ivec,regular);
+    rick->gauss_z = rick->tables->gauss_z;
+    rick->gauss_w = rick->tables->gauss_w;
+    rick->gauss_theta = rick->tables->gauss_theta;
+    rick->plm_f1 = rick->tables->plm_f1;
+    rick->plm_f2 = rick->tables->plm_f2;
+    rick->plm_fac1 = rick->tables->plm_fac1;
+    rick->plm_fac2 = rick->tables->plm_fac2;
+    rick->plm_srt = rick->tables->plm_srt;
+    rick->ell_factor = rick->tables->ell_factor;
+    rick->sin_theta = rick->tables->sin_theta;
+    rick->vector_sh_fac_init = (ivec)?(TRUE):(FALSE);
     //
-    // those will be used by plmbar to store some of the factors
+    // the summation kernels. the m-major coefficients and per-thread
+    // work space get allocated when needed
     //
-    rick_vecalloc(&rick->plm_f1,rick->lmsize,"rick_init 4");
-    rick_vecalloc(&rick->plm_f2,rick->lmsize,"rick_init 5");
-    rick_vecalloc(&rick->plm_fac1,rick->lmsize,"rick_init 6");
-    rick_vecalloc(&rick->plm_fac2,rick->lmsize,"rick_init 7");
-    rick_vecalloc(&rick->plm_srt,rick->nlon,"rick_init 8");
+    rick->kern = rick_get_kernels();
+    rick->mm_work = rick->thread_work = rick->spec_work = NULL;
+    rick->thread_work_n = rick->nthread_work = rick->spec_work_n = 0;
+    rick->acc_work = NULL;
+    rick->acc_work_n = 0;
 
 
     rick->sin_cos_saved = FALSE;
 
-    if(ivec){
-      //
-      // additional arrays for vector spherical harmonics
-      // (perform the computations in SH_RICK_PREC precision)
-      //
-      rick_vecalloc(&rick->ell_factor,rick->nlat,"rick init 9");
-      if(!regular)
-	rick_vecalloc(&rick->sin_theta,rick->nlat,"rick init 9");
-      
-      // 1/(l(l+1)) factors
-      for(i=0,l=1;i < rick->nlat;i++,l++){
-	// no l=0 term, obviously
-	// go from l=1 to l=lmax+1
-	rick->ell_factor[i] = 1.0/sqrt((SH_RICK_PREC)(l*(l+1)));
-	if(!regular){
-	  rick->sin_theta[i] = sqrt((1.0 - rick->gauss_z[i])*
-				    (1.0+rick->gauss_z[i]));
-	}
-	rick->vector_sh_fac_init = TRUE;
-      }
-    }else{
-      rick->vector_sh_fac_init = FALSE;
-    }
     //
     // logic flags
     //
-    rick->computed_legendre = FALSE;
+    rick->computed_legendre = TRUE;
     rick->initialized = TRUE;
     rick->was_called = TRUE;
     /* 
@@ -953,24 +1201,76 @@ void rick_free_module(struct rick_module *rick, int ivec)
 {
   // input: ivec
   
-  free(rick->gauss_z);
-  free(rick->gauss_w);
-  free(rick->gauss_theta);
-  if(rick->computed_legendre){
-    // those are from the Legendre function action
-
-    free(rick->plm_f1);free(rick->plm_f2);
-    free(rick->plm_fac1);free(rick->plm_fac2);
-    free(rick->plm_srt);
+  if(rick->was_called)
+    rick_release_tables(rick->tables);
+  rick->tables = NULL;
+  if(rick->mm_work)
+    free(rick->mm_work);
+  if(rick->nthread_work)
+    free(rick->thread_work);
+  if(rick->spec_work_n)
+    free(rick->spec_work);
+  if(rick->acc_work_n)
+    free(rick->acc_work);
+  rick->mm_work = rick->thread_work = rick->spec_work = NULL;
+  rick->acc_work = NULL;
+  rick->nthread_work = rick->spec_work_n = rick->acc_work_n = 0;
+  rick->was_called = rick->initialized = FALSE;
+}
+/* 
+
+make sure there are work space blocks for all threads that may be
+used in the next parallel region. call outside parallel regions.
+
+*/
+void rick_alloc_workspace(struct rick_module *rick)
+{
+  int nthreads;
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+#else
+  nthreads = 1;
+#endif
+  if(nthreads > rick->nthread_work){
+    /* valuex, valuey, plm, dplm */
+    rick->thread_work_n = 2*(rick->nlon + 2) + 2*rick->lmsize;
+    rick_vecrealloc(&rick->thread_work,nthreads*rick->thread_work_n,
+		    "rick_alloc_workspace");
+    rick->nthread_work = nthreads;
   }
-  if(ivec){
-    free(rick->ell_factor);free(rick->sin_theta);
+  if(!rick->mm_work)		/* m-major coefficients, vector
+				   modules have room for the fused
+				   transform */
+    rick_vecalloc(&rick->mm_work,(2+4*rick->old_ivec)*rick->lmsize,
+		  "rick_alloc_workspace 2");
+}
+/* 
+
+check if lmax and ivec are consistent with the recursion factors for
+rick_plmbar1, those are set up by rick_tables_factors when the shared
+tables are created
+
+*/
+void rick_plmbar1_factors(int ivec,int lmax,struct rick_module *rick)
+{
+  if(!rick->initialized){
+    fprintf(stderr,"rick_plmbar1_factors: error: module not initialized, call rick_init first\n");
+    exit(-1);
+  }
+  // test if lmax has changed
+  if(lmax != rick->tables->lmax){
+    fprintf(stderr,"rick_plmbar1: error: factors were computed for lmax %i\n",rick->tables->lmax);
+    fprintf(stderr,"rick_plmbar1: error: now, lmax is %i\n",lmax);
+    exit(-1);
+  }
+  if(ivec > rick->tables->ivec){
+    fprintf(stderr,"rick_plmbar1: error: init with %i, now ivec %i\n",rick->tables->ivec,ivec);
+    exit(-1);
   }
-  
 }
 void rick_plmbar1(SH_RICK_PREC  *p,SH_RICK_PREC *dp,
 		  int ivec,int lmax,
-		  SH_RICK_PREC z, struct rick_module *rick)
+		  SH_RICK_HIGH_PREC z, struct rick_module *rick)
 {
   //
   //     Evaluates normalized associated Legendre function P(l,m), plm,
@@ -995,6 +1295,9 @@ void rick_plmbar1(SH_RICK_PREC  *p,SH_RICK_PREC *dp,
   //     Routine is stable in single and SH_RICK_PREC 
   //     precision to
   //     l,m = 511 at least; timing proportional to lmax**2
+  //
+  //     for lmax > RICK_PLM_XNUM_LMAX, the m > 0 terms are computed
+  //     with extended exponents, see rick_plmbar1_xnum
   //     R.J.O'Connell 7 Sept. 1989; added dp(z) 10 Jan. 1990.
   //
   //     Added precalculation and storage of square roots 
@@ -1012,9 +1315,9 @@ void rick_plmbar1(SH_RICK_PREC  *p,SH_RICK_PREC *dp,
   //  SH_RICK_PREC,intent(inout), dimension (lmsize)  p, dp
   //
   // local
-  SH_RICK_HIGH_PREC plm,pm1,pm2,pmm,sintsq,fnum,fden;
+  SH_RICK_HIGH_PREC plm,pm1,pm2;
   //
-  int i,l,m,k,kstart,l2,mstop,lmaxm1;
+  int l,m,k,l2,mstop;
   if(!rick->initialized){
     fprintf(stderr,"rick_plmbar1: error: module not initialized, call rick_init first\n");
     exit(-1);
@@ -1024,90 +1327,10 @@ void rick_plmbar1(SH_RICK_PREC  *p,SH_RICK_PREC *dp,
 	    lmax,(double)z);
     exit(-1);
   }
-  if(!rick->computed_legendre) {
-    /* 
-       need to initialize the legendre factors 
-    */
-    if(rick->nlon != (lmax+1)*2){
-      fprintf(stderr,"rick_plmbar1: factor mismatch, lmax: %i vs nlon: %i (needs to be (lmax+1)*2)\n",
-	      lmax,rick->nlon);
-      exit(-1);
-    }
-    //
-    // first call, set up some factors. the arrays were allocated in rick_init
-    //
-    for(k=0,i=1;k < rick->nlon;k++,i++){
-      /* plm_srt[n] = sqrt(n+1) */
-      rick->plm_srt[k] = sqrt((SH_RICK_PREC)(i));
-    }
-    // initialize plm factors
-    for(i=0;i < rick->lmsize;i++){
-      rick->plm_f1[i] = rick->plm_fac1[i] = 0.0;
-      rick->plm_f2[i] = rick->plm_fac2[i] = 0.0;
-    }
-    //     --case for m > 0
-    kstart = 0;
-    for(m=1;m <= lmax;m++){
-      //     --case for P(m,m) 
-      kstart += m+1;
-      if (m != lmax) {
-	//     --case for P(m+1,m)
-	k = kstart+m+1;		
-	//     --case for P(l,m) with l > m+1
-	if (m < (lmax-1)) {
-	  for(l = m+2;l <= lmax;l++){
-	    l2 = l * 2;	
-	    k = k+l;
-	    rick->plm_f1[k] = rick->plm_srt[l2] * rick->plm_srt[l2-2]/
-	      (rick->plm_srt[l+m-1] * rick->plm_srt[l-m-1]);
-	    rick->plm_f2[k]=(rick->plm_srt[l2] * rick->plm_srt[l-m-2]*rick->plm_srt[l+m-2])/
-	      (rick->plm_srt[l2-4] * rick->plm_srt[l+m-1] * rick->plm_srt[l-m-1]);
-	  }
-	}
-      }
-    }
-    if(ivec){
-      //
-      // for derivative of Plm with resp. to theta
-      // (if we forget to call Plm with ivec=1, but use
-      // ivec=1 later, we will notice as all should be zero)
-      //
-      k=2;			
-      for(l=2;l<=lmax;l++){
-	k++;
-	mstop = l - 1;
-	for(m=1;m <= mstop;m++){
-	  k++;
-	  rick->plm_fac1[k] = rick->plm_srt[l-m-1] * rick->plm_srt[l+m]; /* sqrt((l-m)(l+m+1) */
-	  rick->plm_fac2[k] = rick->plm_srt[l+m-1] * rick->plm_srt[l-m]; /* sqrt((l+m)(l-m+1) */
-	  if(m == 1){		/* multiply with sqrt(2) */
-	    rick->plm_fac2[k] = rick->plm_fac2[k] * rick->plm_srt[1];
-	  }
-	}
-	k++;
-      }
-    } /* end ivec==1 */
-    rick->old_lmax = lmax;
-    rick->old_ivec = ivec;
-    rick->computed_legendre = TRUE;
-    /* 
-       end first call 
-    */
-  }else{
-    /* 
-       subsequent call 
-    */
-    // test if lmax has changed
-    if(lmax != rick->old_lmax){
-      fprintf(stderr,"rick_plmbar1: error: factors were computed for lmax %in",rick->old_lmax);
-      fprintf(stderr,"rick_plmbar1: error: now, lmax is %i\n",lmax);
-      exit(-1);
-    }
-    if(ivec > rick->old_ivec){
-      fprintf(stderr,"rick_plmbar1: error: init with %i, now ivec %i\n",rick->old_ivec,ivec);
-      exit(-1);
-    }
-  }
+  /* 
+     set up factors on first call, else check
+  */
+  rick_plmbar1_factors(ivec,lmax,rick);
   /* 
 
   what follows will be executed for each z
@@ -1136,6 +1359,49 @@ void rick_plmbar1(SH_RICK_PREC  *p,SH_RICK_PREC *dp,
     pm1 = plm;
   }
   //       --case for m > 0
+  if(lmax > RICK_PLM_XNUM_LMAX)	/* P(m,m) would underflow */
+    rick_plmbar1_xnum(p,lmax,z,rick);
+  else
+    rick_plmbar1_std(p,lmax,z,rick);
+  if(ivec){
+    // 
+    // derivatives
+    //
+    //     ---derivatives of P(z) wrt theta, where z=cos(theta)
+    //     
+    dp[1] = -p[2];
+    dp[2] =  p[1];
+    k = 2;
+    for(l=2;l <= lmax;l++){
+      k++;
+      //     treat m=0 and m=l separately
+      dp[k] =  -rick->plm_srt[l-1] * rick->plm_srt[l] / rick->plm_srt[1] * p[k+1]; /* m = 0 */
+      dp[k+l] = rick->plm_srt[l-1] / rick->plm_srt[1] * p[k+l-1]; /* m = l */
+      mstop = l-1;
+      for(m=1;m <= mstop;m++){	/* rest */
+	k++;
+	dp[k] = rick->plm_fac2[k] * p[k-1] - rick->plm_fac1[k] * p[k+1];
+	dp[k] *= 0.5;
+      }
+      k++;
+    }
+  }
+}
+
+
+
+/* 
+
+   P(l,m) for m > 0 as part of rick_plmbar1, standard recurrence
+   starting from P(m,m). for large m and small sin(theta), P(m,m)
+   underflows and all P(l,m) of that m are returned as zero
+
+*/
+void rick_plmbar1_std(SH_RICK_PREC *p,int lmax,SH_RICK_HIGH_PREC z,
+		      struct rick_module *rick)
+{
+  SH_RICK_HIGH_PREC plm,pm1,pm2,pmm,sintsq,fnum,fden;
+  int l,m,k,kstart,lmaxm1;
   pmm = 1.0;
   sintsq = (1.0 - z) * (1.0 + z);
   fnum = -1.0;
@@ -1168,44 +1434,113 @@ void rick_plmbar1(SH_RICK_PREC  *p,SH_RICK_PREC *dp,
       }
     }
   }
-  if(ivec){
-    // 
-    // derivatives
-    //
-    //     ---derivatives of P(z) wrt theta, where z=cos(theta)
-    //     
-    dp[1] = -p[2];
-    dp[2] =  p[1];
-    k = 2;
-    for(l=2;l <= lmax;l++){
-      k++;
-      //     treat m=0 and m=l separately
-      dp[k] =  -rick->plm_srt[l-1] * rick->plm_srt[l] / rick->plm_srt[1] * p[k+1]; /* m = 0 */
-      dp[k+l] = rick->plm_srt[l-1] / rick->plm_srt[1] * p[k+l-1]; /* m = l */
-      mstop = l-1;
-      for(m=1;m <= mstop;m++){	/* rest */
-	k++;
-	dp[k] = rick->plm_fac2[k] * p[k-1] - rick->plm_fac1[k] * p[k+1];
-	dp[k] *= 0.5;
+}
+/* 
+
+   P(l,m) for m > 0 as part of rick_plmbar1, using X-numbers,
+   i.e. x * BIG^ix with BIG = 2^RICK_XNUM_IND, for the seeds P(m,m)
+   and the recurrence in l until the values are in the normal range
+   (Fukushima, J. Geodesy, 86, 271-285, 2012). values which are
+   below the double range are returned as zero, but all other terms
+   are retained for high lmax
+
+*/
+void rick_plmbar1_xnum(SH_RICK_PREC *p,int lmax,SH_RICK_HIGH_PREC z,
+		       struct rick_module *rick)
+{
+  SH_RICK_HIGH_PREC pm1,pm2,plm,xs,sint,fnum,fden,big,bigi,bigs,bigsi;
+  int l,m,k,kstart,ix,ixs;
+  big   = ldexp(1.0, RICK_XNUM_IND);
+  bigi  = ldexp(1.0,-RICK_XNUM_IND);
+  bigs  = ldexp(1.0, RICK_XNUM_IND/2);
+  bigsi = ldexp(1.0,-RICK_XNUM_IND/2);
+  sint = sqrt((1.0 - z) * (1.0 + z));
+  /* 
+     sqrt of the product in rick_plmbar1_std, as X-number xs, ixs 
+  */
+  xs = 1.0;ixs = 0;
+  fnum = -1.0;
+  fden =  0.0;
+  kstart = 0;
+  for(m = 1;m <= lmax;m++){
+    //     --case for P(m,m) 
+    kstart += m+1;
+    fnum += 2.0;
+    fden += 2.0;
+    xs *= sint * sqrt(fnum/fden);
+    if(fabs(xs) < bigsi){
+      xs *= big;
+      ixs--;
+    }
+    pm2 = sqrt((SH_RICK_HIGH_PREC)(4*m+2)) * xs;
+    ix = ixs;
+    p[kstart] = RICK_XNUM2F(pm2,ix,bigi);
+    if (m != lmax) {
+      //     --case for P(m+1,m)
+      pm1 = z * rick->plm_srt[2*m+2] * pm2;
+      k = kstart + m + 1;
+      p[k] = RICK_XNUM2F(pm1,ix,bigi);
+      //     --case for P(l,m) with l > m+1, scaled as long as needed
+      for(l = m+2;(l <= lmax) && (ix < 0);l++){
+	k += l;
+	plm = z * rick->plm_f1[k] * pm1 - rick->plm_f2[k] * pm2;
+	pm2 = pm1;
+	pm1 = plm;
+	if(fabs(pm1) >= bigs){
+	  pm1 *= bigi;
+	  pm2 *= bigi;
+	  ix++;
+	}
+	p[k] = RICK_XNUM2F(pm1,ix,bigi);
+      }
+      //     --and in the normal range
+      for(;l <= lmax;l++){
+	k += l;
+	plm = z * rick->plm_f1[k] * pm1 - rick->plm_f2[k] * pm2;
+	p[k] = plm;
+	pm2 = pm1;
+	pm1 = plm;
       }
-      k++;
     }
   }
 }
-
-
-
 //
 // Returns arrays X and W with N points and weights for
 // Gaussian quadrature over interval X1,X2.
 // we call this routine with n = nlat = lmax+1
 //
+// for n > RICK_GAULEG_NEWTON_MAX, uses the O(n) asymptotic method
+// in rick_gauleg_asymp, else Newton iteration as below
+//
+void rick_gauleg(SH_RICK_HIGH_PREC x1, SH_RICK_HIGH_PREC x2, 
+		 SH_RICK_HIGH_PREC *x, SH_RICK_HIGH_PREC *w,int n)
+{
+  int i;
+  SH_RICK_HIGH_PREC xl,xm;
+#if SH_RICK_PRECISION != 32
+  if(n > RICK_GAULEG_NEWTON_MAX){
+    /* nodes on [-1,1], then map */
+    rick_gauleg_asymp(x,w,(SH_RICK_HIGH_PREC *)NULL,n);
+    xm=0.5*(x2+x1);
+    xl=0.5*(x2-x1);
+    for(i=0;i < n;i++){
+      x[i] = xm + xl * x[i];
+      w[i] *= xl;
+    }
+    return;
+  }
+#endif
+  rick_gauleg_newton(x1,x2,x,w,n);
+}
+//
 // this is from Numerical Recipes, but we changed the indexing to 
 // 0..n-1
+//
+// O(n^2) since the full recurrence is evaluated for each Newton step
 //       
 //     
-void rick_gauleg(SH_RICK_PREC x1, SH_RICK_PREC x2, 
-		 SH_RICK_PREC *x, SH_RICK_PREC *w,int n)
+void rick_gauleg_newton(SH_RICK_HIGH_PREC x1, SH_RICK_HIGH_PREC x2, 
+			SH_RICK_HIGH_PREC *x, SH_RICK_HIGH_PREC *w,int n)
 {
   //
   // local variables
@@ -1238,3 +1573,413 @@ void rick_gauleg(SH_RICK_PREC x1, SH_RICK_PREC x2,
     w[n-i-1] = w[i];
   }
 }
+/* 
+
+   Gauss-Legendre nodes and weights on [-1,1] for large n, following
+   Bogaert (SIAM J. Sci. Comput., 36, A1008-A1026, 2014): each
+   node/weight pair is computed from asymptotic expansions in theta
+   around the zeros of the Bessel function J0, at O(1) cost per
+   node. accurate to double precision for n > 100
+
+   x is ascending, theta = acos(x) is output as well if theta is not NULL
+   
+*/
+void rick_gauleg_asymp(SH_RICK_HIGH_PREC *x, SH_RICK_HIGH_PREC *w, 
+		       SH_RICK_HIGH_PREC *theta, int n)
+{
+  int k,m;
+  double th,wk;
+  m = (n+1)/2;
+  for(k=1;k <= m;k++){
+    /* k-th node counted from theta = 0 */
+    rick_gauleg_asymp_pair(n,k,&th,&wk);
+    x[n-k] = cos(th);
+    w[n-k] = wk;
+    if(theta)
+      theta[n-k] = th;
+    if(n-k != k-1){		/* mirror */
+      x[k-1] = -x[n-k];
+      w[k-1] = wk;
+      if(theta)
+	theta[k-1] = RICK_PI - th;
+    }
+  }
+}
+/* 
+
+   node theta_k and weight w_k of n-point Gauss-Legendre for
+   k = 1 ... (n+1)/2, counting from theta = 0
+
+*/
+void rick_gauleg_asymp_pair(int n, int k, double *theta, double *weight)
+{
+  double w,nu,th,x,b,nuosin,bnuosin,winvsinc,wis2,deno;
+  double sf1t,sf2t,sf3t,wsf1t,wsf2t,wsf3t;
+  w = 1.0/((double)n+0.5);
+  nu = rick_bessel_j0_zero(k);
+  th = w*nu;
+  x = th*th;
+  /* J1(nu)^2 */
+  b = j1(nu);
+  b *= b;
+  /* Chebyshev interpolants for the nodes... */
+  sf1t = (((((-1.29052996274280508473467968379e-12*x +2.40724685864330121825976175184e-10)*x 
+	     -3.13148654635992041468855740012e-8)*x +0.275573168962061235623801563453e-5)*x 
+	   -0.148809523713909147898955880165e-3)*x +0.416666666665193394525296923981e-2)*x 
+    -0.416666666666662959639712457549e-1;
+  sf2t = (((((+2.20639421781871003734786884322e-9*x -7.53036771373769326811030753538e-8)*x 
+	     +0.161969259453836261731700382098e-5)*x -0.253300326008232025914059965302e-4)*x 
+	   +0.282116886057560434805998583817e-3)*x -0.209022248387852902722635654229e-2)*x 
+    +0.815972221772932265640401128517e-2;
+  sf3t = (((((-2.97058225375526229899781956673e-8*x +5.55845330223796209655886325712e-7)*x 
+	     -0.567797841356833081642185432056e-5)*x +0.418498100329504574443885193835e-4)*x 
+	   -0.251395293283965914823026348764e-3)*x +0.128654198542845137196151147483e-2)*x 
+    -0.416012165620204364833694266818e-2;
+  /* ... and the weights */
+  wsf1t = ((((((((-2.20902861044616638398573427475e-14*x +2.30365726860377376873232578871e-12)*x 
+		 -1.75257700735423807659851042318e-10)*x +1.03756066927916795821098009353e-8)*x 
+	       -4.63968647553221331251529631098e-7)*x +0.149644593625028648361395938176e-4)*x 
+	     -0.326278659594412170300449074873e-3)*x +0.436507936507598105249726413120e-2)*x 
+	   -0.305555555555553028279487898503e-1)*x +0.833333333333333302184063103900e-1;
+  wsf2t = (((((((+3.63117412152654783455929483029e-12*x +7.67643545069893130779501844323e-11)*x 
+		-7.12912857233642220650643150625e-9)*x +2.11483880685947151466370130277e-7)*x 
+	      -0.381817918680045468483009307090e-5)*x +0.465969530694968391417927388162e-4)*x 
+	    -0.407297185611335764191683161117e-3)*x +0.268959435694729660779984493795e-2)*x 
+    -0.111111111111214923138249347172e-1;
+  wsf3t = (((((((+2.01826791256703301806643264922e-9*x -4.38647122520206649251063212545e-8)*x 
+		+5.08898347288671653137451093208e-7)*x -0.397933316519135275712977531366e-5)*x 
+	      +0.200559326396458326778521795392e-4)*x -0.422888059282921161626339411388e-4)*x 
+	    -0.105646050254076140548678457002e-3)*x -0.947969308958577323145923317955e-4)*x 
+    +0.656966489926484797412985260842e-2;
+  /* refine with the expansions */
+  nuosin = nu/sin(th);
+  bnuosin = b*nuosin;
+  winvsinc = w*w*nuosin;
+  wis2 = winvsinc*winvsinc;
+  *theta = w*(nu + th * winvsinc * (sf1t + wis2*(sf2t + wis2*sf3t)));
+  deno = bnuosin + bnuosin * wis2*(wsf1t + wis2*(wsf2t + wis2*wsf3t));
+  *weight = (2.0*w)/deno;
+}
+/* 
+
+   k-th zero of the Bessel function J0. McMahon's expansion for
+   k > 20, else refine the first terms of that with Newton steps
+
+*/
+double rick_bessel_j0_zero(int k)
+{
+  double z,beta,r,r2;
+  int i;
+  beta = RICK_PI*((double)k-0.25);
+  if(k > 20){
+    r = 1.0/beta;
+    r2 = r*r;
+    z = beta + r*(0.125+r2*(-0.807291666666666666666666666667e-1+r2*(0.246028645833333333333333333333+
+	r2*(-1.82443876720610119047619047619+r2*(25.3364147973439050099206349206+
+	r2*(-567.644412135183381139802038240+r2*(18690.4765282320653831636345064+
+	r2*(-8.49353580299148769921876983660e5+5.09225462402226769498681286758e7*r2))))))));
+  }else{
+    z = beta + 0.125/beta;
+    for(i=0;i < 8;i++)		/* J0' = -J1 */
+      z += j0(z)/j1(z);
+  }
+  return z;
+}
+/* 
+
+   Gauss points z=cos(theta), weights w, and theta for nlat latitudes
+   on [-1,1] as used by rick_init. those are computed only once per
+   nlat and process, and then copied from the cache
+
+*/
+void rick_gauss_points(int nlat,SH_RICK_HIGH_PREC *z,SH_RICK_HIGH_PREC *w,
+		       SH_RICK_HIGH_PREC *theta)
+{
+  static struct rick_gauss_grid *cache = NULL;
+  struct rick_gauss_grid *g;
+  int i;
+#ifdef _OPENMP
+#pragma omp critical(rick_gauss_cache)
+#endif
+  {
+    for(g=cache;g;g=g->next)
+      if(g->nlat == nlat)
+	break;
+    if(!g){
+      g = (struct rick_gauss_grid *)malloc(sizeof(struct rick_gauss_grid));
+      if(!g)
+	HC_MEMERROR("rick_gauss_points");
+      g->nlat = nlat;
+      rick_hvecalloc(&g->z,nlat,"rick_gauss_points 1");
+      rick_hvecalloc(&g->w,nlat,"rick_gauss_points 2");
+      rick_hvecalloc(&g->theta,nlat,"rick_gauss_points 3");
+#if SH_RICK_PRECISION != 32
+      if(nlat > RICK_GAULEG_NEWTON_MAX){
+	rick_gauleg_asymp(g->z,g->w,g->theta,nlat);
+      }else
+#endif
+	{
+	rick_gauleg_newton(-1.0,1.0,g->z,g->w,nlat);
+	for(i=0;i < nlat;i++)
+	  g->theta[i] = acos(g->z[i]);
+      }
+      g->next = cache;
+      cache = g;
+    }
+  }
+  for(i=0;i < nlat;i++){
+    z[i] = g->z[i];
+    w[i] = g->w[i];
+    theta[i] = g->theta[i];
+  }
+}
+/* 
+
+   shared, read-only tables for rick_init: Gauss points, the recursion
+   factors for rick_plmbar1, and the vector harmonics factors. those
+   depend only on lmax, ivec, and the grid type, and are computed once
+   for all modules which use them. tables with ivec = 1 are also
+   handed out for ivec = 0
+
+   release with rick_release_tables
+
+*/
+static struct rick_tables *rick_table_cache = NULL;
+
+struct rick_tables *rick_get_tables(int lmax,int ivec,
+				    my_boolean regular)
+{
+  struct rick_tables *t;
+  int i,l,nlat;
+#ifdef _OPENMP
+#pragma omp critical(rick_table_cache)
+#endif
+  {
+    for(t=rick_table_cache;t;t=t->next)
+      if((t->lmax == lmax)&&(t->ivec >= ivec)&&(t->regular == regular))
+	break;
+    if(!t){
+      t = (struct rick_tables *)calloc(1,sizeof(struct rick_tables));
+      if(!t)
+	HC_MEMERROR("rick_get_tables");
+      t->lmax = lmax;t->ivec = ivec;t->regular = regular;
+      nlat = lmax + 1;
+      if(!regular){
+	rick_hvecalloc(&t->gauss_z,nlat,"rick_get_tables 1");
+	rick_hvecalloc(&t->gauss_w,nlat,"rick_get_tables 2");
+	rick_hvecalloc(&t->gauss_theta,nlat,"rick_get_tables 3");
+	rick_gauss_points(nlat,t->gauss_z,t->gauss_w,t->gauss_theta);
+      }
+      rick_tables_factors(t);
+      if(ivec){
+	//
+	// additional arrays for vector spherical harmonics
+	//
+	rick_vecalloc(&t->ell_factor,nlat,"rick_get_tables 4");
+	if(!regular)
+	  rick_vecalloc(&t->sin_theta,nlat,"rick_get_tables 5");
+	// 1/(l(l+1)) factors
+	for(i=0,l=1;i < nlat;i++,l++){
+	  // no l=0 term, obviously
+	  // go from l=1 to l=lmax+1
+	  t->ell_factor[i] = 1.0/sqrt((SH_RICK_PREC)(l*(l+1)));
+	  if(!regular){
+	    t->sin_theta[i] = sqrt((1.0 - t->gauss_z[i])*
+				   (1.0+t->gauss_z[i]));
+	  }
+	}
+      }
+      t->next = rick_table_cache;
+      rick_table_cache = t;
+    }
+    t->nref++;
+  }
+  return t;
+}
+/* 
+
+   drop a reference to shared tables, and free them if this was the last
+
+*/
+void rick_release_tables(struct rick_tables *t)
+{
+  struct rick_tables **tp;
+  my_boolean remove = FALSE;
+  if(!t)
+    return;
+#ifdef _OPENMP
+#pragma omp critical(rick_table_cache)
+#endif
+  {
+    t->nref--;
+    if(t->nref <= 0){
+      for(tp=&rick_table_cache;*tp;tp=&((*tp)->next))
+	if(*tp == t){
+	  *tp = t->next;
+	  remove = TRUE;
+	  break;
+	}
+    }
+  }
+  if(remove){
+    if(!t->regular){
+      free(t->gauss_z);free(t->gauss_w);free(t->gauss_theta);
+    }
+    free(t->plm_f1);free(t->plm_f2);
+    free(t->plm_fac1);free(t->plm_fac2);
+    free(t->plm_srt);
+    if(t->ivec){
+      free(t->ell_factor);
+      if(!t->regular)
+	free(t->sin_theta);
+    }
+    free(t);
+  }
+}
+/* 
+
+   set up the recursion factors for rick_plmbar1 
+
+*/
+void rick_tables_factors(struct rick_tables *t)
+{
+  int i,l,m,k,kstart,l2,mstop,lmax,nlon,lmsize;
+  lmax = t->lmax;
+  nlon = 2*(lmax+1);
+  lmsize = (lmax+1)*(lmax+2)/2;
+  rick_hvecalloc(&t->plm_f1,lmsize,"rick_tables_factors 1");
+  rick_hvecalloc(&t->plm_f2,lmsize,"rick_tables_factors 2");
+  rick_hvecalloc(&t->plm_fac1,lmsize,"rick_tables_factors 3");
+  rick_hvecalloc(&t->plm_fac2,lmsize,"rick_tables_factors 4");
+  rick_hvecalloc(&t->plm_srt,nlon,"rick_tables_factors 5");
+  for(k=0,i=1;k < nlon;k++,i++){
+    /* plm_srt[n] = sqrt(n+1) */
+    t->plm_srt[k] = sqrt((SH_RICK_HIGH_PREC)(i));
+  }
+  // initialize plm factors
+  for(i=0;i < lmsize;i++){
+    t->plm_f1[i] = t->plm_fac1[i] = 0.0;
+    t->plm_f2[i] = t->plm_fac2[i] = 0.0;
+  }
+  //     --case for m > 0
+  kstart = 0;
+  for(m=1;m <= lmax;m++){
+    //     --case for P(m,m) 
+    kstart += m+1;
+    if (m != lmax) {
+      //     --case for P(m+1,m)
+      k = kstart+m+1;		
+      //     --case for P(l,m) with l > m+1
+      if (m < (lmax-1)) {
+	for(l = m+2;l <= lmax;l++){
+	  l2 = l * 2;	
+	  k = k+l;
+	  t->plm_f1[k] = t->plm_srt[l2] * t->plm_srt[l2-2]/
+	    (t->plm_srt[l+m-1] * t->plm_srt[l-m-1]);
+	  t->plm_f2[k]=(t->plm_srt[l2] * t->plm_srt[l-m-2]*t->plm_srt[l+m-2])/
+	    (t->plm_srt[l2-4] * t->plm_srt[l+m-1] * t->plm_srt[l-m-1]);
+	}
+      }
+    }
+  }
+  if(t->ivec){
+    //
+    // for derivative of Plm with resp. to theta
+    //
+    k=2;			
+    for(l=2;l<=lmax;l++){
+      k++;
+      mstop = l - 1;
+      for(m=1;m <= mstop;m++){
+	k++;
+	t->plm_fac1[k] = t->plm_srt[l-m-1] * t->plm_srt[l+m]; /* sqrt((l-m)(l+m+1) */
+	t->plm_fac2[k] = t->plm_srt[l+m-1] * t->plm_srt[l-m]; /* sqrt((l+m)(l-m+1) */
+	if(m == 1){		/* multiply with sqrt(2) */
+	  t->plm_fac2[k] = t->plm_fac2[k] * t->plm_srt[1];
+	}
+      }
+      k++;
+    }
+  } /* end ivec==1 */
+}
+/* 
+
+   full Legendre function tables at the Gauss latitudes for lmax and
+   ivec (Plm, followed by dPlm if ivec is set), computed with
+   rick_compute_allplm on first request, or mapped from the on-disk
+   cache if there is one (rick_cache_c.c), and shared after that. the
+   returned array is read-only, release with rick_release_plm_table
+
+*/
+static struct rick_plm_table *rick_plm_cache = NULL;
+
+SH_RICK_PREC *rick_get_plm_table(int lmax,int ivec,
+				 struct rick_module *rick)
+{
+  struct rick_plm_table *t;
+#ifdef _OPENMP
+#pragma omp critical(rick_plm_cache)
+#endif
+  {
+    for(t=rick_plm_cache;t;t=t->next)
+      if((t->lmax == lmax)&&(t->ivec >= ivec))
+	break;
+    if(!t){
+      t = (struct rick_plm_table *)calloc(1,sizeof(struct rick_plm_table));
+      if(!t)
+	HC_MEMERROR("rick_get_plm_table");
+      t->lmax = lmax;t->ivec = ivec;
+      /* 
+	 try the on-disk cache first, else compute and store
+      */
+      t->plm = rick_plm_cache_load(lmax,ivec,rick->nlat,rick->old_nplm,
+				   rick->gauss_z,rick->gauss_w,
+				   &t->map,&t->map_size);
+      if(!t->plm){
+	t->map = NULL;
+	rick_vecalloc(&t->plm,rick->old_nplm*(1+ivec),"rick_get_plm_table");
+	rick_compute_allplm(lmax,ivec,t->plm,(t->plm+rick->old_nplm),rick);
+	rick_plm_cache_store(lmax,ivec,rick->nlat,rick->old_nplm,
+			     rick->gauss_z,rick->gauss_w,t->plm);
+      }
+      t->next = rick_plm_cache;
+      rick_plm_cache = t;
+    }
+    t->nref++;
+  }
+  return t->plm;
+}
+/* 
+
+   drop a reference to a Plm table from rick_get_plm_table, returns
+   FALSE if plm is not from the cache
+
+*/
+my_boolean rick_release_plm_table(SH_RICK_PREC *plm)
+{
+  struct rick_plm_table **tp,*t = NULL;
+  my_boolean found = FALSE;
+#ifdef _OPENMP
+#pragma omp critical(rick_plm_cache)
+#endif
+  {
+    for(tp=&rick_plm_cache;*tp;tp=&((*tp)->next))
+      if((*tp)->plm == plm){
+	found = TRUE;
+	(*tp)->nref--;
+	if((*tp)->nref <= 0){
+	  t = *tp;
+	  *tp = t->next;
+	}
+	break;
+      }
+  }
+  if(t){
+    if(t->map)
+      rick_plm_cache_unmap(t->map,t->map_size);
+    else
+      free(t->plm);
+    free(t);
+  }
+  return found;
+}
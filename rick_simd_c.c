@@ -0,0 +1,759 @@
+#include "hc.h"
+/*
+
+   summation kernels for the Gauss/FFT spherical harmonic transforms
+   in rick_sh_c.c
+
+   The transforms work on Legendre functions and coefficients that
+   are stored m-major, i.e. for each order m, all degrees l=m..lmax
+   are contiguous (see RICK_MM_INDEX in sh_rick.h). For fixed m, the
+   Legendre sum of the synthesis then is a dot product over l, and
+   the Gauss quadrature of the analysis an axpy over l, both of which
+   map onto SIMD units.
+
+   There is a generic C version of each kernel, and AVX2/FMA and
+   AVX-512 versions for double precision on x86 which are selected at
+   runtime depending on what the CPU supports. For the single
+   precision build, there are AVX2/AVX-512 versions of the dot
+   kernels of the synthesis at twice the width, and the axpy kernels
+   of the analysis convert the Legendre functions and accumulate
+   into SH_RICK_HIGH_PREC, i.e. double.
+
+   kernels:
+
+   dot2:  s[0] = sum_l a[l] p[l], s[1] = sum_l b[l] p[l]
+
+   dot8:  s[0..3] = sum_l {a,b,c,d}[l] dp[l]
+          s[4..7] = sum_l {a,b,c,d}[l] p[l]
+
+   dot10: as dot8, plus s[8] = sum_l e[l] p[l], s[9] = sum_l f[l] p[l]
+
+   axpy2: a[l] += f[0] p[l], b[l] += f[1] p[l]
+
+   axpy8: {a,b,c,d}[l] += f[0..3] dp[l] + f[4..7] p[l]
+
+*/
+
+/*
+   generic versions, use several partial sums to break the
+   dependency chain
+*/
+static void rick_dot2_generic(SH_RICK_PREC *p,SH_RICK_PREC *a,
+			      SH_RICK_PREC *b,int n,SH_RICK_PREC *s)
+{
+  int l;
+  SH_RICK_PREC sa0,sa1,sb0,sb1;
+  sa0 = sa1 = sb0 = sb1 = 0.0;
+  for(l=0;l < n-1;l+=2){
+    sa0 += a[l]   * p[l];
+    sb0 += b[l]   * p[l];
+    sa1 += a[l+1] * p[l+1];
+    sb1 += b[l+1] * p[l+1];
+  }
+  if(l < n){
+    sa0 += a[l] * p[l];
+    sb0 += b[l] * p[l];
+  }
+  s[0] = sa0 + sa1;
+  s[1] = sb0 + sb1;
+}
+static void rick_dot8_generic(SH_RICK_PREC *p,SH_RICK_PREC *dp,
+			      SH_RICK_PREC *a,SH_RICK_PREC *b,
+			      SH_RICK_PREC *c,SH_RICK_PREC *d,
+			      int n,SH_RICK_PREC *s)
+{
+  int l,k;
+  for(k=0;k < 8;k++)
+    s[k] = 0.0;
+  for(l=0;l < n;l++){
+    s[0] += a[l] * dp[l];
+    s[1] += b[l] * dp[l];
+    s[2] += c[l] * dp[l];
+    s[3] += d[l] * dp[l];
+    s[4] += a[l] * p[l];
+    s[5] += b[l] * p[l];
+    s[6] += c[l] * p[l];
+    s[7] += d[l] * p[l];
+  }
+}
+static void rick_dot10_generic(SH_RICK_PREC *p,SH_RICK_PREC *dp,
+			       SH_RICK_PREC *a,SH_RICK_PREC *b,
+			       SH_RICK_PREC *c,SH_RICK_PREC *d,
+			       SH_RICK_PREC *e,SH_RICK_PREC *f,
+			       int n,SH_RICK_PREC *s)
+{
+  int l,k;
+  for(k=0;k < 10;k++)
+    s[k] = 0.0;
+  for(l=0;l < n;l++){
+    s[0] += a[l] * dp[l];
+    s[1] += b[l] * dp[l];
+    s[2] += c[l] * dp[l];
+    s[3] += d[l] * dp[l];
+    s[4] += a[l] * p[l];
+    s[5] += b[l] * p[l];
+    s[6] += c[l] * p[l];
+    s[7] += d[l] * p[l];
+    s[8] += e[l] * p[l];
+    s[9] += f[l] * p[l];
+  }
+}
+static void rick_axpy2_generic(SH_RICK_PREC *p,int n,SH_RICK_HIGH_PREC *f,
+			       SH_RICK_HIGH_PREC *a,SH_RICK_HIGH_PREC *b)
+{
+  int l;
+  for(l=0;l < n;l++){
+    a[l] += f[0] * p[l];
+    b[l] += f[1] * p[l];
+  }
+}
+static void rick_axpy8_generic(SH_RICK_PREC *p,SH_RICK_PREC *dp,int n,
+			       SH_RICK_HIGH_PREC *f,
+			       SH_RICK_HIGH_PREC *a,SH_RICK_HIGH_PREC *b,
+			       SH_RICK_HIGH_PREC *c,SH_RICK_HIGH_PREC *d)
+{
+  int l;
+  for(l=0;l < n;l++){
+    a[l] += f[0] * dp[l] + f[4] * p[l];
+    b[l] += f[1] * dp[l] + f[5] * p[l];
+    c[l] += f[2] * dp[l] + f[6] * p[l];
+    d[l] += f[3] * dp[l] + f[7] * p[l];
+  }
+}
+
+#if defined(RICK_USE_X86_SIMD) && (SH_RICK_PRECISION == 16)
+/*
+
+   AVX2/FMA versions, four doubles per register
+
+*/
+#define RICK_AVX2 __attribute__((target("avx2,fma")))
+RICK_AVX2 static double rick_hsum_avx2(__m256d x)
+{
+  __m128d lo,hi;
+  lo = _mm256_castpd256_pd128(x);
+  hi = _mm256_extractf128_pd(x,1);
+  lo = _mm_add_pd(lo,hi);
+  hi = _mm_unpackhi_pd(lo,lo);
+  return _mm_cvtsd_f64(_mm_add_sd(lo,hi));
+}
+RICK_AVX2 static void rick_dot2_avx2(double *p,double *a,double *b,
+				     int n,double *s)
+{
+  int l;
+  __m256d sa0,sa1,sb0,sb1,p0,p1;
+  double ra,rb;
+  sa0 = sa1 = sb0 = sb1 = _mm256_setzero_pd();
+  for(l=0;l+8 <= n;l+=8){
+    p0 = _mm256_loadu_pd(p+l);
+    p1 = _mm256_loadu_pd(p+l+4);
+    sa0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+l),  p0,sa0);
+    sb0 = _mm256_fmadd_pd(_mm256_loadu_pd(b+l),  p0,sb0);
+    sa1 = _mm256_fmadd_pd(_mm256_loadu_pd(a+l+4),p1,sa1);
+    sb1 = _mm256_fmadd_pd(_mm256_loadu_pd(b+l+4),p1,sb1);
+  }
+  if(l+4 <= n){
+    p0 = _mm256_loadu_pd(p+l);
+    sa0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+l),p0,sa0);
+    sb0 = _mm256_fmadd_pd(_mm256_loadu_pd(b+l),p0,sb0);
+    l += 4;
+  }
+  ra = rick_hsum_avx2(_mm256_add_pd(sa0,sa1));
+  rb = rick_hsum_avx2(_mm256_add_pd(sb0,sb1));
+  for(;l < n;l++){
+    ra += a[l] * p[l];
+    rb += b[l] * p[l];
+  }
+  s[0] = ra;
+  s[1] = rb;
+}
+RICK_AVX2 static void rick_dot8_avx2(double *p,double *dp,
+				     double *a,double *b,
+				     double *c,double *d,
+				     int n,double *s)
+{
+  int l,k;
+  __m256d acc[8],p0,dp0,x;
+  for(k=0;k < 8;k++)
+    acc[k] = _mm256_setzero_pd();
+  for(l=0;l+4 <= n;l+=4){
+    p0  = _mm256_loadu_pd(p+l);
+    dp0 = _mm256_loadu_pd(dp+l);
+    x = _mm256_loadu_pd(a+l);
+    acc[0] = _mm256_fmadd_pd(x,dp0,acc[0]);acc[4] = _mm256_fmadd_pd(x,p0,acc[4]);
+    x = _mm256_loadu_pd(b+l);
+    acc[1] = _mm256_fmadd_pd(x,dp0,acc[1]);acc[5] = _mm256_fmadd_pd(x,p0,acc[5]);
+    x = _mm256_loadu_pd(c+l);
+    acc[2] = _mm256_fmadd_pd(x,dp0,acc[2]);acc[6] = _mm256_fmadd_pd(x,p0,acc[6]);
+    x = _mm256_loadu_pd(d+l);
+    acc[3] = _mm256_fmadd_pd(x,dp0,acc[3]);acc[7] = _mm256_fmadd_pd(x,p0,acc[7]);
+  }
+  for(k=0;k < 8;k++)
+    s[k] = rick_hsum_avx2(acc[k]);
+  for(;l < n;l++){
+    s[0] += a[l] * dp[l];s[4] += a[l] * p[l];
+    s[1] += b[l] * dp[l];s[5] += b[l] * p[l];
+    s[2] += c[l] * dp[l];s[6] += c[l] * p[l];
+    s[3] += d[l] * dp[l];s[7] += d[l] * p[l];
+  }
+}
+RICK_AVX2 static void rick_dot10_avx2(double *p,double *dp,
+				      double *a,double *b,
+				      double *c,double *d,
+				      double *e,double *f,
+				      int n,double *s)
+{
+  int l,k;
+  __m256d acc[10],p0,dp0,x;
+  for(k=0;k < 10;k++)
+    acc[k] = _mm256_setzero_pd();
+  for(l=0;l+4 <= n;l+=4){
+    p0  = _mm256_loadu_pd(p+l);
+    dp0 = _mm256_loadu_pd(dp+l);
+    x = _mm256_loadu_pd(a+l);
+    acc[0] = _mm256_fmadd_pd(x,dp0,acc[0]);acc[4] = _mm256_fmadd_pd(x,p0,acc[4]);
+    x = _mm256_loadu_pd(b+l);
+    acc[1] = _mm256_fmadd_pd(x,dp0,acc[1]);acc[5] = _mm256_fmadd_pd(x,p0,acc[5]);
+    x = _mm256_loadu_pd(c+l);
+    acc[2] = _mm256_fmadd_pd(x,dp0,acc[2]);acc[6] = _mm256_fmadd_pd(x,p0,acc[6]);
+    x = _mm256_loadu_pd(d+l);
+    acc[3] = _mm256_fmadd_pd(x,dp0,acc[3]);acc[7] = _mm256_fmadd_pd(x,p0,acc[7]);
+    acc[8] = _mm256_fmadd_pd(_mm256_loadu_pd(e+l),p0,acc[8]);
+    acc[9] = _mm256_fmadd_pd(_mm256_loadu_pd(f+l),p0,acc[9]);
+  }
+  for(k=0;k < 10;k++)
+    s[k] = rick_hsum_avx2(acc[k]);
+  for(;l < n;l++){
+    s[0] += a[l] * dp[l];s[4] += a[l] * p[l];
+    s[1] += b[l] * dp[l];s[5] += b[l] * p[l];
+    s[2] += c[l] * dp[l];s[6] += c[l] * p[l];
+    s[3] += d[l] * dp[l];s[7] += d[l] * p[l];
+    s[8] += e[l] * p[l];s[9] += f[l] * p[l];
+  }
+}
+RICK_AVX2 static void rick_axpy2_avx2(double *p,int n,double *f,
+				      double *a,double *b)
+{
+  int l;
+  __m256d fa,fb,p0;
+  fa = _mm256_set1_pd(f[0]);
+  fb = _mm256_set1_pd(f[1]);
+  for(l=0;l+4 <= n;l+=4){
+    p0 = _mm256_loadu_pd(p+l);
+    _mm256_storeu_pd(a+l,_mm256_fmadd_pd(fa,p0,_mm256_loadu_pd(a+l)));
+    _mm256_storeu_pd(b+l,_mm256_fmadd_pd(fb,p0,_mm256_loadu_pd(b+l)));
+  }
+  for(;l < n;l++){
+    a[l] += f[0] * p[l];
+    b[l] += f[1] * p[l];
+  }
+}
+RICK_AVX2 static void rick_axpy8_avx2(double *p,double *dp,int n,
+				      double *f,double *a,double *b,
+				      double *c,double *d)
+{
+  int l,k;
+  double *acc[4];
+  __m256d fd[4],fp[4],p0,dp0,x;
+  acc[0]=a;acc[1]=b;acc[2]=c;acc[3]=d;
+  for(k=0;k < 4;k++){
+    fd[k] = _mm256_set1_pd(f[k]);
+    fp[k] = _mm256_set1_pd(f[k+4]);
+  }
+  for(l=0;l+4 <= n;l+=4){
+    p0  = _mm256_loadu_pd(p+l);
+    dp0 = _mm256_loadu_pd(dp+l);
+    for(k=0;k < 4;k++){
+      x = _mm256_fmadd_pd(fd[k],dp0,_mm256_loadu_pd(acc[k]+l));
+      _mm256_storeu_pd(acc[k]+l,_mm256_fmadd_pd(fp[k],p0,x));
+    }
+  }
+  for(;l < n;l++)
+    for(k=0;k < 4;k++)
+      acc[k][l] += f[k] * dp[l] + f[k+4] * p[l];
+}
+/*
+
+   AVX-512 versions, eight doubles per register. the remainder is
+   handled with masked loads/stores
+
+*/
+#define RICK_AVX512 __attribute__((target("avx512f")))
+RICK_AVX512 static void rick_dot2_avx512(double *p,double *a,double *b,
+					 int n,double *s)
+{
+  int l;
+  __m512d sa,sb,p0;
+  __mmask8 mask;
+  sa = sb = _mm512_setzero_pd();
+  for(l=0;l+8 <= n;l+=8){
+    p0 = _mm512_loadu_pd(p+l);
+    sa = _mm512_fmadd_pd(_mm512_loadu_pd(a+l),p0,sa);
+    sb = _mm512_fmadd_pd(_mm512_loadu_pd(b+l),p0,sb);
+  }
+  if(l < n){
+    mask = (__mmask8)((1u << (n-l))-1);
+    p0 = _mm512_maskz_loadu_pd(mask,p+l);
+    sa = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask,a+l),p0,sa);
+    sb = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask,b+l),p0,sb);
+  }
+  s[0] = _mm512_reduce_add_pd(sa);
+  s[1] = _mm512_reduce_add_pd(sb);
+}
+RICK_AVX512 static void rick_dot8_avx512(double *p,double *dp,
+					 double *a,double *b,
+					 double *c,double *d,
+					 int n,double *s)
+{
+  int l,k;
+  __m512d acc[8],p0,dp0,x;
+  __mmask8 mask;
+  double *coef[4];
+  coef[0]=a;coef[1]=b;coef[2]=c;coef[3]=d;
+  for(k=0;k < 8;k++)
+    acc[k] = _mm512_setzero_pd();
+  for(l=0;l < n;l+=8){
+    mask = (n-l >= 8)?((__mmask8)0xff):((__mmask8)((1u << (n-l))-1));
+    p0  = _mm512_maskz_loadu_pd(mask,p+l);
+    dp0 = _mm512_maskz_loadu_pd(mask,dp+l);
+    for(k=0;k < 4;k++){
+      x = _mm512_maskz_loadu_pd(mask,coef[k]+l);
+      acc[k]   = _mm512_fmadd_pd(x,dp0,acc[k]);
+      acc[k+4] = _mm512_fmadd_pd(x,p0,acc[k+4]);
+    }
+  }
+  for(k=0;k < 8;k++)
+    s[k] = _mm512_reduce_add_pd(acc[k]);
+}
+RICK_AVX512 static void rick_dot10_avx512(double *p,double *dp,
+					  double *a,double *b,
+					  double *c,double *d,
+					  double *e,double *f,
+					  int n,double *s)
+{
+  int l,k;
+  __m512d acc[10],p0,dp0,x;
+  __mmask8 mask;
+  double *coef[4];
+  coef[0]=a;coef[1]=b;coef[2]=c;coef[3]=d;
+  for(k=0;k < 10;k++)
+    acc[k] = _mm512_setzero_pd();
+  for(l=0;l < n;l+=8){
+    mask = (n-l >= 8)?((__mmask8)0xff):((__mmask8)((1u << (n-l))-1));
+    p0  = _mm512_maskz_loadu_pd(mask,p+l);
+    dp0 = _mm512_maskz_loadu_pd(mask,dp+l);
+    for(k=0;k < 4;k++){
+      x = _mm512_maskz_loadu_pd(mask,coef[k]+l);
+      acc[k]   = _mm512_fmadd_pd(x,dp0,acc[k]);
+      acc[k+4] = _mm512_fmadd_pd(x,p0,acc[k+4]);
+    }
+    acc[8] = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask,e+l),p0,acc[8]);
+    acc[9] = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask,f+l),p0,acc[9]);
+  }
+  for(k=0;k < 10;k++)
+    s[k] = _mm512_reduce_add_pd(acc[k]);
+}
+RICK_AVX512 static void rick_axpy2_avx512(double *p,int n,double *f,
+					  double *a,double *b)
+{
+  int l;
+  __m512d fa,fb,p0;
+  __mmask8 mask;
+  fa = _mm512_set1_pd(f[0]);
+  fb = _mm512_set1_pd(f[1]);
+  for(l=0;l < n;l+=8){
+    mask = (n-l >= 8)?((__mmask8)0xff):((__mmask8)((1u << (n-l))-1));
+    p0 = _mm512_maskz_loadu_pd(mask,p+l);
+    _mm512_mask_storeu_pd(a+l,mask,_mm512_fmadd_pd(fa,p0,_mm512_maskz_loadu_pd(mask,a+l)));
+    _mm512_mask_storeu_pd(b+l,mask,_mm512_fmadd_pd(fb,p0,_mm512_maskz_loadu_pd(mask,b+l)));
+  }
+}
+RICK_AVX512 static void rick_axpy8_avx512(double *p,double *dp,int n,
+					  double *f,double *a,double *b,
+					  double *c,double *d)
+{
+  int l,k;
+  double *acc[4];
+  __m512d fd[4],fp[4],p0,dp0,x;
+  __mmask8 mask;
+  acc[0]=a;acc[1]=b;acc[2]=c;acc[3]=d;
+  for(k=0;k < 4;k++){
+    fd[k] = _mm512_set1_pd(f[k]);
+    fp[k] = _mm512_set1_pd(f[k+4]);
+  }
+  for(l=0;l < n;l+=8){
+    mask = (n-l >= 8)?((__mmask8)0xff):((__mmask8)((1u << (n-l))-1));
+    p0  = _mm512_maskz_loadu_pd(mask,p+l);
+    dp0 = _mm512_maskz_loadu_pd(mask,dp+l);
+    for(k=0;k < 4;k++){
+      x = _mm512_fmadd_pd(fd[k],dp0,_mm512_maskz_loadu_pd(mask,acc[k]+l));
+      _mm512_mask_storeu_pd(acc[k]+l,mask,_mm512_fmadd_pd(fp[k],p0,x));
+    }
+  }
+}
+#endif	/* end RICK_USE_X86_SIMD, double */
+
+#if defined(RICK_USE_X86_SIMD) && (SH_RICK_PRECISION == 8)
+/*
+
+   single precision AVX2/FMA versions of the dot kernels, eight
+   floats per register
+
+*/
+#define RICK_AVX2 __attribute__((target("avx2,fma")))
+RICK_AVX2 static float rick_hsum_avx2_ps(__m256 x)
+{
+  __m128 lo,hi;
+  lo = _mm256_castps256_ps128(x);
+  hi = _mm256_extractf128_ps(x,1);
+  lo = _mm_add_ps(lo,hi);
+  hi = _mm_movehl_ps(lo,lo);
+  lo = _mm_add_ps(lo,hi);
+  hi = _mm_shuffle_ps(lo,lo,1);
+  return _mm_cvtss_f32(_mm_add_ss(lo,hi));
+}
+RICK_AVX2 static void rick_dot2_avx2_ps(float *p,float *a,float *b,
+					int n,float *s)
+{
+  int l;
+  __m256 sa,sb,p0;
+  sa = sb = _mm256_setzero_ps();
+  for(l=0;l+8 <= n;l+=8){
+    p0 = _mm256_loadu_ps(p+l);
+    sa = _mm256_fmadd_ps(_mm256_loadu_ps(a+l),p0,sa);
+    sb = _mm256_fmadd_ps(_mm256_loadu_ps(b+l),p0,sb);
+  }
+  s[0] = rick_hsum_avx2_ps(sa);
+  s[1] = rick_hsum_avx2_ps(sb);
+  for(;l < n;l++){
+    s[0] += a[l] * p[l];
+    s[1] += b[l] * p[l];
+  }
+}
+RICK_AVX2 static void rick_dot10_avx2_ps(float *p,float *dp,
+					 float *a,float *b,
+					 float *c,float *d,
+					 float *e,float *f,
+					 int n,float *s)
+{
+  int l,k;
+  __m256 acc[10],p0,dp0,x;
+  float *coef[4];
+  coef[0]=a;coef[1]=b;coef[2]=c;coef[3]=d;
+  for(k=0;k < 10;k++)
+    acc[k] = _mm256_setzero_ps();
+  for(l=0;l+8 <= n;l+=8){
+    p0  = _mm256_loadu_ps(p+l);
+    dp0 = _mm256_loadu_ps(dp+l);
+    for(k=0;k < 4;k++){
+      x = _mm256_loadu_ps(coef[k]+l);
+      acc[k]   = _mm256_fmadd_ps(x,dp0,acc[k]);
+      acc[k+4] = _mm256_fmadd_ps(x,p0,acc[k+4]);
+    }
+    if(e){
+      acc[8] = _mm256_fmadd_ps(_mm256_loadu_ps(e+l),p0,acc[8]);
+      acc[9] = _mm256_fmadd_ps(_mm256_loadu_ps(f+l),p0,acc[9]);
+    }
+  }
+  for(k=0;k < 10;k++)
+    s[k] = rick_hsum_avx2_ps(acc[k]);
+  for(;l < n;l++){
+    for(k=0;k < 4;k++){
+      s[k]   += coef[k][l] * dp[l];
+      s[k+4] += coef[k][l] * p[l];
+    }
+    if(e){
+      s[8] += e[l] * p[l];
+      s[9] += f[l] * p[l];
+    }
+  }
+}
+/* dot8 is dot10 without the e, f terms */
+RICK_AVX2 static void rick_dot8_avx2_ps(float *p,float *dp,
+					float *a,float *b,
+					float *c,float *d,
+					int n,float *s)
+{
+  float s10[10];
+  int k;
+  rick_dot10_avx2_ps(p,dp,a,b,c,d,NULL,NULL,n,s10);
+  for(k=0;k < 8;k++)
+    s[k] = s10[k];
+}
+/* 
+   axpy with single precision Legendre functions and double
+   accumulators, four per register
+*/
+RICK_AVX2 static void rick_axpy2_avx2_ps(float *p,int n,double *f,
+					 double *a,double *b)
+{
+  int l;
+  __m256d fa,fb,p0;
+  fa = _mm256_set1_pd(f[0]);
+  fb = _mm256_set1_pd(f[1]);
+  for(l=0;l+4 <= n;l+=4){
+    p0 = _mm256_cvtps_pd(_mm_loadu_ps(p+l));
+    _mm256_storeu_pd(a+l,_mm256_fmadd_pd(fa,p0,_mm256_loadu_pd(a+l)));
+    _mm256_storeu_pd(b+l,_mm256_fmadd_pd(fb,p0,_mm256_loadu_pd(b+l)));
+  }
+  for(;l < n;l++){
+    a[l] += f[0] * (double)p[l];
+    b[l] += f[1] * (double)p[l];
+  }
+}
+RICK_AVX2 static void rick_axpy8_avx2_ps(float *p,float *dp,int n,
+					 double *f,double *a,double *b,
+					 double *c,double *d)
+{
+  int l,k;
+  double *acc[4];
+  __m256d fd[4],fp[4],p0,dp0,x;
+  acc[0]=a;acc[1]=b;acc[2]=c;acc[3]=d;
+  for(k=0;k < 4;k++){
+    fd[k] = _mm256_set1_pd(f[k]);
+    fp[k] = _mm256_set1_pd(f[k+4]);
+  }
+  for(l=0;l+4 <= n;l+=4){
+    p0  = _mm256_cvtps_pd(_mm_loadu_ps(p+l));
+    dp0 = _mm256_cvtps_pd(_mm_loadu_ps(dp+l));
+    for(k=0;k < 4;k++){
+      x = _mm256_fmadd_pd(fd[k],dp0,_mm256_loadu_pd(acc[k]+l));
+      _mm256_storeu_pd(acc[k]+l,_mm256_fmadd_pd(fp[k],p0,x));
+    }
+  }
+  for(;l < n;l++)
+    for(k=0;k < 4;k++)
+      acc[k][l] += f[k] * (double)dp[l] + f[k+4] * (double)p[l];
+}
+/*
+
+   single precision AVX-512 versions, sixteen floats per register
+
+*/
+#define RICK_AVX512 __attribute__((target("avx512f")))
+RICK_AVX512 static void rick_dot2_avx512_ps(float *p,float *a,float *b,
+					    int n,float *s)
+{
+  int l;
+  __m512 sa,sb,p0;
+  __mmask16 mask;
+  sa = sb = _mm512_setzero_ps();
+  for(l=0;l < n;l+=16){
+    mask = (n-l >= 16)?((__mmask16)0xffff):((__mmask16)((1u << (n-l))-1));
+    p0 = _mm512_maskz_loadu_ps(mask,p+l);
+    sa = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask,a+l),p0,sa);
+    sb = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask,b+l),p0,sb);
+  }
+  s[0] = _mm512_reduce_add_ps(sa);
+  s[1] = _mm512_reduce_add_ps(sb);
+}
+RICK_AVX512 static void rick_dot10_avx512_ps(float *p,float *dp,
+					     float *a,float *b,
+					     float *c,float *d,
+					     float *e,float *f,
+					     int n,float *s)
+{
+  int l,k;
+  __m512 acc[10],p0,dp0,x;
+  __mmask16 mask;
+  float *coef[4];
+  coef[0]=a;coef[1]=b;coef[2]=c;coef[3]=d;
+  for(k=0;k < 10;k++)
+    acc[k] = _mm512_setzero_ps();
+  for(l=0;l < n;l+=16){
+    mask = (n-l >= 16)?((__mmask16)0xffff):((__mmask16)((1u << (n-l))-1));
+    p0  = _mm512_maskz_loadu_ps(mask,p+l);
+    dp0 = _mm512_maskz_loadu_ps(mask,dp+l);
+    for(k=0;k < 4;k++){
+      x = _mm512_maskz_loadu_ps(mask,coef[k]+l);
+      acc[k]   = _mm512_fmadd_ps(x,dp0,acc[k]);
+      acc[k+4] = _mm512_fmadd_ps(x,p0,acc[k+4]);
+    }
+    if(e){
+      acc[8] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask,e+l),p0,acc[8]);
+      acc[9] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask,f+l),p0,acc[9]);
+    }
+  }
+  for(k=0;k < 10;k++)
+    s[k] = _mm512_reduce_add_ps(acc[k]);
+}
+RICK_AVX512 static void rick_dot8_avx512_ps(float *p,float *dp,
+					    float *a,float *b,
+					    float *c,float *d,
+					    int n,float *s)
+{
+  float s10[10];
+  int k;
+  rick_dot10_avx512_ps(p,dp,a,b,c,d,NULL,NULL,n,s10);
+  for(k=0;k < 8;k++)
+    s[k] = s10[k];
+}
+/* 
+   axpy with single precision Legendre functions and double
+   accumulators, eight per register
+*/
+RICK_AVX512 static void rick_axpy2_avx512_ps(float *p,int n,double *f,
+					     double *a,double *b)
+{
+  int l;
+  __m512d fa,fb,p0;
+  fa = _mm512_set1_pd(f[0]);
+  fb = _mm512_set1_pd(f[1]);
+  for(l=0;l+8 <= n;l+=8){
+    p0 = _mm512_cvtps_pd(_mm256_loadu_ps(p+l));
+    _mm512_storeu_pd(a+l,_mm512_fmadd_pd(fa,p0,_mm512_loadu_pd(a+l)));
+    _mm512_storeu_pd(b+l,_mm512_fmadd_pd(fb,p0,_mm512_loadu_pd(b+l)));
+  }
+  for(;l < n;l++){
+    a[l] += f[0] * (double)p[l];
+    b[l] += f[1] * (double)p[l];
+  }
+}
+RICK_AVX512 static void rick_axpy8_avx512_ps(float *p,float *dp,int n,
+					     double *f,double *a,double *b,
+					     double *c,double *d)
+{
+  int l,k;
+  double *acc[4];
+  __m512d fd[4],fp[4],p0,dp0,x;
+  acc[0]=a;acc[1]=b;acc[2]=c;acc[3]=d;
+  for(k=0;k < 4;k++){
+    fd[k] = _mm512_set1_pd(f[k]);
+    fp[k] = _mm512_set1_pd(f[k+4]);
+  }
+  for(l=0;l+8 <= n;l+=8){
+    p0  = _mm512_cvtps_pd(_mm256_loadu_ps(p+l));
+    dp0 = _mm512_cvtps_pd(_mm256_loadu_ps(dp+l));
+    for(k=0;k < 4;k++){
+      x = _mm512_fmadd_pd(fd[k],dp0,_mm512_loadu_pd(acc[k]+l));
+      _mm512_storeu_pd(acc[k]+l,_mm512_fmadd_pd(fp[k],p0,x));
+    }
+  }
+  for(;l < n;l++)
+    for(k=0;k < 4;k++)
+      acc[k][l] += f[k] * (double)dp[l] + f[k+4] * (double)p[l];
+}
+#endif	/* end RICK_USE_X86_SIMD, single */
+
+/*
+
+   select the kernels according to what the CPU can do. this is only
+   done once per process, and it's fine if several threads end up
+   doing it since they all will pick the same
+
+*/
+struct rick_kernels *rick_get_kernels(void)
+{
+  static struct rick_kernels kern;
+  static my_boolean init = FALSE;
+  if(!init){
+    kern.dot2  = rick_dot2_generic;
+    kern.dot8  = rick_dot8_generic;
+    kern.dot10 = rick_dot10_generic;
+    kern.axpy2 = rick_axpy2_generic;
+    kern.axpy8 = rick_axpy8_generic;
+    kern.type  = RICK_KERNEL_GENERIC;
+#if defined(RICK_USE_X86_SIMD) && (SH_RICK_PRECISION == 16)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+      kern.dot2  = rick_dot2_avx512;
+      kern.dot8  = rick_dot8_avx512;
+      kern.dot10 = rick_dot10_avx512;
+      kern.axpy2 = rick_axpy2_avx512;
+      kern.axpy8 = rick_axpy8_avx512;
+      kern.type  = RICK_KERNEL_AVX512;
+    }else if(__builtin_cpu_supports("avx2") &&
+	     __builtin_cpu_supports("fma")){
+      kern.dot2  = rick_dot2_avx2;
+      kern.dot8  = rick_dot8_avx2;
+      kern.dot10 = rick_dot10_avx2;
+      kern.axpy2 = rick_axpy2_avx2;
+      kern.axpy8 = rick_axpy8_avx2;
+      kern.type  = RICK_KERNEL_AVX2;
+    }
+#elif defined(RICK_USE_X86_SIMD) && (SH_RICK_PRECISION == 8)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+      kern.dot2  = rick_dot2_avx512_ps;
+      kern.dot8  = rick_dot8_avx512_ps;
+      kern.dot10 = rick_dot10_avx512_ps;
+      kern.axpy2 = rick_axpy2_avx512_ps;
+      kern.axpy8 = rick_axpy8_avx512_ps;
+      kern.type  = RICK_KERNEL_AVX512;
+    }else if(__builtin_cpu_supports("avx2") &&
+	     __builtin_cpu_supports("fma")){
+      kern.dot2  = rick_dot2_avx2_ps;
+      kern.dot8  = rick_dot8_avx2_ps;
+      kern.dot10 = rick_dot10_avx2_ps;
+      kern.axpy2 = rick_axpy2_avx2_ps;
+      kern.axpy8 = rick_axpy8_avx2_ps;
+      kern.type  = RICK_KERNEL_AVX2;
+    }
+#endif
+    init = TRUE;
+  }
+  return &kern;
+}
+/* name of the kernel type, for verbose output */
+char *rick_kernel_name(int type)
+{
+  switch(type){
+  case RICK_KERNEL_AVX2:
+    return("AVX2/FMA");
+  case RICK_KERNEL_AVX512:
+    return("AVX-512");
+  default:
+    return("generic");
+  }
+}
+/*
+
+   reorder the (l,m) tightly packed A, B coefficients cslm[lmsize2]
+   into m-major arrays a[lmsize], b[lmsize]
+
+   if vector is set, the coefficients will be scaled by 1/sqrt(l(l+1))
+   (ell_factor) as needed for the poloidal/toroidal transforms, and the
+   l=0 term set to zero
+
+*/
+void rick_lm2mm(SH_RICK_PREC *cslm,SH_RICK_PREC *a,SH_RICK_PREC *b,
+		int lmax,my_boolean vector,struct rick_module *rick)
+{
+  int l,m,j,k;
+  SH_RICK_PREC fac;
+  for(k=m=0;m <= lmax;m++){
+    for(l=m;l <= lmax;l++,k++){
+      j = (l+1)*l/2 + m;
+      if(vector)
+	fac = (l)?(rick->ell_factor[l-1]):(0.0);
+      else
+	fac = 1.0;
+      a[k] = cslm[j*2]   * fac;
+      b[k] = cslm[j*2+1] * fac;
+    }
+  }
+}
+/*
+
+   inverse of the above: assign the m-major accumulators a[], b[],
+   which are at higher precision, to cslm[lmsize2], with the same
+   scaling
+
+*/
+void rick_mm2lm(SH_RICK_HIGH_PREC *a,SH_RICK_HIGH_PREC *b,SH_RICK_PREC *cslm,
+		int lmax,my_boolean vector,struct rick_module *rick)
+{
+  int l,m,j,k;
+  SH_RICK_HIGH_PREC fac;
+  for(k=m=0;m <= lmax;m++){
+    for(l=m;l <= lmax;l++,k++){
+      j = (l+1)*l/2 + m;
+      if(vector)
+	fac = (l)?(rick->ell_factor[l-1]):(0.0);
+      else
+	fac = 1.0;
+      cslm[j*2]   = a[k] * fac;
+      cslm[j*2+1] = b[k] * fac;
+    }
+  }
+}
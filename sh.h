@@ -9,10 +9,14 @@
 #endif
 /* 
    
-same for Rick's spherical harmonic routines
+same for Rick's spherical harmonic routines. those follow the overall
+precision unless SH_RICK_PRECISION is set separately, e.g. to 8 for
+the single precision transform library
 
 */
+#ifndef SH_RICK_PRECISION
 #define SH_RICK_PRECISION  HC_PRECISION
+#endif
 
 #include "sh_rick.h"
 /* 
@@ -32,6 +36,7 @@ shana
 				*/
 
 
+struct sh_container;		/* see below */
 /* 
 
  my spherical harmonics structures
@@ -100,6 +105,23 @@ struct sh_lms{
      for Rick type 
   */
   SH_RICK_PREC *alm;
+  /* 
+     the coefficients are either owned by this expansion
+     (SH_ALM_OWN), or part of a block of expansions, see
+     sh_init_expansion_block. the first expansion of a block holds
+     the whole block (SH_ALM_BLOCK_HEAD) and knows its size. views
+     into a memory mapped container file (SH_ALM_VIEW) hold a
+     reference to the container instead
+  */
+  int alm_mode;
+  int block_n;			/* number of expansions in block */
+  size_t block_stride;		/* alm(i+1) - alm(i) within the block */
+  struct sh_container *container;
+  /* 
+     factors to Dahlen & Tromp normalization for m = 0...lmax, shared
+     between expansions, see sh_phys_norm_table
+  */
+  HC_CPREC *phys_fac;
   struct rick_module rick;
 };
 /* 
@@ -153,6 +175,80 @@ struct sh_lms_model{
 
 */
 #define LM_INDEX(l,m,a_or_b) ((((l)+1)*(l)/2+(m))*2+(a_or_b))
+/* 
+
+ per-degree slices of SH_RICK coefficient arrays: all A and B of
+ degree l are contiguous, starting at LM_INDEX(l,0,0). within a slice
+ as returned by sh_lslice, A(l,m) is at [SH_LSLICE_STRIDE*m] and
+ B(l,m) at [SH_LSLICE_STRIDE*m+1], 2(l+1) values in all. 
+
+ SH_LSLICE does the same as sh_lslice without any checks, for inner
+ loops where the type has been tested
+
+*/
+#define SH_LSLICE_STRIDE 2
+/* storage modes of the coefficients, see struct sh_lms */
+#define SH_ALM_OWN 0
+#define SH_ALM_BLOCK_HEAD 1
+#define SH_ALM_BLOCK 2
+#define SH_ALM_VIEW 3
+#define SH_LSLICE(exp,l) ((exp)->alm + LM_INDEX(l,0,0))
+/* 
+   process-wide cache of conversion factors to Dahlen & Tromp
+   normalization, one for each lmax, see sh_phys_norm_table
+*/
+struct sh_phys_norm{
+  int lmax;
+  HC_CPREC *fac;
+  struct sh_phys_norm *next;
+};
+/* 
+
+   binary container for a set of layers of expansions, see
+   sh_container.c. the header is followed by the layer index, and the
+   coefficient blocks of all layers, each aligned to
+   SH_CONTAINER_ALIGN bytes. all numbers are little endian
+
+*/
+/* 
+   kind of a set of expansions: scalar, or r/pol/tor vector, or the
+   horizontal stress tensor of hc_sum for HC_HTRACTIONS, with the
+   isotropic part and the pol/tor velocity potentials. the latter is
+   marked by a negative shps in the parameter line, and by kind in
+   the container header
+*/
+#define SH_SET_VECTOR 0
+#define SH_SET_HTENSOR 1
+#define SH_CONTAINER_MAGIC "HCSHCONT"
+#define SH_CONTAINER_VERSION 1
+#define SH_CONTAINER_HDR 128	/* header bytes */
+#define SH_CONTAINER_ALIGN 64	/* alignment of coefficient blocks */
+struct sh_container_header{
+  char magic[8];
+  int version,byte_order,prec,nset,shps,type;
+  long long index_offset;	/* start of the layer index */
+  long long size;		/* total file size */
+  unsigned long long checksum;	/* of the layer index */
+  int kind,pad;			/* SH_SET_VECTOR or SH_SET_HTENSOR */
+};
+struct sh_container_layer{
+  double zlabel;		/* depth label */
+  int lmax,shps,type,pad;
+  long long offset;		/* start of the coefficient block */
+  long long stride;		/* values from one expansion to the next */
+  unsigned long long checksum;	/* of the coefficient block */
+};
+struct sh_container{
+  struct sh_container_header h;
+  struct sh_container_layer *layer; /* index, h.nset entries */
+  unsigned char *map;		/* file mapping when reading */
+  size_t map_size;
+  my_boolean *checked;		/* layer checksum verified */
+  my_boolean zero_copy;		/* coefficients can be used in place */
+  int nref;			/* open handle plus expansion views */
+  FILE *out;			/* when writing */
+  int nwritten;
+};
 
 #define __SH_HEADER_READ__
 #endif
@@ -0,0 +1,435 @@
+#include "hc.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+/*
+
+   versioned binary container for a set of layers of spherical
+   harmonic expansions, e.g. a solution or a density model
+
+   file layout: a struct sh_container_header (padded to
+   SH_CONTAINER_HDR bytes), the layer index of nset struct
+   sh_container_layer entries (depth label, lmax, shps, type, offset
+   and checksum of the coefficients), and the coefficient blocks. a
+   block holds the shps expansions of one layer in the internal
+   SH_RICK layout (see LM_INDEX), as 4 or 8 byte floats, each
+   expansion starting at a SH_CONTAINER_ALIGN byte boundary. all
+   numbers are little endian
+
+   the header checksum covers the index, and each layer has its own
+   checksum, which is verified when the layer is first used. single
+   layers can thus be accessed without reading the whole file
+
+   for reading, the file gets memory-mapped. if precision and byte
+   order match, sh_container_view_layer sets up expansions whose
+   coefficients point into the mapping (SH_ALM_VIEW), without any
+   copy. the mapping is private, so those may be modified, and is
+   released once the container is closed and all views are freed
+
+   hc_read_sh_solution and hc_assign_density detect containers
+   automatically
+
+*/
+
+/*
+   convert n items of size len from or to little endian
+*/
+void sh_container_le(void *x,size_t len,int n)
+{
+  int i;
+  if(hc_is_little_endian())
+    return;
+  for(i=0;i < n;i++)
+    hc_flip_byte_order((void *)((char *)x + (size_t)i*len),len);
+}
+void sh_container_le_header(struct sh_container_header *h)
+{
+  sh_container_le(&h->version,sizeof(int),6);
+  sh_container_le(&h->index_offset,sizeof(long long),2);
+  sh_container_le(&h->checksum,sizeof(unsigned long long),1);
+  sh_container_le(&h->kind,sizeof(int),2);
+}
+void sh_container_le_index(struct sh_container_layer *layer,int n)
+{
+  int i;
+  for(i=0;i < n;i++){
+    sh_container_le(&layer[i].zlabel,sizeof(double),1);
+    sh_container_le(&layer[i].lmax,sizeof(int),4);
+    sh_container_le(&layer[i].offset,sizeof(long long),2);
+    sh_container_le(&layer[i].checksum,sizeof(unsigned long long),1);
+  }
+}
+/*
+   number of values from one expansion of a block to the next
+*/
+long long sh_container_stride(int lmax,int prec)
+{
+  long long n,nalign;
+  n = (long long)(lmax+1)*(long long)(lmax+2);
+  nalign = SH_CONTAINER_ALIGN/prec;
+  return ((n + nalign - 1)/nalign)*nalign;
+}
+/*
+   check if the stream is positioned at the start of a container,
+   without changing the position. returns FALSE for streams that
+   cannot seek
+*/
+hc_boolean sh_container_detect(FILE *in)
+{
+  char magic[8];
+  long pos;
+  size_t n;
+  if((pos = ftell(in)) < 0)
+    return FALSE;
+  n = fread(magic,1,8,in);
+  fseek(in,pos,SEEK_SET);
+  if((n == 8) && (memcmp(magic,SH_CONTAINER_MAGIC,8) == 0))
+    return TRUE;
+  return FALSE;
+}
+/*
+
+   start writing a container with nset layers of shps expansions to
+   out, which has to be a newly opened, seekable file. prec is 4 or 8,
+   the bytes per coefficient. layers get added with
+   sh_container_write_layer, and sh_container_close writes the index
+
+*/
+struct sh_container *sh_container_create(FILE *out,int nset,int shps,
+					 int prec)
+{
+  struct sh_container *c;
+  long long i;
+  if((prec != 4)&&(prec != 8)){
+    fprintf(stderr,"sh_container_create: error: precision %i undefined\n",prec);
+    exit(-1);
+  }
+  if((nset < 1)||(shps < 1)){
+    fprintf(stderr,"sh_container_create: error: nset %i shps %i\n",nset,shps);
+    exit(-1);
+  }
+  if(ftell(out) != 0)
+    HC_ERROR("sh_container_create","need to write to the start of a seekable file");
+  c = (struct sh_container *)calloc(1,sizeof(struct sh_container));
+  if(!c)
+    HC_MEMERROR("sh_container_create");
+  c->layer = (struct sh_container_layer *)calloc(nset,sizeof(struct sh_container_layer));
+  if(!c->layer)
+    HC_MEMERROR("sh_container_create");
+  memcpy(c->h.magic,SH_CONTAINER_MAGIC,8);
+  c->h.version = SH_CONTAINER_VERSION;
+  c->h.byte_order = 0x01020304;
+  c->h.prec = prec;
+  c->h.nset = nset;
+  c->h.shps = shps;
+  c->h.type = SH_RICK;
+  c->h.kind = SH_SET_VECTOR;	/* can be changed before closing */
+  c->h.index_offset = SH_CONTAINER_HDR;
+  /*
+     placeholders for header and index, the first block starts
+     aligned after those
+  */
+  c->h.size = SH_CONTAINER_HDR + (long long)nset * (long long)sizeof(struct sh_container_layer);
+  c->h.size = ((c->h.size + SH_CONTAINER_ALIGN - 1)/SH_CONTAINER_ALIGN)*SH_CONTAINER_ALIGN;
+  for(i=0;i < c->h.size;i++)
+    fputc(0,out);
+  c->out = out;
+  c->nwritten = 0;
+  c->nref = 1;
+  return c;
+}
+/*
+
+   append layer ilayer, which has to follow the previous one, with
+   expansions exp[shps] and depth label zlabel. the coefficients are
+   scaled by fac[shps], if fac is not NULL
+
+*/
+void sh_container_write_layer(struct sh_container *c,struct sh_lms *exp,
+			      int shps,int ilayer,HC_CPREC zlabel,
+			      HC_CPREC *fac)
+{
+  struct sh_container_layer *l;
+  unsigned char *buf;
+  double *dbuf;
+  float *fbuf;
+  long long stride,i,n;
+  size_t bytes;
+  int j;
+  HC_CPREC f;
+  if(!c->out)
+    HC_ERROR("sh_container_write_layer","container not open for writing");
+  if((ilayer != c->nwritten)||(ilayer >= c->h.nset)||(shps != c->h.shps)){
+    fprintf(stderr,"sh_container_write_layer: error: layer %i (%i written, nset %i), shps %i (%i)\n",
+	    ilayer,c->nwritten,c->h.nset,shps,c->h.shps);
+    exit(-1);
+  }
+  for(j=0;j < shps;j++)
+    if((exp[j].type != SH_RICK)||(exp[j].lmax != exp[0].lmax))
+      HC_ERROR("sh_container_write_layer","need SH_RICK expansions of same lmax");
+  stride = sh_container_stride(exp[0].lmax,c->h.prec);
+  n = exp[0].n_lm;
+  bytes = (size_t)shps * (size_t)stride * (size_t)c->h.prec;
+  buf = (unsigned char *)calloc(bytes,1);
+  if(!buf)
+    HC_MEMERROR("sh_container_write_layer");
+  dbuf = (double *)buf;fbuf = (float *)buf;
+  for(j=0;j < shps;j++){
+    f = (fac)?(fac[j]):(1.0);
+    if(c->h.prec == 8)
+      for(i=0;i < n;i++)
+	dbuf[j*stride+i] = (double)(exp[j].alm[i] * f);
+    else
+      for(i=0;i < n;i++)
+	fbuf[j*stride+i] = (float)(exp[j].alm[i] * f);
+  }
+  sh_container_le(buf,c->h.prec,(int)(bytes/c->h.prec));
+  l = c->layer + ilayer;
+  l->zlabel = (double)zlabel;
+  l->lmax = exp[0].lmax;
+  l->shps = shps;
+  l->type = SH_RICK;
+  l->offset = c->h.size;
+  l->stride = stride;
+  l->checksum = rick_plm_cache_checksum(RICK_PLM_CACHE_CHECKSUM_INIT,buf,bytes);
+  if(fwrite(buf,1,bytes,c->out) != bytes)
+    HC_ERROR("sh_container_write_layer","write error");
+  free(buf);
+  c->h.size += (long long)bytes;
+  c->nwritten++;
+}
+/*
+
+   open a container from a stream positioned at its start, as checked
+   with sh_container_detect. the stream can be closed afterwards
+
+*/
+struct sh_container *sh_container_open(FILE *in,hc_boolean verbose)
+{
+  struct sh_container *c;
+  struct stat st;
+  struct sh_container_layer *l;
+  size_t isize;
+  long long bytes;
+  int i;
+  void *p;
+  if((fstat(fileno(in),&st) != 0)||(st.st_size < SH_CONTAINER_HDR))
+    HC_ERROR("sh_container_open","cannot determine size, or file too small");
+  p = mmap(NULL,(size_t)st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fileno(in),0);
+  if(p == MAP_FAILED)
+    HC_ERROR("sh_container_open","mmap failed");
+  c = (struct sh_container *)calloc(1,sizeof(struct sh_container));
+  if(!c)
+    HC_MEMERROR("sh_container_open");
+  c->map = (unsigned char *)p;
+  c->map_size = (size_t)st.st_size;
+  memcpy(&c->h,c->map,sizeof(struct sh_container_header));
+  sh_container_le_header(&c->h);
+  /*
+     test header
+  */
+  if((memcmp(c->h.magic,SH_CONTAINER_MAGIC,8) != 0)||
+     (c->h.version != SH_CONTAINER_VERSION)||(c->h.byte_order != 0x01020304)){
+    fprintf(stderr,"sh_container_open: error: not a version %i container\n",
+	    SH_CONTAINER_VERSION);
+    exit(-1);
+  }
+  isize = (size_t)c->h.nset * sizeof(struct sh_container_layer);
+  if(((c->h.prec != 4)&&(c->h.prec != 8))||(c->h.nset < 1)||(c->h.shps < 1)||
+     ((c->h.kind != SH_SET_VECTOR)&&(c->h.kind != SH_SET_HTENSOR))||
+     (c->h.size != (long long)c->map_size)||(c->h.index_offset < SH_CONTAINER_HDR)||
+     (c->h.index_offset + (long long)isize > c->h.size)){
+    fprintf(stderr,"sh_container_open: error: header: prec %i nset %i shps %i size %lli (file: %lli)\n",
+	    c->h.prec,c->h.nset,c->h.shps,c->h.size,(long long)c->map_size);
+    exit(-1);
+  }
+  if(rick_plm_cache_checksum(RICK_PLM_CACHE_CHECKSUM_INIT,c->map+c->h.index_offset,isize) !=
+     c->h.checksum)
+    HC_ERROR("sh_container_open","index checksum mismatch");
+  /*
+     layer index
+  */
+  c->layer = (struct sh_container_layer *)malloc(isize);
+  c->checked = (my_boolean *)calloc(c->h.nset,sizeof(my_boolean));
+  if(!c->layer || !c->checked)
+    HC_MEMERROR("sh_container_open");
+  memcpy(c->layer,c->map+c->h.index_offset,isize);
+  sh_container_le_index(c->layer,c->h.nset);
+  for(i=0;i < c->h.nset;i++){
+    l = c->layer + i;
+    bytes = (long long)l->shps * l->stride * c->h.prec;
+    if((l->lmax < 1)||(l->shps != c->h.shps)||(l->type != SH_RICK)||
+       (l->offset % SH_CONTAINER_ALIGN)||(l->stride < (long long)(l->lmax+1)*(l->lmax+2))||
+       (l->offset < c->h.index_offset + (long long)isize)||(l->offset + bytes > c->h.size)){
+      fprintf(stderr,"sh_container_open: error: index entry %i: lmax %i shps %i type %i offset %lli\n",
+	      i+1,l->lmax,l->shps,l->type,l->offset);
+      exit(-1);
+    }
+  }
+  /* can we use the coefficients in place? */
+  c->zero_copy = (hc_is_little_endian() && (c->h.prec == (int)sizeof(SH_RICK_PREC)));
+  c->nref = 1;
+  c->out = NULL;
+  if(verbose)
+    fprintf(stderr,"sh_container_open: %i layers of %i expansions%s, lmax %i, %i byte floats, %s\n",
+	    c->h.nset,c->h.shps,(c->h.kind == SH_SET_HTENSOR)?(" (stress tensor)"):(""),
+	    c->layer[0].lmax,c->h.prec,(c->zero_copy)?("in place"):("converting"));
+  return c;
+}
+/*
+   verify the checksum of a layer once
+*/
+void sh_container_check_layer(struct sh_container *c,int ilayer)
+{
+  struct sh_container_layer *l;
+  if((ilayer < 0)||(ilayer >= c->h.nset)||(!c->map)){
+    fprintf(stderr,"sh_container_check_layer: error: layer %i out of range (nset %i)\n",
+	    ilayer+1,c->h.nset);
+    exit(-1);
+  }
+  if(c->checked[ilayer])
+    return;
+  l = c->layer + ilayer;
+  if(rick_plm_cache_checksum(RICK_PLM_CACHE_CHECKSUM_INIT,c->map + l->offset,
+			     (size_t)l->shps * (size_t)l->stride * (size_t)c->h.prec) !=
+     l->checksum){
+    fprintf(stderr,"sh_container_check_layer: error: checksum mismatch in layer %i\n",
+	    ilayer+1);
+    exit(-1);
+  }
+  c->checked[ilayer] = TRUE;
+}
+/*
+
+   initialize exp[shps] with the expansions of layer ilayer, with the
+   coefficients in place if possible, else as a copy
+
+*/
+void sh_container_view_layer(struct sh_container *c,int ilayer,
+			     struct sh_lms *exp,int ivec,
+			     hc_boolean verbose)
+{
+  struct sh_container_layer *l;
+  int j;
+  sh_container_check_layer(c,ilayer);
+  l = c->layer + ilayer;
+  if(!c->zero_copy){
+    for(j=0;j < l->shps;j++)
+      sh_init_expansion((exp+j),l->lmax,l->type,ivec,verbose,FALSE);
+    sh_container_copy_layer(c,ilayer,exp,NULL);
+    return;
+  }
+  for(j=0;j < l->shps;j++){
+    sh_init_expansion_alm((exp+j),l->lmax,l->type,ivec,verbose,FALSE,
+			  ((SH_RICK_PREC *)(c->map + l->offset) + (size_t)j*(size_t)l->stride),
+			  SH_ALM_VIEW);
+    exp[j].container = c;
+    exp[j].spectral_init = TRUE;
+    c->nref++;
+  }
+}
+/*
+
+   copy the coefficients of layer ilayer to the initialized expansions
+   exp[shps], scaled by fac[shps] unless NULL. exp may have a larger
+   lmax than the layer, those coefficients are set to zero
+
+*/
+void sh_container_copy_layer(struct sh_container *c,int ilayer,
+			     struct sh_lms *exp,HC_CPREC *fac)
+{
+  struct sh_container_layer *l;
+  unsigned char *src;
+  double dv;
+  float fv;
+  HC_CPREC f;
+  int j,i,n;
+  sh_container_check_layer(c,ilayer);
+  l = c->layer + ilayer;
+  n = (l->lmax+1)*(l->lmax+2);
+  for(j=0;j < l->shps;j++){
+    if((exp[j].type != SH_RICK)||(exp[j].lmax < l->lmax)){
+      fprintf(stderr,"sh_container_copy_layer: error: expansion %i type %i lmax %i, layer %i has lmax %i\n",
+	      j+1,exp[j].type,exp[j].lmax,ilayer+1,l->lmax);
+      exit(-1);
+    }
+    f = (fac)?(fac[j]):(1.0);
+    src = c->map + l->offset + (size_t)j*(size_t)l->stride*(size_t)c->h.prec;
+    if(c->zero_copy && (f == 1.0)){
+      memcpy(exp[j].alm,src,(size_t)n*sizeof(SH_RICK_PREC));
+    }else if(c->h.prec == 8){
+      for(i=0;i < n;i++){
+	memcpy(&dv,src+(size_t)i*8,8);
+	sh_container_le(&dv,8,1);
+	exp[j].alm[i] = (SH_RICK_PREC)(dv * f);
+      }
+    }else{
+      for(i=0;i < n;i++){
+	memcpy(&fv,src+(size_t)i*4,4);
+	sh_container_le(&fv,4,1);
+	exp[j].alm[i] = (SH_RICK_PREC)(fv * f);
+      }
+    }
+    for(i=n;i < exp[j].n_lm;i++)
+      exp[j].alm[i] = 0.0;
+    exp[j].spectral_init = TRUE;
+  }
+}
+/*
+
+   finish writing, or close a container opened for reading. the
+   mapping remains valid until all views have been freed
+
+*/
+void sh_container_close(struct sh_container *c)
+{
+  struct sh_container_header h;
+  struct sh_container_layer *index;
+  unsigned char hbuf[SH_CONTAINER_HDR];
+  size_t isize;
+  if(c->out){
+    if(c->nwritten != c->h.nset){
+      fprintf(stderr,"sh_container_close: error: wrote %i out of %i layers\n",
+	      c->nwritten,c->h.nset);
+      exit(-1);
+    }
+    /* index and its checksum, as stored */
+    isize = (size_t)c->h.nset * sizeof(struct sh_container_layer);
+    index = (struct sh_container_layer *)malloc(isize);
+    if(!index)
+      HC_MEMERROR("sh_container_close");
+    memcpy(index,c->layer,isize);
+    sh_container_le_index(index,c->h.nset);
+    c->h.checksum = rick_plm_cache_checksum(RICK_PLM_CACHE_CHECKSUM_INIT,
+					    (unsigned char *)index,isize);
+    h = c->h;
+    sh_container_le_header(&h);
+    memset(hbuf,0,SH_CONTAINER_HDR);
+    memcpy(hbuf,&h,sizeof(struct sh_container_header));
+    if((fseek(c->out,0,SEEK_SET) != 0)||
+       (fwrite(hbuf,1,SH_CONTAINER_HDR,c->out) != SH_CONTAINER_HDR)||
+       (fseek(c->out,c->h.index_offset,SEEK_SET) != 0)||
+       (fwrite(index,1,isize,c->out) != isize)||
+       (fseek(c->out,0,SEEK_END) != 0))
+      HC_ERROR("sh_container_close","write error");
+    free(index);
+    c->out = NULL;
+  }
+  sh_container_release(c);
+}
+/*
+   drop one reference, free once there are none left
+*/
+void sh_container_release(struct sh_container *c)
+{
+  c->nref--;
+  if(c->nref > 0)
+    return;
+  if(c->map)
+    munmap(c->map,c->map_size);
+  free(c->layer);
+  if(c->checked)
+    free(c->checked);
+  free(c);
+}
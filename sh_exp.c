@@ -19,13 +19,48 @@ void sh_allocate_and_init(struct sh_lms **exp, int n,int lmax,
 			  int type, int ivec, hc_boolean verbose,
 			  hc_boolean regular)
 {
-  int i;
   /* init as zeroes! */
   *exp = (struct sh_lms *)calloc(n,sizeof(struct sh_lms));
   if(!(*exp))
     HC_MEMERROR("sh_allocate_and_init");
+  sh_init_expansion_block(*exp,n,lmax,type,ivec,verbose,regular);
+}
+/* 
+
+initialize n expansions of the same lmax and type as for
+sh_init_expansion. for SH_RICK, the coefficients of all expansions are
+placed in one block, expansion i at exp[0].alm + i *
+exp[0].block_stride, each starting at an HC_MEM_ALIGN boundary. loops
+over layers thus go linearly through memory, and there is only one
+allocation
+
+sh_free_expansion(exp,n) releases the block with the first expansion
+
+*/
+void sh_init_expansion_block(struct sh_lms *exp, int n, int lmax, 
+			     int type, int ivec, hc_boolean verbose,
+			     hc_boolean regular)
+{
+  int i,nalign;
+  size_t stride;
+  SH_RICK_PREC *block;
+  if((type != SH_RICK)||(n < 2)){
+    for(i=0;i < n;i++)
+      sh_init_expansion((exp+i),lmax,type,ivec,verbose,regular);
+    return;
+  }
+  /* round up to full alignment blocks */
+  nalign = HC_MEM_ALIGN/sizeof(SH_RICK_PREC);
+  stride = (size_t)(lmax+1)*(size_t)(lmax+2);
+  stride = ((stride + nalign - 1)/nalign)*nalign;
+  block = (SH_RICK_PREC *)hc_aligned_alloc(sizeof(SH_RICK_PREC)*stride*(size_t)n,
+					   "sh_init_expansion_block");
   for(i=0;i < n;i++){
-    sh_init_expansion((*exp+i),lmax,type,ivec,verbose,regular);
+    sh_init_expansion_alm((exp+i),lmax,type,ivec,verbose,regular,
+			  (block + stride * (size_t)i),
+			  ((i==0)?(SH_ALM_BLOCK_HEAD):(SH_ALM_BLOCK)));
+    exp[i].block_n = (i==0)?(n):(0);
+    exp[i].block_stride = stride;
   }
 }
 
@@ -45,6 +80,18 @@ if regular is set, will not use Gauss points
 */
 void sh_init_expansion(struct sh_lms *exp, int lmax, int type, 
 		       int ivec, hc_boolean verbose,hc_boolean regular)
+{
+  sh_init_expansion_alm(exp,lmax,type,ivec,verbose,regular,
+			NULL,SH_ALM_OWN);
+}
+/* 
+   as above, but for SH_RICK, use alm[(lmax+1)*(lmax+2)] as coefficient
+   storage if alm_mode is not SH_ALM_OWN. for SH_ALM_VIEW, the
+   coefficients in alm are kept
+*/
+void sh_init_expansion_alm(struct sh_lms *exp, int lmax, int type, 
+			   int ivec, hc_boolean verbose,hc_boolean regular,
+			   SH_RICK_PREC *alm,int alm_mode)
 {
   /* 
      initialize logic flags 
@@ -116,12 +163,18 @@ void sh_init_expansion(struct sh_lms *exp, int lmax, int type,
        make room for the coefficients A and B in compact storage
     */
     exp->n_lm = exp->lmsmall2;
-    /* 
-       use single precision vector 
-    */
-    rick_vecalloc(&exp->alm,exp->n_lm,"sh_init_expansion");
-
-    sh_clear_alm(exp);
+    exp->alm_mode = alm_mode;
+    exp->block_n = 0;
+    exp->block_stride = exp->n_lm;
+    exp->container = NULL;
+    if(alm_mode == SH_ALM_OWN)
+      rick_vecalloc(&exp->alm,exp->n_lm,"sh_init_expansion");
+    else
+      exp->alm = alm;
+    if(alm_mode != SH_ALM_VIEW)	/* views keep what is there */
+      sh_clear_alm(exp);
+    /* conversion factors to physical normalization */
+    exp->phys_fac = sh_phys_norm_table(exp->lmax);
     /* 
        
     init the parameters for Rick subroutines
@@ -171,7 +224,14 @@ void sh_free_expansion(struct sh_lms *exp, int n)
       break;
 #endif
     case SH_RICK:
-      free(exp[i].alm);
+      if(exp[i].alm_mode == SH_ALM_VIEW)
+	sh_container_release(exp[i].container);
+      else if(exp[i].alm_mode != SH_ALM_BLOCK) /* own or whole block */
+	free(exp[i].alm);
+#ifdef NO_RICK_FORTRAN
+      /* drop the reference to the shared tables */
+      rick_free_module(&exp[i].rick,exp[i].rick.old_ivec);
+#endif
       break;
 #ifdef HC_USE_SPHEREPACK
     case SH_SPHEREPACK_GAUSS:
@@ -244,21 +304,18 @@ power[lmaxp1]
 void sh_compute_power_per_degree(struct sh_lms *exp, 
 				 HC_PREC *power)
 {
-  int l,m;
-  HC_CPREC value[2];
-  hc_boolean need_b;
+  int l,m2;
+  HC_CPREC *value;
+  hc_vecalloc(&value,2*exp->lmaxp1,"sh_compute_power_per_degree");
   for(l=0;l<=exp->lmax;l++){
     power[l] = 0.0;
-    for(m=0;m<=l;m++){
-      need_b = (hc_boolean) ((m == 0) ? (0) : (2));
-      sh_get_coeff(exp,l,m,need_b,TRUE,value); /* convert to DT
-						  normalization  */
-      power[l] += value[0] * value[0];
-      if(need_b) 
-	power[l] += value[1] * value[1];
-    } /* end m loop */
+    sh_get_coeff_l(exp,l,TRUE,value); /* convert to DT
+					 normalization  */
+    for(m2=0;m2 < 2*(l+1);m2++) /* B(l,0) is zero */
+      power[l] += value[m2] * value[m2];
     power[l] /= 2.0*((HC_CPREC)l)+1.0;
   } /* end l loop */
+  free(value);
 }
 /* compute total correlation up to llim */
 HC_PREC sh_correlation(struct sh_lms *exp1, struct sh_lms *exp2, int llim)
@@ -269,10 +326,8 @@ HC_PREC sh_correlation(struct sh_lms *exp1, struct sh_lms *exp2, int llim)
 
 HC_PREC sh_correlation_per_degree(struct sh_lms *exp1, struct sh_lms *exp2, int lmin,int lmax)
 {
-  int l,m;
-  HC_CPREC sum[3],tmp,atmp,btmp,ctmp,value1[2],value2[2];
-  double dtmp;
-  hc_boolean need_b;
+  int l,m2;
+  HC_CPREC sum[3],tmp,atmp,ctmp,*value1,*value2;
 
   sum[0]=sum[1]=sum[2]=0.0;
 
@@ -281,30 +336,21 @@ HC_PREC sh_correlation_per_degree(struct sh_lms *exp1, struct sh_lms *exp2, int
 	    exp1->lmax,exp2->lmax,lmin,lmax);
     exit(-1);
   }
+  hc_vecalloc(&value1,4*(lmax+1),"sh_correlation_per_degree");
+  value2 = value1 + 2*(lmax+1);
   for(l=lmin;l <= lmax;l++){
-
-    for(m=0;m<=l;m++){
-
-      need_b = (hc_boolean) ((m == 0) ? (0) : (2));
-      sh_get_coeff(exp1,l,m,need_b,TRUE,value1); /* convert to DT normalization  */
-      sh_get_coeff(exp2,l,m,need_b,TRUE,value2); /* convert to DT normalization  */
-
-      atmp = value1[0];
-      ctmp = value2[0];
+    /* all A and B of this degree, convert to DT normalization  */
+    sh_get_coeff_l(exp1,l,TRUE,value1);
+    sh_get_coeff_l(exp2,l,TRUE,value2);
+    for(m2=0;m2 < 2*(l+1);m2++){ /* B(l,0) is zero */
+      atmp = value1[m2];
+      ctmp = value2[m2];
       sum[0] += atmp * ctmp;
       sum[1] += atmp * atmp;
       sum[2] += ctmp * ctmp;
-
-      if(need_b){
-	btmp = value1[1];
-	dtmp = value2[1];
-	sum[0] += btmp* dtmp;
-	sum[1] += btmp * btmp;
-	sum[2] += dtmp * dtmp;
-      }
     } /* end m loop */
-    
   } /* end l loop */
+  free(value1);
   tmp = sqrt(sum[1]*sum[2]);
   return sum[0]/tmp;
 }
@@ -339,7 +385,8 @@ void sh_single_par_and_exp_to_stream(struct sh_lms *exp, FILE *out,
 
 print one line with all parameters needed to identify a spherical
 harmonics expansion for a scalar (shps == 1), poloidal/toroidal (shps
-== 2), or a vector field (shps == 3)
+== 2), or a vector field (shps == 3). shps == -3 marks a horizontal
+stress tensor set (SH_SET_HTENSOR), which has three expansions as well
 
 exp[shps]
 
@@ -432,7 +479,8 @@ void sh_print_parameters_to_stream(struct sh_lms *exp, int shps,
    zlabel: float label of this set
    ivec: scalar/vector flag. 0 for shps==1, 1 else
    
-   
+   sets of kind SH_SET_HTENSOR are refused, since they cannot be
+   synthesized like vectors, see sh_read_set_parameters_from_stream
    
 */
 hc_boolean sh_read_parameters_from_stream(int *type, int *lmax, 
@@ -444,6 +492,32 @@ hc_boolean sh_read_parameters_from_stream(int *type, int *lmax,
 					  hc_boolean short_format,
 					  hc_boolean binary,
 					  hc_boolean verbose)
+{
+  int kind;
+  if(!sh_read_set_parameters_from_stream(type,lmax,shps,ilayer,nset,zlabel,
+					 ivec,&kind,in,short_format,binary,
+					 verbose))
+    return FALSE;
+  if(kind != SH_SET_VECTOR){
+    fprintf(stderr,"sh_read_parameters: error: set is a horizontal stress tensor, not a vector\n");
+    fprintf(stderr,"sh_read_parameters: use hc_extract_spatial or hc_extract_sh_layer\n");
+    exit(-1);
+  }
+  return TRUE;
+}
+/* 
+   same, and return the kind of the set, SH_SET_VECTOR or
+   SH_SET_HTENSOR. shps is positive for both
+*/
+hc_boolean sh_read_set_parameters_from_stream(int *type, int *lmax, 
+					      int *shps,
+					      int *ilayer, int *nset,
+					      HC_CPREC *zlabel,
+					      int *ivec,int *kind,
+					      FILE *in, 
+					      hc_boolean short_format,
+					      hc_boolean binary,
+					      hc_boolean verbose)
 {
   int input1[2],input2[3];
   HC_PREC fz;
@@ -492,6 +566,11 @@ hc_boolean sh_read_parameters_from_stream(int *type, int *lmax,
     *shps = 1;     
     *type = HC_DEFAULT_INTERNAL_FORMAT;
   }
+  if(*shps < 0){
+    *kind = SH_SET_HTENSOR;
+    *shps = -(*shps);
+  }else
+    *kind = SH_SET_VECTOR;
   if(*shps == 1)
     *ivec = 0;
   else
@@ -565,9 +644,10 @@ void sh_print_coefficients_to_stream(struct sh_lms *exp,
 				     hc_boolean binary, 
 				     hc_boolean verbose)
 {
-  int j,l,m;
-  HC_PREC value[2];
+  int j,l,m,n2;
+  HC_CPREC *value,*v;
   HC_PREC fvalue[2];
+  struct hc_outbuf ob;
   /* 
      test  other expansions this set 
   */
@@ -583,35 +663,40 @@ void sh_print_coefficients_to_stream(struct sh_lms *exp,
       exit(-1);
     }
   } /* end test */
-  if(binary){
-    for(l=0;l <= exp[0].lmax;l++)
-      for(m=0;m <= l;m++)
-	for(j=0;j < shps;j++){
-	  /* 
-	     output is in physical convention, convert from whatever
-	     we are using internally
-	  */
-	  sh_get_coeff((exp+j),l,m,2,TRUE,value);
-	  fvalue[0] = value[0]*fac[j];
-	  fvalue[1] = value[1]*fac[j];
+  /* 
+     all A and B of one degree for all sets
+  */
+  n2 = 2*exp[0].lmaxp1;
+  hc_vecalloc(&value,shps*n2,"sh_print_coefficients_to_stream");
+  if(!binary)
+    hc_outbuf_init(&ob,out,(size_t)65536);
+  for(l=0;l <= exp[0].lmax;l++){
+    /* 
+       output is in physical convention, convert from whatever we are
+       using internally
+    */
+    for(j=0;j < shps;j++)
+      sh_get_coeff_l((exp+j),l,TRUE,(value+j*n2));
+    for(m=0;m <= l;m++){
+      for(j=0,v=value+2*m;j < shps;j++,v+=n2){
+	if(binary){
+	  fvalue[0] = v[0]*fac[j];
+	  fvalue[1] = v[1]*fac[j];
 	  hc_print_float(fvalue, 2, out);
+	}else{		/* "%15.7e %15.7e\t" */
+	  hc_outbuf_e(&ob,(double)(v[0]*fac[j]),15,7);
+	  hc_outbuf_c(&ob,' ');
+	  hc_outbuf_e(&ob,(double)(v[1]*fac[j]),15,7);
+	  hc_outbuf_c(&ob,'\t');
 	}
-  }else{
-    for(l=0;l <= exp[0].lmax;l++){
-      for(m=0;m <= l;m++){
-	for(j=0;j < shps;j++){
-	  /* output in physical convention, convert from internal
-	     convention */
-	  sh_get_coeff((exp+j),l,m,2,TRUE,value);
-	  fprintf(out,"%15.7e %15.7e\t",
-		  (double)(value[0]*fac[j]),
-		  (double)(value[1]*fac[j]));
-	}
-	fprintf(out,"\n");
-      } /* end m loop */
-    }	/* end l loop */
-    //fprintf(out,"\n");
-  }
+      }
+      if(!binary)
+	hc_outbuf_c(&ob,'\n');
+    } /* end m loop */
+  }	/* end l loop */
+  if(!binary)
+    hc_outbuf_free(&ob);
+  free(value);
 }
 /* 
 
@@ -632,8 +717,8 @@ void sh_read_coefficients_from_stream(struct sh_lms *exp, int shps, int lmax,
 				      FILE *in, hc_boolean binary, HC_CPREC *fac,
 				      hc_boolean verbose)
 {
-  int j,k,l,m,lmax_loc;
-  HC_CPREC value[2]={0,0};
+  int j,k,l,m,lmax_loc,n2;
+  HC_CPREC *value,*v;
   HC_PREC fvalue[2]={0,0};
   if(lmax < 0)
     lmax_loc = exp[0].lmax;
@@ -654,44 +739,47 @@ void sh_read_coefficients_from_stream(struct sh_lms *exp, int shps, int lmax,
       exit(-1);
     }
   } /* end test */
-  if(binary){
-    for(l=0;l <= lmax_loc;l++)
-      for(m=0;m <= l;m++)
-	for(j=0;j < shps;j++){
+  /* 
+     A and B of one degree for all sets, zero for the rest if we are
+     limiting to lmax_loc
+  */
+  n2 = 2*exp[0].lmaxp1;
+  hc_vecalloc(&value,shps*n2,"sh_read_coefficients_from_stream");
+  for(k=0;k < shps*n2;k++)
+    value[k] = 0.0;
+  for(l=0;l <= lmax_loc;l++){
+    for(m=0;m <= l;m++)
+      for(j=0,v=value+2*m;j < shps;j++,v+=n2){
+	if(binary){
 	  if(hc_read_float(fvalue,2,in)!=2){
 	    fprintf(stderr,"sh_read_coefficients_from_stream: read error: set %i l %i m %i\n",
 		    j+1,l,m);
 	    exit(-1);
 	  }
 	  for(k=0;k<2;k++)
-	    value[k] = (HC_CPREC)fvalue[k];
-	  /* read in real, Dahlen & Tromp normalized coefficients and
-	     convert to whatever format we are using internally */
-	  sh_write_coeff((exp+j),l,m,(m==0)?(0):(2),TRUE,value);
-	}
-  }else{
-    for(l=0;l <= lmax_loc;l++)
-      for(m=0;m <= l;m++)
-	for(j=0;j < shps;j++){
-	  if(fscanf(in,HC_TWO_FLT_FORMAT,value,(value+1))!=2){
+	    v[k] = (HC_CPREC)fvalue[k];
+	}else{
+	  if((!hc_read_flt(in,v))||(!hc_read_flt(in,(v+1)))){
 	    fprintf(stderr,"sh_read_coefficients_from_stream: read error: set %i l %i m %i, last val: %g %g\n",
-		    j+1,l,m,(double)value[0],(double)value[1]);
+		    j+1,l,m,(double)v[0],(double)v[1]);
 	    exit(-1);
 	  }
-	  /* read in real, Dahlen & Tromp normalized coefficients and
-	     convert to whatever format we are using internally */
-	  sh_write_coeff((exp+j),l,m,(m==0)?(0):(2),TRUE,value);
 	}
+      }
+    /* read in real, Dahlen & Tromp normalized coefficients and
+       convert to whatever format we are using internally */
+    for(j=0;j < shps;j++)
+      sh_write_coeff_l((exp+j),l,TRUE,(value+j*n2));
   }
   /* fill up rest with zeroes, if we are limiting to lmax_loc */
   if(lmax_loc < exp[0].lmax){
-    value[0] = value[1] = 0.0;
+    for(k=0;k < n2;k++)
+      value[k] = 0.0;
     for(l=lmax_loc+1;l <= exp[0].lmax;l++)
-      for(m=0;m <= l;m++)
-	for(j=0;j < shps;j++)
-	  sh_write_coeff((exp+j),l,m,(m==0)?(0):(2),TRUE,value);
+      for(j=0;j < shps;j++)
+	sh_write_coeff_l((exp+j),l,TRUE,value);
   }
-
+  free(value);
 
 
   for(j=0;j < shps;j++){
@@ -751,7 +839,55 @@ void sh_read_spatial_data_from_grd(struct sh_lms *exp, struct ggrd_gt *ggrd,
 				   HC_PREC *z)
 {
   FILE *fdummy=NULL;
-  sh_read_spatial_data(exp,fdummy,ggrd,TRUE,use_3d,shps,data,z);
+  if(!use_3d)
+    sh_interpolate_spatial_data_from_grd(exp,ggrd,shps,data);
+  else
+    sh_read_spatial_data(exp,fdummy,ggrd,TRUE,use_3d,shps,data,z);
+}
+/* 
+
+interpolate shps grd files at the locations of the spatial basis of
+exp, output in data[shps * exp->npoints]
+
+the points are distributed over threads, each thread interpolates
+with its own cursors, the grids are shared
+
+*/
+void sh_interpolate_spatial_data_from_grd(struct sh_lms *exp, 
+					  struct ggrd_gt *ggrd,
+					  int shps, HC_PREC *data)
+{
+  int j;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    struct ggrd_cursor *cur;
+    HC_PREC lon,lat;
+    double dvalue;
+    int k;
+    cur = (struct ggrd_cursor *)malloc(sizeof(struct ggrd_cursor)*shps);
+    if(!cur)
+      HC_MEMERROR("sh_interpolate_spatial_data_from_grd");
+    for(k=0;k < shps;k++)
+      ggrd_cursor_init((cur+k),(ggrd+k));
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(j=0;j < exp->npoints;j++){
+      sh_get_coordinates(exp,j,&lon,&lat);
+      for(k=0;k < shps;k++){
+	if(!ggrd_grdtrack_interpolate_tp_r((double)LAT2THETA(lat),(double)LON2PHI(lon),
+					   (ggrd+k),&dvalue,FALSE,FALSE,(cur+k))){
+	  fprintf(stderr,"sh_interpolate_spatial_data_from_grd: interpolation error grd %i, lon %g lat %g\n",
+		  k+1,(double)lon,(double)lat);
+	  exit(-1);
+	}
+	data[k*exp[0].npoints+j] = dvalue;
+      }
+    }
+    free(cur);
+  }
 }
 /* 
 
@@ -1188,6 +1324,41 @@ void sh_compute_spatial(struct sh_lms *exp, int ivec,
 
 /* 
 
+compute the spatial representation of a radial scalar field,
+exp[0], and a poloidal/toroidal vector field, exp[1] and exp[2], on
+the same grid. data has to hold 3*npoints, r, theta and phi
+components. 
+
+for Rick type expansions with precomputed Plm, the Legendre functions
+are only passed over once for all components, else this is the same
+as a scalar and a vector call of sh_compute_spatial
+
+*/
+void sh_compute_spatial_rv(struct sh_lms *exp,hc_boolean save_plm,
+			   SH_RICK_PREC **plm,HC_PREC *data, 
+			   hc_boolean verbose)
+{
+#ifdef NO_RICK_FORTRAN
+  if((exp->type == SH_RICK) && save_plm && (exp[0].lmax == exp[1].lmax)){
+    if((!exp[0].spectral_init)||(!exp[1].spectral_init)||(!exp[2].spectral_init)){
+      fprintf(stderr,"sh_compute_spatial_rv: coefficients set not initialized\n");
+      exit(-1);
+    }
+    /* Plm for vector fields, computed once */
+    sh_compute_plm((exp+1),1,plm,verbose); 
+    rick_shc2d_pre_rv(exp[0].alm,exp[1].alm,exp[2].alm,exp[1].lmax,
+		      *plm,(*plm+exp[1].n_plm),
+		      data,(data+exp[0].npoints),(data+2*exp[0].npoints),
+		      &exp[1].rick);
+    return;
+  }
+#endif
+  sh_compute_spatial(exp,0,save_plm,plm,data,verbose);
+  sh_compute_spatial((exp+1),1,save_plm,plm,(data+exp[0].npoints),verbose);
+}
+
+/* 
+
 compute a spatial expansion on an regular grid given in theta and
 phi arrays of npoints length
 
@@ -1227,7 +1398,7 @@ void sh_compute_spatial_reg(struct sh_lms *exp, int ivec,
 #ifdef NO_RICK_FORTRAN
     if(save_plm)
       rick_shc2d_pre_reg(exp[0].alm,exp[1].alm,exp[0].lmax,
-			   *plm,(*plm+exp->n_plm),
+			   *plm,(*plm+(exp->lmsmall2/2)*ntheta),
 			   ivec,data,(data+npoints),
 			   &exp->rick,theta,ntheta,phi,nphi,
 			   save_sincos_fac);
@@ -1284,6 +1455,144 @@ void sh_compute_spatial_irreg(struct sh_lms *exp, int ivec,
     break;
   }
 }
+/* 
+   
+   work[0,1] = d_phi exp[1,2], work[2] = divergence, and work[3] = curl
+   coefficients of the exp[1,2] vector field. with the Rick vector
+   normalization, those are -sqrt(l(l+1)) and sqrt(l(l+1)) times the
+   poloidal and toroidal coefficients, respectively
+
+*/
+static void sh_tensor_work_coefficients(struct sh_lms *exp,struct sh_lms *work)
+{
+  int i,l,m;
+  SH_RICK_PREC *a,*b,fac;
+  if(exp->type != SH_RICK)
+    sh_exp_type_error("sh_tensor_work_coefficients",exp);
+  for(i=0;i < 2;i++){
+    sh_aexp_equals_bexp_coeff((work+i),(exp+1+i));
+    sh_aexp_equals_bexp_coeff((work+2+i),(exp+1+i));
+    for(l=0;l <= work[i].lmax;l++){
+      /* A cos(m phi) + B sin(m phi) -> m B cos(m phi) - m A sin(m phi) */
+      a = SH_LSLICE((work+i),l);
+      for(m=0;m <= l;m++){
+	fac = a[2*m];
+	a[2*m]   =  (SH_RICK_PREC)m * a[2*m+1];
+	a[2*m+1] = -(SH_RICK_PREC)m * fac;
+      }
+      fac = sqrt((SH_RICK_PREC)l*((SH_RICK_PREC)l+1.0));
+      if(i == 0)
+	fac = -fac;
+      b = SH_LSLICE((work+2+i),l);
+      for(m=0;m < 2*(l+1);m++)
+	b[m] *= fac;
+    }
+  }
+  for(i=0;i < 4;i++)
+    work[i].spectral_init = TRUE;
+}
+/* 
+
+   combine the seven spatial fields iso, u_t, u_p, a_t, a_p, d, k,
+   which are f[j*stride], at colatitude theta into ttt, ttp, tpp,
+   at data[k*dstride]
+
+*/
+static void sh_tensor_from_fields(HC_PREC theta,HC_PREC *f,int stride,
+			   HC_PREC *data,int dstride)
+{
+  HC_PREC s,c,ett,epp,etp;
+  s = sin(theta);
+  c = cos(theta)/s;
+  ett = f[5*stride] - c * f[stride] - f[4*stride]/s;
+  epp = c * f[stride] + f[4*stride]/s;
+  etp = 0.5 * f[6*stride] - c * f[2*stride] + f[3*stride]/s;
+  data[0]         = f[0] + 0.5*(ett - epp);
+  data[dstride]   = etp;
+  data[2*dstride] = f[0] - 0.5*(ett - epp);
+}
+/* 
+
+compute the horizontal components of a symmetric tensor field, ttt,
+ttp, and tpp, from exp[0], a scalar expansion of the isotropic part
+(ttt+tpp)/2, and exp[1] and exp[2], the poloidal and toroidal
+expansions of a vector field u whose horizontal strain gives the
+deviatoric part, as for the HC_HTRACTIONS solution. with s =
+sin(theta) and c = cot(theta), the strain components follow from
+the spatial u, the phi derivatives a = d_phi u, and the surface
+divergence d and radial curl k, which are all obtained by regular
+scalar and vector syntheses of modified coefficients
+
+e_tt = d - c u_t - a_p/s
+e_pp =     c u_t + a_p/s
+e_tp = k/2 - c u_p + a_t/s
+
+such that ttt = iso + (e_tt - e_pp)/2, tpp = iso - (e_tt - e_pp)/2,
+and ttp = e_tp. the poles are not part of either grid
+
+work[4] has to be initialized like exp, and will hold the phi
+derivatives, divergence and curl. data has to hold 3*npoints
+
+*/
+void sh_compute_spatial_tensor(struct sh_lms *exp,struct sh_lms *work,
+			       hc_boolean save_plm,SH_RICK_PREC **plm,
+			       HC_PREC *data, hc_boolean verbose)
+{
+  int i,np;
+  HC_PREC *f,lon,lat;
+  np = exp[0].npoints;
+  sh_tensor_work_coefficients(exp,work);
+  if(save_plm)			/* all from the same vector table */
+    for(i=0;i < 4;i++){
+      if(i < 3)
+	sh_compute_plm((exp+i),1,plm,verbose);
+      sh_compute_plm((work+i),1,plm,verbose);
+    }
+  hc_vecalloc(&f,7*np,"sh_compute_spatial_tensor");
+  sh_compute_spatial(exp,0,save_plm,plm,f,verbose); /* isotropic */
+  sh_compute_spatial((exp+1),1,save_plm,plm,(f+np),verbose); /* u */
+  sh_compute_spatial(work,1,save_plm,plm,(f+3*np),verbose); /* d_phi u */
+  sh_compute_spatial((work+2),0,save_plm,plm,(f+5*np),verbose); /* div */
+  sh_compute_spatial((work+3),0,save_plm,plm,(f+6*np),verbose); /* curl */
+  for(i=0;i < np;i++){
+    sh_get_coordinates(exp,i,&lon,&lat);
+    sh_tensor_from_fields(LAT2THETA(lat),(f+i),np,(data+i),np);
+  }
+  free(f);
+}
+/* 
+
+same on a regular grid, with separate scalar and vector Plm tables
+as for sh_compute_spatial_reg. the work expansions should be kept
+between calls, else the Plm get recomputed
+
+*/
+void sh_compute_spatial_tensor_reg(struct sh_lms *exp,struct sh_lms *work,
+				   SH_RICK_PREC **plm_s,SH_RICK_PREC **plm_v,
+				   HC_PREC *theta, int ntheta, 
+				   HC_PREC *phi,int nphi,
+				   HC_PREC *data, hc_boolean verbose)
+{
+  int i,j,np;
+  HC_PREC *f;
+  np = nphi * ntheta;
+  sh_tensor_work_coefficients(exp,work);
+  hc_vecalloc(&f,7*np,"sh_compute_spatial_tensor_reg");
+  sh_compute_spatial_reg(exp,0,TRUE,plm_s,theta,ntheta,phi,nphi,
+			 f,verbose,TRUE);
+  sh_compute_spatial_reg((exp+1),1,TRUE,plm_v,theta,ntheta,phi,nphi,
+			 (f+np),verbose,TRUE);
+  sh_compute_spatial_reg(work,1,TRUE,plm_v,theta,ntheta,phi,nphi,
+			 (f+3*np),verbose,TRUE);
+  sh_compute_spatial_reg((work+2),0,TRUE,plm_s,theta,ntheta,phi,nphi,
+			 (f+5*np),verbose,TRUE);
+  sh_compute_spatial_reg((work+3),0,TRUE,plm_s,theta,ntheta,phi,nphi,
+			 (f+6*np),verbose,TRUE);
+  for(j=0;j < ntheta;j++)
+    for(i=0;i < nphi;i++)
+      sh_tensor_from_fields(theta[j],(f+j*nphi+i),np,(data+j*nphi+i),np);
+  free(f);
+}
 
 /* 
    
@@ -1356,23 +1665,28 @@ void sh_print_spatial_data_to_stream(struct sh_lms *exp, int shps,
 {
   int j,k;
   HC_PREC lon,lat;
+  struct hc_outbuf ob;
+  hc_outbuf_init(&ob,out,HC_OUTBUF_SIZE);
   for(j=0;j < exp[0].npoints;j++){
     /* 
        get coordinates
     */
     sh_get_coordinates(exp,j,&lon,&lat);
-    /* print coordinates */
-    if(!use_3d){
-      /* print lon lat  */
-      fprintf(out,"%14.7f %14.7f\t",(double)lon,(double)lat);
-    }else{
+    /* print coordinates, "%14.7f %14.7f\t" */
+    hc_outbuf_f(&ob,(double)lon,14,7);hc_outbuf_c(&ob,' ');
+    hc_outbuf_f(&ob,(double)lat,14,7);
+    if(use_3d){
       /* print lon lat z[i] */
-      fprintf(out,"%14.7f %14.7f %14.7f\t",(double)lon,(double)lat,(double)z);
+      hc_outbuf_c(&ob,' ');hc_outbuf_f(&ob,(double)z,14,7);
+    }
+    hc_outbuf_c(&ob,'\t');
+    for(k=0;k < shps;k++){		/* loop through all scalars, "%14.7e " */
+      hc_outbuf_e(&ob,(double)data[j+exp[0].npoints*k],14,7);
+      hc_outbuf_c(&ob,' ');
     }
-    for(k=0;k < shps;k++)		/* loop through all scalars */
-      fprintf(out,"%14.7e ",(double)data[j+exp[0].npoints*k]);
-    fprintf(out,"\n");
+    hc_outbuf_c(&ob,'\n');
   }	/* end points in lateral space loop */
+  hc_outbuf_free(&ob);
 }
 
 void sh_get_coordinates(struct sh_lms *exp,
@@ -1528,6 +1842,20 @@ void sh_print_irreg_spatial_data_to_stream(struct sh_lms *exp, int shps,
 }
 /* 
 
+release a Legendre function array as obtained from sh_compute_plm,
+and set it to NULL
+
+*/
+void sh_free_plm(SH_RICK_PREC **plm)
+{
+  if(*plm){
+    if(!rick_release_plm_table(*plm))
+      free(*plm);
+    *plm = NULL;
+  }
+}
+/* 
+
 compute the associated Legendre functions for all (l,m) at 
 all latidutinal lcoations once and only once
 
@@ -1544,6 +1872,7 @@ void sh_compute_plm(struct sh_lms *exp,int ivec,
 		    SH_RICK_PREC **plm,
 		    hc_boolean verbose)
 {
+  SH_RICK_PREC *old_plm;
   if(!exp->plm_computed){
     if((!exp->lmax)||(!exp->n_plm)||(!exp->tn_plm)){
       fprintf(stderr,"sh_compute_plm: error, expansion not initialized?\n");
@@ -1552,12 +1881,11 @@ void sh_compute_plm(struct sh_lms *exp,int ivec,
       exit(-1);
     }
     /* 
-       allocate 
-    */
-    rick_vecalloc(plm,exp->tn_plm,"sh_compute_plm");
-    /* 
-       compute the Legendre polynomials 
+       compute the Legendre polynomials. a previous array in *plm
+       gets released after the new one has been obtained, since it
+       might be the same shared table
     */
+    old_plm = *plm;
     switch(exp->type){
 #ifdef HC_USE_HEALPIX
 
@@ -1565,17 +1893,25 @@ void sh_compute_plm(struct sh_lms *exp,int ivec,
       if(verbose)
 	fprintf(stderr,"sh_compute_plm: healpix: computing Plm for lmax %i\n",
 		exp->lmax);
+      rick_vecalloc(plm,exp->tn_plm,"sh_compute_plm");
       heal_plmgen(*plm,&exp->heal.nside,&exp->lmax,&ivec);
       break;
 #endif
     case SH_RICK:
+#ifdef NO_RICK_FORTRAN
+      /* 
+	 those only depend on lmax and ivec, and are shared
+	 between all expansions
+      */
       if(verbose)
-	fprintf(stderr,"sh_compute_plm: Rick: computing all Plm for lmax %i\n",
+	fprintf(stderr,"sh_compute_plm: Rick: obtaining all Plm for lmax %i\n",
 		exp->lmax);
-#ifdef NO_RICK_FORTRAN
-      rick_compute_allplm(exp->lmax,ivec,*plm,
-			  (*plm+exp->n_plm),&exp->rick);
+      *plm = rick_get_plm_table(exp->lmax,ivec,&exp->rick);
 #else
+      if(verbose)
+	fprintf(stderr,"sh_compute_plm: Rick: computing all Plm for lmax %i\n",
+		exp->lmax);
+      rick_vecalloc(plm,exp->tn_plm,"sh_compute_plm");
       rick_f90_compute_allplm(&exp->lmax,&ivec,*plm,
 			      (*plm+exp->n_plm));
 #endif
@@ -1589,6 +1925,7 @@ void sh_compute_plm(struct sh_lms *exp,int ivec,
       sh_exp_type_error("compute_plm",exp);
       break;
     }
+    sh_free_plm(&old_plm);
     exp->plm_computed = TRUE;
     exp->old_lmax = exp->lmax;
     exp->old_ivec = ivec;
@@ -1666,7 +2003,8 @@ void sh_compute_plm_reg(struct sh_lms *exp,int ivec,
 	fprintf(stderr,"sh_compute_plm_reg: Rick: computing all Plm for lmax %i and %i points\n",
 		exp->lmax,npoints);
 #ifdef NO_RICK_FORTRAN
-      rick_compute_allplm_reg(exp->lmax,ivec,*plm,(*plm+exp->old_tnplm_irr),&exp->rick,
+      /* dPlm follow the lmsize * npoints Plm */
+      rick_compute_allplm_reg(exp->lmax,ivec,*plm,(*plm+(exp->lmsmall2/2)*npoints),&exp->rick,
 				theta,npoints);
 #else
       HC_ERROR("compute_plm_reg","rick fortran not implemented");
@@ -1782,7 +2120,7 @@ void sh_get_coeff(struct sh_lms *exp,int l, int m, int use_b,
       }else{
 	if(phys_norm){
 	  *value = (HC_CPREC)exp->alm[LM_INDEX(l,m,use_b)] * 
-	    SH_RICK_FACTOR(l,m);
+	    exp->phys_fac[m];
 	}else{
 	  *value = (HC_CPREC)exp->alm[LM_INDEX(l,m,use_b)];
 	}
@@ -1790,7 +2128,7 @@ void sh_get_coeff(struct sh_lms *exp,int l, int m, int use_b,
     }else{ 			/* both  */
       index = LM_INDEX(l,m,0);
       if(phys_norm){
-	s1 = SH_RICK_FACTOR(l,m);
+	s1 = exp->phys_fac[m];
 	value[0] = (HC_CPREC)exp->alm[index  ]* s1;
 	value[1] = (m != 0)?((HC_CPREC)exp->alm[index+1]* s1):(0.0);
       }else{
@@ -1888,10 +2226,10 @@ void sh_write_coeff(struct sh_lms *exp,int l, int m,
     if(phys_norm){		/* convert */
       if(use_b < 2){		/* A or B */
 	exp->alm[LM_INDEX(l,m,use_b)] = 
-	  *value / SH_RICK_FACTOR(l,m);
+	  *value / exp->phys_fac[m];
       }else{			/* both */
 	exp->alm[(index=LM_INDEX(l,m,0))] = 
-	  value[0] / (s1=SH_RICK_FACTOR(l,m));
+	  value[0] / (s1=exp->phys_fac[m]);
 	exp->alm[index+1] = value[1] / s1;
       }
     }else{			/* as is */
@@ -1962,10 +2300,10 @@ void sh_add_coeff(struct sh_lms *exp,int l, int m,
     if(phys_norm){		/* convert */
       if(use_b < 2){		/* A or B */
 	exp->alm[LM_INDEX(l,m,use_b)] += 
-	  *value / SH_RICK_FACTOR(l,m);
+	  *value / exp->phys_fac[m];
       }else{			/* both */
 	exp->alm[(index=LM_INDEX(l,m,0))] += 
-	  value[0] / (s1=SH_RICK_FACTOR(l,m));
+	  value[0] / (s1=exp->phys_fac[m]);
 	exp->alm[index+1] += value[1] / s1;
       }
     }else{			/* as is */
@@ -1988,6 +2326,144 @@ void sh_add_coeff(struct sh_lms *exp,int l, int m,
   }
 }
 
+/* 
+
+   conversion factors from the internal SH_RICK convention to real
+   spherical harmonics as in Dahlen & Tromp, C_DT(l,m) = fac[m] *
+   C_RICK(l,m), for m = 0...lmax. Rick's factor does not depend on l,
+   so this replaces SH_RICK_FACTOR(l,m) for all l <= lmax
+
+   the tables are computed once per lmax and process and shared, do
+   not free
+
+*/
+HC_CPREC *sh_phys_norm_table(int lmax)
+{
+  static struct sh_phys_norm *cache = NULL;
+  struct sh_phys_norm *t;
+  int m;
+#ifdef _OPENMP
+#pragma omp critical(sh_phys_norm_cache)
+#endif
+  {
+    for(t=cache;t;t=t->next)
+      if(t->lmax == lmax)
+	break;
+    if(!t){
+      t = (struct sh_phys_norm *)malloc(sizeof(struct sh_phys_norm));
+      if(!t)
+	HC_MEMERROR("sh_phys_norm_table");
+      t->lmax = lmax;
+      hc_vecalloc(&t->fac,lmax+1,"sh_phys_norm_table");
+      for(m=0;m <= lmax;m++)
+	t->fac[m] = SH_RICK_FACTOR(lmax,m);
+      t->next = cache;
+      cache = t;
+    }
+  }
+  return t->fac;
+}
+/* 
+
+   return the slice of all A and B coefficients of degree l of a
+   SH_RICK expansion, in the internal convention. A(l,m) is at
+   [SH_LSLICE_STRIDE*m], B(l,m) at [SH_LSLICE_STRIDE*m+1]
+
+*/
+SH_RICK_PREC *sh_lslice(struct sh_lms *exp,int l)
+{
+  if(exp->type != SH_RICK)
+    sh_exp_type_error("sh_lslice",exp);
+  if((l < 0)||(l > exp->lmax)){
+    fprintf(stderr,"sh_lslice: error: l=%i out of bounds for lmax=%i expansion\n",
+	    l,exp->lmax);
+    exit(-1);
+  }
+  return SH_LSLICE(exp,l);
+}
+/* 
+
+   get all A and B coefficients of degree l in one go, value[2(l+1)],
+   ordered like a slice, A(l,m) = value[2m], B(l,m) = value[2m+1]. B
+   will be zero for m == 0. if phys_norm is set, converts to Dahlen &
+   Tromp as in sh_get_coeff
+
+*/
+void sh_get_coeff_l(struct sh_lms *exp,int l,hc_boolean phys_norm,
+		    HC_CPREC *value)
+{
+  SH_RICK_PREC *a;
+  HC_CPREC s1;
+  int m,m2;
+  if(exp->type == SH_RICK){
+    a = sh_lslice(exp,l);
+    if(phys_norm){
+      for(m=m2=0;m <= l;m++,m2+=2){
+	s1 = exp->phys_fac[m];
+	value[m2]   = (HC_CPREC)a[m2]   * s1;
+	value[m2+1] = (HC_CPREC)a[m2+1] * s1;
+      }
+    }else{
+      for(m2=0;m2 < 2*(l+1);m2++)
+	value[m2] = (HC_CPREC)a[m2];
+    }
+    value[1] = 0.0;
+  }else{
+    for(m=0;m <= l;m++)
+      sh_get_coeff(exp,l,m,2,phys_norm,(value+2*m));
+  }
+}
+/* 
+
+   write all A and B coefficients of degree l from value[2(l+1)],
+   ordered as for sh_get_coeff_l. the m == 0 B term is ignored, and
+   set to zero
+
+*/
+void sh_write_coeff_l(struct sh_lms *exp,int l,hc_boolean phys_norm,
+		      HC_CPREC *value)
+{
+  SH_RICK_PREC *a;
+  HC_CPREC s1;
+  int m,m2;
+  if(exp->type == SH_RICK){
+    a = sh_lslice(exp,l);
+    if(phys_norm){
+      for(m=m2=0;m <= l;m++,m2+=2){
+	s1 = exp->phys_fac[m];
+	a[m2]   = value[m2]   / s1;
+	a[m2+1] = value[m2+1] / s1;
+      }
+    }else{
+      for(m2=0;m2 < 2*(l+1);m2++)
+	a[m2] = value[m2];
+    }
+    a[1] = 0.0;
+  }else{
+    sh_write_coeff(exp,l,0,0,phys_norm,value);
+    for(m=1;m <= l;m++)
+      sh_write_coeff(exp,l,m,2,phys_norm,(value+2*m));
+  }
+}
+/* 
+
+   convert the whole expansion to Dahlen & Tromp normalization and
+   store in c[exp->lmsmall2], packed as LM_INDEX, and the reverse
+
+*/
+void sh_get_phys_norm_coeff(struct sh_lms *exp,HC_CPREC *c)
+{
+  int l;
+  for(l=0;l <= exp->lmax;l++)
+    sh_get_coeff_l(exp,l,TRUE,(c+LM_INDEX(l,0,0)));
+}
+void sh_write_phys_norm_coeff(struct sh_lms *exp,HC_CPREC *c)
+{
+  int l;
+  for(l=0;l <= exp->lmax;l++)
+    sh_write_coeff_l(exp,l,TRUE,(c+LM_INDEX(l,0,0)));
+}
+
 /* 
    copy a whole expansion structure 
    a --> b, i.e.
@@ -2127,8 +2603,12 @@ which only depends on l
 */
 void sh_scale_expansion_l_factor(struct sh_lms *exp, HC_CPREC *lfac)
 {
-  int l,m,index;
+  int l,m;
+#ifdef HC_USE_HEALPIX
+  int index;
+#endif
   HC_CPREC fac;
+  SH_RICK_PREC *a;
   switch(exp->type){
 #ifdef HC_USE_HEALPIX
 
@@ -2145,10 +2625,9 @@ void sh_scale_expansion_l_factor(struct sh_lms *exp, HC_CPREC *lfac)
   case SH_RICK:
     for(l=0;l <= exp->lmax;l++){
       fac = lfac[l];
-      for(m=0;m <= l;m++){
-	exp->alm[(index = LM_INDEX(l,m,0))] *= fac;
-	exp->alm[index+1] *= fac;
-      }
+      a = SH_LSLICE(exp,l);
+      for(m=0;m < 2*(l+1);m++)	/* A and B */
+	a[m] *= fac;
     }
     break;
 #ifdef HC_USE_SPHEREPACK
@@ -2163,6 +2642,39 @@ void sh_scale_expansion_l_factor(struct sh_lms *exp, HC_CPREC *lfac)
 }
 
 
+/* 
+
+add the expansion b, scaled with fac[0...lmax] which only depends on
+l, to expansion a, i.e. a = a + fac(l) b, lmax(b) <= lmax(a)
+
+*/
+void sh_add_expansion_l_factor(struct sh_lms *a, struct sh_lms *b, 
+			       HC_CPREC *lfac)
+{
+  int l,m;
+  HC_CPREC fac;
+  SH_RICK_PREC *aa,*ba;
+  if((a->type != b->type)||(a->lmax < b->lmax)){
+    fprintf(stderr,"sh_add_expansion_l_factor: error: type %i/%i lmax %i/%i mix not implemented\n",
+	    a->type,b->type,a->lmax,b->lmax);
+    exit(-1);
+  }
+  switch(a->type){
+  case SH_RICK:
+    for(l=0;l <= b->lmax;l++){
+      fac = lfac[l];
+      aa = SH_LSLICE(a,l);
+      ba = SH_LSLICE(b,l);
+      for(m=0;m < 2*(l+1);m++)	/* A and B */
+	aa[m] += fac * ba[m];
+    }
+    break;
+  default:
+    sh_exp_type_error("sh_add_expansion_l_factor",a);
+    break;
+ }
+}
+
 /* 
    scale all coefficients 
 */
@@ -67,16 +67,14 @@ void sh_init_model(struct sh_lms_model *model,int lmax,int type,
     calloc(model->nexp,sizeof(struct sh_lms));
   if(!model->exp)
     HC_MEMERROR("sh_init_model");
+  /* initialize expansions in one block, use irregular grid */
+  sh_init_expansion_block(model->exp,model->nexp,lmax,type,model->ivec,
+			  verbose,FALSE);
   model->tnpoints = 0;
-  for(i=0;i < model->nexp;i++){	/* initialize expansions and add 
-				   up total number of points 
+  for(i=0;i < model->nexp;i++)	/* add up total number of points 
 				   in spatial domain
 				*/
-    /* use irregular grid */
-    sh_init_expansion((model->exp+i),lmax,type,model->ivec,
-		      verbose,FALSE);
     model->tnpoints += model->exp[i].npoints;
-  }
   /* logic  flag for spatial data */
   model->spatial_init = FALSE;
   /* should we attempt to precompute and store legendre factors? */
@@ -113,7 +111,7 @@ void sh_free_model(struct sh_lms_model *model)
   free(model->z);
   sh_free_expansion(model->exp,model->nexp);
   if(model->save_plm)
-    free(model->plm);
+    sh_free_plm(&model->plm);
 }
 /* 
 
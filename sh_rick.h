@@ -39,6 +39,7 @@ and Tromp
 #define SH_RICK_PREC long double
 #define rick_vecalloc hc_vecalloc
 #define rick_vecrealloc hc_vecrealloc
+#define rick_hvecalloc hc_vecalloc
 #define SH_RICK_FLT_FMT "%Lf"
 
 #elif SH_RICK_PRECISION == 16	/* double */
@@ -47,6 +48,7 @@ and Tromp
 #define SH_RICK_PREC double
 #define rick_vecalloc hc_dvecalloc
 #define rick_vecrealloc hc_dvecrealloc
+#define rick_hvecalloc hc_dvecalloc
 #define SH_RICK_FLT_FMT "%lf"
 
 #else  /* single */
@@ -55,6 +57,7 @@ and Tromp
 #define SH_RICK_PREC float
 #define rick_vecalloc hc_svecalloc
 #define rick_vecrealloc hc_svecrealloc
+#define rick_hvecalloc hc_dvecalloc
 #define SH_RICK_FLT_FMT "%f"
 
 #endif
@@ -62,6 +65,149 @@ and Tromp
 #ifndef my_boolean
 #define my_boolean unsigned short 
 #endif
+/* 
+
+   the Legendre functions for the Gauss grid are stored m-major for
+   each latitude: for every m, l runs from m to lmax. this gives the
+   offset of P(l,m) within one latitude
+
+*/
+#define RICK_MM_INDEX(l, m, lmax) ((m)*((lmax)+1) - ((m)*((m)-1))/2 + ((l)-(m)))
+/* 
+   
+   SIMD summation kernels, double and single precision x86 only,
+   else the generic C versions are used. define RICK_NO_SIMD to
+   switch off
+
+*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+  ((SH_RICK_PRECISION == 16)||(SH_RICK_PRECISION == 8)) && !defined(RICK_NO_SIMD)
+#define RICK_USE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/* 
+
+   OpenMP parallel latitude loops, each thread gets its own part of
+   the work space in rick_module
+
+*/
+#ifdef _OPENMP
+#include <omp.h>
+#define RICK_THREAD_WS(rick) ((rick)->thread_work + omp_get_thread_num() * (rick)->thread_work_n)
+#else
+#define RICK_THREAD_WS(rick) ((rick)->thread_work)
+#endif
+
+/* 
+
+   rick_plmbar1 uses extended exponent numbers for P(l,m), m > 0,
+   above this lmax, RICK_XNUM_IND is the exponent of the scaling
+   factor 2^RICK_XNUM_IND, and RICK_XNUM2F converts x * 2^(ix
+   RICK_XNUM_IND) to a regular number for ix <= 0
+
+*/
+#define RICK_PLM_XNUM_LMAX 511
+#define RICK_XNUM_IND 960
+#define RICK_XNUM2F(x,ix,bigi) (((ix) == 0)?(x):(((ix) == -1)?((x)*(bigi)):(0.0)))
+/* 
+
+   Gauss-Legendre points up to this n are computed with Newton
+   iterations, above with asymptotic expansions
+
+*/
+#define RICK_GAULEG_NEWTON_MAX 100
+/* process-wide cache of Gauss points, one for each nlat */
+struct rick_gauss_grid{
+  int nlat;
+  SH_RICK_HIGH_PREC *z,*w,*theta;
+  struct rick_gauss_grid *next;
+};
+/* 
+
+   read-only tables which are shared between all rick_module
+   structures with the same lmax, Gauss or regular grid, and at least
+   the same ivec. reference counted, see rick_get_tables
+
+*/
+struct rick_tables{
+  int lmax,ivec,nref;
+  my_boolean regular;
+  /* Gauss points, only for regular = FALSE, at higher precision */
+  SH_RICK_HIGH_PREC *gauss_z,*gauss_w,*gauss_theta;
+  /* recursion factors for rick_plmbar1, at higher precision */
+  SH_RICK_HIGH_PREC *plm_f1,*plm_f2,*plm_fac1,*plm_fac2,*plm_srt;
+  /* vector harmonics factors, for ivec = 1 */
+  SH_RICK_PREC *sin_theta,*ell_factor;
+  struct rick_tables *next;
+};
+/* 
+   full Plm and dPlm arrays at the Gauss latitudes as from
+   rick_compute_allplm, shared and reference counted the same way
+*/
+struct rick_plm_table{
+  int lmax,ivec,nref;
+  SH_RICK_PREC *plm;
+  /* if mapped from the on-disk cache, else NULL */
+  void *map;
+  size_t map_size;
+  struct rick_plm_table *next;
+};
+/* 
+
+   irregular output locations, grouped by colatitude such that the
+   Legendre functions only need to be evaluated once for each unique
+   theta. see rick_init_point_set
+
+*/
+struct rick_point_set{
+  int npoints;			/* number of points */
+  int ntheta;			/* number of unique colatitudes */
+  SH_RICK_PREC *theta;		/* unique colatitudes, ascending */
+  int *start;			/* points of theta[i] are order[start[i]..start[i+1]-1] */
+  int *order;			/* index of the points in the caller's arrays */
+  SH_RICK_PREC *phi;		/* longitudes, sorted the same as order */
+};
+/* for sorting */
+struct rick_point_sort{
+  SH_RICK_PREC theta;
+  int index;
+};
+/* 
+   on-disk cache of Plm tables, see rick_cache_c.c 
+*/
+#define RICK_PLM_CACHE_ENV "HC_PLM_CACHE" /* environment variable with the directory */
+#define RICK_PLM_CACHE_MAGIC "HCRKPLM"
+#define RICK_PLM_CACHE_VERSION 1
+#define RICK_PLM_CACHE_HDR 128	/* header bytes, keeps data aligned */
+#define RICK_PLM_CACHE_CHECKSUM_INIT 14695981039346656037ULL
+struct rick_plm_cache_header{
+  char magic[8];
+  int version,byte_order,prec,lmax,ivec,nlat,nplm;
+  long long ndata;		/* number of values after the header */
+  unsigned long long checksum;
+};
+
+#define RICK_KERNEL_GENERIC 0
+#define RICK_KERNEL_AVX2 1
+#define RICK_KERNEL_AVX512 2
+
+struct rick_kernels{
+  int type;
+  void (*dot2)(SH_RICK_PREC *,SH_RICK_PREC *,SH_RICK_PREC *,
+	       int,SH_RICK_PREC *);
+  void (*dot8)(SH_RICK_PREC *,SH_RICK_PREC *,SH_RICK_PREC *,
+	       SH_RICK_PREC *,SH_RICK_PREC *,SH_RICK_PREC *,
+	       int,SH_RICK_PREC *);
+  void (*dot10)(SH_RICK_PREC *,SH_RICK_PREC *,SH_RICK_PREC *,
+		SH_RICK_PREC *,SH_RICK_PREC *,SH_RICK_PREC *,
+		SH_RICK_PREC *,SH_RICK_PREC *,int,SH_RICK_PREC *);
+  void (*axpy2)(SH_RICK_PREC *,int,SH_RICK_HIGH_PREC *,
+		SH_RICK_HIGH_PREC *,SH_RICK_HIGH_PREC *);
+  void (*axpy8)(SH_RICK_PREC *,SH_RICK_PREC *,int,SH_RICK_HIGH_PREC *,
+		SH_RICK_HIGH_PREC *,SH_RICK_HIGH_PREC *,SH_RICK_HIGH_PREC *,
+		SH_RICK_HIGH_PREC *);
+};
 #ifndef FALSE
 #define FALSE 0
 #endif
@@ -74,7 +220,10 @@ struct rick_module{
   // read the defines for single/double precision
   // other stuff needed by more than one subroutine
   // Gauss points: cos(theta), weights, and actual theta
-  SH_RICK_PREC  *gauss_z, *gauss_w, *gauss_theta;
+  // (this and the Legendre and vector factors below point into tables)
+  // those are kept at higher precision, so that the single precision
+  // build evaluates the Legendre functions at the exact nodes
+  SH_RICK_HIGH_PREC  *gauss_z, *gauss_w, *gauss_theta;
   //
   //
   SH_RICK_PREC *cfac,*sfac;
@@ -83,11 +232,29 @@ struct rick_module{
   // those are for Legendre polynomials (fac1  fac2 only for ivec=1)
   // make those double precision
   //
-  SH_RICK_PREC  *plm_f1,*plm_f2,*plm_fac1,*plm_fac2,*plm_srt;
+  SH_RICK_HIGH_PREC  *plm_f1,*plm_f2,*plm_fac1,*plm_fac2,*plm_srt;
   // this is for vector harmonics, only for ivec=1
   SH_RICK_PREC  *sin_theta,*ell_factor;
   // spacing in longitudes
   SH_RICK_PREC dphi;
+  // the shared tables the above pointers point into
+  struct rick_tables *tables;
+  // m-major coefficient work space, (2+4*ivec)*lmsize, allocated
+  // with the thread work space
+  SH_RICK_PREC *mm_work;
+  // summation kernels
+  struct rick_kernels *kern;
+  // per-thread work space, nthread_work blocks of thread_work_n,
+  // each holding valuex, valuey (nlon+2) and plm, dplm (lmsize)
+  SH_RICK_PREC *thread_work;
+  int thread_work_n,nthread_work;
+  // Fourier coefficients of all latitudes for the analysis
+  SH_RICK_PREC *spec_work;
+  int spec_work_n;
+  // m-major accumulators of the Gauss integration in the analysis,
+  // (2+2*ivec)*lmsize, at higher precision
+  SH_RICK_HIGH_PREC *acc_work;
+  int acc_work_n;
   // int (bounds and such)
   int nlat,nlon,lmsize,lmsize2,nlonm1;
   // logic flags